@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 #include <cubos/core/log.hpp>
 
 namespace cubos::core::ecs
@@ -47,7 +49,9 @@ namespace cubos::core::ecs
     /// @brief System argument which provides write access to the resource @p T, or query argument
     /// which provides write access to the component @p T.
     ///
-    /// Can be used as a pointer with both the `->` and `*` operators.
+    /// Can be used as a pointer with both the `->` and `*` operators. Accessing a component
+    /// through it marks the component as changed, for the purposes of @ref Changed, unless it's
+    /// accessed through a const reference to the argument.
     ///
     /// @tparam T Resource or component type.
     /// @ingroup core-ecs
@@ -62,22 +66,60 @@ namespace cubos::core::ecs
         {
         }
 
+        /// @brief Creates a new write argument which marks the component as changed when accessed.
+        /// @param ref Reference to the component.
+        /// @param changed Tick at which the component was last changed.
+        /// @param tick Current tick.
+        inline Write(T& ref, uint32_t& changed, uint32_t tick)
+            : mRef(ref)
+            , mChanged(&changed)
+            , mTick(tick)
+        {
+        }
+
         /// @brief Accesses the resource or component.
         /// @return Pointer to the resource or component.
         inline T* operator->()
         {
+            this->markChanged();
             return &mRef;
         }
 
         /// @brief Accesses the resource or component.
         /// @return Reference to the resource or component.
         inline T& operator*()
+        {
+            this->markChanged();
+            return mRef;
+        }
+
+        /// @brief Accesses the resource or component without marking it as changed.
+        /// @return Pointer to the resource or component.
+        inline const T* operator->() const
+        {
+            return &mRef;
+        }
+
+        /// @brief Accesses the resource or component without marking it as changed.
+        /// @return Reference to the resource or component.
+        inline const T& operator*() const
         {
             return mRef;
         }
 
     private:
-        T& mRef; ///< Reference to the resource or component.
+        T& mRef;                      ///< Reference to the resource or component.
+        uint32_t* mChanged = nullptr; ///< Tick at which the component was last changed, if tracked.
+        uint32_t mTick = 0;           ///< Current tick.
+
+        /// @brief Marks the component as changed, if its changes are tracked.
+        inline void markChanged()
+        {
+            if (mChanged != nullptr)
+            {
+                *mChanged = mTick;
+            }
+        }
     };
 
     /// @brief System argument which provides read access to the resource @p T if it exists, or
@@ -136,7 +178,9 @@ namespace cubos::core::ecs
     /// query argument which provides write access to the component @p T if it exists.
     ///
     /// While the @ref Write demands that the resource or component exists, this argument does not.
-    /// Can be used as a pointer with both the `->` and `*` operators.
+    /// Can be used as a pointer with both the `->` and `*` operators. Accessing a component
+    /// through it marks the component as changed, for the purposes of @ref Changed, unless it's
+    /// accessed through a const reference to the argument.
     ///
     /// @tparam T Resource or component type.
     /// @ingroup core-ecs
@@ -152,6 +196,18 @@ namespace cubos::core::ecs
         {
         }
 
+        /// @brief Creates a new optional write argument which marks the component as changed when
+        /// accessed.
+        /// @param ptr Pointer to the component.
+        /// @param changed Tick at which the component was last changed.
+        /// @param tick Current tick.
+        inline OptWrite(T* ptr, uint32_t& changed, uint32_t tick)
+            : mPtr(ptr)
+            , mChanged(&changed)
+            , mTick(tick)
+        {
+        }
+
         /// @brief Accesses the resource or component, aborting if it does not exist.
         /// @return Reference to the resource or component.
         inline T* operator->()
@@ -166,6 +222,24 @@ namespace cubos::core::ecs
             return this->get();
         }
 
+        /// @brief Accesses the resource or component without marking it as changed, aborting if
+        /// it does not exist.
+        /// @return Pointer to the resource or component.
+        inline const T* operator->() const
+        {
+            CUBOS_ASSERT(mPtr != nullptr, "Attempted to access a null optional resource or component");
+            return mPtr;
+        }
+
+        /// @brief Accesses the resource or component without marking it as changed, aborting if
+        /// it does not exist.
+        /// @return Reference to the resource or component.
+        inline const T& operator*() const
+        {
+            CUBOS_ASSERT(mPtr != nullptr, "Attempted to access a null optional resource or component");
+            return *mPtr;
+        }
+
         /// @brief Checks if the resource or component exists.
         /// @return Whether the resource or component exists.
         inline operator bool() const
@@ -174,14 +248,51 @@ namespace cubos::core::ecs
         }
 
     private:
-        T* mPtr; ///< Pointer to the resource or component.
+        T* mPtr;                      ///< Pointer to the resource or component.
+        uint32_t* mChanged = nullptr; ///< Tick at which the component was last changed, if tracked.
+        uint32_t mTick = 0;           ///< Current tick.
 
         /// @brief Accesses the resource or component, aborting if it does not exist.
         /// @return Reference to the resource or component.
         inline T& get()
         {
             CUBOS_ASSERT(mPtr != nullptr, "Attempted to access a null optional resource or component");
+            if (mChanged != nullptr)
+            {
+                *mChanged = mTick;
+            }
             return *mPtr;
         }
     };
+
+    /// @brief Query argument which provides read access to the component @p T, and which only
+    /// matches entities whose @p T component has changed since the query last ran.
+    ///
+    /// A component is considered changed when it's added, or when it's accessed through a
+    /// @ref Write or @ref OptWrite argument. The first time a query runs, all components are
+    /// considered changed. Can be used as a pointer with both the `->` and `*` operators.
+    ///
+    /// @tparam T Component type.
+    /// @ingroup core-ecs
+    template <typename T>
+    class Changed : public Read<T>
+    {
+    public:
+        using Read<T>::Read;
+    };
+
+    /// @brief Query argument which provides read access to the component @p T, and which only
+    /// matches entities whose @p T component has been added since the query last ran.
+    ///
+    /// The first time a query runs, all components are considered added. Can be used as a pointer
+    /// with both the `->` and `*` operators.
+    ///
+    /// @tparam T Component type.
+    /// @ingroup core-ecs
+    template <typename T>
+    class Added : public Read<T>
+    {
+    public:
+        using Read<T>::Read;
+    };
 } // namespace cubos::core::ecs
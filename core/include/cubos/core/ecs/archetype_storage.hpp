@@ -0,0 +1,140 @@
+/// @file
+/// @brief Class @ref cubos::core::ecs::ArchetypeStorage.
+/// @ingroup core-ecs
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include <cubos/core/ecs/storage.hpp>
+
+namespace cubos::core::ecs
+{
+    /// @brief Storage implementation which keeps components in the archetypes of their entities.
+    ///
+    /// Each archetype with the component owns a column where the components of its entities are
+    /// packed in the same order as the entities themselves, so queries which iterate over
+    /// archetypes read them sequentially. The entity manager moves components between columns
+    /// when entities change archetypes, which makes adding and removing components slower than
+    /// on other storages.
+    ///
+    /// Values can only be inserted for entities whose mask already has the component, and erasing
+    /// does nothing, as removing the component from the mask already destroys it. Must be
+    /// registered in a world before being used.
+    ///
+    /// @tparam T Component type.
+    /// @ingroup core-ecs
+    template <typename T>
+    class ArchetypeStorage : public Storage<T>
+    {
+    public:
+        /// @brief Column of components of type @p T.
+        class Column : public IColumn
+        {
+        public:
+            std::unique_ptr<IColumn> empty() const override;
+            void pushDefault() override;
+            void moveFrom(IColumn& other, std::size_t from, std::size_t to) override;
+            void swapRemove(std::size_t row) override;
+            void clear() override;
+            void* data() override;
+
+            std::vector<T> values; ///< Components, one per row.
+        };
+
+        T* insert(uint32_t index, T value) override;
+        T* get(uint32_t index) override;
+        const T* get(uint32_t index) const override;
+        void erase(uint32_t index) override;
+        std::unique_ptr<IColumn> attach(const EntityManager& entities, std::size_t componentId) override;
+
+    private:
+        const EntityManager* mEntities = nullptr; ///< Entity manager which owns the columns.
+        std::size_t mId = 0;                      ///< Identifier of the component type.
+    };
+
+    template <typename T>
+    std::unique_ptr<IColumn> ArchetypeStorage<T>::Column::empty() const
+    {
+        return std::make_unique<Column>();
+    }
+
+    template <typename T>
+    void ArchetypeStorage<T>::Column::pushDefault()
+    {
+        this->values.emplace_back();
+    }
+
+    template <typename T>
+    void ArchetypeStorage<T>::Column::moveFrom(IColumn& other, std::size_t from, std::size_t to)
+    {
+        this->values[to].~T();
+        new (&this->values[to]) T(std::move(static_cast<Column&>(other).values[from]));
+    }
+
+    template <typename T>
+    void ArchetypeStorage<T>::Column::swapRemove(std::size_t row)
+    {
+        if (row + 1 != this->values.size())
+        {
+            this->values[row].~T();
+            new (&this->values[row]) T(std::move(this->values.back()));
+        }
+
+        this->values.pop_back();
+    }
+
+    template <typename T>
+    void ArchetypeStorage<T>::Column::clear()
+    {
+        this->values.clear();
+    }
+
+    template <typename T>
+    void* ArchetypeStorage<T>::Column::data()
+    {
+        return this->values.data();
+    }
+
+    template <typename T>
+    T* ArchetypeStorage<T>::insert(uint32_t index, T value)
+    {
+        T* component = this->get(index);
+        if (component != nullptr)
+        {
+            component->~T();
+            new (component) T(std::move(value));
+        }
+
+        return component;
+    }
+
+    template <typename T>
+    T* ArchetypeStorage<T>::get(uint32_t index)
+    {
+        auto* column = static_cast<Column*>(mEntities->column(index, mId));
+        return column == nullptr ? nullptr : &column->values[mEntities->row(index)];
+    }
+
+    template <typename T>
+    const T* ArchetypeStorage<T>::get(uint32_t index) const
+    {
+        const auto* column = static_cast<const Column*>(mEntities->column(index, mId));
+        return column == nullptr ? nullptr : &column->values[mEntities->row(index)];
+    }
+
+    template <typename T>
+    void ArchetypeStorage<T>::erase(uint32_t /*index*/)
+    {
+        // Do nothing: the component is destroyed when it is removed from the entity's mask.
+    }
+
+    template <typename T>
+    std::unique_ptr<IColumn> ArchetypeStorage<T>::attach(const EntityManager& entities, std::size_t componentId)
+    {
+        mEntities = &entities;
+        mId = componentId;
+        return std::make_unique<Column>();
+    }
+} // namespace cubos::core::ecs
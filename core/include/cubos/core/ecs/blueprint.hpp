@@ -4,6 +4,10 @@
 
 #pragma once
 
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
 #include <cubos/core/data/old/binary_deserializer.hpp>
 #include <cubos/core/data/old/binary_serializer.hpp>
 #include <cubos/core/data/old/serialization_map.hpp>
@@ -47,6 +51,10 @@ namespace cubos::core::ecs
         /// @param deserializer Ddeserializer to deserialize from.
         bool addFromDeserializer(Entity entity, const std::string& name, data::old::Deserializer& deserializer);
 
+        /// @brief Returns the number of entities in the blueprint.
+        /// @return Number of entities.
+        std::size_t size() const;
+
         /// @brief Returns an entity from its name.
         /// @param name Entity name.
         /// @return Entity identifier, or null entity if not found.
@@ -73,19 +81,38 @@ namespace cubos::core::ecs
         friend class CommandBuffer;
 
         /// @brief Stores all component data of a certain type.
+        ///
+        /// Components are stored serialized, and compiled lazily into prototypes the first time
+        /// the blueprint is spawned after being modified. Prototypes of components which don't
+        /// reference entities are spawned by copying them, which is much faster than
+        /// deserializing them again for every instance.
         struct IBuffer
         {
             /// @brief Names of the entities of the components present in the stream, in the same order.
             std::vector<std::string> names;
             memory::BufferStream stream; ///< Self growing buffer stream where the component data is stored.
-            std::mutex mutex;            ///< Protect the stream.
+            std::mutex mutex;            ///< Protect the stream and the prototypes.
+            bool compiled = false;       ///< Whether the prototypes are up to date with the stream.
+
+            /// @brief Indices on the blueprint of the entities of each component. Only valid after
+            /// the buffer is compiled.
+            std::vector<uint32_t> indices;
 
             virtual ~IBuffer() = default;
 
-            /// @brief Adds all of the components stored in the buffer to the specified commands object.
+            /// @brief Adds the components stored in the buffer to multiple instances of the
+            /// blueprint.
+            ///
+            /// The entities of each instance must be stored contiguously, in the same order as in
+            /// the blueprint.
+            ///
             /// @param commands Commands object to add the components to.
-            /// @param context Context to use when deserializing the components.
-            virtual void addAll(CommandBuffer& commands, data::old::Context& context) = 0;
+            /// @param map Map of the entities of the blueprint.
+            /// @param entities Entities of the instances.
+            /// @param count Number of instances.
+            virtual void instantiate(CommandBuffer& commands,
+                                     const data::old::SerializationMap<Entity, std::string>& map,
+                                     const std::vector<Entity>& entities, std::size_t count) = 0;
 
             /// @brief Merges the data of another buffer of the same type into this one.
             /// @param other Buffer to merge from.
@@ -105,25 +132,27 @@ namespace cubos::core::ecs
         template <typename ComponentType>
         struct Buffer : IBuffer
         {
-            // Interface methods implementation.
-
-            inline void addAll(CommandBuffer& commands, data::old::Context& context) override
+            /// @brief Compiled components, in the same order as the stream. Empty if the
+            /// components reference entities, and thus must be deserialized for each instance.
+            std::vector<ComponentType> prototypes;
+
+            /// @brief Deserializes every component in the stream.
+            /// @param map Map of entity names to the entities they should be deserialized as.
+            /// @param components Vector to store the components in.
+            inline void read(data::old::SerializationMap<Entity, std::string> map,
+                             std::vector<ComponentType>& components)
             {
-                this->mutex.lock();
                 auto pos = this->stream.tell();
                 this->stream.seek(0, memory::SeekOrigin::Begin);
                 auto des = data::old::BinaryDeserializer(this->stream);
-                des.context().pushSubContext(context);
+                des.context().push(std::move(map));
 
-                auto& map = des.context().get<data::old::SerializationMap<Entity, std::string>>();
-                for (const auto& name : this->names)
+                components.resize(this->names.size());
+                for (auto& component : components)
                 {
-                    ComponentType type;
-                    des.read(type);
-                    commands.add(map.getRef(name), std::move(type));
+                    des.read(component);
                 }
                 this->stream.seek(static_cast<ptrdiff_t>(pos), memory::SeekOrigin::Begin);
-                this->mutex.unlock();
 
                 if (des.failed())
                 {
@@ -132,6 +161,103 @@ namespace cubos::core::ecs
                 }
             }
 
+            /// @brief Compiles the prototypes, if they're not up to date.
+            /// @param map Map of the entities of the blueprint.
+            inline void compile(const data::old::SerializationMap<Entity, std::string>& map)
+            {
+                if (this->compiled)
+                {
+                    return;
+                }
+
+                this->compiled = true;
+                this->indices.clear();
+                this->prototypes.clear();
+                for (const auto& name : this->names)
+                {
+                    this->indices.push_back(map.getRef(name).index);
+                }
+
+                if constexpr (std::is_copy_constructible_v<ComponentType>)
+                {
+                    // Deserialize the components twice, with entity references resolving to
+                    // different generations. If the results differ when serialized with raw entity
+                    // identifiers, the components reference entities, which would have to be
+                    // remapped on each instance.
+                    data::old::SerializationMap<Entity, std::string> shiftedMap;
+                    for (uint32_t i = 0; i < static_cast<uint32_t>(map.size()); ++i)
+                    {
+                        shiftedMap.add(Entity(i, 1), map.getId(Entity(i, 0)));
+                    }
+
+                    std::vector<ComponentType> shifted;
+                    this->read(map, this->prototypes);
+                    this->read(std::move(shiftedMap), shifted);
+
+                    memory::BufferStream original{};
+                    memory::BufferStream remapped{};
+                    auto originalSer = data::old::BinarySerializer(original);
+                    auto remappedSer = data::old::BinarySerializer(remapped);
+                    for (std::size_t i = 0; i < this->prototypes.size(); ++i)
+                    {
+                        originalSer.write(this->prototypes[i], "data");
+                        remappedSer.write(shifted[i], "data");
+                    }
+
+                    if (original.tell() != remapped.tell() ||
+                        std::memcmp(original.getBuffer(), remapped.getBuffer(), original.tell()) != 0)
+                    {
+                        this->prototypes.clear();
+                    }
+                }
+            }
+
+            // Interface methods implementation.
+
+            inline void instantiate(CommandBuffer& commands,
+                                    const data::old::SerializationMap<Entity, std::string>& map,
+                                    const std::vector<Entity>& entities, std::size_t count) override
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                this->compile(map);
+
+                auto& components = commands.arena().buffer<ComponentType>().components;
+                if constexpr (std::is_copy_constructible_v<ComponentType>)
+                {
+                    if (!this->prototypes.empty() || this->names.empty())
+                    {
+                        for (std::size_t i = 0; i < count; ++i)
+                        {
+                            const Entity* instance = entities.data() + i * map.size();
+                            for (std::size_t j = 0; j < this->prototypes.size(); ++j)
+                            {
+                                components.emplace_back(instance[this->indices[j]], this->prototypes[j]);
+                            }
+                        }
+                        return;
+                    }
+                }
+
+                // The components reference entities, so they must be deserialized for each
+                // instance, with the references resolving to the entities of the instance.
+                std::vector<ComponentType> deserialized;
+                for (std::size_t i = 0; i < count; ++i)
+                {
+                    const Entity* instance = entities.data() + i * map.size();
+                    data::old::SerializationMap<Entity, std::string> instanceMap;
+                    for (uint32_t j = 0; j < static_cast<uint32_t>(map.size()); ++j)
+                    {
+                        instanceMap.add(instance[j], map.getId(Entity(j, 0)));
+                    }
+
+                    this->read(std::move(instanceMap), deserialized);
+                    for (std::size_t j = 0; j < deserialized.size(); ++j)
+                    {
+                        components.emplace_back(instance[this->indices[j]], std::move(deserialized[j]));
+                    }
+                }
+            }
+
             inline void merge(IBuffer* other, const std::string& prefix, data::old::Context& src,
                               data::old::Context& dst) override
             {
@@ -156,6 +282,7 @@ namespace cubos::core::ecs
                 }
                 buffer->stream.seek(static_cast<ptrdiff_t>(pos), memory::SeekOrigin::Begin);
                 buffer->mutex.unlock();
+                this->compiled = false;
             }
 
             inline IBuffer* create() override
@@ -206,6 +333,7 @@ namespace cubos::core::ecs
                 ser.context().push(mMap);
                 ser.write(components, "data");
                 buf->names.push_back(mMap.getId(entity));
+                buf->compiled = false;
             }(),
 
             ...);
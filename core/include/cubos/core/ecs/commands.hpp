@@ -4,9 +4,12 @@
 
 #pragma once
 
+#include <deque>
+#include <memory>
 #include <mutex>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
+#include <vector>
 
 #include <cubos/core/ecs/world.hpp>
 
@@ -144,11 +147,27 @@ namespace cubos::core::ecs
         /// @return Blueprint builder.
         BlueprintBuilder spawn(const Blueprint& blueprint);
 
+        /// @brief Spawns multiple instances of a blueprint into the world.
+        /// @see CommandBuffer::spawnMany
+        /// @param blueprint Blueprint to spawn.
+        /// @param count Number of instances.
+        /// @return Spawned entities.
+        std::vector<Entity> spawnMany(const Blueprint& blueprint, std::size_t count);
+
     private:
         CommandBuffer& mBuffer; ///< Command buffer to write to.
     };
 
     /// @brief Stores commands to execute them later.
+    ///
+    /// Each thread records its commands into an arena of its own, so that multiple threads can
+    /// record commands at the same time without contending on a lock. Only creating entities and
+    /// the first command of a thread on a buffer lock a mutex. Arenas are keyed by the sequence set
+    /// with @ref setSequence() on the recording thread, which the @ref Dispatcher sets to the
+    /// position of the running system in its call chain. On @ref commit(), arenas are merged in
+    /// sequence order, so the result doesn't depend on which thread ran each system, and the
+    /// commands of each arena are applied in the order they were recorded.
+    ///
     /// @ingroup core-ecs
     class CommandBuffer final
     {
@@ -187,6 +206,49 @@ namespace cubos::core::ecs
         /// @return Blueprint builder.
         BlueprintBuilder spawn(const Blueprint& blueprint);
 
+        /// @brief Spawns multiple instances of a blueprint into the world.
+        ///
+        /// Much faster than calling @ref spawn() repeatedly, as all entities are created at once,
+        /// and no builders are created. The entity with index `i` on the blueprint is spawned on
+        /// instance `n` as the entity at index `n * blueprint.size() + i` of the returned vector.
+        ///
+        /// @param blueprint Blueprint to spawn.
+        /// @param count Number of instances.
+        /// @return Spawned entities.
+        std::vector<Entity> spawnMany(const Blueprint& blueprint, std::size_t count);
+
+        /// @brief Sets the sequence key of the commands recorded by the calling thread from now on.
+        ///
+        /// Work split across threads should key the commands of each part by its index, so that
+        /// they are committed in the same order no matter which thread recorded them first.
+        ///
+        /// @param sequence Sequence key.
+        static void setSequence(std::size_t sequence);
+
+        /// @brief Gets the sequence key of the commands recorded by the calling thread.
+        /// @return Sequence key.
+        static std::size_t sequence();
+
+        /// @brief Sets the sequence key of the calling thread while in scope, and restores the
+        /// previous one when destroyed.
+        ///
+        /// Threads waiting on a @ref ThreadPool run other tasks meanwhile, which may set their
+        /// own sequence keys, so whoever sets a key must restore the one it replaced.
+        class SequenceGuard final
+        {
+        public:
+            /// @brief Constructs.
+            /// @param sequence Sequence key to set.
+            SequenceGuard(std::size_t sequence);
+            ~SequenceGuard();
+
+            SequenceGuard(const SequenceGuard&) = delete;
+            SequenceGuard& operator=(const SequenceGuard&) = delete;
+
+        private:
+            std::size_t mPrevious; ///< Sequence key to restore.
+        };
+
         /// @brief Aborts the commands, rolling back any changes made.
         void abort();
 
@@ -196,6 +258,7 @@ namespace cubos::core::ecs
     private:
         friend EntityBuilder;
         friend BlueprintBuilder;
+        friend Blueprint;
         friend Dispatcher;
 
         /// @brief Stores components of a specific type, queued for addition to the component
@@ -207,11 +270,10 @@ namespace cubos::core::ecs
             /// @brief Clears every component in the buffer.
             virtual void clear() = 0;
 
-            /// @brief Moves the specified component from the buffer to the component manager. If
-            /// the component doesn't exist, nothing happens.
-            /// @param entity Entity identifier.
+            /// @brief Moves every component in the buffer to the component manager, in the order
+            /// they were added.
             /// @param manager Component manager.
-            virtual void move(Entity entity, ComponentManager& manager) = 0;
+            virtual void moveAll(ComponentManager& manager) = 0;
         };
 
         /// @brief Implementation of the above interface for a component type
@@ -223,23 +285,57 @@ namespace cubos::core::ecs
             // Interface methods implementation.
 
             void clear() override;
-            void move(Entity entity, ComponentManager& manager) override;
+            void moveAll(ComponentManager& manager) override;
+
+            /// @brief Finds the last component added to the given entity.
+            /// @param entity Entity identifier.
+            /// @return Component, or null if there's none.
+            ComponentType* find(Entity entity);
+
+            /// @brief Components in the buffer, in the order they were added. A deque is used so
+            /// that references returned by the builders stay valid as more components are added.
+            std::deque<std::pair<Entity, ComponentType>> components;
+        };
 
-            std::unordered_map<Entity, ComponentType> components; ///< Components in the buffer.
+        /// @brief Commands recorded by a single thread with a single sequence key.
+        struct Arena
+        {
+            std::size_t sequence;   ///< Sequence key, which determines the order in which arenas are merged.
+            std::thread::id thread; ///< Thread which records to this arena.
+            std::unordered_map<std::type_index, std::unique_ptr<IBuffer>> buffers; ///< Component buffers per type.
+            std::vector<Entity> created;                                           ///< Uncommitted created entities.
+            std::vector<Entity> destroyed;                                         ///< Uncommitted destroyed entities.
+            std::vector<std::pair<Entity, Entity::Mask>> added;   ///< Masks of uncommitted added components.
+            std::vector<std::pair<Entity, Entity::Mask>> removed; ///< Masks of uncommitted removed components.
+
+            /// @brief Gets the buffer for the given component type, creating it if necessary.
+            /// @tparam ComponentType Component type.
+            /// @return Component buffer.
+            template <typename ComponentType>
+            Buffer<ComponentType>& buffer();
+
+            /// @brief Clears the commands, keeping the allocated memory.
+            void clear();
         };
 
+        /// @brief Gets the arena of the calling thread for its current sequence key, creating it if
+        /// necessary.
+        ///
+        /// Doesn't lock unless the thread is recording to this buffer with a new key.
+        ///
+        /// @return Arena of the calling thread.
+        Arena& arena();
+
         /// @brief Clears the commands.
         void clear();
 
-        std::mutex mMutex; ///< Make this thread-safe.
+        std::mutex mMutex; ///< Protects the arena list and entity creation.
         World& mWorld;     ///< World to which the commands will be applied.
+        std::size_t mId;   ///< Unique identifier, used to find the arenas of each thread.
 
-        std::unordered_map<std::type_index, IBuffer*> mBuffers; ///< Component buffers per component type.
-        std::unordered_set<Entity> mCreated;                    ///< Uncommitted created entities.
-        std::unordered_set<Entity> mDestroyed;                  ///< Uncommitted destroyed entities.
-        std::unordered_map<Entity, Entity::Mask> mAdded;        ///< Mask of the uncommitted added components.
-        std::unordered_map<Entity, Entity::Mask> mRemoved;      ///< Mask of the uncommitted removed components.
-        std::unordered_set<Entity> mChanged;                    ///< Entities whose mask has changed.
+        /// @brief Arenas of the threads which recorded commands, sorted by sequence key. Arenas with
+        /// the same key are kept in the order they were created.
+        std::vector<std::unique_ptr<Arena>> mArenas;
     };
 
     // Implementation.
@@ -247,15 +343,9 @@ namespace cubos::core::ecs
     template <typename ComponentType>
     ComponentType& EntityBuilder::get()
     {
-        auto it = mCommands.mBuffers.find(typeid(ComponentType));
-        if (it != mCommands.mBuffers.end())
+        if (auto* component = mCommands.arena().buffer<ComponentType>().find(mEntity))
         {
-            auto buf = static_cast<CommandBuffer::Buffer<ComponentType>*>(it->second);
-            auto it = buf->components.find(mEntity);
-            if (it != buf->components.end())
-            {
-                return it->second;
-            }
+            return *component;
         }
 
         CUBOS_CRITICAL("Entity does not have the requested component");
@@ -272,15 +362,9 @@ namespace cubos::core::ecs
     template <typename ComponentType>
     ComponentType& BlueprintBuilder::get(const std::string& name)
     {
-        auto it = mCommands.mBuffers.find(typeid(ComponentType));
-        if (it != mCommands.mBuffers.end())
+        if (auto* component = mCommands.arena().buffer<ComponentType>().find(this->entity(name)))
         {
-            auto buf = static_cast<CommandBuffer::Buffer<ComponentType>*>(it->second);
-            auto it = buf->components.find(this->entity(name));
-            if (it != buf->components.end())
-            {
-                return it->second;
-            }
+            return *component;
         }
 
         CUBOS_CRITICAL("Entity does not have the requested component");
@@ -315,32 +399,23 @@ namespace cubos::core::ecs
     template <typename... ComponentTypes>
     void CommandBuffer::add(Entity entity, ComponentTypes&&... components)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        Entity::Mask& mask = mAdded[entity];
-        mChanged.insert(entity);
+        Arena& arena = this->arena();
+        Entity::Mask mask{};
 
         (
             [&]() {
-                auto it = mBuffers.find(typeid(ComponentTypes));
-                if (it == mBuffers.end())
-                {
-                    it = mBuffers.emplace(typeid(ComponentTypes), new Buffer<ComponentTypes>()).first;
-                }
-
-                std::size_t componentID = mWorld.mComponentManager.getID<ComponentTypes>();
-                mask.set(componentID);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.erase(entity);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.emplace(entity, std::move(components));
+                mask.set(mWorld.mComponentManager.getID<ComponentTypes>());
+                arena.buffer<ComponentTypes>().components.emplace_back(entity, std::move(components));
             }(),
             ...);
+
+        arena.added.emplace_back(entity, mask);
     }
 
     template <typename... ComponentTypes>
     void CommandBuffer::remove(Entity entity)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-        Entity::Mask& mask = mRemoved[entity];
-        mChanged.insert(entity);
+        Entity::Mask mask{};
 
         (
             [&]() {
@@ -348,34 +423,35 @@ namespace cubos::core::ecs
                 mask.set(componentID);
             }(),
             ...);
+
+        this->arena().removed.emplace_back(entity, mask);
     }
 
     template <typename... ComponentTypes>
     EntityBuilder CommandBuffer::create(ComponentTypes&&... components)
     {
-        std::lock_guard<std::mutex> lock(mMutex);
-
-        Entity entity = mWorld.mEntityManager.create(0);
-        mCreated.insert(entity);
-        mChanged.insert(entity);
-        Entity::Mask& mask = mAdded[entity];
+        Entity entity;
+        {
+            // The entity manager is shared by all threads, so this is the only command which locks.
+            std::lock_guard<std::mutex> lock(mMutex);
+            entity = mWorld.mEntityManager.create(0);
+        }
 
-        (
-            [&]() {
-                auto it = mBuffers.find(typeid(ComponentTypes));
-                if (it == mBuffers.end())
-                {
-                    it = mBuffers.emplace(typeid(ComponentTypes), new Buffer<ComponentTypes>()).first;
-                }
+        this->arena().created.push_back(entity);
+        this->add(entity, std::move(components)...);
+        return {entity, *this};
+    }
 
-                std::size_t componentID = mWorld.mComponentManager.getID<ComponentTypes>();
-                mask.set(componentID);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.erase(entity);
-                static_cast<Buffer<ComponentTypes>*>(it->second)->components.emplace(entity, components);
-            }(),
-            ...);
+    template <typename ComponentType>
+    CommandBuffer::Buffer<ComponentType>& CommandBuffer::Arena::buffer()
+    {
+        auto& buf = this->buffers[typeid(ComponentType)];
+        if (buf == nullptr)
+        {
+            buf = std::make_unique<Buffer<ComponentType>>();
+        }
 
-        return {entity, *this};
+        return static_cast<Buffer<ComponentType>&>(*buf);
     }
 
     template <typename ComponentType>
@@ -385,13 +461,28 @@ namespace cubos::core::ecs
     }
 
     template <typename ComponentType>
-    void CommandBuffer::Buffer<ComponentType>::move(Entity entity, ComponentManager& manager)
+    void CommandBuffer::Buffer<ComponentType>::moveAll(ComponentManager& manager)
     {
-        auto it = this->components.find(entity);
-        if (it != this->components.end())
+        for (auto& [entity, component] : this->components)
         {
-            manager.add(entity.index, std::move(it->second));
-            this->components.erase(it);
+            manager.add(entity.index, std::move(component));
         }
+
+        this->components.clear();
+    }
+
+    template <typename ComponentType>
+    ComponentType* CommandBuffer::Buffer<ComponentType>::find(Entity entity)
+    {
+        // Builders usually access components they have just added, so search from the end.
+        for (auto it = this->components.rbegin(); it != this->components.rend(); ++it)
+        {
+            if (it->first == entity)
+            {
+                return &it->second;
+            }
+        }
+
+        return nullptr;
     }
 } // namespace cubos::core::ecs
@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
 #include <memory>
@@ -11,6 +12,7 @@
 #include <optional>
 #include <shared_mutex>
 #include <typeindex>
+#include <vector>
 
 #include <cubos/core/ecs/storage.hpp>
 
@@ -35,6 +37,37 @@ namespace cubos::core::ecs
     /// @ingroup core-ecs
     std::optional<std::string_view> getComponentName(std::type_index type);
 
+    /// @brief Stores when the components of a storage were added, when they last changed and when
+    /// they were last removed.
+    ///
+    /// Ticks are indexed by entity index. Added and changed ticks are only meaningful for entities
+    /// which have the component, and removed ticks for entities which don't.
+    ///
+    /// @ingroup core-ecs
+    struct ComponentTicks
+    {
+        std::vector<uint32_t> added;   ///< Tick at which each component was added.
+        std::vector<uint32_t> changed; ///< Tick at which each component last changed.
+        std::vector<uint32_t> removed; ///< Tick at which each component was last removed.
+    };
+
+    /// @brief Maximum age of the ticks compared by @ref isTickNewer(). Ticks wrap around, so they
+    /// can only be ordered while they're less than half of their range apart.
+    /// @ingroup core-ecs
+    constexpr uint32_t MaxTickAge = 1U << 30;
+
+    /// @brief Checks if a tick happened after the last run of a query, wrapping around safely.
+    /// @note Both ticks must be at most @ref MaxTickAge older than @p thisRun.
+    /// @param tick Tick to check.
+    /// @param lastRun Tick of the last run of the query.
+    /// @param thisRun Tick of the current run of the query.
+    /// @return Whether the tick is newer than the last run.
+    /// @ingroup core-ecs
+    inline bool isTickNewer(uint32_t tick, uint32_t lastRun, uint32_t thisRun)
+    {
+        return thisRun - tick < thisRun - lastRun;
+    }
+
     /// @brief Utility struct used to reference a storage of component type @p T for reading.
     /// @tparam T Component type.
     /// @ingroup core-ecs
@@ -50,15 +83,21 @@ namespace cubos::core::ecs
         /// @return Underlying storage reference.
         const Storage<T>& get() const;
 
+        /// @brief Gets the change ticks of the components in the storage.
+        /// @return Change ticks.
+        const ComponentTicks& ticks() const;
+
     private:
         friend class ComponentManager;
 
         /// @brief Constructs.
         /// @param storage  Storage to reference.
+        /// @param ticks Change ticks of the storage.
         /// @param lock Read lock to hold.
-        ReadStorage(const Storage<T>& storage, std::shared_lock<std::shared_mutex>&& lock);
+        ReadStorage(const Storage<T>& storage, const ComponentTicks& ticks, std::shared_lock<std::shared_mutex>&& lock);
 
         const Storage<T>& mStorage;
+        const ComponentTicks& mTicks;
         std::shared_lock<std::shared_mutex> mLock;
     };
 
@@ -77,15 +116,21 @@ namespace cubos::core::ecs
         /// @return Underlying storage reference.
         Storage<T>& get() const;
 
+        /// @brief Gets the change ticks of the components in the storage.
+        /// @return Change ticks.
+        ComponentTicks& ticks() const;
+
     private:
         friend class ComponentManager;
 
         /// @brief Constructs.
         /// @param storage Storage to reference.
+        /// @param ticks Change ticks of the storage.
         /// @param lock Write lock to hold.
-        WriteStorage(Storage<T>& storage, std::unique_lock<std::shared_mutex>&& lock);
+        WriteStorage(Storage<T>& storage, ComponentTicks& ticks, std::unique_lock<std::shared_mutex>&& lock);
 
         Storage<T>& mStorage;
+        ComponentTicks& mTicks;
         std::unique_lock<std::shared_mutex> mLock;
     };
 
@@ -102,15 +147,22 @@ namespace cubos::core::ecs
         /// Must be called before any component of this type is used in any way.
         ///
         /// @tparam T Type of the component.
+        /// @param entities Entity manager, where the storage may keep its components in columns.
         template <typename T>
-        void registerComponent();
+        void registerComponent(EntityManager& entities);
 
         /// @brief Registers a new component type with the component manager.
         ///
         /// Must be called before any component of this type is used in any way.
         ///
         /// @param type Type of the component.
-        void registerComponent(std::type_index type);
+        /// @param entities Entity manager, where the storage may keep its components in columns.
+        void registerComponent(std::type_index type, EntityManager& entities);
+
+        /// @brief Checks if a component type is registered.
+        /// @param type Component type.
+        /// @return Whether the type is registered.
+        bool isRegistered(std::type_index type) const;
 
         /// @brief Gets the identifier of a registered component type.
         /// @param type Component type.
@@ -159,6 +211,10 @@ namespace cubos::core::ecs
         void remove(uint32_t id, std::size_t componentId);
 
         /// @brief Removes all components from an entity.
+        ///
+        /// Unlike the other removal methods, doesn't mark the components as removed, as this is
+        /// used when the entity is destroyed or its components are replaced.
+        ///
         /// @param id Entity index.
         void removeAll(uint32_t id);
 
@@ -178,6 +234,54 @@ namespace cubos::core::ecs
         bool unpack(uint32_t id, std::size_t componentId, const data::old::Package& package,
                     data::old::Context* context);
 
+        /// @brief Writes the components of multiple entities to a stream, in the same order.
+        /// @param ids Entity indices. All entities must have the component.
+        /// @param componentId Component identifier.
+        /// @param stream Stream to write to.
+        void writeSnapshot(const std::vector<uint32_t>& ids, std::size_t componentId, memory::Stream& stream) const;
+
+        /// @brief Creates an empty storage for a registered component type, which can be filled
+        /// without touching the current components, and later swapped in with
+        /// @ref replaceStorage().
+        /// @param componentId Component identifier.
+        /// @param entities Entity manager, where the storage may keep its components in columns.
+        /// @return New storage.
+        std::unique_ptr<IStorage> createStorage(std::size_t componentId, EntityManager& entities) const;
+
+        /// @brief Replaces the storage of a component type, marking the components of the given
+        /// entities as added.
+        /// @param componentId Component identifier.
+        /// @param storage Storage created by @ref createStorage().
+        /// @param entities Entity manager which now holds the entities of the storage.
+        /// @param ids Indices of the entities which have the component.
+        void replaceStorage(std::size_t componentId, std::unique_ptr<IStorage> storage, EntityManager& entities,
+                            const std::vector<uint32_t>& ids);
+
+        /// @brief Gets the number of registered component types.
+        ///
+        /// Component identifiers range from 1 to the returned value, inclusive.
+        ///
+        /// @return Number of registered component types.
+        std::size_t count() const;
+
+        /// @brief Advances the change detection tick.
+        ///
+        /// Called whenever a query starts running, so that changes can be ordered relative to
+        /// query runs. Components added or removed in between are all marked with the tick the
+        /// next run takes.
+        ///
+        /// @return New tick.
+        uint32_t advanceTick() const;
+
+        /// @brief Moves the stored ticks which are older than half of @ref MaxTickAge up to that
+        /// age, so that they never wrap around and look newer than they are.
+        ///
+        /// Only does any work once every quarter of @ref MaxTickAge ticks, and so is meant to be
+        /// called whenever commands are committed.
+        ///
+        /// @note Must not be called while queries are running.
+        void clampTicks();
+
     private:
         struct Entry
         {
@@ -185,12 +289,29 @@ namespace cubos::core::ecs
 
             std::unique_ptr<IStorage> storage;        ///< Generic component storage.
             std::unique_ptr<std::shared_mutex> mutex; ///< Read/write lock for the storage.
+            std::unique_ptr<ComponentTicks> ticks;    ///< Change ticks of the components.
         };
 
+        /// @brief Gets the tick with which added and removed components are marked.
+        /// @return Tick which the next query run takes.
+        uint32_t changeTick() const;
+
+        /// @brief Marks a component as added and changed at the current change tick.
+        /// @param id Entity index.
+        /// @param componentId Component identifier.
+        void markAdded(uint32_t id, std::size_t componentId);
+
+        /// @brief Marks a component as removed at the current change tick.
+        /// @param id Entity index.
+        /// @param componentId Component identifier.
+        void markRemoved(uint32_t id, std::size_t componentId);
+
         /// @brief Maps component types to component IDs.
         std::unordered_map<std::type_index, std::size_t> mTypeToIds;
 
-        std::vector<Entry> mEntries; ///< Registered component storages.
+        std::vector<Entry> mEntries;             ///< Registered component storages.
+        mutable std::atomic<uint32_t> mTick = 0; ///< Current change detection tick.
+        uint32_t mClampedTick = 0;               ///< Tick at which the stored ticks were last clamped.
     };
 
     // Implementation.
@@ -204,6 +325,7 @@ namespace cubos::core::ecs
     template <typename T>
     ReadStorage<T>::ReadStorage(ReadStorage&& other) noexcept
         : mStorage(other.mStorage)
+        , mTicks(other.mTicks)
         , mLock(std::move(other.mLock))
     {
         // Do nothing.
@@ -216,8 +338,16 @@ namespace cubos::core::ecs
     }
 
     template <typename T>
-    ReadStorage<T>::ReadStorage(const Storage<T>& storage, std::shared_lock<std::shared_mutex>&& lock)
+    const ComponentTicks& ReadStorage<T>::ticks() const
+    {
+        return mTicks;
+    }
+
+    template <typename T>
+    ReadStorage<T>::ReadStorage(const Storage<T>& storage, const ComponentTicks& ticks,
+                                std::shared_lock<std::shared_mutex>&& lock)
         : mStorage(storage)
+        , mTicks(ticks)
         , mLock(std::move(lock))
     {
         // Do nothing.
@@ -226,6 +356,7 @@ namespace cubos::core::ecs
     template <typename T>
     WriteStorage<T>::WriteStorage(WriteStorage&& other) noexcept
         : mStorage(other.mStorage)
+        , mTicks(other.mTicks)
         , mLock(std::move(other.mLock))
     {
         // Do nothing.
@@ -238,17 +369,25 @@ namespace cubos::core::ecs
     }
 
     template <typename T>
-    WriteStorage<T>::WriteStorage(Storage<T>& storage, std::unique_lock<std::shared_mutex>&& lock)
+    ComponentTicks& WriteStorage<T>::ticks() const
+    {
+        return mTicks;
+    }
+
+    template <typename T>
+    WriteStorage<T>::WriteStorage(Storage<T>& storage, ComponentTicks& ticks,
+                                  std::unique_lock<std::shared_mutex>&& lock)
         : mStorage(storage)
+        , mTicks(ticks)
         , mLock(std::move(lock))
     {
         // Do nothing.
     }
 
     template <typename T>
-    void ComponentManager::registerComponent()
+    void ComponentManager::registerComponent(EntityManager& entities)
     {
-        this->registerComponent(typeid(T));
+        this->registerComponent(typeid(T), entities);
     }
 
     template <typename T>
@@ -262,6 +401,7 @@ namespace cubos::core::ecs
     {
         const std::size_t componentId = this->getID<T>();
         return ReadStorage<T>(*static_cast<const Storage<T>*>(mEntries[componentId - 1].storage.get()),
+                              *mEntries[componentId - 1].ticks,
                               std::shared_lock<std::shared_mutex>(*mEntries[componentId - 1].mutex));
     }
 
@@ -270,6 +410,7 @@ namespace cubos::core::ecs
     {
         const std::size_t componentId = this->getID<T>();
         return WriteStorage<T>(*static_cast<Storage<T>*>(mEntries[componentId - 1].storage.get()),
+                               *mEntries[componentId - 1].ticks,
                                std::unique_lock<std::shared_mutex>(*mEntries[componentId - 1].mutex));
     }
 
@@ -279,6 +420,7 @@ namespace cubos::core::ecs
         const std::size_t componentId = this->getID<T>();
         auto storage = static_cast<Storage<T>*>(mEntries[componentId - 1].storage.get());
         storage->insert(id, std::move(value));
+        this->markAdded(id, componentId);
     }
 
     template <typename T>
@@ -287,5 +429,6 @@ namespace cubos::core::ecs
         const std::size_t componentId = this->getID<T>();
         auto storage = static_cast<Storage<T>*>(mEntries[componentId - 1].storage.get());
         storage->erase(id);
+        this->markRemoved(id, componentId);
     }
 } // namespace cubos::core::ecs
@@ -7,11 +7,14 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include <cubos/core/ecs/system.hpp>
 #include <cubos/core/log.hpp>
+#include <cubos/core/thread_pool.hpp>
 
 #define ENSURE_CURR_SYSTEM()                                                                                           \
     do                                                                                                                 \
@@ -51,6 +54,12 @@
 namespace cubos::core::ecs
 {
     /// @brief Used to add systems and relations between them and then dispatch them all at once.
+    ///
+    /// When compiling the call chain, systems are packed into stages: each stage takes every system
+    /// whose predecessors ran in earlier stages and which doesn't conflict with the others in it.
+    /// If a thread pool is set through @ref setThreadPool(), the systems of each stage run in
+    /// parallel. Commands are committed at the end of each stage.
+    ///
     /// @ingroup core-ecs
     class Dispatcher
     {
@@ -79,6 +88,10 @@ namespace cubos::core::ecs
         template <typename F>
         void tagAddCondition(F func);
 
+        /// @brief Makes systems with the current tag always run on the thread which calls
+        /// @ref callSystems().
+        void tagSetMainThread();
+
         /// @brief Adds a system, and sets it as the current system for further configuration.
         /// @tparam F System type.
         /// @param func System to add.
@@ -103,6 +116,25 @@ namespace cubos::core::ecs
         template <typename F>
         void systemAddCondition(F func);
 
+        /// @brief Makes the current system always run on the thread which calls @ref callSystems().
+        ///
+        /// Necessary for systems which use thread-bound APIs, such as the render device.
+        void systemSetMainThread();
+
+        /// @brief Sets the name of the current system, which identifies it when profiling.
+        ///
+        /// Systems without a name are named after their tags.
+        ///
+        /// @param name Name.
+        void systemSetName(const std::string& name);
+
+        /// @brief Sets the thread pool used to run systems of the same stage in parallel.
+        ///
+        /// If no thread pool is set, all systems run sequentially on the calling thread.
+        ///
+        /// @param pool Thread pool, or null to run all systems sequentially.
+        void setThreadPool(ThreadPool* pool);
+
         /// @brief Compiles the call chain. Required before @ref callSystems() can be called.
         ///
         /// Takes all pending systems and determines their execution order.
@@ -133,7 +165,7 @@ namespace cubos::core::ecs
 
             Dependency before, after;
             std::bitset<CUBOS_CORE_DISPATCHER_MAX_CONDITIONS> conditions;
-            // TODO: Add threading modes, etc...
+            bool mainThread = false; ///< Whether the system must run on the calling thread.
             std::vector<std::string> inherits;
         };
 
@@ -143,6 +175,8 @@ namespace cubos::core::ecs
             std::shared_ptr<SystemSettings> settings;
             std::shared_ptr<AnySystemWrapper<void>> system;
             std::unordered_set<std::string> tags;
+            const char* name = nullptr; ///< Name of the system, interned by the profiler.
+            std::size_t index = 0;      ///< Position of the system in the compiled call chain.
         };
 
         /// @brief Internal class used to implement a DFS algorithm for call chain compilation
@@ -157,6 +191,7 @@ namespace cubos::core::ecs
             System* s;
             std::string t;
             std::shared_ptr<SystemSettings> settings;
+            std::vector<std::size_t> children; ///< Indices of the nodes which must run after this one.
         };
 
         /// @brief Visits a DFSNode to create a topological order.
@@ -170,6 +205,31 @@ namespace cubos::core::ecs
         /// @param settings Settings to handle inheritance for.
         void handleTagInheritance(std::shared_ptr<SystemSettings>& settings);
 
+        /// @brief Checks if a system can be added to a stage, running in parallel with the systems
+        /// already in it.
+        /// @param stage Systems in the stage.
+        /// @param system System to check.
+        /// @return Whether the system can be added to the stage.
+        bool fitsInStage(const std::vector<System*>& stage, System* system) const;
+
+        /// @brief Calls a system, profiling it.
+        ///
+        /// The commands recorded by the system are keyed by its position in the call chain, so that
+        /// they are committed in the same order no matter which thread ran it.
+        ///
+        /// @param system System to call.
+        /// @param world World to call the system in.
+        /// @param cmds Command buffer.
+        static void callSystem(System* system, World& world, CommandBuffer& cmds);
+
+        /// @brief Evaluates the conditions of a system, if they haven't been evaluated yet in this
+        /// iteration.
+        /// @param system System to check.
+        /// @param world World to call the conditions in.
+        /// @param cmds Command buffer.
+        /// @return Whether all conditions of the system returned true.
+        bool checkConditions(System* system, World& world, CommandBuffer& cmds);
+
         /// @brief Assign a condition a bit in the condition bitset, and returns that assigned bit.
         /// @ŧparam F Condition type.
         /// @param func Condition to assign a bit for.
@@ -190,8 +250,10 @@ namespace cubos::core::ecs
 
         // Variables for holding information after call chain is compiled.
 
-        std::vector<System*> mSystems; ///< Compiled order of running systems.
-        bool mPrepared = false;        ///< Whether the systems are prepared for execution.
+        std::vector<System*> mSystems;             ///< Compiled order of running systems.
+        std::vector<std::vector<System*>> mStages; ///< Groups of systems which may run in parallel.
+        ThreadPool* mThreadPool = nullptr;         ///< Thread pool used to run stages in parallel.
+        bool mPrepared = false;                    ///< Whether the systems are prepared for execution.
     };
 
     template <typename F>
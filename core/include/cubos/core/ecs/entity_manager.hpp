@@ -6,8 +6,8 @@
 
 #include <bitset>
 #include <cstdint>
+#include <memory>
 #include <queue>
-#include <set>
 #include <unordered_map>
 #include <vector>
 
@@ -47,15 +47,58 @@ namespace cubos::core::ecs
         uint32_t generation; ///< Allows us to detect if the entity has been removed.
     };
 
+    /// @brief Type-erased array of components of a single type, owned by an archetype.
+    ///
+    /// Each row holds the component of the entity at the same position in the entity list of the
+    /// archetype. Used by storages which keep their components in archetypes, such as
+    /// @ref ArchetypeStorage.
+    ///
+    /// @ingroup core-ecs
+    class IColumn
+    {
+    public:
+        virtual ~IColumn() = default;
+
+        /// @brief Creates an empty column for the same component type.
+        /// @return Empty column.
+        virtual std::unique_ptr<IColumn> empty() const = 0;
+
+        /// @brief Appends a default constructed component.
+        virtual void pushDefault() = 0;
+
+        /// @brief Moves a component from another column of the same type into a row of this one.
+        /// @param other Column to move from.
+        /// @param from Row of the component in @p other.
+        /// @param to Row to move the component to.
+        virtual void moveFrom(IColumn& other, std::size_t from, std::size_t to) = 0;
+
+        /// @brief Removes a row, by moving the component in the last row into it.
+        /// @param row Row to remove.
+        virtual void swapRemove(std::size_t row) = 0;
+
+        /// @brief Removes all rows.
+        virtual void clear() = 0;
+
+        /// @brief Gets the first row, after which the remaining rows are packed.
+        /// @return Pointer to the component in the first row, to be cast to the component type.
+        virtual void* data() = 0;
+    };
+
     /// @brief Holds and manages entities and their component masks.
     ///
+    /// Entities are grouped in archetypes by their component masks. Each archetype keeps the
+    /// indices of its entities packed in a single array and, for the component types registered
+    /// with @ref registerColumn(), a column with their components in the same order, so that
+    /// iterating over an archetype walks contiguous memory.
+    ///
     /// Used internally by @ref World.
     ///
     /// @ingroup core-ecs
     class EntityManager final
     {
     public:
-        /// @brief Used to iterate over all entities in a manager with a certain component mask.
+        /// @brief Used to iterate over all entities in a manager with a certain component mask, or
+        /// over all entities in a given list of archetypes.
         class Iterator
         {
         public:
@@ -64,20 +107,46 @@ namespace cubos::core::ecs
             bool operator!=(const Iterator& /*other*/) const;
             Iterator& operator++();
 
+            /// @brief Gets the index of the archetype the iterator is currently at.
+            /// @return Index of the current archetype.
+            std::size_t archetype() const;
+
+            /// @brief Gets the row of the current entity in the columns of its archetype.
+            /// @return Row.
+            std::size_t row() const;
+
+            /// @brief Gets the column where the current archetype stores one of its components.
+            /// @param componentId Component identifier.
+            /// @return Column, or null if the archetype doesn't store the component in a column.
+            IColumn* column(std::size_t componentId) const;
+
         private:
             friend EntityManager;
 
-            const EntityManager& mManager; ///< Entity manager being iterated.
-            const Entity::Mask mMask;      ///< Mask of the components to be iterated.
+            const EntityManager& mManager;                 ///< Entity manager being iterated.
+            const Entity::Mask mMask;                      ///< Mask of the components to be iterated.
+            const std::vector<std::size_t>* mArchetypes{}; ///< Archetypes to iterate, or null to use the mask.
 
             /// @param e Entity manager being iterated.
             /// @param m Mask of the components to be iterated.
             Iterator(const EntityManager& e, Entity::Mask m);
+
+            /// @param e Entity manager being iterated.
+            /// @param archetypes Indices of the archetypes to be iterated.
+            Iterator(const EntityManager& e, const std::vector<std::size_t>& archetypes);
+
             Iterator(const EntityManager& e);
 
-            std::unordered_map<Entity::Mask, std::set<uint32_t>>::const_iterator
-                mArchetypeIt;                             ///< Current archetype iterator.
-            std::set<uint32_t>::const_iterator mEntityIt; ///< Current entity iterator.
+            /// @brief Checks if the iterator has gone past the last archetype.
+            /// @return Whether the iterator is at the end.
+            bool atEnd() const;
+
+            /// @brief Advances the archetype index until an archetype which matches the mask and
+            /// isn't empty is found, or the end is reached.
+            void skipArchetypes();
+
+            std::size_t mArchetype; ///< Index of the current archetype, or of its position in the list.
+            std::size_t mEntity;    ///< Index of the current entity in the current archetype.
         };
 
         /// @brief Constructs with a certain initial entity capacity.
@@ -104,6 +173,28 @@ namespace cubos::core::ecs
         /// @return Component mask of the entity.
         const Entity::Mask& getMask(Entity entity) const;
 
+        /// @brief Makes archetypes store the components of a type in columns.
+        ///
+        /// Must be called before any entity has the component. Whenever an entity changes
+        /// archetypes, the components it keeps are moved to its new row, and the ones it loses are
+        /// destroyed. Added components start default constructed.
+        ///
+        /// @param componentId Component identifier.
+        /// @param prototype Empty column, copied by every archetype with the component.
+        void registerColumn(std::size_t componentId, std::unique_ptr<IColumn> prototype);
+
+        /// @brief Gets the column where the archetype of an entity stores one of its components.
+        /// @param index Entity index.
+        /// @param componentId Component identifier.
+        /// @return Column, or null if the entity doesn't have the component or it isn't stored in
+        /// columns.
+        IColumn* column(uint32_t index, std::size_t componentId) const;
+
+        /// @brief Gets the row of an entity in the columns of its archetype.
+        /// @param index Entity index.
+        /// @return Row.
+        uint32_t row(uint32_t index) const;
+
         /// @brief Checks if an entity is still valid.
         ///
         /// Different from isAlive, as it will return true for entities which still have not been
@@ -118,6 +209,36 @@ namespace cubos::core::ecs
         /// @return Whether the entity is alive.
         bool isAlive(Entity entity) const;
 
+        /// @brief Gets the number of entity slots, including the ones which are free.
+        /// @return Number of entity slots.
+        std::size_t capacity() const;
+
+        /// @brief Gets the generation of an entity slot.
+        ///
+        /// If the slot is free, this is the generation of the next entity created on it.
+        ///
+        /// @param index Entity index.
+        /// @return Generation.
+        uint32_t generation(uint32_t index) const;
+
+        /// @brief Replaces all entities with the given ones.
+        ///
+        /// Archetypes are kept, so that lists built by @ref matchArchetypes() remain valid.
+        ///
+        /// @param generations Generation of each entity slot.
+        /// @param masks Component mask of each entity slot. Slots whose mask doesn't have the
+        /// first bit set are free. Components stored in columns start default constructed.
+        void reset(const std::vector<uint32_t>& generations, const std::vector<Entity::Mask>& masks);
+
+        /// @brief Replaces all entities with the ones of another entity manager.
+        ///
+        /// Archetypes are kept, so that lists built by @ref matchArchetypes() remain valid, and the
+        /// archetypes of @p other are moved into the matching ones, along with their columns. Both
+        /// managers must have the same columns registered.
+        ///
+        /// @param other Entity manager to take the entities from. Left empty.
+        void replace(EntityManager&& other);
+
         /// @brief Returns an iterator over all entities.
         /// @return Iterator over all entities.
         Iterator begin() const;
@@ -127,21 +248,73 @@ namespace cubos::core::ecs
         /// @return Iterator over all entities with the given component mask.
         Iterator withMask(Entity::Mask mask) const;
 
+        /// @brief Returns an iterator over all entities in the given archetypes.
+        ///
+        /// The list must outlive the iterator. Use @ref matchArchetypes() to build it.
+        ///
+        /// @param archetypes Indices of the archetypes to be iterated.
+        /// @return Iterator over all entities in the given archetypes.
+        Iterator withArchetypes(const std::vector<std::size_t>& archetypes) const;
+
+        /// @brief Adds the archetypes created since a list was last updated which match a mask
+        /// to that list.
+        ///
+        /// Archetypes are never removed, so a list kept up to date with this method only needs
+        /// to check archetypes which have been created since the last call.
+        ///
+        /// @param mask Mask of the components to be matched.
+        /// @param[in,out] seen Number of archetypes already checked. Starts at 0.
+        /// @param[in,out] archetypes Indices of the matching archetypes.
+        void matchArchetypes(const Entity::Mask& mask, std::size_t& seen, std::vector<std::size_t>& archetypes) const;
+
         /// @brief Returns an iterator which points to the end of the entity manager.
         /// @return Iterator which points to the end of the entity manager.
         Iterator end() const;
 
     private:
+        /// @brief Value of @ref EntityData::archetype for entities which aren't in any archetype.
+        static constexpr uint32_t NoArchetype = UINT32_MAX;
+
         /// @brief Internal data struct containing the state of an entity.
         struct EntityData
         {
             uint32_t generation; ///< Used to detect if the entity has been removed.
             Entity::Mask mask;   ///< Component mask of the entity.
+            uint32_t archetype;  ///< Index of the archetype of the entity, or @ref NoArchetype.
+            uint32_t row;        ///< Position of the entity in the entity list of its archetype.
+        };
+
+        /// @brief Internal data struct containing the entities of a set of components.
+        struct Archetype
+        {
+            Entity::Mask mask;              ///< Component mask of the archetype.
+            std::vector<uint32_t> entities; ///< Densely packed indices of the entities in the archetype.
+
+            /// @brief Columns of the components stored in the archetype, indexed by component
+            /// identifier, or null for the components which aren't.
+            std::vector<std::unique_ptr<IColumn>> columns;
         };
 
-        std::vector<EntityData> mEntities;                                ///< Pool of entities.
-        std::queue<uint32_t> mAvailableEntities;                          ///< Queue with available entity indices.
-        std::unordered_map<Entity::Mask, std::set<uint32_t>> mArchetypes; ///< Cache archetype entity indices.
+        /// @brief Gets the index of the archetype with the given mask, creating it if necessary.
+        /// @param mask Component mask of the archetype.
+        /// @return Archetype index.
+        uint32_t archetype(const Entity::Mask& mask);
+
+        /// @brief Adds an entity to the archetype with the given mask, creating it if necessary.
+        /// @param index Entity index.
+        /// @param mask Component mask of the entity.
+        void addToArchetype(uint32_t index, const Entity::Mask& mask);
+
+        /// @brief Removes a row from an archetype.
+        /// @param archetype Archetype index.
+        /// @param row Row of the entity to remove.
+        void removeFromArchetype(uint32_t archetype, uint32_t row);
+
+        std::vector<EntityData> mEntities;                           ///< Pool of entities.
+        std::queue<uint32_t> mAvailableEntities;                     ///< Queue with available entity indices.
+        std::vector<Archetype> mArchetypes;                          ///< Archetypes, never removed once created.
+        std::unordered_map<Entity::Mask, std::size_t> mArchetypeIds; ///< Maps masks to archetype indices.
+        std::vector<std::unique_ptr<IColumn>> mColumns;              ///< Column prototypes, by component identifier.
     };
 } // namespace cubos::core::ecs
 
@@ -7,12 +7,32 @@
 #define DEFAULT_FILTER_MASK ~0u
 #define DEFAULT_PUSH_MASK 0
 
+#include <algorithm>
 #include <atomic>
-#include <deque>
+#include <bit>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include <cubos/core/log.hpp>
 
 namespace cubos::core::ecs
 {
     /// @brief Resource which stores events of type @p T.
+    ///
+    /// Events are double buffered: events sent during a frame are kept until the end of the next
+    /// frame, which is marked by calling @ref update(). This way, every system which runs once
+    /// per frame reads each event exactly once, regardless of whether it runs before or after the
+    /// system which sent it. Events are identified by their index in the sequence of all events
+    /// ever sent, and reading an event which has already been discarded is not possible.
+    ///
+    /// Events are stored in segments which grow geometrically and are reused between frames, so
+    /// that sending events doesn't allocate memory once the pipe has warmed up. Multiple threads
+    /// may push events at the same time, but not while events are being read.
+    ///
     /// @note This resource is meant to be used through @ref EventReader and @ref EventWriter.
     /// @tparam T Event type.
     /// @ingroup core-ecs
@@ -20,11 +40,35 @@ namespace cubos::core::ecs
     class EventPipe
     {
     public:
+        ~EventPipe() = default;
+
+        /// @brief Constructs an empty pipe.
+        EventPipe() = default;
+
+        /// @brief Forbid copy construction.
+        EventPipe(const EventPipe&) = delete;
+
         /// @brief Pushes an event into the event pipe.
+        ///
+        /// May be called concurrently with other calls to @ref push() and @ref pushMany().
+        ///
         /// @param event Event.
         /// @param mask Mask.
         void push(T event, unsigned int mask = DEFAULT_PUSH_MASK);
 
+        /// @brief Pushes a batch of events into the event pipe, all with the same mask.
+        ///
+        /// Reserves space for all of the events at once, which is much cheaper than pushing them
+        /// one by one. May be called concurrently with other calls to @ref push() and
+        /// @ref pushMany().
+        ///
+        /// @param events Events.
+        /// @param mask Mask.
+        void pushMany(std::span<const T> events, unsigned int mask = DEFAULT_PUSH_MASK);
+
+        /// @brief Marks the end of a frame, discarding the events sent before the frame started.
+        void update();
+
         /// @brief Returns the event mask from event pipe at the given @p index.
         /// @param index Event index.
         /// @return Event mask.
@@ -35,8 +79,15 @@ namespace cubos::core::ecs
         /// @return Event and mask.
         std::pair<const T&, unsigned int> get(std::size_t index) const;
 
-        /// @brief Clears events that have been read by all readers.
-        void clear();
+        /// @brief Returns the longest run of contiguously stored events starting at the given
+        /// @p index.
+        /// @param index Index of the first event.
+        /// @return Events, or an empty span if there are no events at or after @p index.
+        std::span<const T> batch(std::size_t index) const;
+
+        /// @brief Returns the index of the oldest event which is still stored.
+        /// @return Index of the oldest event.
+        std::size_t firstEvent() const;
 
         /// @brief Returns the number of events that already were sent.
         /// @return Number of events that already were sent.
@@ -46,54 +97,95 @@ namespace cubos::core::ecs
         /// @return Number of events that are present on the pipe.
         std::size_t size() const;
 
-        /// @brief Adds a new reader to reader count.
-        ///
-        /// This is necessary to keep track of when its okay to delete events on @ref clear().
-        ///
-        /// @note This is called on @ref impl::SystemFetcher::prepare().
-        /// @see EventReader
-        void addReader();
+    private:
+        /// @brief Number of events in the first segment of a buffer. Each following segment is
+        /// twice as large as the previous one.
+        static constexpr std::size_t FirstSegmentSize = 64;
 
-        /// @brief Removes a reader from reader count.
-        /// @see EventReader
-        void removeReader();
+        /// @brief Maximum number of segments in a buffer.
+        static constexpr std::size_t SegmentCount = 32;
 
-    private:
-        /// @brief Stores an event, its mask and its read count.
-        struct Event
+        /// @brief Alignment of the segments, which must fit both events and masks.
+        static constexpr std::align_val_t SegmentAlignment{std::max(alignof(T), alignof(unsigned int))};
+
+        /// @brief Events sent during a single frame.
+        ///
+        /// Each segment is a single allocation which holds its events followed by their masks.
+        /// Segments are allocated lazily, and kept when the buffer is cleared.
+        class Buffer
         {
-            T event;
-            unsigned int mask;
-            mutable std::atomic_size_t readCount{0};
+        public:
+            ~Buffer();
 
-            Event(T e, unsigned int m)
-                : event(std::move(e))
-                , mask(m)
-            {
-            }
+            /// @brief Constructs an empty buffer.
+            Buffer() = default;
 
-            Event(const Event& other)
-            {
-                *this = other;
-            }
+            /// @brief Reserves space for @p count events and initializes them.
+            /// @tparam F Function type.
+            /// @param count Number of events.
+            /// @param init Function called with the offset of each event in the batch, and
+            /// pointers to where the event and its mask must be constructed.
+            template <typename F>
+            void append(std::size_t count, F init);
 
-            Event& operator=(const Event& other)
-            {
-                this->event = other.event;
-                this->mask = other.mask;
-                this->readCount = other.readCount.load();
-                return *this;
-            }
+            /// @brief Destroys all events in the buffer, keeping the segments.
+            void clear();
+
+            /// @brief Returns the event and mask with the given @p index.
+            /// @param index Event index, relative to the start of the buffer.
+            /// @return Event and mask.
+            std::pair<const T&, unsigned int> get(std::size_t index) const;
+
+            /// @brief Returns the events from the given @p index until the end of its segment or
+            /// the end of the buffer.
+            /// @param index Event index, relative to the start of the buffer.
+            /// @return Events.
+            std::span<const T> batch(std::size_t index) const;
+
+            /// @brief Returns the number of events in the buffer.
+            /// @return Number of events.
+            std::size_t size() const;
+
+        private:
+            /// @brief Gets the segment which stores the event with the given @p index.
+            /// @param index Event index.
+            /// @return Segment index.
+            static std::size_t segmentOf(std::size_t index);
+
+            /// @brief Gets the index of the first event stored in the given @p segment.
+            /// @param segment Segment index.
+            /// @return Event index.
+            static std::size_t segmentStart(std::size_t segment);
+
+            /// @brief Gets the events stored in the segment with the given @p data.
+            /// @param data Segment data.
+            /// @return Events.
+            static T* events(std::byte* data);
+
+            /// @brief Gets the masks stored in the segment with the given @p data and @p segment
+            /// index.
+            /// @param data Segment data.
+            /// @param segment Segment index.
+            /// @return Masks.
+            static unsigned int* masks(std::byte* data, std::size_t segment);
+
+            /// @brief Gets the given @p segment, allocating it if necessary.
+            /// @param segment Segment index.
+            /// @return Segment data.
+            std::byte* reserve(std::size_t segment);
+
+            std::atomic<std::byte*> mSegments[SegmentCount]{}; ///< Allocated segments.
+            std::atomic<std::size_t> mSize{0};                 ///< Number of events in the buffer.
         };
 
-        /// @brief List of events that are in the pipe.
-        std::deque<Event> mEvents;
+        /// @brief Buffers of the current and of the previous frame.
+        Buffer mBuffers[2];
 
-        /// @brief How many readers the event pipe currently has.
-        std::size_t mReaderCount;
+        /// @brief Index of the buffer of the current frame.
+        std::size_t mCurrent{0};
 
-        /// @brief How many events were deleted.
-        std::size_t mDeletedEvents{0};
+        /// @brief Index of the first event in the buffer of the previous frame.
+        std::size_t mFirst{0};
     };
 
     // EventPipe implementation.
@@ -101,60 +193,210 @@ namespace cubos::core::ecs
     template <typename T>
     void EventPipe<T>::push(T event, unsigned int mask)
     {
-        mEvents.push_back(Event(event, mask));
+        mBuffers[mCurrent].append(1, [&](std::size_t, T* dst, unsigned int* dstMask) {
+            new (dst) T(std::move(event));
+            *dstMask = mask;
+        });
+    }
+
+    template <typename T>
+    void EventPipe<T>::pushMany(std::span<const T> events, unsigned int mask)
+    {
+        mBuffers[mCurrent].append(events.size(), [&](std::size_t i, T* dst, unsigned int* dstMask) {
+            new (dst) T(events[i]);
+            *dstMask = mask;
+        });
+    }
+
+    template <typename T>
+    void EventPipe<T>::update()
+    {
+        auto& previous = mBuffers[mCurrent ^ 1];
+        mFirst += previous.size();
+        previous.clear();
+        mCurrent ^= 1;
     }
 
     template <typename T>
     unsigned int EventPipe<T>::getEventMask(std::size_t index) const
     {
-        index = index - mDeletedEvents;
-        return mEvents.at(index).mask;
+        return this->get(index).second;
     }
 
     template <typename T>
     std::pair<const T&, unsigned int> EventPipe<T>::get(std::size_t index) const
     {
-        index = index - mDeletedEvents;
-        const Event& ev = mEvents.at(index);
-        ev.readCount++;
-        return std::pair<const T&, unsigned int>(ev.event, ev.mask);
+        CUBOS_ASSERT(index >= mFirst && index < this->sentEvents(), "Event {} isn't stored in the pipe", index);
+        const auto& previous = mBuffers[mCurrent ^ 1];
+        index -= mFirst;
+        if (index < previous.size())
+        {
+            return previous.get(index);
+        }
+        return mBuffers[mCurrent].get(index - previous.size());
     }
 
     template <typename T>
-    void EventPipe<T>::clear()
+    std::span<const T> EventPipe<T>::batch(std::size_t index) const
     {
-        while (!mEvents.empty() && mEvents.front().readCount == mReaderCount)
+        index = std::max(index, mFirst) - mFirst;
+        const auto& previous = mBuffers[mCurrent ^ 1];
+        if (index < previous.size())
         {
-            mEvents.pop_front();
-            mDeletedEvents++;
+            return previous.batch(index);
         }
+        return mBuffers[mCurrent].batch(index - previous.size());
+    }
+
+    template <typename T>
+    std::size_t EventPipe<T>::firstEvent() const
+    {
+        return mFirst;
     }
 
     template <typename T>
     std::size_t EventPipe<T>::sentEvents() const
     {
-        return mEvents.size() + mDeletedEvents;
+        return mFirst + this->size();
     }
 
     template <typename T>
     std::size_t EventPipe<T>::size() const
     {
-        return mEvents.size();
+        return mBuffers[0].size() + mBuffers[1].size();
     }
 
+    // EventPipe::Buffer implementation.
+
     template <typename T>
-    void EventPipe<T>::addReader()
+    EventPipe<T>::Buffer::~Buffer()
     {
-        mReaderCount++;
+        this->clear();
+        for (auto& segment : mSegments)
+        {
+            if (auto* data = segment.load(std::memory_order_relaxed))
+            {
+                ::operator delete(data, SegmentAlignment);
+            }
+        }
     }
 
     template <typename T>
-    void EventPipe<T>::removeReader()
+    template <typename F>
+    void EventPipe<T>::Buffer::append(std::size_t count, F init)
     {
-        if (mReaderCount > 0)
+        // Claim the slots first, so that other threads can append at the same time. Readers never
+        // run alongside writers, so the events don't need to be published one by one.
+        std::size_t start = mSize.fetch_add(count, std::memory_order_relaxed);
+        std::size_t end = start + count;
+        for (std::size_t i = start; i < end;)
         {
-            mReaderCount--;
+            auto segment = segmentOf(i);
+            auto* data = this->reserve(segment);
+            auto* segmentEvents = events(data);
+            auto* segmentMasks = masks(data, segment);
+            auto segmentEnd = std::min(end, segmentStart(segment + 1));
+            for (; i < segmentEnd; ++i)
+            {
+                auto offset = i - segmentStart(segment);
+                init(i - start, segmentEvents + offset, segmentMasks + offset);
+            }
+        }
+    }
+
+    template <typename T>
+    void EventPipe<T>::Buffer::clear()
+    {
+        auto size = mSize.load(std::memory_order_relaxed);
+        if constexpr (!std::is_trivially_destructible_v<T>)
+        {
+            for (std::size_t i = 0; i < size; ++i)
+            {
+                auto segment = segmentOf(i);
+                std::destroy_at(events(mSegments[segment].load(std::memory_order_relaxed)) + i -
+                                segmentStart(segment));
+            }
+        }
+        mSize.store(0, std::memory_order_relaxed);
+    }
+
+    template <typename T>
+    std::pair<const T&, unsigned int> EventPipe<T>::Buffer::get(std::size_t index) const
+    {
+        auto segment = segmentOf(index);
+        auto* data = mSegments[segment].load(std::memory_order_acquire);
+        auto offset = index - segmentStart(segment);
+        return {events(data)[offset], masks(data, segment)[offset]};
+    }
+
+    template <typename T>
+    std::span<const T> EventPipe<T>::Buffer::batch(std::size_t index) const
+    {
+        auto size = this->size();
+        if (index >= size)
+        {
+            return {};
         }
+
+        auto segment = segmentOf(index);
+        auto* data = mSegments[segment].load(std::memory_order_acquire);
+        auto offset = index - segmentStart(segment);
+        auto end = std::min(size, segmentStart(segment + 1));
+        return {events(data) + offset, end - index};
+    }
+
+    template <typename T>
+    std::size_t EventPipe<T>::Buffer::size() const
+    {
+        return mSize.load(std::memory_order_relaxed);
     }
 
+    template <typename T>
+    std::size_t EventPipe<T>::Buffer::segmentOf(std::size_t index)
+    {
+        return static_cast<std::size_t>(std::bit_width(index / FirstSegmentSize + 1)) - 1;
+    }
+
+    template <typename T>
+    std::size_t EventPipe<T>::Buffer::segmentStart(std::size_t segment)
+    {
+        return FirstSegmentSize * ((std::size_t{1} << segment) - 1);
+    }
+
+    template <typename T>
+    T* EventPipe<T>::Buffer::events(std::byte* data)
+    {
+        return reinterpret_cast<T*>(data);
+    }
+
+    template <typename T>
+    unsigned int* EventPipe<T>::Buffer::masks(std::byte* data, std::size_t segment)
+    {
+        return reinterpret_cast<unsigned int*>(data + (FirstSegmentSize << segment) * sizeof(T));
+    }
+
+    template <typename T>
+    std::byte* EventPipe<T>::Buffer::reserve(std::size_t segment)
+    {
+        CUBOS_ASSERT(segment < SegmentCount, "Too many events sent in a single frame");
+
+        auto* data = mSegments[segment].load(std::memory_order_acquire);
+        if (data == nullptr)
+        {
+            // Multiple threads may race to allocate the same segment, in which case only one of
+            // them gets to keep its allocation.
+            auto bytes = (FirstSegmentSize << segment) * (sizeof(T) + sizeof(unsigned int));
+            auto* allocated = static_cast<std::byte*>(::operator new(bytes, SegmentAlignment));
+            if (mSegments[segment].compare_exchange_strong(data, allocated, std::memory_order_acq_rel,
+                                                           std::memory_order_acquire))
+            {
+                data = allocated;
+            }
+            else
+            {
+                ::operator delete(allocated, SegmentAlignment);
+            }
+        }
+        return data;
+    }
 } // namespace cubos::core::ecs
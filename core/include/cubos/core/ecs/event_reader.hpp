@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <optional>
+#include <span>
 
 #include <cubos/core/ecs/event_pipe.hpp>
 
@@ -15,6 +17,10 @@ namespace cubos::core::ecs
     /// Filtering the received events by their mask is also possible via the parameter @p M.
     /// By default, the reader will read all events sent.
     ///
+    /// Events are only kept by the @ref EventPipe until the end of the frame after the one they
+    /// were sent in. Readers which don't run at least once every frame, such as fixed update
+    /// systems, may thus miss events.
+    ///
     /// @see Systems can send events using @ref EventWriter.
     /// @tparam T Event.
     /// @tparam M Filter mask.
@@ -36,6 +42,16 @@ namespace cubos::core::ecs
         /// @return Reference to current event, or `std::nullopt` if there are no more events.
         std::optional<std::reference_wrapper<const T>> read();
 
+        /// @brief Returns a span with the next unread events which are stored contiguously, and
+        /// advances past them.
+        ///
+        /// Much faster than reading events one by one. Calling this repeatedly until it returns an
+        /// empty span reads all unread events. As masks are ignored, only available to readers
+        /// which don't filter events.
+        ///
+        /// @return Unread events, or an empty span if there are none.
+        std::span<const T> readBatch();
+
         /// @brief Used to iterate over events received by a reader.
         class Iterator
         {
@@ -83,6 +99,8 @@ namespace cubos::core::ecs
     template <typename T, unsigned int M>
     std::optional<std::reference_wrapper<const T>> EventReader<T, M>::read()
     {
+        // Skip events which were already discarded by the pipe.
+        mIndex = std::max(mIndex, mPipe.firstEvent());
         while (mIndex < mPipe.sentEvents())
         {
             std::pair<const T&, unsigned int> p = mPipe.get(mIndex++);
@@ -97,6 +115,16 @@ namespace cubos::core::ecs
         return std::nullopt;
     }
 
+    template <typename T, unsigned int M>
+    std::span<const T> EventReader<T, M>::readBatch()
+    {
+        static_assert(M == DEFAULT_FILTER_MASK, "Batch reads are only available to readers without a filter mask.");
+
+        auto batch = mPipe.batch(mIndex);
+        mIndex = std::max(mIndex, mPipe.firstEvent()) + batch.size();
+        return batch;
+    }
+
     template <typename T, unsigned int M>
     bool EventReader<T, M>::matchesMask(decltype(M) mask) const
     {
@@ -4,14 +4,19 @@
 
 #pragma once
 
+#include <span>
+
 #include <cubos/core/ecs/event_pipe.hpp>
 
 namespace cubos::core::ecs
 {
     /// @brief System argument which allows the system to send events of type @p T to other
     /// systems.
+    ///
+    /// Multiple systems writing events of the same type may run in parallel.
+    ///
     /// @see Systems can read sent events using @ref EventReader.
-    /// @tparam T
+    /// @tparam T Event.
     /// @ingroup core-ecs
     template <typename T>
     class EventWriter
@@ -26,6 +31,14 @@ namespace cubos::core::ecs
         /// @param mask Mask.
         void push(T event, unsigned int mask = DEFAULT_PUSH_MASK);
 
+        /// @brief Sends the given @p events to the event pipe, all with the same @p mask.
+        ///
+        /// Prefer this over @ref push() when sending many events at once.
+        ///
+        /// @param events Events.
+        /// @param mask Mask.
+        void pushMany(std::span<const T> events, unsigned int mask = DEFAULT_PUSH_MASK);
+
     private:
         EventPipe<T>& mPipe;
     };
@@ -41,7 +54,13 @@ namespace cubos::core::ecs
     template <typename T>
     void EventWriter<T>::push(T event, unsigned int mask)
     {
-        mPipe.push(event, mask);
+        mPipe.push(std::move(event), mask);
+    }
+
+    template <typename T>
+    void EventWriter<T>::pushMany(std::span<const T> events, unsigned int mask)
+    {
+        mPipe.pushMany(events, mask);
     }
 
 } // namespace cubos::core::ecs
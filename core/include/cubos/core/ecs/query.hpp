@@ -8,13 +8,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <optional>
+#include <tuple>
+#include <type_traits>
 #include <typeindex>
 #include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <cubos/core/ecs/accessors.hpp>
+#include <cubos/core/ecs/commands.hpp>
 #include <cubos/core/ecs/world.hpp>
+#include <cubos/core/thread_pool.hpp>
 
 namespace cubos::core::ecs
 {
@@ -26,11 +33,29 @@ namespace cubos::core::ecs
         std::unordered_set<std::type_index> written; ///< Components written.
     };
 
+    /// @brief State kept by a query between runs.
+    ///
+    /// Caches which archetypes match the query, so that they don't have to be searched for every
+    /// time the query is iterated. Archetypes are never removed, so only the archetypes created
+    /// since the last run need to be checked. Also stores the ticks used to detect which
+    /// components changed since the last run. Systems keep one for each of their queries.
+    ///
+    /// @ingroup core-ecs
+    struct QueryState
+    {
+        std::size_t seen = 0;                ///< Number of archetypes already checked.
+        std::vector<std::size_t> archetypes; ///< Indices of the archetypes which match the query.
+        uint32_t lastRun = 0;                ///< Tick at which the query last ran.
+        uint32_t thisRun = 0;                ///< Tick at which the query is running.
+    };
+
     namespace impl
     {
         /// @brief Fetches the requested data from a world.
         ///
-        /// Each possible accessor type is specialized to provide the correct data.
+        /// Each possible accessor type is specialized to provide the correct data. When the
+        /// component is stored in a column of the entity's archetype, `arg` receives a pointer to
+        /// it, which is used instead of looking the component up in its storage.
         ///
         /// @tparam T Query argument type.
         template <typename T>
@@ -47,9 +72,11 @@ namespace cubos::core::ecs
             using InnerType = Component;
 
             constexpr static bool IsOptional = false;
+            constexpr static bool IsFilter = false;
             static void add(QueryInfo& info);
             static Type fetch(const World& world);
-            static Write<Component> arg(const World& world, Type& lock, Entity entity);
+            static Write<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                        Component* column);
         };
 
         template <typename Component>
@@ -59,9 +86,11 @@ namespace cubos::core::ecs
             using InnerType = Component;
 
             constexpr static bool IsOptional = false;
+            constexpr static bool IsFilter = false;
             static void add(QueryInfo& info);
             static Type fetch(const World& world);
-            static Read<Component> arg(const World& world, Type& lock, Entity entity);
+            static Read<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                       Component* column);
         };
 
         template <typename Component>
@@ -71,9 +100,11 @@ namespace cubos::core::ecs
             using InnerType = Component;
 
             constexpr static bool IsOptional = true;
+            constexpr static bool IsFilter = false;
             static void add(QueryInfo& info);
             static Type fetch(const World& world);
-            static OptWrite<Component> arg(const World& world, Type& lock, Entity entity);
+            static OptWrite<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                           Component* column);
         };
 
         template <typename Component>
@@ -83,9 +114,41 @@ namespace cubos::core::ecs
             using InnerType = Component;
 
             constexpr static bool IsOptional = true;
+            constexpr static bool IsFilter = false;
             static void add(QueryInfo& info);
             static Type fetch(const World& world);
-            static OptRead<Component> arg(const World& world, Type& lock, Entity entity);
+            static OptRead<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                          Component* column);
+        };
+
+        template <typename Component>
+        struct QueryFetcher<Changed<Component>>
+        {
+            using Type = ReadStorage<Component>;
+            using InnerType = Component;
+
+            constexpr static bool IsOptional = false;
+            constexpr static bool IsFilter = true;
+            static void add(QueryInfo& info);
+            static Type fetch(const World& world);
+            static Changed<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                          Component* column);
+            static bool matches(Type& lock, Entity entity, const QueryState& state);
+        };
+
+        template <typename Component>
+        struct QueryFetcher<Added<Component>>
+        {
+            using Type = ReadStorage<Component>;
+            using InnerType = Component;
+
+            constexpr static bool IsOptional = false;
+            constexpr static bool IsFilter = true;
+            static void add(QueryInfo& info);
+            static Type fetch(const World& world);
+            static Added<Component> arg(const World& world, Type& lock, Entity entity, const QueryState& state,
+                                        Component* column);
+            static bool matches(Type& lock, Entity entity, const QueryState& state);
         };
     } // namespace impl
 
@@ -102,6 +165,9 @@ namespace cubos::core::ecs
     /// to `Rotation` and `Scale` components are also passed but may be null if the component is
     /// not present in the entity. Whenever mutability is not needed, Read/OptRead should be used.
     ///
+    /// Queries can also be filtered to the entities whose components have changed or have been
+    /// added since the query last ran, with the @ref Changed and @ref Added arguments.
+    ///
     /// @tparam ComponentTypes Component accessor types to be queried.
     /// @ingroup core-ecs
     template <typename... ComponentTypes>
@@ -110,6 +176,10 @@ namespace cubos::core::ecs
     public:
         using Fetched = std::tuple<typename impl::QueryFetcher<ComponentTypes>::Type...>;
 
+        /// @brief Pointers to components stored in the columns of an archetype, or null for the
+        /// components which aren't stored in columns.
+        using Columns = std::tuple<typename impl::QueryFetcher<ComponentTypes>::InnerType*...>;
+
         /// @brief Used to iterate over the results of a query.
         class Iterator
         {
@@ -125,19 +195,36 @@ namespace cubos::core::ecs
         private:
             friend Query<ComponentTypes...>;
 
-            const World& mWorld;         ///< World to query from.
-            Fetched& mFetched;           ///< Fetched data.
-            EntityManager::Iterator mIt; ///< Internal entity iterator.
+            const World& mWorld;               ///< World to query from.
+            Fetched& mFetched;                 ///< Fetched data.
+            const QueryState& mState;          ///< State of the query.
+            EntityManager::Iterator mIt;       ///< Internal entity iterator.
+            std::size_t mArchetype = SIZE_MAX; ///< Archetype whose columns are in @ref mColumns.
+            Columns mColumns{};                ///< First rows of the columns of the current archetype.
 
             /// @param world World to query from.
             /// @param fetched Fetched data.
+            /// @param state State of the query.
             /// @param it Internal entity iterator.
-            Iterator(const World& world, Fetched& fetched, EntityManager::Iterator it);
+            Iterator(const World& world, Fetched& fetched, const QueryState& state, EntityManager::Iterator it);
+
+            /// @brief Advances the internal iterator until an entity which passes the filters of
+            /// the query is found, or the end is reached.
+            void skipFiltered();
+
+            /// @brief Fetches the columns of the archetype the internal iterator is at, if it has
+            /// moved to another archetype.
+            void fetchColumns();
+
+            /// @brief Gets the components of the current entity which are stored in columns.
+            /// @return Pointers to the components, or null for the ones not stored in columns.
+            Columns components() const;
         };
 
         /// @brief Constructs a query over the given world.
         /// @param world World to query.
-        Query(const World& world);
+        /// @param state State kept between runs, or null to use a state of its own.
+        Query(const World& world, QueryState* state = nullptr);
 
         /// @brief Gets an iterator to the first entity which matches the query.
         /// @return Iterator.
@@ -147,11 +234,69 @@ namespace cubos::core::ecs
         /// @return Iterator.
         Iterator end();
 
+        /// @brief Calls a function for each entity which matches the query, splitting the entities
+        /// in chunks which are processed in parallel on the world's thread pool.
+        ///
+        /// The function receives the same values an iteration over the query produces. It may be
+        /// called concurrently for different entities, and thus must only access the components
+        /// it receives. Runs sequentially on the calling thread if the world has no thread pool.
+        ///
+        /// @tparam F Function type.
+        /// @param func Function to call with each entity and its components.
+        /// @param chunkSize Number of entities processed at once by each thread.
+        template <typename F>
+        void parEach(F func, std::size_t chunkSize = 1024);
+
+        /// @brief Splits the range `[0, count)` in chunks which are processed in parallel on the
+        /// world's thread pool.
+        ///
+        /// Useful to process in parallel data other than the entities of the query, such as pairs
+        /// of entities, while accessing their components through @ref operator[]. As with
+        /// @ref parEach, the function may be called concurrently, and thus must not access the
+        /// same mutable components from different chunks. Runs sequentially on the calling thread
+        /// if the world has no thread pool.
+        ///
+        /// @tparam F Function type.
+        /// @param count Number of elements in the range.
+        /// @param func Function called with the first and one past the last index of each chunk.
+        /// @param chunkSize Number of elements processed at once by each thread.
+        template <typename F>
+        void parFor(std::size_t count, F func, std::size_t chunkSize = 1024);
+
         /// @brief Accesses an entity's components directly, without iterating over the query.
         /// @param entity Entity to access.
-        /// @return Requested components, or std::nullopt if the entity does not match the query.
+        /// @return Requested components, or std::nullopt if the entity isn't alive or does not match the query.
         std::optional<std::tuple<ComponentTypes...>> operator[](Entity entity);
 
+        /// @brief Checks if an entity's component has changed since the query last ran.
+        ///
+        /// Useful when any of several components changing should be acted upon, which can't be
+        /// expressed with @ref Changed arguments alone.
+        ///
+        /// @tparam T Component type, which must be accessed by the query.
+        /// @param entity Entity to check.
+        /// @return Whether the entity has the component and it has changed.
+        template <typename T>
+        bool changed(Entity entity) const;
+
+        /// @brief Checks if an entity's component has been added since the query last ran.
+        /// @tparam T Component type, which must be accessed by the query.
+        /// @param entity Entity to check.
+        /// @return Whether the entity has the component and it has been added.
+        template <typename T>
+        bool added(Entity entity) const;
+
+        /// @brief Checks if an entity's component has been removed since the query last ran.
+        ///
+        /// Useful to react to components being removed, as the removed component can't be
+        /// accessed anymore.
+        ///
+        /// @tparam T Component type, which must be accessed by the query.
+        /// @param entity Entity to check.
+        /// @return Whether the entity doesn't have the component and it has been removed.
+        template <typename T>
+        bool removed(Entity entity) const;
+
         /// @brief Gets information about the query.
         /// @return Query information.
         static QueryInfo info();
@@ -159,9 +304,30 @@ namespace cubos::core::ecs
     private:
         friend World;
 
-        const World& mWorld; ///< World to query.
-        Fetched mFetched;    ///< Fetched data.
-        Entity::Mask mMask;  ///< Mask of the components to query.
+        /// @brief Gets an iterator over the entities which have the components of the query.
+        /// @return Entity iterator.
+        EntityManager::Iterator entities();
+
+        /// @brief Checks if an entity passes the filters of the query.
+        /// @param entity Entity to check.
+        /// @return Whether the entity passes the filters.
+        bool passesFilters(Entity entity);
+
+        /// @brief Gets the state of the query.
+        /// @return Query state.
+        const QueryState& state() const;
+
+        /// @brief Gets the change ticks of a component accessed by the query.
+        /// @tparam T Component type.
+        /// @return Change ticks.
+        template <typename T>
+        const ComponentTicks& ticks() const;
+
+        const World& mWorld;  ///< World to query.
+        Fetched mFetched;     ///< Fetched data.
+        Entity::Mask mMask;   ///< Mask of the components to query.
+        QueryState* mState;   ///< External state, may be null.
+        QueryState mOwnState; ///< State used when no external state is given.
     };
 
     // Implementation.
@@ -169,11 +335,15 @@ namespace cubos::core::ecs
     template <typename... ComponentTypes>
     std::tuple<Entity, ComponentTypes...> Query<ComponentTypes...>::Iterator::operator*() const
     {
-
         // Convert the fetched data into the desired query reference types.
-        return std::forward_as_tuple(
-            *mIt, impl::QueryFetcher<ComponentTypes>::arg(
-                      mWorld, std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), *mIt)...);
+        return std::apply(
+            [&](auto*... columns) {
+                return std::tuple<Entity, ComponentTypes...>(
+                    *mIt, impl::QueryFetcher<ComponentTypes>::arg(
+                              mWorld, std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), *mIt,
+                              mState, columns)...);
+            },
+            this->components());
     }
 
     template <typename... ComponentTypes>
@@ -192,23 +362,87 @@ namespace cubos::core::ecs
     typename Query<ComponentTypes...>::Iterator& Query<ComponentTypes...>::Iterator::operator++()
     {
         ++mIt;
+        this->skipFiltered();
+        this->fetchColumns();
         return *this;
     }
 
     template <typename... ComponentTypes>
-    Query<ComponentTypes...>::Iterator::Iterator(const World& world, Fetched& fetched, EntityManager::Iterator it)
+    Query<ComponentTypes...>::Iterator::Iterator(const World& world, Fetched& fetched, const QueryState& state,
+                                                 EntityManager::Iterator it)
         : mWorld(world)
         , mFetched(fetched)
+        , mState(state)
         , mIt(std::move(it))
     {
-        // Nothing to do.
+        this->skipFiltered();
+        this->fetchColumns();
+    }
+
+    template <typename... ComponentTypes>
+    void Query<ComponentTypes...>::Iterator::skipFiltered()
+    {
+        if constexpr ((impl::QueryFetcher<ComponentTypes>::IsFilter || ...))
+        {
+            auto end = mWorld.mEntityManager.end();
+            while (mIt != end && !([&]() {
+                       if constexpr (impl::QueryFetcher<ComponentTypes>::IsFilter)
+                       {
+                           return impl::QueryFetcher<ComponentTypes>::matches(
+                               std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), *mIt, mState);
+                       }
+                       return true;
+                   }() && ...))
+            {
+                ++mIt;
+            }
+        }
+    }
+
+    template <typename... ComponentTypes>
+    void Query<ComponentTypes...>::Iterator::fetchColumns()
+    {
+        if (mIt == mWorld.mEntityManager.end() || mIt.archetype() == mArchetype)
+        {
+            return;
+        }
+
+        // Entities of the same archetype share their columns, so they're only looked up once per
+        // archetype, and then indexed by the row of each entity.
+        mArchetype = mIt.archetype();
+        mColumns = Columns{[&]() {
+            using Component = typename impl::QueryFetcher<ComponentTypes>::InnerType;
+            auto* column = mIt.column(mWorld.mComponentManager.template getID<Component>());
+            return column == nullptr ? nullptr : static_cast<Component*>(column->data());
+        }()...};
+    }
+
+    template <typename... ComponentTypes>
+    typename Query<ComponentTypes...>::Columns Query<ComponentTypes...>::Iterator::components() const
+    {
+        auto row = mIt.row();
+        return std::apply([&](auto*... columns) { return Columns{(columns == nullptr ? nullptr : columns + row)...}; },
+                          mColumns);
     }
 
     template <typename... ComponentTypes>
-    Query<ComponentTypes...>::Query(const World& world)
+    Query<ComponentTypes...>::Query(const World& world, QueryState* state)
         : mWorld(world)
         , mFetched(std::forward_as_tuple(impl::QueryFetcher<ComponentTypes>::fetch(world)...))
+        , mState(state)
     {
+        // Changes made from now on are seen as newer than this run, and changes made since the
+        // previous run as older.
+        auto& ownState = mState != nullptr ? *mState : mOwnState;
+        ownState.lastRun = ownState.thisRun;
+        ownState.thisRun = mWorld.mComponentManager.advanceTick();
+        if (ownState.thisRun - ownState.lastRun > MaxTickAge)
+        {
+            // Older ticks can't be told apart, so runs further apart are treated as if they were
+            // just that far apart.
+            ownState.lastRun = ownState.thisRun - MaxTickAge;
+        }
+
         // We must turn the type from Read<T> and similar to T before getting the ID.
         std::size_t ids[] = {0,
                              (impl::QueryFetcher<ComponentTypes>::IsOptional
@@ -228,13 +462,161 @@ namespace cubos::core::ecs
     template <typename... ComponentTypes>
     typename Query<ComponentTypes...>::Iterator Query<ComponentTypes...>::begin()
     {
-        return Iterator(mWorld, mFetched, mWorld.mEntityManager.withMask(mMask));
+        return Iterator(mWorld, mFetched, this->state(), this->entities());
     }
 
     template <typename... ComponentTypes>
     typename Query<ComponentTypes...>::Iterator Query<ComponentTypes...>::end()
     {
-        return Iterator(mWorld, mFetched, mWorld.mEntityManager.end());
+        return Iterator(mWorld, mFetched, this->state(), mWorld.mEntityManager.end());
+    }
+
+    template <typename... ComponentTypes>
+    template <typename F>
+    void Query<ComponentTypes...>::parEach(F func, std::size_t chunkSize)
+    {
+        static_assert(std::is_invocable_v<F&, Entity, ComponentTypes...>,
+                      "The function must receive an entity and the queried components.");
+
+        // Components stored in columns are located while walking the archetypes, so that the
+        // chunks don't have to look them up again.
+        std::vector<std::pair<Entity, Columns>> entities;
+        for (auto it = this->begin(), end = this->end(); it != end; ++it)
+        {
+            entities.emplace_back(*it.mIt, it.components());
+        }
+
+        this->parFor(
+            entities.size(),
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    std::apply(
+                        [&](auto*... columns) {
+                            func(entities[i].first,
+                                 impl::QueryFetcher<ComponentTypes>::arg(
+                                     mWorld, std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched),
+                                     entities[i].first, this->state(), columns)...);
+                        },
+                        entities[i].second);
+                }
+            },
+            chunkSize);
+    }
+
+    template <typename... ComponentTypes>
+    template <typename F>
+    void Query<ComponentTypes...>::parFor(std::size_t count, F func, std::size_t chunkSize)
+    {
+        static_assert(std::is_invocable_v<F&, std::size_t, std::size_t>,
+                      "The function must receive the first and one past the last index of a chunk.");
+
+        chunkSize = chunkSize == 0 ? 1 : chunkSize;
+        std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+        ThreadPool* pool = mWorld.threadPool();
+        if (pool == nullptr || chunkCount <= 1)
+        {
+            func(std::size_t{0}, count);
+            return;
+        }
+
+        // Chunks are claimed by whoever gets to them first, including the calling thread. Waiting
+        // for the group runs other tasks meanwhile, so this doesn't deadlock even if the query is
+        // iterated from one of the pool's tasks.
+        std::size_t sequence = CommandBuffer::sequence();
+        std::atomic<std::size_t> next{0};
+        auto work = [&]() {
+            // Commands recorded by the chunks belong to the system which iterated the query, no
+            // matter which thread runs them.
+            CommandBuffer::SequenceGuard guard{sequence};
+            for (auto chunk = next++; chunk < chunkCount; chunk = next++)
+            {
+                func(chunk * chunkSize, std::min((chunk + 1) * chunkSize, count));
+            }
+        };
+
+        // The calling thread already handles one share of the chunks.
+        TaskGroup group{};
+        std::size_t helperCount = std::min(chunkCount - 1, pool->threadCount());
+        for (std::size_t i = 0; i < helperCount; ++i)
+        {
+            pool->addTask(group, work);
+        }
+
+        work();
+        pool->wait(group);
+    }
+
+    template <typename... ComponentTypes>
+    EntityManager::Iterator Query<ComponentTypes...>::entities()
+    {
+        // Only archetypes created since the last iteration have to be checked against the mask.
+        auto& state = mState != nullptr ? *mState : mOwnState;
+        mWorld.mEntityManager.matchArchetypes(mMask, state.seen, state.archetypes);
+        return mWorld.mEntityManager.withArchetypes(state.archetypes);
+    }
+
+    template <typename... ComponentTypes>
+    bool Query<ComponentTypes...>::passesFilters(Entity entity)
+    {
+        (void)entity; // Unused when the query has no filters.
+        return ([&]() {
+            if constexpr (impl::QueryFetcher<ComponentTypes>::IsFilter)
+            {
+                return impl::QueryFetcher<ComponentTypes>::matches(
+                    std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), entity, this->state());
+            }
+            return true;
+        }() && ...);
+    }
+
+    template <typename... ComponentTypes>
+    const QueryState& Query<ComponentTypes...>::state() const
+    {
+        return mState != nullptr ? *mState : mOwnState;
+    }
+
+    template <typename... ComponentTypes>
+    template <typename T>
+    const ComponentTicks& Query<ComponentTypes...>::ticks() const
+    {
+        if constexpr ((std::is_same_v<typename impl::QueryFetcher<ComponentTypes>::Type, WriteStorage<T>> || ...))
+        {
+            return std::get<WriteStorage<T>>(mFetched).ticks();
+        }
+        else
+        {
+            static_assert((std::is_same_v<typename impl::QueryFetcher<ComponentTypes>::Type, ReadStorage<T>> || ...),
+                          "The component must be accessed by the query.");
+            return std::get<ReadStorage<T>>(mFetched).ticks();
+        }
+    }
+
+    template <typename... ComponentTypes>
+    template <typename T>
+    bool Query<ComponentTypes...>::changed(Entity entity) const
+    {
+        const auto& ticks = this->template ticks<T>();
+        return mWorld.template has<T>(entity) &&
+               isTickNewer(ticks.changed[entity.index], this->state().lastRun, this->state().thisRun);
+    }
+
+    template <typename... ComponentTypes>
+    template <typename T>
+    bool Query<ComponentTypes...>::added(Entity entity) const
+    {
+        const auto& ticks = this->template ticks<T>();
+        return mWorld.template has<T>(entity) &&
+               isTickNewer(ticks.added[entity.index], this->state().lastRun, this->state().thisRun);
+    }
+
+    template <typename... ComponentTypes>
+    template <typename T>
+    bool Query<ComponentTypes...>::removed(Entity entity) const
+    {
+        const auto& ticks = this->template ticks<T>();
+        return !mWorld.template has<T>(entity) && entity.index < ticks.removed.size() &&
+               isTickNewer(ticks.removed[entity.index], this->state().lastRun, this->state().thisRun);
     }
 
     template <typename... ComponentTypes>
@@ -258,9 +640,11 @@ namespace cubos::core::ecs
     }
 
     template <typename Component>
-    Write<Component> impl::QueryFetcher<Write<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity)
+    Write<Component> impl::QueryFetcher<Write<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity,
+                                                               const QueryState& state, Component* column)
     {
-        return {*lock.get().get(entity.index)};
+        return {column != nullptr ? *column : *lock.get().get(entity.index), lock.ticks().changed[entity.index],
+                state.thisRun};
     }
 
     template <typename Component>
@@ -276,9 +660,10 @@ namespace cubos::core::ecs
     }
 
     template <typename Component>
-    Read<Component> impl::QueryFetcher<Read<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity)
+    Read<Component> impl::QueryFetcher<Read<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity,
+                                                             const QueryState& /*unused*/, Component* column)
     {
-        return {*lock.get().get(entity.index)};
+        return {column != nullptr ? *column : *lock.get().get(entity.index)};
     }
 
     template <typename Component>
@@ -295,11 +680,17 @@ namespace cubos::core::ecs
     }
 
     template <typename Component>
-    OptWrite<Component> impl::QueryFetcher<OptWrite<Component>>::arg(const World& world, Type& lock, Entity entity)
+    OptWrite<Component> impl::QueryFetcher<OptWrite<Component>>::arg(const World& world, Type& lock, Entity entity,
+                                                                      const QueryState& state, Component* column)
     {
+        if (column != nullptr)
+        {
+            return {column, lock.ticks().changed[entity.index], state.thisRun};
+        }
+
         if (world.has<Component>(entity))
         {
-            return {lock.get().get(entity.index)};
+            return {lock.get().get(entity.index), lock.ticks().changed[entity.index], state.thisRun};
         }
 
         return {nullptr};
@@ -319,8 +710,14 @@ namespace cubos::core::ecs
     }
 
     template <typename Component>
-    OptRead<Component> impl::QueryFetcher<OptRead<Component>>::arg(const World& world, Type& lock, Entity entity)
+    OptRead<Component> impl::QueryFetcher<OptRead<Component>>::arg(const World& world, Type& lock, Entity entity,
+                                                                    const QueryState& /*unused*/, Component* column)
     {
+        if (column != nullptr)
+        {
+            return {column};
+        }
+
         if (world.has<Component>(entity))
         {
             return {lock.get().get(entity.index)};
@@ -329,14 +726,71 @@ namespace cubos::core::ecs
         return {nullptr};
     }
 
+    template <typename Component>
+    void impl::QueryFetcher<Changed<Component>>::add(QueryInfo& info)
+    {
+        info.read.insert(typeid(Component));
+    }
+
+    template <typename Component>
+    typename impl::QueryFetcher<Changed<Component>>::Type impl::QueryFetcher<Changed<Component>>::fetch(
+        const World& world)
+    {
+        return world.mComponentManager.read<Component>();
+    }
+
+    template <typename Component>
+    Changed<Component> impl::QueryFetcher<Changed<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity,
+                                                                   const QueryState& /*unused*/, Component* column)
+    {
+        return {column != nullptr ? *column : *lock.get().get(entity.index)};
+    }
+
+    template <typename Component>
+    bool impl::QueryFetcher<Changed<Component>>::matches(Type& lock, Entity entity, const QueryState& state)
+    {
+        return isTickNewer(lock.ticks().changed[entity.index], state.lastRun, state.thisRun);
+    }
+
+    template <typename Component>
+    void impl::QueryFetcher<Added<Component>>::add(QueryInfo& info)
+    {
+        info.read.insert(typeid(Component));
+    }
+
+    template <typename Component>
+    typename impl::QueryFetcher<Added<Component>>::Type impl::QueryFetcher<Added<Component>>::fetch(const World& world)
+    {
+        return world.mComponentManager.read<Component>();
+    }
+
+    template <typename Component>
+    Added<Component> impl::QueryFetcher<Added<Component>>::arg(const World& /*unused*/, Type& lock, Entity entity,
+                                                               const QueryState& /*unused*/, Component* column)
+    {
+        return {column != nullptr ? *column : *lock.get().get(entity.index)};
+    }
+
+    template <typename Component>
+    bool impl::QueryFetcher<Added<Component>>::matches(Type& lock, Entity entity, const QueryState& state)
+    {
+        return isTickNewer(lock.ticks().added[entity.index], state.lastRun, state.thisRun);
+    }
+
     template <typename... ComponentTypes>
     std::optional<std::tuple<ComponentTypes...>> Query<ComponentTypes...>::operator[](Entity entity)
     {
+        if (!mWorld.mEntityManager.isAlive(entity))
+        {
+            return std::nullopt;
+        }
+
         auto mask = mWorld.mEntityManager.getMask(entity);
-        if ((mask & mMask) == mMask)
+        if ((mask & mMask) == mMask && this->passesFilters(entity))
         {
             return std::forward_as_tuple(impl::QueryFetcher<ComponentTypes>::arg(
-                mWorld, std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), entity)...);
+                mWorld, std::get<typename impl::QueryFetcher<ComponentTypes>::Type>(mFetched), entity, this->state(),
+                nullptr)...);
         }
 
         return std::nullopt;
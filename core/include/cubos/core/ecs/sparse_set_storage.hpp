@@ -0,0 +1,123 @@
+/// @file
+/// @brief Class @ref cubos::core::ecs::SparseSetStorage.
+/// @ingroup core-ecs
+
+#pragma once
+
+#include <vector>
+
+#include <cubos/core/ecs/storage.hpp>
+
+namespace cubos::core::ecs
+{
+    /// @brief Storage implementation that uses a sparse set.
+    ///
+    /// Components are kept densely packed in a single array, and a paged sparse array maps entity
+    /// indices to positions in it. Insertion and removal are O(1), and memory usage grows with the
+    /// number of components instead of with the highest entity index, which makes this storage a
+    /// good fit for components which only a few entities have.
+    ///
+    /// @tparam T Component type.
+    /// @ingroup core-ecs
+    template <typename T>
+    class SparseSetStorage : public Storage<T>
+    {
+    public:
+        T* insert(uint32_t index, T value) override;
+        T* get(uint32_t index) override;
+        const T* get(uint32_t index) const override;
+        void erase(uint32_t index) override;
+
+    private:
+        /// @brief Number of entity indices covered by each page of the sparse array.
+        static constexpr uint32_t PageSize = 4096;
+
+        /// @brief Value used in the sparse array for entities without a component.
+        static constexpr uint32_t Empty = UINT32_MAX;
+
+        /// @brief Gets the position of an entity's component in the dense arrays.
+        /// @param index Entity index.
+        /// @return Position in the dense arrays, or @ref Empty if the entity has no component.
+        uint32_t find(uint32_t index) const;
+
+        std::vector<std::vector<uint32_t>> mSparse; ///< Pages mapping entity indices to dense positions.
+        std::vector<uint32_t> mIndices;             ///< Entity index of each component in the dense array.
+        std::vector<T> mData;                       ///< Densely packed components.
+    };
+
+    template <typename T>
+    T* SparseSetStorage<T>::insert(uint32_t index, T value)
+    {
+        uint32_t position = this->find(index);
+        if (position != Empty)
+        {
+            mData[position].~T();
+            new (&mData[position]) T(std::move(value));
+            return &mData[position];
+        }
+
+        // Allocate the page where the entity index falls, if it doesn't exist yet.
+        std::size_t page = index / PageSize;
+        if (mSparse.size() <= page)
+        {
+            mSparse.resize(page + 1);
+        }
+        if (mSparse[page].empty())
+        {
+            mSparse[page].resize(PageSize, Empty);
+        }
+
+        mSparse[page][index % PageSize] = static_cast<uint32_t>(mData.size());
+        mIndices.push_back(index);
+        mData.emplace_back(std::move(value));
+        return &mData.back();
+    }
+
+    template <typename T>
+    T* SparseSetStorage<T>::get(uint32_t index)
+    {
+        return &mData[this->find(index)];
+    }
+
+    template <typename T>
+    const T* SparseSetStorage<T>::get(uint32_t index) const
+    {
+        return &mData[this->find(index)];
+    }
+
+    template <typename T>
+    void SparseSetStorage<T>::erase(uint32_t index)
+    {
+        uint32_t position = this->find(index);
+        if (position == Empty)
+        {
+            return;
+        }
+
+        // Move the last component into the hole, so that the dense arrays stay packed.
+        uint32_t last = mIndices.back();
+        if (last != index)
+        {
+            mData[position].~T();
+            new (&mData[position]) T(std::move(mData.back()));
+            mIndices[position] = last;
+            mSparse[last / PageSize][last % PageSize] = position;
+        }
+
+        mSparse[index / PageSize][index % PageSize] = Empty;
+        mIndices.pop_back();
+        mData.pop_back();
+    }
+
+    template <typename T>
+    uint32_t SparseSetStorage<T>::find(uint32_t index) const
+    {
+        std::size_t page = index / PageSize;
+        if (page >= mSparse.size() || mSparse[page].empty())
+        {
+            return Empty;
+        }
+
+        return mSparse[page][index % PageSize];
+    }
+} // namespace cubos::core::ecs
@@ -4,6 +4,12 @@
 
 #pragma once
 
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/data/old/binary_serializer.hpp>
 #include <cubos/core/data/old/package.hpp>
 #include <cubos/core/data/old/serialization_map.hpp>
 #include <cubos/core/ecs/entity_manager.hpp>
@@ -38,12 +44,38 @@ namespace cubos::core::ecs
         /// @return Whether the unpackaging was successful.
         virtual bool unpack(uint32_t index, const data::old::Package& package, data::old::Context* context) = 0;
 
+        /// @brief Writes the values at the given indices to a stream, in the same order.
+        /// @param stream Stream to write to.
+        /// @param indices Indices of the values to write. Must all be present in the storage.
+        virtual void writeSnapshot(memory::Stream& stream, const std::vector<uint32_t>& indices) const = 0;
+
+        /// @brief Reads values written by @ref writeSnapshot() and inserts them at the given indices.
+        /// @param stream Stream to read from.
+        /// @param indices Indices where to insert the values, in the same order they were written.
+        /// @return Whether the values were read successfully.
+        virtual bool readSnapshot(memory::Stream& stream, const std::vector<uint32_t>& indices) = 0;
+
         /// @brief Gets the type the components being stored here.
         /// @return Component type.
         virtual std::type_index type() const = 0;
+
+        /// @brief Called when the storage is registered in a world, or replaces the storage of a
+        /// world, so that it can keep its components in the archetypes of the world's entities.
+        /// @param entities Entity manager of the world.
+        /// @param componentId Identifier of the component type in the world.
+        /// @return Empty column for the archetypes to store the components in, or null if the
+        /// storage keeps them itself.
+        virtual std::unique_ptr<IColumn> attach(const EntityManager& /*entities*/, std::size_t /*componentId*/)
+        {
+            return nullptr;
+        }
     };
 
     /// @brief Abstract container for a component type @p T.
+    ///
+    /// Snapshots of trivially copyable components are written as raw memory blocks, and are thus
+    /// only meant to be read by the same build which wrote them. Other components are serialized.
+    ///
     /// @tparam T Component type.
     /// @ingroup core-ecs
     template <typename T>
@@ -87,6 +119,83 @@ namespace cubos::core::ecs
             return false;
         }
 
+        inline void writeSnapshot(memory::Stream& stream, const std::vector<uint32_t>& indices) const override
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+            {
+                // Written first so that snapshots of a type whose layout changed are rejected.
+                auto size = static_cast<uint32_t>(sizeof(T));
+                stream.write(&size, sizeof(size));
+                if constexpr (!std::is_empty_v<T>)
+                {
+                    // Gather the values into a contiguous block, so that they can be written at once.
+                    std::vector<T> values;
+                    values.reserve(indices.size());
+                    for (auto index : indices)
+                    {
+                        values.push_back(*this->get(index));
+                    }
+                    stream.write(values.data(), values.size() * sizeof(T));
+                }
+            }
+            else
+            {
+                auto ser = data::old::BinarySerializer(stream);
+                for (auto index : indices)
+                {
+                    ser.write(*this->get(index), "data");
+                }
+            }
+        }
+
+        inline bool readSnapshot(memory::Stream& stream, const std::vector<uint32_t>& indices) override
+        {
+            if constexpr (std::is_trivially_copyable_v<T>)
+            {
+                uint32_t size = 0;
+                if (stream.read(&size, sizeof(size)) != sizeof(size) || size != sizeof(T))
+                {
+                    return false;
+                }
+
+                std::vector<T> values(indices.size());
+                if constexpr (!std::is_empty_v<T>)
+                {
+                    if (stream.read(values.data(), values.size() * sizeof(T)) != values.size() * sizeof(T))
+                    {
+                        return false;
+                    }
+                }
+
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                {
+                    this->insert(indices[i], values[i]);
+                }
+            }
+            else
+            {
+                auto des = data::old::BinaryDeserializer(stream);
+                for (std::size_t i = 0; i < indices.size(); ++i)
+                {
+                    T value;
+                    des.read(value);
+                    if (des.failed())
+                    {
+                        // Don't leave the storage with only part of the values.
+                        for (std::size_t j = 0; j < i; ++j)
+                        {
+                            this->erase(indices[j]);
+                        }
+                        return false;
+                    }
+
+                    this->insert(indices[i], std::move(value));
+                }
+            }
+
+            return true;
+        }
+
         inline std::type_index type() const override
         {
             return std::type_index(typeid(T));
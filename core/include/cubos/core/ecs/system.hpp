@@ -37,6 +37,12 @@ namespace cubos::core::ecs
         /// @brief Set of resources the system writes.
         std::unordered_set<std::type_index> resourcesWritten;
 
+        /// @brief Set of resources the system only appends to, such as event pipes.
+        ///
+        /// Systems which append to the same resource may run in parallel, but not alongside
+        /// systems which read or write it.
+        std::unordered_set<std::type_index> resourcesAppended;
+
         /// @brief Set of components the system reads.
         std::unordered_set<std::type_index> componentsRead;
 
@@ -162,7 +168,7 @@ namespace cubos::core::ecs
         struct SystemFetcher<Query<ComponentTypes...>>
         {
             using Type = Query<ComponentTypes...>;
-            using State = std::monostate;
+            using State = QueryState;
 
             static void add(SystemInfo& info);
             static State prepare(World& world);
@@ -221,7 +227,7 @@ namespace cubos::core::ecs
         template <typename T>
         struct SystemFetcher<EventWriter<T>>
         {
-            using Type = WriteResource<EventPipe<T>>;
+            using Type = ReadResource<EventPipe<T>>;
             using State = std::monostate;
 
             static void add(SystemInfo& info);
@@ -463,7 +469,7 @@ namespace cubos::core::ecs
     }
 
     template <typename... ComponentTypes>
-    std::monostate impl::SystemFetcher<Query<ComponentTypes...>>::prepare(World& /*unused*/)
+    QueryState impl::SystemFetcher<Query<ComponentTypes...>>::prepare(World& /*unused*/)
     {
         return {};
     }
@@ -471,9 +477,10 @@ namespace cubos::core::ecs
     template <typename... ComponentTypes>
     Query<ComponentTypes...> impl::SystemFetcher<Query<ComponentTypes...>>::fetch(World& world,
                                                                                   CommandBuffer& /*unused*/,
-                                                                                  State& /*unused*/)
+                                                                                  State& state)
     {
-        return Query<ComponentTypes...>(world);
+        // The query state is kept in the system's state, so that it persists between runs.
+        return Query<ComponentTypes...>(world, &state);
     }
 
     template <typename... ComponentTypes>
@@ -551,9 +558,8 @@ namespace cubos::core::ecs
     }
 
     template <typename T, unsigned int M>
-    std::size_t impl::SystemFetcher<EventReader<T, M>>::prepare(World& world)
+    std::size_t impl::SystemFetcher<EventReader<T, M>>::prepare(World& /*unused*/)
     {
-        world.write<EventPipe<T>>().get().addReader();
         return 0; // Initially we haven't read any events.
     }
 
@@ -568,13 +574,13 @@ namespace cubos::core::ecs
     EventReader<T, M> impl::SystemFetcher<EventReader<T, M>>::arg(
         std::tuple<std::size_t&, ReadResource<EventPipe<T>>>&& fetched)
     {
-        return EventReader<T>(std::get<1>(fetched).get(), std::get<0>(fetched));
+        return EventReader<T, M>(std::get<1>(fetched).get(), std::get<0>(fetched));
     }
 
     template <typename T>
     void impl::SystemFetcher<EventWriter<T>>::add(SystemInfo& info)
     {
-        info.resourcesWritten.insert(typeid(T));
+        info.resourcesAppended.insert(typeid(T));
     }
 
     template <typename T>
@@ -584,16 +590,18 @@ namespace cubos::core::ecs
     }
 
     template <typename T>
-    WriteResource<EventPipe<T>> impl::SystemFetcher<EventWriter<T>>::fetch(World& world, CommandBuffer& /*unused*/,
-                                                                           State& /*unused*/)
+    ReadResource<EventPipe<T>> impl::SystemFetcher<EventWriter<T>>::fetch(World& world, CommandBuffer& /*unused*/,
+                                                                          State& /*unused*/)
     {
-        return world.write<EventPipe<T>>();
+        // Only a read lock is taken, so that multiple writers can run in parallel. Pushing events
+        // is thread-safe, and the scheduler never runs writers alongside readers.
+        return world.read<EventPipe<T>>();
     }
 
     template <typename T>
-    EventWriter<T> impl::SystemFetcher<EventWriter<T>>::arg(WriteResource<EventPipe<T>>&& fetched)
+    EventWriter<T> impl::SystemFetcher<EventWriter<T>>::arg(ReadResource<EventPipe<T>>&& fetched)
     {
-        return EventWriter<T>(fetched.get());
+        return EventWriter<T>(const_cast<EventPipe<T>&>(fetched.get()));
     }
 
     template <typename... Args>
@@ -13,6 +13,11 @@
 #include <cubos/core/ecs/resource_manager.hpp>
 #include <cubos/core/log.hpp>
 
+namespace cubos::core
+{
+    class ThreadPool;
+} // namespace cubos::core
+
 namespace cubos::core::ecs
 {
     namespace impl
@@ -118,6 +123,35 @@ namespace cubos::core::ecs
         /// @return Whether the package was unpacked successfully.
         bool unpack(Entity entity, const data::old::Package& package, data::old::Context* context = nullptr);
 
+        /// @brief Writes all entities and their components to a stream, in a single binary pass.
+        ///
+        /// Entity identifiers are kept exactly, so that components which reference entities
+        /// remain valid when the snapshot is loaded. Trivially copyable components are written
+        /// as raw memory blocks, and thus snapshots are only meant to be loaded by the same build
+        /// which saved them. Resources are not saved.
+        ///
+        /// @param stream Stream to write to.
+        void saveSnapshot(memory::Stream& stream) const;
+
+        /// @brief Replaces all entities and components with the ones in a snapshot written by
+        /// @ref saveSnapshot().
+        ///
+        /// All component types in the snapshot must be registered in this world. The snapshot is
+        /// fully read and validated before any entity is replaced, so if it can't be loaded the
+        /// world is left untouched.
+        ///
+        /// @param stream Stream to read from.
+        /// @return Whether the snapshot was loaded successfully.
+        bool loadSnapshot(memory::Stream& stream);
+
+        /// @brief Sets the thread pool used by queries to process entities in parallel.
+        /// @param pool Thread pool, or null to process entities sequentially.
+        void setThreadPool(ThreadPool* pool);
+
+        /// @brief Gets the thread pool used by queries to process entities in parallel.
+        /// @return Thread pool, or null if none was set.
+        ThreadPool* threadPool() const;
+
         /// @brief Returns an iterator which points to the first entity of the world.
         /// @return Iterator.
         Iterator begin() const;
@@ -136,6 +170,7 @@ namespace cubos::core::ecs
         ResourceManager mResourceManager;
         EntityManager mEntityManager;
         ComponentManager mComponentManager;
+        ThreadPool* mThreadPool = nullptr;
     };
 
     // Implementation.
@@ -151,7 +186,7 @@ namespace cubos::core::ecs
     void World::registerComponent()
     {
         CUBOS_TRACE("Registered component '{}'", getComponentName<T>().value());
-        mComponentManager.registerComponent<T>();
+        mComponentManager.registerComponent<T>(mEntityManager);
     }
 
     template <typename T>
@@ -204,16 +239,12 @@ namespace cubos::core::ecs
         }
 
         auto mask = mEntityManager.getMask(entity);
+        (mask.set(mComponentManager.getID<ComponentTypes>()), ...);
 
-        (
-            [&]() {
-                std::size_t componentId = mComponentManager.getID<ComponentTypes>();
-                mask.set(componentId);
-                mComponentManager.add(entity.index, std::move(components));
-            }(),
-            ...);
-
+        // The mask is updated first, so that storages which keep components in archetypes already
+        // have a row for the entity when the components are inserted.
         mEntityManager.setMask(entity, mask);
+        (mComponentManager.add(entity.index, std::move(components)), ...);
 
 #if CUBOS_LOG_LEVEL <= CUBOS_LOG_LEVEL_DEBUG
         std::string componentNames[] = {"'" + std::string{getComponentName<ComponentTypes>().value()} + "'" ...};
@@ -0,0 +1,120 @@
+/// @file
+/// @brief Class @ref cubos::core::Profiler and profiling macros.
+/// @ingroup core
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace cubos::core::memory
+{
+    class Stream;
+} // namespace cubos::core::memory
+
+/// @addtogroup core
+/// @{
+
+/// @brief Concatenates two tokens, expanding them first.
+#define CUBOS_PROFILE_CONCAT_INNER(a, b) a##b
+
+/// @brief Concatenates two tokens, expanding them first.
+#define CUBOS_PROFILE_CONCAT(a, b) CUBOS_PROFILE_CONCAT_INNER(a, b)
+
+/// @brief Profiles the rest of the current scope as a zone with the given name.
+/// @param name Name of the zone, which must outlive the profiler, such as a string literal.
+#define CUBOS_PROFILE_SCOPE(name)                                                                                      \
+    ::cubos::core::Profiler::Scope CUBOS_PROFILE_CONCAT(cubosProfileScope, __LINE__)(name)
+
+/// @}
+
+namespace cubos::core
+{
+    /// @brief Records how long named zones of code take to run, grouped into frames.
+    ///
+    /// Zones are recorded by @ref Scope objects, usually through @ref CUBOS_PROFILE_SCOPE, on any
+    /// thread. Each call to @ref endFrame() gathers the zones which finished since the previous
+    /// call into a frame, and the most recent frames are kept in a ring buffer. Nothing is
+    /// recorded until the profiler is enabled.
+    ///
+    /// @ingroup core
+    class Profiler final
+    {
+    public:
+        Profiler() = delete;
+
+        /// @brief Timed zone of code.
+        struct Zone
+        {
+            const char* name; ///< Name of the zone.
+            uint32_t thread;  ///< Identifier of the thread which ran the zone.
+            uint32_t depth;   ///< Number of zones the zone is nested in, on its thread.
+            int64_t start;    ///< Time at which the zone started, in nanoseconds.
+            int64_t end;      ///< Time at which the zone ended, in nanoseconds.
+        };
+
+        /// @brief Zones recorded between two calls to @ref endFrame().
+        struct Frame
+        {
+            int64_t start;           ///< Time at which the frame started, in nanoseconds.
+            int64_t end;             ///< Time at which the frame ended, in nanoseconds.
+            std::vector<Zone> zones; ///< Zones which ended during the frame, sorted by start time.
+        };
+
+        /// @brief Records a zone from its construction until its destruction.
+        class Scope final
+        {
+        public:
+            ~Scope();
+
+            /// @brief Starts the zone, if the profiler is enabled.
+            /// @param name Name of the zone, which must outlive the profiler.
+            Scope(const char* name);
+
+            /// @brief Forbid copy construction.
+            Scope(const Scope&) = delete;
+
+        private:
+            const char* mName; ///< Name of the zone, or null if it isn't being recorded.
+            int64_t mStart;    ///< Time at which the zone started.
+        };
+
+        /// @brief Enables or disables recording zones.
+        /// @param enabled Whether zones should be recorded.
+        static void setEnabled(bool enabled);
+
+        /// @brief Checks if zones are being recorded.
+        /// @return Whether zones are being recorded.
+        static bool enabled();
+
+        /// @brief Sets how many frames are kept. Older frames are discarded.
+        /// @param capacity Maximum number of frames.
+        static void setCapacity(std::size_t capacity);
+
+        /// @brief Ends the current frame, moving the zones recorded since the last frame into it.
+        static void endFrame();
+
+        /// @brief Gets the recorded frames.
+        /// @return Frames, from oldest to newest.
+        static std::vector<Frame> frames();
+
+        /// @brief Discards all recorded frames.
+        static void clear();
+
+        /// @brief Gets a name which lives as long as the profiler, for zones with dynamic names.
+        /// @param name Name.
+        /// @return Equal name with a stable address.
+        static const char* intern(std::string_view name);
+
+        /// @brief Gets the current time, as used by zones.
+        /// @return Time in nanoseconds.
+        static int64_t now();
+
+        /// @brief Writes the recorded frames in the Chrome trace event format, which can be opened
+        /// in `chrome://tracing` or Perfetto.
+        /// @param stream Stream to write to.
+        static void writeChromeTrace(memory::Stream& stream);
+    };
+} // namespace cubos::core
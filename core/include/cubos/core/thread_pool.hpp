@@ -1,19 +1,119 @@
 /// @file
-/// @brief Class @ref cubos::core::ThreadPool.
+/// @brief Class @ref cubos::core::ThreadPool and related types.
 /// @ingroup core
 
 #pragma once
 
+#include <atomic>
 #include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <deque>
-#include <functional>
+#include <memory>
 #include <mutex>
+#include <new>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace cubos::core
 {
+    /// @brief Move-only callable which can be submitted to a @ref ThreadPool.
+    ///
+    /// Unlike `std::function`, callables which fit in @ref InlineSize bytes are stored inline,
+    /// without allocating any memory.
+    ///
+    /// @ingroup core
+    class Task final
+    {
+    public:
+        /// @brief Maximum size of the callables stored inline.
+        static constexpr std::size_t InlineSize = 48;
+
+        ~Task();
+
+        /// @brief Constructs a task which calls the given callable.
+        /// @tparam F Callable type.
+        /// @param func Callable.
+        template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, Task>>>
+        Task(F&& func);
+
+        /// @brief Move constructor.
+        /// @param other Task to move from.
+        Task(Task&& other) noexcept;
+
+        /// @brief Forbid copy construction.
+        Task(const Task&) = delete;
+
+        /// @brief Calls the callable.
+        void operator()();
+
+    private:
+        /// @brief Operations on the stored callable.
+        struct VTable
+        {
+            void (*call)(void* storage);
+            void (*move)(void* dst, void* src);
+            void (*destroy)(void* storage);
+        };
+
+        /// @brief Operations for callables stored inline.
+        /// @tparam F Callable type.
+        template <typename F>
+        static constexpr VTable InlineVTable = {
+            [](void* storage) { (*std::launder(reinterpret_cast<F*>(storage)))(); },
+            [](void* dst, void* src) {
+                new (dst) F(std::move(*std::launder(reinterpret_cast<F*>(src))));
+                std::launder(reinterpret_cast<F*>(src))->~F();
+            },
+            [](void* storage) { std::launder(reinterpret_cast<F*>(storage))->~F(); },
+        };
+
+        /// @brief Operations for callables stored on the heap, of which only a pointer is stored.
+        /// @tparam F Callable type.
+        template <typename F>
+        static constexpr VTable HeapVTable = {
+            [](void* storage) { (**std::launder(reinterpret_cast<F**>(storage)))(); },
+            [](void* dst, void* src) { new (dst) F*(*std::launder(reinterpret_cast<F**>(src))); },
+            [](void* storage) { delete *std::launder(reinterpret_cast<F**>(storage)); },
+        };
+
+        alignas(std::max_align_t) unsigned char mStorage[InlineSize]; ///< Callable or pointer to it.
+        const VTable* mVTable;                                        ///< Operations on the callable.
+    };
+
+    /// @brief Counts the unfinished tasks submitted through it, so that they can be waited on
+    /// without waiting for every other task in the pool.
+    /// @note Must outlive the tasks submitted through it.
+    /// @ingroup core
+    class TaskGroup final
+    {
+    public:
+        TaskGroup() = default;
+
+        /// @brief Forbid copy construction.
+        TaskGroup(const TaskGroup&) = delete;
+
+        /// @brief Checks if all tasks submitted through the group have finished.
+        /// @return Whether all tasks finished.
+        bool done() const;
+
+    private:
+        friend class ThreadPool;
+
+        std::atomic<std::size_t> mPending{0}; ///< Number of unfinished tasks.
+    };
+
     /// @brief Manages a pool of threads, to which tasks can be submitted.
+    ///
+    /// Each thread has its own work-stealing deque. Tasks submitted from a thread of the pool are
+    /// pushed to its deque, and run by it in last-in first-out order, while idle threads steal
+    /// the oldest tasks from the others. Tasks submitted from other threads go to a shared queue.
+    ///
+    /// Waiting for tasks runs other pending tasks in the meantime, so tasks may wait for tasks
+    /// they submit without deadlocking the pool.
+    ///
     /// @note Blocks on tasks to finish on destruction.
     /// @ingroup core
     class ThreadPool final
@@ -33,20 +133,89 @@ namespace cubos::core
 
         /// @brief Adds a task to the thread pool. Starts when a thread becomes available.
         /// @param task Task to add.
-        void addTask(std::function<void()> task);
+        void addTask(Task task);
+
+        /// @brief Adds a task to the thread pool, as part of the given group.
+        /// @param group Group to add the task to.
+        /// @param task Task to add.
+        void addTask(TaskGroup& group, Task task);
 
-        /// @brief Blocks until all tasks finish.
+        /// @brief Blocks until all tasks finish, running pending tasks meanwhile.
         void wait();
 
+        /// @brief Blocks until all tasks of the given group finish, running pending tasks
+        /// meanwhile.
+        /// @param group Group to wait for.
+        void wait(TaskGroup& group);
+
+        /// @brief Gets the number of threads in the pool.
+        /// @return Number of threads.
+        std::size_t threadCount() const;
+
     private:
-        std::vector<std::thread> mThreads;        ///< Threads in the pool.
-        std::deque<std::function<void()>> mTasks; ///< Queue of tasks to execute.
+        struct Job;
+        struct JobCache;
+        struct Worker;
 
-        std::mutex mMutex;                 ///< Protects the tasks vector.
-        std::condition_variable mNewTask;  ///< Notifies threads when new tasks may be available.
-        std::condition_variable mTaskDone; ///< Notifies threads when a task has finished executing.
+        /// @brief Submits a task, to this thread's deque if it belongs to the pool, or to the
+        /// shared queue otherwise.
+        /// @param task Task to submit.
+        /// @param group Group the task belongs to, or null.
+        void submit(Task task, TaskGroup* group);
 
-        std::atomic<std::size_t> mNumTasks; ///< Number of tasks currently being executed.
-        bool mStop;                         ///< Set to true when the thread pool is being destroyed.
+        /// @brief Takes a pending job, if there's any.
+        /// @param worker Worker of the calling thread, or null if it doesn't belong to the pool.
+        /// @return Job, or null if none was found.
+        Job* find(Worker* worker);
+
+        /// @brief Runs a job and gives it back to the cache it came from.
+        /// @param job Job to run.
+        void run(Job* job);
+
+        /// @brief Runs pending jobs until the given counter reaches zero.
+        /// @param counter Counter of unfinished tasks.
+        void waitFor(const std::atomic<std::size_t>& counter);
+
+        /// @brief Gets the worker of the calling thread.
+        /// @return Worker, or null if the calling thread doesn't belong to the pool.
+        Worker* current() const;
+
+        /// @brief Wakes sleeping threads, if there are any.
+        /// @param all Whether all threads should be woken, instead of just one.
+        void wake(bool all);
+
+        std::vector<std::unique_ptr<Worker>> mWorkers; ///< Workers of the pool, one per thread.
+        std::vector<std::thread> mThreads;            ///< Threads in the pool.
+
+        std::mutex mInjectedMutex;               ///< Protects the shared queue and its job cache.
+        std::deque<Job*> mInjected;              ///< Jobs submitted from threads outside the pool.
+        std::unique_ptr<JobCache> mInjectedJobs; ///< Jobs recycled by threads outside the pool.
+        std::mutex mMutex;                       ///< Used to put threads to sleep.
+        std::condition_variable mWake;           ///< Notifies sleeping threads of new jobs or finished tasks.
+
+        std::atomic<std::size_t> mInjectedCount{0}; ///< Number of jobs in the shared queue.
+        std::atomic<std::int64_t> mQueued{0};       ///< Number of jobs submitted but not yet taken.
+        std::atomic<std::size_t> mUnfinished{0};    ///< Number of tasks which haven't finished yet.
+        std::atomic<std::size_t> mSleeping{0};      ///< Number of threads sleeping on @ref mWake.
+        std::atomic<bool> mStop{false};             ///< Set to true when the thread pool is being destroyed.
     };
+
+    // Implementation.
+
+    template <typename F, typename>
+    Task::Task(F&& func)
+    {
+        using Func = std::decay_t<F>;
+        if constexpr (sizeof(Func) <= InlineSize && alignof(Func) <= alignof(std::max_align_t) &&
+                      std::is_nothrow_move_constructible_v<Func>)
+        {
+            new (mStorage) Func(std::forward<F>(func));
+            mVTable = &InlineVTable<Func>;
+        }
+        else
+        {
+            new (mStorage) Func*(new Func(std::forward<F>(func)));
+            mVTable = &HeapVTable<Func>;
+        }
+    }
 } // namespace cubos::core
@@ -17,6 +17,11 @@ bool Blueprint::addFromDeserializer(Entity entity, const std::string& name, data
     return Registry::create(name, deserializer, *this, entity);
 }
 
+std::size_t Blueprint::size() const
+{
+    return mMap.size();
+}
+
 Entity Blueprint::entity(const std::string& name) const
 {
     if (!mMap.hasId(name))
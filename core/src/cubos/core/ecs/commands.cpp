@@ -1,5 +1,10 @@
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
 #include <cubos/core/ecs/blueprint.hpp>
 #include <cubos/core/ecs/commands.hpp>
+#include <cubos/core/profiler.hpp>
 
 using namespace cubos::core::ecs;
 
@@ -49,8 +54,17 @@ BlueprintBuilder Commands::spawn(const Blueprint& blueprint)
     return mBuffer.spawn(blueprint);
 }
 
+std::vector<Entity> Commands::spawnMany(const Blueprint& blueprint, std::size_t count)
+{
+    return mBuffer.spawnMany(blueprint, count);
+}
+
+/// @brief Used to give each command buffer a unique identifier.
+static std::atomic<std::size_t> nextBufferId{1};
+
 CommandBuffer::CommandBuffer(World& world)
     : mWorld(world)
+    , mId(nextBufferId++)
 {
     // Do nothing.
 }
@@ -62,89 +76,147 @@ CommandBuffer::~CommandBuffer()
 
 void CommandBuffer::destroy(Entity entity)
 {
-    std::lock_guard<std::mutex> lock(mMutex);
-
-    mDestroyed.insert(entity);
+    this->arena().destroyed.push_back(entity);
 }
 
 BlueprintBuilder CommandBuffer::spawn(const Blueprint& blueprint)
 {
+    auto entities = this->spawnMany(blueprint, 1);
+
     data::old::SerializationMap<Entity, std::string> map;
-    for (uint32_t i = 0; i < static_cast<uint32_t>(blueprint.mMap.size()); ++i)
+    for (uint32_t i = 0; i < static_cast<uint32_t>(entities.size()); ++i)
     {
-        map.add(this->create().entity(), blueprint.mMap.getId(Entity(i, 0)));
+        map.add(entities[i], blueprint.mMap.getId(Entity(i, 0)));
     }
 
-    data::old::Context context;
-    context.push(map);
-    for (const auto& buf : blueprint.mBuffers)
+    return {std::move(map), *this};
+}
+
+std::vector<Entity> CommandBuffer::spawnMany(const Blueprint& blueprint, std::size_t count)
+{
+    CUBOS_PROFILE_SCOPE("CommandBuffer::spawnMany");
+
+    std::vector<Entity> entities(blueprint.size() * count);
     {
-        buf.second->addAll(*this, context);
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto& entity : entities)
+        {
+            entity = mWorld.mEntityManager.create(0);
+        }
     }
 
-    return {std::move(map), *this};
+    Arena& arena = this->arena();
+    arena.created.insert(arena.created.end(), entities.begin(), entities.end());
+
+    // Add the components of each type, while gathering the component masks of the entities, which
+    // are the same on every instance.
+    std::vector<Entity::Mask> masks(blueprint.size());
+    for (const auto& [type, buffer] : blueprint.mBuffers)
+    {
+        buffer->instantiate(*this, blueprint.mMap, entities, count);
+
+        auto id = mWorld.mComponentManager.getIDFromIndex(type);
+        for (auto index : buffer->indices)
+        {
+            masks[index].set(id);
+        }
+    }
+
+    arena.added.reserve(arena.added.size() + entities.size());
+    for (std::size_t i = 0; i < entities.size(); ++i)
+    {
+        arena.added.emplace_back(entities[i], masks[i % masks.size()]);
+    }
+
+    return entities;
 }
 
 void CommandBuffer::commit()
 {
+    CUBOS_PROFILE_SCOPE("CommandBuffer::commit");
     std::lock_guard<std::mutex> lock(mMutex);
+    mWorld.mComponentManager.clampTicks();
 
     // 1. Components are removed.
-    for (auto& [entity, removed] : mRemoved)
+    for (auto& arena : mArenas)
     {
-        for (std::size_t componentId = 1; componentId <= CUBOS_CORE_ECS_MAX_COMPONENTS; ++componentId)
+        for (auto& [entity, removed] : arena->removed)
         {
-            if (removed.test(componentId))
+            for (std::size_t componentId = 1; componentId <= CUBOS_CORE_ECS_MAX_COMPONENTS; ++componentId)
             {
-                mWorld.mComponentManager.remove(entity.index, componentId);
+                if (removed.test(componentId))
+                {
+                    mWorld.mComponentManager.remove(entity.index, componentId);
+                }
             }
         }
     }
 
     // 2. Entities are destroyed.
-    for (auto entity : mDestroyed)
+    for (auto& arena : mArenas)
     {
-        mWorld.mComponentManager.removeAll(entity.index);
-        mWorld.mEntityManager.destroy(entity);
+        for (auto entity : arena->destroyed)
+        {
+            mWorld.mComponentManager.removeAll(entity.index);
+            mWorld.mEntityManager.destroy(entity);
+        }
     }
 
-    // 3. Components are added.
-    for (auto& [entity, added] : mAdded)
+    // 3. The final mask of each entity is computed, and then set only once, so that entities don't
+    // pass through intermediate archetypes. Removals are applied before additions, so that a
+    // component which is both removed and added ends up present.
+    std::vector<std::pair<Entity, Entity::Mask>> masks;
+    std::unordered_map<uint32_t, std::size_t> slots;
+    auto finalMask = [&](Entity entity) -> Entity::Mask& {
+        auto [it, inserted] = slots.try_emplace(entity.index, masks.size());
+        if (inserted)
+        {
+            masks.emplace_back(entity, mWorld.mEntityManager.getMask(entity));
+        }
+        return masks[it->second].second;
+    };
+
+    for (auto& arena : mArenas)
     {
-        for (auto& buf : mBuffers)
+        for (auto& [entity, removed] : arena->removed)
         {
-            buf.second->move(entity, mWorld.mComponentManager);
+            finalMask(entity) &= ~removed;
         }
     }
 
-    // 4. Entities masks are set.
-    for (const auto& entity : mChanged)
+    for (auto& arena : mArenas)
     {
-        // Get the old mask.
-        auto mask = mWorld.mEntityManager.getMask(entity);
-
-        // Remove the components.
-        auto it = mRemoved.find(entity);
-        if (it != mRemoved.end())
+        for (auto& [entity, added] : arena->added)
         {
-            mask &= ~it->second;
+            finalMask(entity) |= added;
         }
+    }
 
-        // Add the new components.
-        it = mAdded.find(entity);
-        if (it != mAdded.end())
+    for (auto& arena : mArenas)
+    {
+        for (auto entity : arena->created)
         {
-            mask |= it->second;
+            finalMask(entity).set(0);
         }
+    }
 
-        // If its a new entity, set the activation bit.
-        if (mCreated.find(entity) != mCreated.end())
+    for (auto& [entity, mask] : masks)
+    {
+        // Entities destroyed in step 2 are skipped, as their generation no longer matches.
+        if (mWorld.mEntityManager.isValid(entity))
         {
-            mask.set(0);
+            mWorld.mEntityManager.setMask(entity, mask);
         }
+    }
 
-        // Update the mask.
-        mWorld.mEntityManager.setMask(entity, mask);
+    // 4. Components are added, one component type at a time. This happens after the masks are
+    // updated, so that storages which keep components in archetypes already have rows for them.
+    for (auto& arena : mArenas)
+    {
+        for (auto& [type, buffer] : arena->buffers)
+        {
+            buffer->moveAll(mWorld.mComponentManager);
+        }
     }
 
     this->clear();
@@ -154,25 +226,92 @@ void CommandBuffer::abort()
 {
     std::lock_guard<std::mutex> lock(mMutex);
 
-    for (auto entity : mCreated)
+    for (auto& arena : mArenas)
     {
-        mWorld.mEntityManager.destroy(entity);
+        for (auto entity : arena->created)
+        {
+            mWorld.mEntityManager.destroy(entity);
+        }
     }
 
     this->clear();
 }
 
-void CommandBuffer::clear()
+/// @brief Sequence key of the commands recorded by the current thread.
+static thread_local std::size_t currentSequence = 0;
+
+void CommandBuffer::setSequence(std::size_t sequence)
+{
+    currentSequence = sequence;
+}
+
+std::size_t CommandBuffer::sequence()
+{
+    return currentSequence;
+}
+
+CommandBuffer::SequenceGuard::SequenceGuard(std::size_t sequence)
+    : mPrevious(currentSequence)
+{
+    currentSequence = sequence;
+}
+
+CommandBuffer::SequenceGuard::~SequenceGuard()
+{
+    currentSequence = mPrevious;
+}
+
+CommandBuffer::Arena& CommandBuffer::arena()
+{
+    // Each thread remembers the last arena it recorded to, so that recording successive commands
+    // to the same buffer with the same sequence key doesn't need to lock.
+    thread_local std::size_t cachedId = 0;
+    thread_local std::size_t cachedSequence = 0;
+    thread_local Arena* cachedArena = nullptr;
+    if (cachedId == mId && cachedSequence == currentSequence)
+    {
+        return *cachedArena;
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto threadId = std::this_thread::get_id();
+    auto it = std::find_if(mArenas.begin(), mArenas.end(), [&](const auto& arena) {
+        return arena->sequence == currentSequence && arena->thread == threadId;
+    });
+    if (it == mArenas.end())
+    {
+        // Insert after every arena with a lower or equal key, keeping the list sorted.
+        it = std::upper_bound(mArenas.begin(), mArenas.end(), currentSequence,
+                              [](std::size_t sequence, const auto& arena) { return sequence < arena->sequence; });
+        it = mArenas.insert(it, std::make_unique<Arena>());
+        (*it)->sequence = currentSequence;
+        (*it)->thread = threadId;
+    }
+
+    cachedId = mId;
+    cachedSequence = currentSequence;
+    cachedArena = it->get();
+    return *cachedArena;
+}
+
+void CommandBuffer::Arena::clear()
 {
-    for (auto& buffer : mBuffers)
+    for (auto& [type, buffer] : this->buffers)
     {
-        delete buffer.second;
+        buffer->clear();
     }
 
-    mBuffers.clear();
-    mCreated.clear();
-    mDestroyed.clear();
-    mAdded.clear();
-    mRemoved.clear();
-    mChanged.clear();
+    this->created.clear();
+    this->destroyed.clear();
+    this->added.clear();
+    this->removed.clear();
+}
+
+void CommandBuffer::clear()
+{
+    // Arenas are kept, as threads hold pointers to them and they can reuse their memory.
+    for (auto& arena : mArenas)
+    {
+        arena->clear();
+    }
 }
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <cubos/core/ecs/component_manager.hpp>
 #include <cubos/core/ecs/registry.hpp>
 
@@ -9,7 +11,7 @@ std::optional<std::string_view> cubos::core::ecs::getComponentName(std::type_ind
     return Registry::name(type);
 }
 
-void ComponentManager::registerComponent(std::type_index type)
+void ComponentManager::registerComponent(std::type_index type, EntityManager& entities)
 {
     if (mTypeToIds.find(type) == mTypeToIds.end())
     {
@@ -20,11 +22,22 @@ void ComponentManager::registerComponent(std::type_index type)
             abort();
         }
 
-        mTypeToIds[type] = mEntries.size() + 1; // Component ids start at 1.
+        auto id = mEntries.size() + 1; // Component ids start at 1.
+        if (auto column = storage->attach(entities, id))
+        {
+            entities.registerColumn(id, std::move(column));
+        }
+
+        mTypeToIds[type] = id;
         mEntries.emplace_back(std::move(storage));
     }
 }
 
+bool ComponentManager::isRegistered(std::type_index type) const
+{
+    return mTypeToIds.find(type) != mTypeToIds.end();
+}
+
 std::size_t ComponentManager::getIDFromIndex(std::type_index type) const
 {
     if (auto it = mTypeToIds.find(type); it != mTypeToIds.end())
@@ -53,6 +66,7 @@ std::type_index ComponentManager::getType(std::size_t id) const
 void ComponentManager::remove(uint32_t id, std::size_t componentId)
 {
     mEntries[componentId - 1].storage->erase(id);
+    this->markRemoved(id, componentId);
 }
 
 void ComponentManager::removeAll(uint32_t id)
@@ -67,6 +81,7 @@ ComponentManager::Entry::Entry(std::unique_ptr<IStorage> storage)
     : storage(std::move(storage))
 {
     this->mutex = std::make_unique<std::shared_mutex>();
+    this->ticks = std::make_unique<ComponentTicks>();
 }
 
 data::old::Package ComponentManager::pack(uint32_t id, std::size_t componentId, data::old::Context* context) const
@@ -77,5 +92,119 @@ data::old::Package ComponentManager::pack(uint32_t id, std::size_t componentId,
 bool ComponentManager::unpack(uint32_t id, std::size_t componentId, const data::old::Package& package,
                               data::old::Context* context)
 {
-    return mEntries[componentId - 1].storage->unpack(id, package, context);
+    if (!mEntries[componentId - 1].storage->unpack(id, package, context))
+    {
+        return false;
+    }
+
+    this->markAdded(id, componentId);
+    return true;
+}
+
+void ComponentManager::writeSnapshot(const std::vector<uint32_t>& ids, std::size_t componentId,
+                                     memory::Stream& stream) const
+{
+    mEntries[componentId - 1].storage->writeSnapshot(stream, ids);
+}
+
+std::unique_ptr<IStorage> ComponentManager::createStorage(std::size_t componentId, EntityManager& entities) const
+{
+    auto storage = Registry::createStorage(this->getType(componentId));
+    if (auto column = storage->attach(entities, componentId))
+    {
+        entities.registerColumn(componentId, std::move(column));
+    }
+
+    return storage;
+}
+
+void ComponentManager::replaceStorage(std::size_t componentId, std::unique_ptr<IStorage> storage,
+                                      EntityManager& entities, const std::vector<uint32_t>& ids)
+{
+    // The columns of the storage, if any, were moved to the given entity manager, which already
+    // has its prototype registered.
+    storage->attach(entities, componentId);
+    mEntries[componentId - 1].storage = std::move(storage);
+
+    auto& ticks = *mEntries[componentId - 1].ticks;
+    auto tick = this->changeTick();
+    std::size_t size = ticks.added.size();
+    for (auto id : ids)
+    {
+        size = std::max(size, static_cast<std::size_t>(id) + 1);
+    }
+    ticks.added.resize(size);
+    ticks.changed.resize(size);
+
+    for (auto id : ids)
+    {
+        ticks.added[id] = ticks.changed[id] = tick;
+    }
+}
+
+std::size_t ComponentManager::count() const
+{
+    return mEntries.size();
+}
+
+uint32_t ComponentManager::advanceTick() const
+{
+    return ++mTick;
+}
+
+void ComponentManager::clampTicks()
+{
+    auto tick = mTick.load();
+    if (tick - mClampedTick < MaxTickAge / 4)
+    {
+        return;
+    }
+
+    // Between clamps ticks age by at most another quarter of the maximum age. Ticks are compared
+    // as signed differences, as changes may be marked with the tick after the current one.
+    mClampedTick = tick;
+    auto oldest = tick - MaxTickAge / 2;
+    for (auto& entry : mEntries)
+    {
+        for (auto* list : {&entry.ticks->added, &entry.ticks->changed, &entry.ticks->removed})
+        {
+            for (auto& stored : *list)
+            {
+                if (static_cast<int32_t>(stored - oldest) < 0)
+                {
+                    stored = oldest;
+                }
+            }
+        }
+    }
+}
+
+uint32_t ComponentManager::changeTick() const
+{
+    // Changes made between query runs share the tick of the next run, instead of each advancing
+    // the tick, so that it doesn't wrap around any sooner than needed.
+    return mTick.load() + 1;
+}
+
+void ComponentManager::markAdded(uint32_t id, std::size_t componentId)
+{
+    auto& ticks = *mEntries[componentId - 1].ticks;
+    if (ticks.added.size() <= id)
+    {
+        ticks.added.resize(id + 1);
+        ticks.changed.resize(id + 1);
+    }
+
+    ticks.added[id] = ticks.changed[id] = this->changeTick();
+}
+
+void ComponentManager::markRemoved(uint32_t id, std::size_t componentId)
+{
+    auto& ticks = *mEntries[componentId - 1].ticks;
+    if (ticks.removed.size() <= id)
+    {
+        ticks.removed.resize(id + 1);
+    }
+
+    ticks.removed[id] = this->changeTick();
 }
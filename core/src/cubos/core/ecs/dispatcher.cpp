@@ -1,6 +1,7 @@
 #include <algorithm>
 
 #include <cubos/core/ecs/dispatcher.hpp>
+#include <cubos/core/profiler.hpp>
 
 using namespace cubos::core::ecs;
 
@@ -11,6 +12,7 @@ void Dispatcher::SystemSettings::copyFrom(const SystemSettings* other)
     std::unique_copy(other->before.system.begin(), other->before.system.end(), std::back_inserter(this->before.system));
     std::unique_copy(other->after.system.begin(), other->after.system.end(), std::back_inserter(this->after.system));
     this->conditions |= other->conditions;
+    this->mainThread |= other->mainThread;
 }
 
 Dispatcher::~Dispatcher()
@@ -59,6 +61,12 @@ void Dispatcher::tagSetBeforeTag(const std::string& tag)
     mTagSettings[tag]->after.tag.push_back(mCurrTag);
 }
 
+void Dispatcher::tagSetMainThread()
+{
+    ENSURE_CURR_TAG();
+    mTagSettings[mCurrTag]->mainThread = true;
+}
+
 void Dispatcher::systemAddTag(const std::string& tag)
 {
     ENSURE_CURR_SYSTEM();
@@ -88,6 +96,24 @@ void Dispatcher::systemSetBeforeTag(const std::string& tag)
     mTagSettings[tag]->after.system.push_back(mCurrSystem);
 }
 
+void Dispatcher::systemSetName(const std::string& name)
+{
+    ENSURE_CURR_SYSTEM();
+    mCurrSystem->name = Profiler::intern(name);
+}
+
+void Dispatcher::systemSetMainThread()
+{
+    ENSURE_CURR_SYSTEM();
+    ENSURE_SYSTEM_SETTINGS(mCurrSystem);
+    mCurrSystem->settings->mainThread = true;
+}
+
+void Dispatcher::setThreadPool(ThreadPool* pool)
+{
+    mThreadPool = pool;
+}
+
 void Dispatcher::handleTagInheritance(std::shared_ptr<SystemSettings>& settings)
 {
     for (auto& parentTag : settings->inherits)
@@ -124,12 +150,12 @@ void Dispatcher::compileChain()
     std::vector<DFSNode> nodes;
     for (System* system : mPendingSystems)
     {
-        nodes.push_back(DFSNode{DFSNode::WHITE, system, "", system->settings});
+        nodes.push_back(DFSNode{DFSNode::WHITE, system, "", system->settings, {}});
     }
 
     for (auto& [tag, settings] : mTagSettings)
     {
-        nodes.push_back(DFSNode{DFSNode::WHITE, nullptr, tag, settings});
+        nodes.push_back(DFSNode{DFSNode::WHITE, nullptr, tag, settings, {}});
     }
 
     // Keep running while there are unvisited nodes
@@ -148,7 +174,96 @@ void Dispatcher::compileChain()
     // on move operations, just reverse the final list for the same effect.
     std::reverse(mSystems.begin(), mSystems.end());
 
-    CUBOS_INFO("Call chain completed successfully!");
+    // Find which systems must run after each system, either directly or through tags, so that
+    // systems with ordering constraints between them never end up in the same stage.
+    std::unordered_map<System*, std::unordered_set<System*>> successors;
+    for (const auto& node : nodes)
+    {
+        if (node.s == nullptr)
+        {
+            continue;
+        }
+
+        auto& reachable = successors[node.s];
+        std::vector<bool> visited(nodes.size(), false);
+        std::vector<std::size_t> stack(node.children);
+        while (!stack.empty())
+        {
+            std::size_t index = stack.back();
+            stack.pop_back();
+            if (visited[index])
+            {
+                continue;
+            }
+
+            visited[index] = true;
+            if (nodes[index].s != nullptr)
+            {
+                reachable.insert(nodes[index].s);
+            }
+            stack.insert(stack.end(), nodes[index].children.begin(), nodes[index].children.end());
+        }
+    }
+
+    // Name unnamed systems after their tags and position in the chain, so that they can be told
+    // apart when profiling.
+    for (std::size_t i = 0; i < mSystems.size(); ++i)
+    {
+        mSystems[i]->index = i;
+        if (mSystems[i]->name == nullptr)
+        {
+            std::vector<std::string> tags(mSystems[i]->tags.begin(), mSystems[i]->tags.end());
+            std::sort(tags.begin(), tags.end());
+
+            std::string name = "#" + std::to_string(i);
+            for (const auto& tag : tags)
+            {
+                name += " " + tag;
+            }
+            mSystems[i]->name = Profiler::intern(name);
+        }
+    }
+
+    std::unordered_map<System*, std::vector<System*>> predecessors;
+    for (const auto& [system, after] : successors)
+    {
+        for (System* other : after)
+        {
+            predecessors[other].push_back(system);
+        }
+    }
+
+    // Pack the systems into stages, in the order of the chain. Each stage takes every system whose
+    // predecessors all ran in earlier stages and which doesn't conflict with the systems already
+    // in it, and the others are left for the next stages. The first system left always fits, as
+    // its predecessors come before it in the chain, so every stage takes at least one system.
+    mStages.clear();
+    std::unordered_set<System*> placed;
+    std::vector<System*> pending = mSystems;
+    while (!pending.empty())
+    {
+        auto& stage = mStages.emplace_back();
+        std::vector<System*> left;
+        for (System* system : pending)
+        {
+            const auto& before = predecessors[system];
+            bool ready =
+                std::all_of(before.begin(), before.end(), [&](System* other) { return placed.contains(other); });
+            if (ready && this->fitsInStage(stage, system))
+            {
+                stage.push_back(system);
+            }
+            else
+            {
+                left.push_back(system);
+            }
+        }
+
+        placed.insert(stage.begin(), stage.end());
+        pending = std::move(left);
+    }
+
+    CUBOS_INFO("Call chain completed successfully! ({} systems in {} stages)", mSystems.size(), mStages.size());
     mPendingSystems.clear();
     mCurrSystem = nullptr;
     mTagSettings.clear();
@@ -176,6 +291,7 @@ bool Dispatcher::dfsVisit(DFSNode& node, std::vector<DFSNode>& nodes)
                     {
                         if (std::find(it->s->tags.begin(), it->s->tags.end(), tag) != it->s->tags.end())
                         {
+                            node.children.push_back(static_cast<std::size_t>(it - nodes.begin()));
                             if (dfsVisit(*it, nodes))
                             {
                                 return true;
@@ -187,6 +303,7 @@ bool Dispatcher::dfsVisit(DFSNode& node, std::vector<DFSNode>& nodes)
                         if (tag == it->t || std::find(it->settings->inherits.begin(), it->settings->inherits.end(),
                                                       tag) != it->settings->inherits.end())
                         {
+                            node.children.push_back(static_cast<std::size_t>(it - nodes.begin()));
                             if (dfsVisit(*it, nodes))
                             {
                                 return true;
@@ -204,6 +321,7 @@ bool Dispatcher::dfsVisit(DFSNode& node, std::vector<DFSNode>& nodes)
                 {
                     if (it->settings.get() == settings)
                     {
+                        node.children.push_back(static_cast<std::size_t>(it - nodes.begin()));
                         if (dfsVisit(*it, nodes))
                         {
                             return true;
@@ -225,6 +343,91 @@ bool Dispatcher::dfsVisit(DFSNode& node, std::vector<DFSNode>& nodes)
     return false;
 }
 
+bool Dispatcher::fitsInStage(const std::vector<System*>& stage, System* system) const
+{
+    const auto& info = system->system->info();
+    bool queries = !info.componentsRead.empty() || !info.componentsWritten.empty();
+    for (System* other : stage)
+    {
+        const auto& otherInfo = other->system->info();
+        bool otherQueries = !otherInfo.componentsRead.empty() || !otherInfo.componentsWritten.empty();
+
+        // Creating entities through commands changes the entity manager, which queries read from.
+        // Otherwise, systems which use commands can share a stage, as the commands of each system
+        // are committed at its end, in the order of the chain.
+        if ((info.usesCommands && otherQueries) || (otherInfo.usesCommands && queries))
+        {
+            return false;
+        }
+
+        if (!info.compatible(otherInfo))
+        {
+            return false;
+        }
+
+        // The conditions of the system are evaluated before the stage starts, and thus must not
+        // depend on anything written by the other systems in it.
+        if (system->settings != nullptr)
+        {
+            for (std::size_t i = 0; i < mConditions.size(); ++i)
+            {
+                if (system->settings->conditions.test(i) && !mConditions[i]->info().compatible(otherInfo))
+                {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void Dispatcher::callSystem(System* system, World& world, CommandBuffer& cmds)
+{
+    CUBOS_PROFILE_SCOPE(system->name);
+
+    // Sequence 0 is left for commands recorded outside of systems, such as by conditions.
+    // The previous key is restored, as this may run nested in another system waiting for tasks.
+    CommandBuffer::SequenceGuard guard{system->index + 1};
+    system->system->call(world, cmds);
+}
+
+bool Dispatcher::checkConditions(System* system, World& world, CommandBuffer& cmds)
+{
+    if (system->settings == nullptr)
+    {
+        return true;
+    }
+
+    auto conditionsMask = system->settings->conditions;
+    std::size_t i = 0;
+    while (conditionsMask.any())
+    {
+        if (conditionsMask.test(0))
+        {
+            // We have a condition, check if it has run already
+            if (!mRunConditions.test(i))
+            {
+                mRunConditions.set(i);
+                if (mConditions[i]->call(world, cmds))
+                {
+                    mRetConditions.set(i);
+                }
+            }
+            // Check if the condition returned true
+            if (!mRetConditions.test(i))
+            {
+                return false;
+            }
+        }
+
+        i += 1;
+        conditionsMask >>= 1;
+    }
+
+    return true;
+}
+
 void Dispatcher::callSystems(World& world, CommandBuffer& cmds)
 {
     // If the systems haven't been prepared yet, do so now.
@@ -248,47 +451,49 @@ void Dispatcher::callSystems(World& world, CommandBuffer& cmds)
     mRunConditions.reset();
     mRetConditions.reset();
 
-    for (auto& system : mSystems)
+    std::vector<System*> toRun;
+    for (auto& stage : mStages)
     {
-        // Query for conditions
-        bool canRun = true;
+        // Conditions are evaluated on this thread, before any system of the stage starts running.
+        toRun.clear();
+        for (System* system : stage)
+        {
+            if (this->checkConditions(system, world, cmds))
+            {
+                toRun.push_back(system);
+            }
+        }
 
-        if (system->settings != nullptr)
+        if (mThreadPool == nullptr || toRun.size() <= 1)
         {
-            auto conditionsMask = system->settings->conditions;
-            std::size_t i = 0;
-            while (conditionsMask.any())
+            for (System* system : toRun)
             {
-                if (conditionsMask.test(0))
+                callSystem(system, world, cmds);
+            }
+        }
+        else
+        {
+            // Only the systems of this stage are waited for, and not unrelated tasks of the pool.
+            TaskGroup group{};
+            for (System* system : toRun)
+            {
+                if (system->settings == nullptr || !system->settings->mainThread)
                 {
-                    // We have a condition, check if it has run already
-                    if (!mRunConditions.test(i))
-                    {
-                        mRunConditions.set(i);
-                        if (mConditions[i]->call(world, cmds))
-                        {
-                            mRetConditions.set(i);
-                        }
-                    }
-                    // Check if the condition returned true
-                    if (!mRetConditions.test(i))
-                    {
-                        canRun = false;
-                        break;
-                    }
+                    mThreadPool->addTask(group, [system, &world, &cmds]() { callSystem(system, world, cmds); });
                 }
+            }
 
-                i += 1;
-                conditionsMask >>= 1;
+            for (System* system : toRun)
+            {
+                if (system->settings != nullptr && system->settings->mainThread)
+                {
+                    callSystem(system, world, cmds);
+                }
             }
-        }
 
-        if (canRun)
-        {
-            system->system->call(world, cmds);
+            mThreadPool->wait(group);
         }
 
-        // TODO: Check synchronization concerns when this gets multithreaded
         cmds.commit();
     }
 }
@@ -93,44 +93,95 @@ bool Entity::isNull() const
 EntityManager::Iterator::Iterator(const EntityManager& e, const Entity::Mask m)
     : mManager(e)
     , mMask(m)
+    , mArchetype(0)
+    , mEntity(0)
 {
     if (!m.test(0))
     {
         abort(); // You can't iterate over invalid entities.
     }
 
-    mArchetypeIt = mManager.mArchetypes.begin();
-    while (mArchetypeIt != mManager.mArchetypes.end() &&
-           ((mArchetypeIt->first & mMask) != mMask || mArchetypeIt->second.empty()))
+    this->skipArchetypes();
+}
+
+EntityManager::Iterator::Iterator(const EntityManager& e, const std::vector<std::size_t>& archetypes)
+    : mManager(e)
+    , mArchetypes(&archetypes)
+    , mArchetype(0)
+    , mEntity(0)
+{
+    this->skipArchetypes();
+}
+
+EntityManager::Iterator::Iterator(const EntityManager& e)
+    : mManager(e)
+    , mArchetype(SIZE_MAX)
+    , mEntity(0)
+{
+    // Do nothing.
+}
+
+bool EntityManager::Iterator::atEnd() const
+{
+    if (mArchetypes != nullptr)
     {
-        ++mArchetypeIt;
+        return mArchetype >= mArchetypes->size();
     }
 
-    if (mArchetypeIt != mManager.mArchetypes.end())
+    return mArchetype >= mManager.mArchetypes.size();
+}
+
+std::size_t EntityManager::Iterator::archetype() const
+{
+    if (mArchetypes != nullptr)
     {
-        mEntityIt = mArchetypeIt->second.begin();
+        return (*mArchetypes)[mArchetype];
     }
+
+    return mArchetype;
 }
 
-EntityManager::Iterator::Iterator(const EntityManager& e)
-    : mManager(e)
+void EntityManager::Iterator::skipArchetypes()
 {
-    mArchetypeIt = mManager.mArchetypes.end();
+    while (!this->atEnd())
+    {
+        const auto& archetype = mManager.mArchetypes[this->archetype()];
+
+        // Archetypes in a list are already known to match, so only the mask iteration checks it.
+        if (!archetype.entities.empty() && (mArchetypes != nullptr || (archetype.mask & mMask) == mMask))
+        {
+            break;
+        }
+
+        ++mArchetype;
+    }
+}
+
+std::size_t EntityManager::Iterator::row() const
+{
+    return mEntity;
+}
+
+IColumn* EntityManager::Iterator::column(std::size_t componentId) const
+{
+    return mManager.mArchetypes[this->archetype()].columns[componentId].get();
 }
 
 Entity EntityManager::Iterator::operator*() const
 {
-    return {*mEntityIt, mManager.mEntities[*mEntityIt].generation};
+    uint32_t index = mManager.mArchetypes[this->archetype()].entities[mEntity];
+    return {index, mManager.mEntities[index].generation};
 }
 
 bool EntityManager::Iterator::operator==(const Iterator& other) const
 {
-    if (other.mArchetypeIt == mManager.mArchetypes.end())
+    bool atEnd = this->atEnd();
+    if (other.atEnd())
     {
-        return mArchetypeIt == mManager.mArchetypes.end();
+        return atEnd;
     }
 
-    return mArchetypeIt == other.mArchetypeIt && mEntityIt == other.mEntityIt;
+    return !atEnd && this->archetype() == other.archetype() && mEntity == other.mEntity;
 }
 
 bool EntityManager::Iterator::operator!=(const Iterator& other) const
@@ -140,26 +191,15 @@ bool EntityManager::Iterator::operator!=(const Iterator& other) const
 
 EntityManager::Iterator& EntityManager::Iterator::operator++()
 {
-    if (mArchetypeIt != mManager.mArchetypes.end())
+    if (!this->atEnd())
     {
-        if (mEntityIt != mArchetypeIt->second.end())
-        {
-            ++mEntityIt;
-        }
-
-        if (mEntityIt == mArchetypeIt->second.end())
+        ++mEntity;
+        if (mEntity >= mManager.mArchetypes[this->archetype()].entities.size())
         {
             // Move to the next archetype.
-            do
-            {
-                ++mArchetypeIt;
-            } while (mArchetypeIt != mManager.mArchetypes.end() &&
-                     ((mArchetypeIt->first & mMask) != mMask || mArchetypeIt->second.empty()));
-
-            if (mArchetypeIt != mManager.mArchetypes.end())
-            {
-                mEntityIt = mArchetypeIt->second.begin();
-            }
+            ++mArchetype;
+            mEntity = 0;
+            this->skipArchetypes();
         }
     }
 
@@ -171,7 +211,7 @@ EntityManager::EntityManager(std::size_t initialCapacity)
     mEntities.reserve(initialCapacity);
     for (std::size_t i = 0; i < initialCapacity; ++i)
     {
-        mEntities.push_back(EntityData{0, 1});
+        mEntities.push_back(EntityData{0, 1, NoArchetype, 0});
         mAvailableEntities.push(static_cast<uint32_t>(i));
     }
 }
@@ -185,7 +225,7 @@ Entity EntityManager::create(Entity::Mask mask)
         mEntities.reserve(oldSize * 2);
         for (std::size_t i = oldSize; i < oldSize * 2; ++i)
         {
-            mEntities.push_back(EntityData{0, 0});
+            mEntities.push_back(EntityData{0, 0, NoArchetype, 0});
             mAvailableEntities.push(static_cast<uint32_t>(i));
         }
     }
@@ -193,9 +233,9 @@ Entity EntityManager::create(Entity::Mask mask)
     uint32_t index = mAvailableEntities.front();
     mAvailableEntities.pop();
     mEntities[index].mask = mask;
-    if (mask.any() && mask.test(0))
+    if (mask.any())
     {
-        mArchetypes[mask].insert(index);
+        this->addToArchetype(index, mask);
     }
 
     return {index, mEntities[index].generation};
@@ -210,20 +250,123 @@ void EntityManager::destroy(Entity entity)
 
 void EntityManager::setMask(Entity entity, Entity::Mask mask)
 {
-    if (mEntities[entity.index].mask != mask)
+    auto& data = mEntities[entity.index];
+    if (data.mask == mask)
+    {
+        return;
+    }
+
+    uint32_t oldArchetype = data.archetype;
+    uint32_t oldRow = data.row;
+    data.mask = mask;
+    data.archetype = NoArchetype;
+    if (mask.any())
+    {
+        this->addToArchetype(entity.index, mask);
+    }
+
+    if (oldArchetype != NoArchetype)
     {
-        if (mEntities[entity.index].mask.any() && mEntities[entity.index].mask.test(0))
+        // Move the components the entity keeps to its new row before the old one is removed.
+        if (data.archetype != NoArchetype)
         {
-            mArchetypes[mEntities[entity.index].mask].erase(entity.index);
+            auto& from = mArchetypes[oldArchetype].columns;
+            auto& to = mArchetypes[data.archetype].columns;
+            for (std::size_t id = 0; id < from.size(); ++id)
+            {
+                if (from[id] != nullptr && to[id] != nullptr)
+                {
+                    to[id]->moveFrom(*from[id], oldRow, data.row);
+                }
+            }
         }
-        mEntities[entity.index].mask = mask;
-        if (mask.any() && mask.test(0))
+
+        this->removeFromArchetype(oldArchetype, oldRow);
+    }
+}
+
+uint32_t EntityManager::archetype(const Entity::Mask& mask)
+{
+    auto it = mArchetypeIds.find(mask);
+    if (it == mArchetypeIds.end())
+    {
+        it = mArchetypeIds.emplace(mask, mArchetypes.size()).first;
+        auto& archetype = mArchetypes.emplace_back(Archetype{mask, {}, {}});
+        archetype.columns.resize(mask.size());
+        for (std::size_t id = 0; id < mColumns.size(); ++id)
+        {
+            if (mColumns[id] != nullptr && mask.test(id))
+            {
+                archetype.columns[id] = mColumns[id]->empty();
+            }
+        }
+    }
+
+    return static_cast<uint32_t>(it->second);
+}
+
+void EntityManager::addToArchetype(uint32_t index, const Entity::Mask& mask)
+{
+    auto id = this->archetype(mask);
+    auto& archetype = mArchetypes[id];
+    mEntities[index].archetype = id;
+    mEntities[index].row = static_cast<uint32_t>(archetype.entities.size());
+    archetype.entities.push_back(index);
+    for (auto& column : archetype.columns)
+    {
+        if (column != nullptr)
+        {
+            column->pushDefault();
+        }
+    }
+}
+
+void EntityManager::removeFromArchetype(uint32_t archetype, uint32_t row)
+{
+    // Swap the entity with the last one of the archetype, so that the rows stay packed.
+    // The removed entity may already be in another archetype, so its row is left untouched.
+    auto& entities = mArchetypes[archetype].entities;
+    if (row + 1 != entities.size())
+    {
+        entities[row] = entities.back();
+        mEntities[entities[row]].row = row;
+    }
+    entities.pop_back();
+    for (auto& column : mArchetypes[archetype].columns)
+    {
+        if (column != nullptr)
         {
-            mArchetypes[mask].insert(entity.index);
+            column->swapRemove(row);
         }
     }
 }
 
+void EntityManager::registerColumn(std::size_t componentId, std::unique_ptr<IColumn> prototype)
+{
+    if (mColumns.size() <= componentId)
+    {
+        mColumns.resize(componentId + 1);
+    }
+
+    mColumns[componentId] = std::move(prototype);
+}
+
+IColumn* EntityManager::column(uint32_t index, std::size_t componentId) const
+{
+    const auto& data = mEntities[index];
+    if (data.archetype == NoArchetype)
+    {
+        return nullptr;
+    }
+
+    return mArchetypes[data.archetype].columns[componentId].get();
+}
+
+uint32_t EntityManager::row(uint32_t index) const
+{
+    return mEntities[index].row;
+}
+
 const Entity::Mask& EntityManager::getMask(Entity entity) const
 {
     return mEntities[entity.index].mask;
@@ -239,6 +382,95 @@ bool EntityManager::isAlive(Entity entity) const
     return this->isValid(entity) && mEntities[entity.index].mask.test(0);
 }
 
+std::size_t EntityManager::capacity() const
+{
+    return mEntities.size();
+}
+
+uint32_t EntityManager::generation(uint32_t index) const
+{
+    return mEntities[index].generation;
+}
+
+void EntityManager::reset(const std::vector<uint32_t>& generations, const std::vector<Entity::Mask>& masks)
+{
+    for (auto& archetype : mArchetypes)
+    {
+        archetype.entities.clear();
+        for (auto& column : archetype.columns)
+        {
+            if (column != nullptr)
+            {
+                column->clear();
+            }
+        }
+    }
+
+    mEntities.clear();
+    mAvailableEntities = {};
+    for (std::size_t i = 0; i < generations.size(); ++i)
+    {
+        auto index = static_cast<uint32_t>(i);
+        mEntities.push_back(EntityData{generations[i], masks[i], NoArchetype, 0});
+        if (masks[i].test(0))
+        {
+            this->addToArchetype(index, masks[i]);
+        }
+        else
+        {
+            mAvailableEntities.push(index);
+        }
+    }
+
+    if (mEntities.empty())
+    {
+        // The pool must never be empty, as it grows by doubling its size.
+        mEntities.push_back(EntityData{0, 0, NoArchetype, 0});
+        mAvailableEntities.push(0);
+    }
+}
+
+void EntityManager::replace(EntityManager&& other)
+{
+    for (auto& archetype : mArchetypes)
+    {
+        archetype.entities.clear();
+        for (auto& column : archetype.columns)
+        {
+            if (column != nullptr)
+            {
+                column->clear();
+            }
+        }
+    }
+
+    // Move each archetype of the other manager into the matching one of this manager, and
+    // remember where it went, so that the archetype indices of the entities can be fixed.
+    std::vector<uint32_t> ids(other.mArchetypes.size());
+    for (std::size_t i = 0; i < other.mArchetypes.size(); ++i)
+    {
+        ids[i] = this->archetype(other.mArchetypes[i].mask);
+        auto& archetype = mArchetypes[ids[i]];
+        archetype.entities = std::move(other.mArchetypes[i].entities);
+        archetype.columns = std::move(other.mArchetypes[i].columns);
+    }
+
+    mEntities = std::move(other.mEntities);
+    mAvailableEntities = std::move(other.mAvailableEntities);
+    for (auto& data : mEntities)
+    {
+        if (data.archetype != NoArchetype)
+        {
+            data.archetype = ids[data.archetype];
+        }
+    }
+
+    other.mEntities.clear();
+    other.mAvailableEntities = {};
+    other.mArchetypes.clear();
+    other.mArchetypeIds.clear();
+}
+
 EntityManager::Iterator EntityManager::begin() const
 {
     return {*this, Entity::Mask(1)};
@@ -249,6 +481,23 @@ EntityManager::Iterator EntityManager::withMask(Entity::Mask mask) const
     return {*this, mask};
 }
 
+EntityManager::Iterator EntityManager::withArchetypes(const std::vector<std::size_t>& archetypes) const
+{
+    return {*this, archetypes};
+}
+
+void EntityManager::matchArchetypes(const Entity::Mask& mask, std::size_t& seen,
+                                    std::vector<std::size_t>& archetypes) const
+{
+    for (; seen < mArchetypes.size(); ++seen)
+    {
+        if ((mArchetypes[seen].mask & mask) == mask)
+        {
+            archetypes.push_back(seen);
+        }
+    }
+}
+
 EntityManager::Iterator EntityManager::end() const
 {
     return {*this};
@@ -7,10 +7,18 @@ bool SystemInfo::valid() const
     if (this->usesWorld)
     {
         return !this->usesCommands && this->resourcesRead.empty() && this->resourcesWritten.empty() &&
-               this->componentsRead.empty() && this->componentsWritten.empty();
+               this->resourcesAppended.empty() && this->componentsRead.empty() && this->componentsWritten.empty();
     }
 
     for (const auto& rsc : this->resourcesRead)
+    {
+        if (this->resourcesWritten.contains(rsc) || this->resourcesAppended.contains(rsc))
+        {
+            return false;
+        }
+    }
+
+    for (const auto& rsc : this->resourcesAppended)
     {
         if (this->resourcesWritten.contains(rsc))
         {
@@ -38,7 +46,15 @@ bool SystemInfo::compatible(const SystemInfo& other) const
 
     for (const auto& rsc : this->resourcesRead)
     {
-        if (other.resourcesWritten.contains(rsc))
+        if (other.resourcesWritten.contains(rsc) || other.resourcesAppended.contains(rsc))
+        {
+            return false;
+        }
+    }
+
+    for (const auto& rsc : this->resourcesAppended)
+    {
+        if (other.resourcesRead.contains(rsc) || other.resourcesWritten.contains(rsc))
         {
             return false;
         }
@@ -54,7 +70,8 @@ bool SystemInfo::compatible(const SystemInfo& other) const
 
     for (const auto& rsc : this->resourcesWritten)
     {
-        if (other.resourcesRead.contains(rsc) || other.resourcesWritten.contains(rsc))
+        if (other.resourcesRead.contains(rsc) || other.resourcesWritten.contains(rsc) ||
+            other.resourcesAppended.contains(rsc))
         {
             return false;
         }
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <cubos/core/ecs/registry.hpp>
 #include <cubos/core/ecs/world.hpp>
 
@@ -52,10 +54,11 @@ bool World::unpack(Entity entity, const data::old::Package& package, data::old::
 
     // Remove all existing components.
     mComponentManager.removeAll(entity.index);
+    mEntityManager.setMask(entity, Entity::Mask{1});
 
     Entity::Mask mask{1};
     bool success = true;
-
+    std::vector<std::pair<std::size_t, const data::old::Package*>> components;
     for (const auto& field : package.fields())
     {
         auto type = Registry::type(field.first);
@@ -67,13 +70,19 @@ bool World::unpack(Entity entity, const data::old::Package& package, data::old::
         }
 
         auto id = mComponentManager.getIDFromIndex(*type);
-        if (mComponentManager.unpack(entity.index, id, field.second, context))
-        {
-            mask.set(id);
-        }
-        else
+        mask.set(id);
+        components.emplace_back(id, &field.second);
+    }
+
+    // The mask is set before unpacking, so that storages which keep components in archetypes
+    // already have a row for the entity. Components which fail to unpack are removed again.
+    mEntityManager.setMask(entity, mask);
+    for (const auto& [id, componentPackage] : components)
+    {
+        if (!mComponentManager.unpack(entity.index, id, *componentPackage, context))
         {
-            CUBOS_ERROR("Could not unpack component '{}'", field.first);
+            CUBOS_ERROR("Could not unpack component '{}'", Registry::name(mComponentManager.getType(id)).value());
+            mask.reset(id);
             success = false;
         }
     }
@@ -82,6 +91,197 @@ bool World::unpack(Entity entity, const data::old::Package& package, data::old::
     return success;
 }
 
+/// @brief Identifies world snapshots, and their format version.
+static constexpr uint32_t SnapshotMagic = 0x43554253; // "CUBS"
+static constexpr uint32_t SnapshotVersion = 2;
+
+/// @brief Writes a vector of integers to a stream, prefixed by its size.
+/// @param stream Stream to write to.
+/// @param values Values to write.
+static void writeIndices(memory::Stream& stream, const std::vector<uint32_t>& values)
+{
+    auto size = static_cast<uint32_t>(values.size());
+    stream.write(&size, sizeof(size));
+    stream.write(values.data(), values.size() * sizeof(uint32_t));
+}
+
+/// @brief Reads a vector of integers written by @ref writeIndices() from a stream.
+/// @param stream Stream to read from.
+/// @param[out] values Read values.
+/// @return Whether the values were read successfully.
+static bool readIndices(memory::Stream& stream, std::vector<uint32_t>& values)
+{
+    uint32_t size = 0;
+    if (stream.read(&size, sizeof(size)) != sizeof(size))
+    {
+        return false;
+    }
+
+    values.resize(size);
+    return stream.read(values.data(), values.size() * sizeof(uint32_t)) == values.size() * sizeof(uint32_t);
+}
+
+void World::saveSnapshot(memory::Stream& stream) const
+{
+    stream.write(&SnapshotMagic, sizeof(SnapshotMagic));
+    stream.write(&SnapshotVersion, sizeof(SnapshotVersion));
+
+    // Generations are written for free slots too, so that identifiers of entities destroyed
+    // before the snapshot was taken don't become valid again after it is loaded.
+    std::vector<uint32_t> generations(mEntityManager.capacity());
+    for (std::size_t i = 0; i < generations.size(); ++i)
+    {
+        generations[i] = mEntityManager.generation(static_cast<uint32_t>(i));
+    }
+    writeIndices(stream, generations);
+
+    std::vector<uint32_t> alive;
+    for (auto entity : mEntityManager)
+    {
+        alive.push_back(entity.index);
+    }
+    writeIndices(stream, alive);
+
+    // Component identifiers depend on the registration order, so columns are identified by the
+    // component names, and the masks are rebuilt from the columns each entity appears in. Every
+    // column is written before any component, so that the entities can be placed in their final
+    // archetypes before the components are read.
+    auto count = static_cast<uint32_t>(mComponentManager.count());
+    stream.write(&count, sizeof(count));
+    std::vector<std::vector<uint32_t>> columns(mComponentManager.count() + 1);
+    for (std::size_t id = 1; id <= mComponentManager.count(); ++id)
+    {
+        auto name = Registry::name(mComponentManager.getType(id)).value();
+        auto nameSize = static_cast<uint32_t>(name.size());
+        stream.write(&nameSize, sizeof(nameSize));
+        stream.write(name.data(), name.size());
+
+        Entity::Mask mask{};
+        mask.set(0);
+        mask.set(id);
+        for (auto it = mEntityManager.withMask(mask); it != mEntityManager.end(); ++it)
+        {
+            columns[id].push_back((*it).index);
+        }
+        writeIndices(stream, columns[id]);
+    }
+
+    for (std::size_t id = 1; id <= mComponentManager.count(); ++id)
+    {
+        mComponentManager.writeSnapshot(columns[id], id, stream);
+    }
+}
+
+bool World::loadSnapshot(memory::Stream& stream)
+{
+    uint32_t magic = 0;
+    uint32_t version = 0;
+    stream.read(&magic, sizeof(magic));
+    stream.read(&version, sizeof(version));
+    if (magic != SnapshotMagic || version != SnapshotVersion)
+    {
+        CUBOS_ERROR("Stream doesn't contain a world snapshot of version {}", SnapshotVersion);
+        return false;
+    }
+
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> alive;
+    if (!readIndices(stream, generations) || !readIndices(stream, alive))
+    {
+        CUBOS_ERROR("Could not read the entities of the world snapshot");
+        return false;
+    }
+
+    std::vector<Entity::Mask> masks(generations.size());
+    for (auto index : alive)
+    {
+        if (index >= masks.size())
+        {
+            CUBOS_ERROR("World snapshot contains an invalid entity index {}", index);
+            return false;
+        }
+
+        masks[index].set(0);
+    }
+
+    uint32_t count = 0;
+    stream.read(&count, sizeof(count));
+    std::vector<std::size_t> ids;
+    std::vector<std::vector<uint32_t>> columns(mComponentManager.count() + 1);
+    std::vector<bool> read(mComponentManager.count() + 1, false);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t nameSize = 0;
+        stream.read(&nameSize, sizeof(nameSize));
+        std::string name(nameSize, '\0');
+        stream.read(name.data(), name.size());
+
+        auto type = Registry::type(name);
+        if (!type.has_value() || !mComponentManager.isRegistered(*type))
+        {
+            CUBOS_ERROR("Component type '{}' is not registered in this world", name);
+            return false;
+        }
+
+        auto id = mComponentManager.getIDFromIndex(*type);
+        auto& column = columns[id];
+        if (read[id] || !readIndices(stream, column) ||
+            !std::all_of(column.begin(), column.end(),
+                         [&](uint32_t index) { return index < masks.size() && masks[index].test(0); }))
+        {
+            CUBOS_ERROR("Could not read the entities with components of type '{}'", name);
+            return false;
+        }
+        read[id] = true;
+        ids.push_back(id);
+
+        for (auto index : column)
+        {
+            masks[index].set(id);
+        }
+    }
+
+    // The snapshot is read into a temporary entity manager and storages, which only replace the
+    // current ones once everything has been read, so that the world is left untouched on failure.
+    // The storages are created before the entities, so that archetypes get their columns, and
+    // each entity is placed straight into its final archetype.
+    EntityManager entities{0};
+    std::vector<std::unique_ptr<IStorage>> storages;
+    for (std::size_t id = 1; id <= mComponentManager.count(); ++id)
+    {
+        storages.push_back(mComponentManager.createStorage(id, entities));
+    }
+    entities.reset(generations, masks);
+
+    for (auto id : ids)
+    {
+        if (!storages[id - 1]->readSnapshot(stream, columns[id]))
+        {
+            CUBOS_ERROR("Could not read the components of type '{}'",
+                        Registry::name(mComponentManager.getType(id)).value());
+            return false;
+        }
+    }
+
+    mEntityManager.replace(std::move(entities));
+    for (std::size_t id = 1; id <= mComponentManager.count(); ++id)
+    {
+        mComponentManager.replaceStorage(id, std::move(storages[id - 1]), mEntityManager, columns[id]);
+    }
+
+    return true;
+}
+
+void World::setThreadPool(ThreadPool* pool)
+{
+    mThreadPool = pool;
+}
+
+ThreadPool* World::threadPool() const
+{
+    return mThreadPool;
+}
+
 World::Iterator World::begin() const
 {
     return mEntityManager.begin();
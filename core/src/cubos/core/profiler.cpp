@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+#include <cubos/core/memory/stream.hpp>
+#include <cubos/core/profiler.hpp>
+
+using namespace cubos::core;
+
+/// @brief Zones recorded by a thread which haven't been gathered into a frame yet.
+struct ThreadZones
+{
+    std::mutex mutex;                  ///< Protects the zones, which are only gathered at frame ends.
+    std::vector<Profiler::Zone> zones; ///< Zones recorded since the last frame ended.
+    uint32_t id;                       ///< Identifier of the thread.
+    uint32_t depth = 0;                ///< Number of zones currently open on the thread.
+};
+
+/// @brief Global state of the profiler.
+struct ProfilerState
+{
+    std::atomic<bool> enabled{false};
+
+    std::mutex mutex; ///< Protects everything below.
+    std::vector<std::shared_ptr<ThreadZones>> threads;
+    std::deque<Profiler::Frame> frames;
+    std::size_t capacity = 300;
+    int64_t frameStart = Profiler::now();
+    std::unordered_set<std::string> names;
+};
+
+/// @brief Gets the global state of the profiler, initializing it on first use.
+/// @return Profiler state.
+static ProfilerState& state()
+{
+    static ProfilerState state;
+    return state;
+}
+
+/// @brief Gets the zones of the calling thread, registering it on first use.
+/// @return Thread zones.
+static ThreadZones& threadZones()
+{
+    thread_local std::shared_ptr<ThreadZones> zones = []() {
+        auto zones = std::make_shared<ThreadZones>();
+        std::lock_guard lock(state().mutex);
+        zones->id = static_cast<uint32_t>(state().threads.size()) + 1; // Thread 0 is used for frames.
+        state().threads.push_back(zones);
+        return zones;
+    }();
+    return *zones;
+}
+
+/// @brief Writes a string as a JSON string literal.
+/// @param stream Stream to write to.
+/// @param str String to write.
+static void printJsonString(memory::Stream& stream, const char* str)
+{
+    stream.put('"');
+    for (; *str != '\0'; ++str)
+    {
+        if (*str == '"' || *str == '\\')
+        {
+            stream.put('\\');
+            stream.put(*str);
+        }
+        else if (static_cast<unsigned char>(*str) < 0x20)
+        {
+            stream.put(' ');
+        }
+        else
+        {
+            stream.put(*str);
+        }
+    }
+    stream.put('"');
+}
+
+/// @brief Writes a single complete event in the Chrome trace event format.
+/// @param stream Stream to write to.
+/// @param name Name of the event.
+/// @param thread Identifier of the thread.
+/// @param start Start time, in nanoseconds since the start of the trace.
+/// @param duration Duration, in nanoseconds.
+static void printChromeEvent(memory::Stream& stream, const char* name, uint32_t thread, int64_t start,
+                             int64_t duration)
+{
+    stream.print("{\"name\":");
+    printJsonString(stream, name);
+    stream.print(",\"ph\":\"X\",\"pid\":0,\"tid\":");
+    stream.print(thread);
+    stream.print(",\"ts\":");
+    stream.print(static_cast<double>(start) / 1000.0, 3);
+    stream.print(",\"dur\":");
+    stream.print(static_cast<double>(duration) / 1000.0, 3);
+    stream.put('}');
+}
+
+Profiler::Scope::~Scope()
+{
+    if (mName != nullptr)
+    {
+        auto end = Profiler::now();
+        auto& zones = threadZones();
+        zones.depth -= 1;
+
+        std::lock_guard lock(zones.mutex);
+        zones.zones.push_back({mName, zones.id, zones.depth, mStart, end});
+    }
+}
+
+Profiler::Scope::Scope(const char* name)
+    : mName(nullptr)
+    , mStart(0)
+{
+    if (Profiler::enabled())
+    {
+        threadZones().depth += 1;
+        mName = name;
+        mStart = Profiler::now();
+    }
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    state().enabled = enabled;
+}
+
+bool Profiler::enabled()
+{
+    return state().enabled.load(std::memory_order_relaxed);
+}
+
+void Profiler::setCapacity(std::size_t capacity)
+{
+    std::lock_guard lock(state().mutex);
+    state().capacity = capacity;
+    while (state().frames.size() > capacity)
+    {
+        state().frames.pop_front();
+    }
+}
+
+void Profiler::endFrame()
+{
+    auto end = Profiler::now();
+    std::lock_guard lock(state().mutex);
+
+    Frame frame{state().frameStart, end, {}};
+    for (auto& thread : state().threads)
+    {
+        std::lock_guard threadLock(thread->mutex);
+        frame.zones.insert(frame.zones.end(), thread->zones.begin(), thread->zones.end());
+        thread->zones.clear();
+    }
+
+    state().frameStart = end;
+    if (!Profiler::enabled() && frame.zones.empty())
+    {
+        return;
+    }
+
+    std::sort(frame.zones.begin(), frame.zones.end(), [](const Zone& a, const Zone& b) { return a.start < b.start; });
+    state().frames.push_back(std::move(frame));
+    while (state().frames.size() > state().capacity)
+    {
+        state().frames.pop_front();
+    }
+}
+
+std::vector<Profiler::Frame> Profiler::frames()
+{
+    std::lock_guard lock(state().mutex);
+    return {state().frames.begin(), state().frames.end()};
+}
+
+void Profiler::clear()
+{
+    std::lock_guard lock(state().mutex);
+    state().frames.clear();
+}
+
+const char* Profiler::intern(std::string_view name)
+{
+    std::lock_guard lock(state().mutex);
+    return state().names.emplace(name).first->c_str();
+}
+
+int64_t Profiler::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+void Profiler::writeChromeTrace(memory::Stream& stream)
+{
+    auto frames = Profiler::frames();
+    int64_t origin = frames.empty() ? 0 : frames.front().start;
+
+    stream.print("{\"traceEvents\":[");
+    bool first = true;
+    for (const auto& frame : frames)
+    {
+        stream.print(first ? "\n" : ",\n");
+        first = false;
+        printChromeEvent(stream, "Frame", 0, frame.start - origin, frame.end - frame.start);
+
+        for (const auto& zone : frame.zones)
+        {
+            stream.print(",\n");
+            printChromeEvent(stream, zone.name, zone.thread, zone.start - origin, zone.end - zone.start);
+        }
+    }
+    stream.print("\n]}\n");
+}
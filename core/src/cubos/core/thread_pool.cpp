@@ -1,39 +1,282 @@
+#include <optional>
+#include <utility>
+
 #include <cubos/core/thread_pool.hpp>
 
 using namespace cubos::core;
 
+/// @brief Number of times a waiting thread looks for jobs before going to sleep.
+static constexpr int SpinCount = 64;
+
+/// @brief Task submitted to the pool, along with the group it belongs to.
+struct ThreadPool::Job
+{
+    std::optional<Task> task; ///< Task, reset once it runs so that its captures are released.
+    TaskGroup* group;         ///< Group the task belongs to, or null.
+    JobCache* cache;          ///< Cache the job is given back to after it runs.
+    Job* next;                ///< Next job in the cache, while the job is in one.
+};
+
+/// @brief Recycles the jobs submitted by a thread, so that submitting tasks doesn't allocate
+/// once the thread has submitted as many tasks at a time as it usually does.
+///
+/// Jobs are given back to the cache of the thread which submitted them. Only the owner takes
+/// jobs from a cache. Other threads push the jobs they give back to a lock-free stack, which the
+/// owner takes whole once its own list runs out, so popping never races with another pop.
+struct ThreadPool::JobCache
+{
+    Job* owned = nullptr;                ///< Jobs which only the owner touches.
+    std::atomic<Job*> returned{nullptr}; ///< Jobs given back by other threads.
+
+    ~JobCache()
+    {
+        for (Job* list : {owned, returned.load(std::memory_order_acquire)})
+        {
+            while (list != nullptr)
+            {
+                delete std::exchange(list, list->next);
+            }
+        }
+    }
+
+    /// @brief Takes a job from the cache, or allocates one if it's empty. Must only be called by
+    /// the owner.
+    /// @param task Task of the job.
+    /// @param group Group of the job, or null.
+    /// @return Job.
+    Job* take(Task task, TaskGroup* group)
+    {
+        if (owned == nullptr)
+        {
+            owned = returned.exchange(nullptr, std::memory_order_acquire);
+        }
+
+        Job* job = owned;
+        if (job != nullptr)
+        {
+            owned = job->next;
+        }
+        else
+        {
+            job = new Job{std::nullopt, nullptr, this, nullptr};
+        }
+
+        job->task.emplace(std::move(task));
+        job->group = group;
+        return job;
+    }
+
+    /// @brief Gives a job back to the cache.
+    /// @param job Job, whose task has already been reset.
+    /// @param owner Whether the calling thread is the owner of the cache.
+    void give(Job* job, bool owner)
+    {
+        if (owner)
+        {
+            job->next = owned;
+            owned = job;
+            return;
+        }
+
+        job->next = returned.load(std::memory_order_relaxed);
+        while (!returned.compare_exchange_weak(job->next, job, std::memory_order_release, std::memory_order_relaxed))
+        {
+            // Do nothing.
+        }
+    }
+};
+
+/// @brief Thread of the pool, along with its work-stealing deque.
+///
+/// The deque is a Chase-Lev deque: the owner thread pushes and pops jobs at the bottom without
+/// locking, while other threads steal jobs from the top with a single compare-and-swap.
+struct ThreadPool::Worker
+{
+    /// @brief Circular array of jobs, whose capacity is a power of two.
+    struct Ring
+    {
+        std::int64_t capacity;
+        std::unique_ptr<std::atomic<Job*>[]> slots;
+
+        Ring(std::int64_t capacity)
+            : capacity(capacity)
+            , slots(new std::atomic<Job*>[static_cast<std::size_t>(capacity)])
+        {
+            // Do nothing.
+        }
+
+        Job* get(std::int64_t i) const
+        {
+            return slots[static_cast<std::size_t>(i & (capacity - 1))].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, Job* job)
+        {
+            slots[static_cast<std::size_t>(i & (capacity - 1))].store(job, std::memory_order_relaxed);
+        }
+    };
+
+    std::size_t index; ///< Index of the worker in the pool.
+    JobCache jobs;     ///< Jobs submitted by the worker's thread.
+
+    std::atomic<std::int64_t> top{0};    ///< Index of the oldest job, where jobs are stolen from.
+    std::atomic<std::int64_t> bottom{0}; ///< Index past the newest job, where the owner works.
+    std::atomic<Ring*> ring;             ///< Current array of jobs.
+
+    /// @brief Arrays replaced by bigger ones. Thieves may still be reading them, so they're only
+    /// freed along with the worker.
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    Worker(std::size_t index)
+        : index(index)
+    {
+        rings.push_back(std::make_unique<Ring>(256));
+        ring.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    /// @brief Pushes a job to the bottom of the deque. Must only be called by the owner.
+    void push(Job* job)
+    {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        Ring* r = ring.load(std::memory_order_relaxed);
+        if (b - t > r->capacity - 1)
+        {
+            // The deque is full, copy its jobs to an array twice as big.
+            rings.push_back(std::make_unique<Ring>(r->capacity * 2));
+            for (auto i = t; i < b; ++i)
+            {
+                rings.back()->put(i, r->get(i));
+            }
+
+            r = rings.back().get();
+            ring.store(r, std::memory_order_release);
+        }
+
+        r->put(b, job);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    /// @brief Pops the newest job from the bottom of the deque. Must only be called by the owner.
+    Job* pop()
+    {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        Ring* r = ring.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+
+        if (t > b)
+        {
+            // The deque was empty.
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return nullptr;
+        }
+
+        Job* job = r->get(b);
+        if (t == b)
+        {
+            // This is the last job, so we must race thieves for it.
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                job = nullptr;
+            }
+
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+
+        return job;
+    }
+
+    /// @brief Steals the oldest job from the top of the deque. May be called by any thread.
+    Job* steal()
+    {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+        {
+            return nullptr;
+        }
+
+        Job* job = ring.load(std::memory_order_acquire)->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr; // Lost the race to another thief or to the owner.
+        }
+
+        return job;
+    }
+};
+
+/// @brief Pool the current thread belongs to, if any.
+static thread_local const ThreadPool* currentPool = nullptr;
+
+/// @brief Index of the current thread in its pool.
+static thread_local std::size_t currentIndex = 0;
+
+Task::~Task()
+{
+    if (mVTable != nullptr)
+    {
+        mVTable->destroy(mStorage);
+    }
+}
+
+Task::Task(Task&& other) noexcept
+    : mVTable(other.mVTable)
+{
+    if (mVTable != nullptr)
+    {
+        mVTable->move(mStorage, other.mStorage);
+        other.mVTable = nullptr;
+    }
+}
+
+void Task::operator()()
+{
+    mVTable->call(mStorage);
+}
+
+bool TaskGroup::done() const
+{
+    return mPending.load(std::memory_order_acquire) == 0;
+}
+
 ThreadPool::ThreadPool(std::size_t numThreads)
+    : mInjectedJobs(std::make_unique<JobCache>())
 {
-    mThreads.reserve(numThreads);
-    mNumTasks = 0;
-    mStop = false;
+    // All workers must exist before any thread starts, as threads steal from each other.
+    mWorkers.reserve(numThreads);
+    for (std::size_t i = 0; i < numThreads; i++)
+    {
+        mWorkers.push_back(std::make_unique<Worker>(i));
+    }
 
+    mThreads.reserve(numThreads);
     for (std::size_t i = 0; i < numThreads; i++)
     {
-        mThreads.emplace_back([this]() {
+        mThreads.emplace_back([this, i, worker = mWorkers[i].get()]() {
+            currentPool = this;
+            currentIndex = i;
             while (true)
             {
-                std::function<void()> task;
-
+                if (Job* job = this->find(worker))
                 {
-                    std::unique_lock<std::mutex> lock(mMutex);
-
-                    // Wait until a task is available, or the thread pool is being destroyed.
-                    mNewTask.wait(lock, [this]() { return mStop || !mTasks.empty(); });
-                    if (mStop && mTasks.empty())
-                    {
-                        return; // Thread pool is being destroyed, and there are no more tasks to execute.
-                    }
-                    task = std::move(mTasks.front());
-                    mTasks.pop_front();
-                    mNumTasks += 1; // A task is being executed.
+                    this->run(job);
+                    continue;
                 }
 
-                task();
-                mNumTasks -= 1; // Task has finished executing.
-
-                // Signal that a thread has finished executing a task.
-                mTaskDone.notify_one();
+                // Sleep until a job is submitted or the pool is being destroyed.
+                std::unique_lock<std::mutex> lock(mMutex);
+                mSleeping += 1;
+                mWake.wait(lock, [this]() { return mStop || mQueued > 0; });
+                mSleeping -= 1;
+                if (mStop)
+                {
+                    return;
+                }
             }
         });
     }
@@ -41,25 +284,177 @@ ThreadPool::ThreadPool(std::size_t numThreads)
 
 ThreadPool::~ThreadPool()
 {
-    mStop = true;
-    mNewTask.notify_all();
+    this->wait();
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
     for (auto& thread : mThreads)
     {
         thread.join();
     }
 }
 
-void ThreadPool::addTask(std::function<void()> task)
+void ThreadPool::addTask(Task task)
 {
+    this->submit(std::move(task), nullptr);
+}
+
+void ThreadPool::addTask(TaskGroup& group, Task task)
+{
+    group.mPending += 1;
+    this->submit(std::move(task), &group);
+}
+
+void ThreadPool::wait()
+{
+    this->waitFor(mUnfinished);
+}
+
+void ThreadPool::wait(TaskGroup& group)
+{
+    this->waitFor(group.mPending);
+}
+
+std::size_t ThreadPool::threadCount() const
+{
+    return mThreads.size();
+}
+
+void ThreadPool::submit(Task task, TaskGroup* group)
+{
+    // The counters are incremented before the job becomes visible, so that they never drop
+    // below zero when the job is taken right away.
+    mUnfinished += 1;
+    mQueued += 1;
+
+    if (Worker* worker = this->current())
     {
-        std::unique_lock<std::mutex> lock(mMutex);
-        mTasks.push_back(std::move(task));
+        worker->push(worker->jobs.take(std::move(task), group));
+    }
+    else
+    {
+        // Holding the mutex of the shared queue makes this thread the owner of its cache.
+        std::lock_guard<std::mutex> lock(mInjectedMutex);
+        mInjected.push_back(mInjectedJobs->take(std::move(task), group));
+        mInjectedCount += 1;
+    }
+
+    this->wake(false);
+}
+
+ThreadPool::Job* ThreadPool::find(Worker* worker)
+{
+    Job* job = nullptr;
+
+    // Jobs submitted by the thread itself are the most likely to still be in its cache.
+    if (worker != nullptr)
+    {
+        job = worker->pop();
+    }
+
+    // Avoid contending on the shared queue's mutex when it's empty, which is the common case.
+    if (job == nullptr && mInjectedCount > 0)
+    {
+        std::lock_guard<std::mutex> lock(mInjectedMutex);
+        if (!mInjected.empty())
+        {
+            job = mInjected.front();
+            mInjected.pop_front();
+            mInjectedCount -= 1;
+        }
     }
-    mNewTask.notify_one();
+
+    // Start stealing from the next worker, so that thieves spread over the pool.
+    std::size_t start = worker != nullptr ? worker->index + 1 : 0;
+    for (std::size_t i = 0; job == nullptr && i < mWorkers.size(); ++i)
+    {
+        Worker& victim = *mWorkers[(start + i) % mWorkers.size()];
+        if (&victim != worker)
+        {
+            job = victim.steal();
+        }
+    }
+
+    if (job != nullptr)
+    {
+        mQueued -= 1;
+    }
+
+    return job;
 }
 
-void ThreadPool::wait()
+void ThreadPool::run(Job* job)
 {
-    std::unique_lock<std::mutex> lock(mMutex);
-    mTaskDone.wait(lock, [this]() { return mNumTasks == 0 && mTasks.empty(); });
+    (*job->task)();
+    job->task.reset();
+
+    // The group may be destroyed as soon as its counter reaches zero, so it must not be touched
+    // after that. The job is given back before that too, as the pool may then be destroyed.
+    TaskGroup* group = job->group;
+    Worker* worker = this->current();
+    job->cache->give(job, worker != nullptr && job->cache == &worker->jobs);
+    bool finished = group != nullptr && group->mPending.fetch_sub(1) == 1;
+    finished = mUnfinished.fetch_sub(1) == 1 || finished;
+
+    if (finished)
+    {
+        this->wake(true);
+    }
+}
+
+void ThreadPool::waitFor(const std::atomic<std::size_t>& counter)
+{
+    Worker* worker = this->current();
+    int spins = 0;
+    while (counter > 0)
+    {
+        if (Job* job = this->find(worker))
+        {
+            this->run(job);
+            spins = 0;
+        }
+        else if (++spins < SpinCount)
+        {
+            std::this_thread::yield();
+        }
+        else
+        {
+            // The remaining tasks are being run by other threads, sleep until they finish or
+            // until more jobs are submitted.
+            std::unique_lock<std::mutex> lock(mMutex);
+            mSleeping += 1;
+            mWake.wait(lock, [&]() { return counter == 0 || mQueued > 0; });
+            mSleeping -= 1;
+            spins = 0;
+        }
+    }
+}
+
+ThreadPool::Worker* ThreadPool::current() const
+{
+    return currentPool == this ? mWorkers[currentIndex].get() : nullptr;
+}
+
+void ThreadPool::wake(bool all)
+{
+    // Sleeping threads check the counters while holding the mutex, so locking it here guarantees
+    // they either see the new values or are already waiting for the notification.
+    if (mSleeping > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+        }
+
+        if (all)
+        {
+            mWake.notify_all();
+        }
+        else
+        {
+            mWake.notify_one();
+        }
+    }
 }
@@ -0,0 +1,164 @@
+#include <doctest/doctest.h>
+
+#include <cubos/core/ecs/archetype_storage.hpp>
+#include <cubos/core/ecs/query.hpp>
+
+#include "utils.hpp"
+
+using cubos::core::ecs::ArchetypeStorage;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::EntityManager;
+using cubos::core::ecs::OptRead;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::World;
+using cubos::core::ecs::Write;
+
+TEST_CASE("ecs::ArchetypeStorage")
+{
+    EntityManager entities{4};
+    ArchetypeStorage<int> storage{};
+    entities.registerColumn(1, storage.attach(entities, 1));
+
+    Entity::Mask mask{};
+    mask.set(0);
+    mask.set(1);
+    auto other = mask;
+    other.set(2);
+
+    SUBCASE("components of the same archetype are packed together")
+    {
+        auto a = entities.create(mask);
+        auto b = entities.create(mask);
+        auto c = entities.create(mask);
+        CHECK(*storage.insert(a.index, 10) == 10);
+        storage.insert(b.index, 20);
+        storage.insert(c.index, 30);
+        CHECK(storage.get(b.index) == storage.get(a.index) + 1);
+        CHECK(storage.get(c.index) == storage.get(a.index) + 2);
+
+        // Inserting into an entity which already has a value replaces it.
+        storage.insert(b.index, 21);
+        CHECK(*storage.get(b.index) == 21);
+    }
+
+    SUBCASE("components follow their entities across archetypes")
+    {
+        auto a = entities.create(mask);
+        auto b = entities.create(mask);
+        storage.insert(a.index, 10);
+        storage.insert(b.index, 20);
+
+        entities.setMask(a, other);
+        CHECK(*storage.get(a.index) == 10);
+        CHECK(*storage.get(b.index) == 20);
+
+        // Once the component is removed from the mask, there's nowhere to insert it.
+        entities.setMask(a, Entity::Mask{1});
+        CHECK(storage.get(a.index) == nullptr);
+        CHECK(storage.insert(a.index, 11) == nullptr);
+
+        // Components added back start default constructed.
+        entities.setMask(a, mask);
+        CHECK(*storage.get(a.index) == 0);
+        CHECK(*storage.get(b.index) == 20);
+
+        entities.destroy(b);
+        CHECK(*storage.get(a.index) == 0);
+    }
+
+    SUBCASE("removed components are destructed")
+    {
+        EntityManager detectEntities{4};
+        ArchetypeStorage<DetectDestructorComponent> detectStorage{};
+        detectEntities.registerColumn(1, detectStorage.attach(detectEntities, 1));
+
+        bool destructed = false;
+        auto a = detectEntities.create(mask);
+        auto b = detectEntities.create(mask);
+        detectStorage.insert(a.index, DetectDestructorComponent{{&destructed}});
+        detectStorage.insert(b.index, DetectDestructorComponent{});
+
+        // Moving the entity to another archetype keeps the component alive.
+        detectEntities.setMask(a, other);
+        CHECK_FALSE(destructed);
+
+        detectEntities.setMask(a, Entity::Mask{1});
+        CHECK(destructed);
+    }
+}
+
+TEST_CASE("ecs::ArchetypeStorage in a world")
+{
+    World world{};
+    setupWorld(world);
+    world.registerComponent<ArchetypeIntegerComponent>();
+    world.registerComponent<ArchetypeDetectDestructorComponent>();
+
+    SUBCASE("queries read components from the columns of each archetype")
+    {
+        // Spread the entities over a few archetypes, some of which also have components stored
+        // elsewhere.
+        for (int i = 0; i < 30; ++i)
+        {
+            auto entity = world.create(ArchetypeIntegerComponent{i});
+            if (i % 3 == 1)
+            {
+                world.add(entity, IntegerComponent{-i});
+            }
+            else if (i % 3 == 2)
+            {
+                world.add(entity, ParentComponent{});
+            }
+        }
+        world.create(IntegerComponent{100});
+
+        for (auto [entity, archetypeInteger, integer] :
+             Query<Write<ArchetypeIntegerComponent>, OptRead<IntegerComponent>>(world))
+        {
+            CHECK(world.has<ArchetypeIntegerComponent>(entity));
+            CHECK((integer ? integer->value == -archetypeInteger->value : archetypeInteger->value % 3 != 1));
+            archetypeInteger->value *= 2;
+        }
+
+        Query<Write<ArchetypeIntegerComponent>>(world).parEach(
+            [](Entity /*entity*/, Write<ArchetypeIntegerComponent> integer) { integer->value += 1; }, 4);
+
+        int total = 0;
+        for (auto [entity, archetypeInteger, integer] :
+             Query<Read<ArchetypeIntegerComponent>, Read<IntegerComponent>>(world))
+        {
+            CHECK(archetypeInteger->value == -integer->value * 2 + 1);
+            total += 1;
+        }
+        CHECK(total == 10);
+
+        // Optional components are only found on the entities which have them.
+        for (auto [entity, archetypeInteger, integer] :
+             Query<OptRead<ArchetypeIntegerComponent>, Read<IntegerComponent>>(world))
+        {
+            CHECK((integer->value == 100) == !archetypeInteger);
+        }
+    }
+
+    SUBCASE("components are destructed when removed")
+    {
+        bool removed = false;
+        bool destroyed = false;
+        auto foo = world.create(ArchetypeDetectDestructorComponent{{&removed}});
+        auto bar = world.create(ArchetypeDetectDestructorComponent{{&destroyed}}, IntegerComponent{0});
+
+        // Changing archetypes keeps the components alive.
+        world.add(foo, ParentComponent{});
+        world.remove<IntegerComponent>(bar);
+        CHECK_FALSE(removed);
+        CHECK_FALSE(destroyed);
+
+        world.remove<ArchetypeDetectDestructorComponent>(foo);
+        CHECK(removed);
+        CHECK_FALSE(destroyed);
+
+        world.destroy(bar);
+        CHECK(destroyed);
+    }
+}
@@ -73,6 +73,44 @@ TEST_CASE("ecs::Blueprint")
         CHECK(bazPkg.field("integer").get<int>() == 2);
     }
 
+    SUBCASE("spawn many instances of the blueprint")
+    {
+        // Spawn twice, so that the second spawn uses the already compiled blueprint.
+        auto first = cmds.spawnMany(blueprint, 3);
+        auto second = cmds.spawnMany(blueprint, 2);
+        cmdBuffer.commit();
+
+        REQUIRE(first.size() == 6);
+        REQUIRE(second.size() == 4);
+        first.insert(first.end(), second.begin(), second.end());
+
+        for (std::size_t i = 0; i < first.size(); i += blueprint.size())
+        {
+            auto spawnedBar = first[i + bar.index];
+            auto spawnedBaz = first[i + baz.index];
+            CHECK(world.isAlive(spawnedBar));
+            CHECK(world.isAlive(spawnedBaz));
+
+            // Each "baz" must reference the "bar" of its own instance.
+            auto bazPkg = world.pack(spawnedBaz);
+            CHECK(bazPkg.fields().size() == 2);
+            CHECK(bazPkg.field("parent").get<Entity>() == spawnedBar);
+            CHECK(bazPkg.field("integer").get<int>() == 2);
+            CHECK(world.pack(spawnedBar).fields().size() == 0);
+        }
+    }
+
+    SUBCASE("modify the blueprint after spawning it")
+    {
+        cmds.spawnMany(blueprint, 1);
+        blueprint.add(bar, IntegerComponent{5});
+        auto spawned = cmds.spawnMany(blueprint, 1);
+        cmdBuffer.commit();
+
+        CHECK(world.pack(spawned[bar.index]).field("integer").get<int>() == 5);
+        CHECK(world.pack(spawned[baz.index]).field("integer").get<int>() == 2);
+    }
+
     SUBCASE("merge one blueprint into another blueprint and then spawn it")
     {
         // Create another blueprint with one entity.
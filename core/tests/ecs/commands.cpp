@@ -1,11 +1,18 @@
+#include <thread>
+#include <vector>
+
 #include <doctest/doctest.h>
 
 #include <cubos/core/ecs/commands.hpp>
+#include <cubos/core/ecs/query.hpp>
 
 #include "utils.hpp"
 
 using cubos::core::ecs::CommandBuffer;
 using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
 using cubos::core::ecs::World;
 
 TEST_CASE("ecs::Commands")
@@ -59,4 +66,63 @@ TEST_CASE("ecs::Commands")
         cmdBuffer.commit();
         CHECK_FALSE(world.isAlive(entity));
     }
+
+    SUBCASE("remove and add back a component")
+    {
+        cmds.remove<IntegerComponent>(foo);
+        cmds.add(foo, IntegerComponent{1});
+        cmdBuffer.commit();
+        CHECK(world.has<IntegerComponent>(foo));
+        CHECK(std::get<0>(*Query<Read<IntegerComponent>>(world)[foo])->value == 1);
+    }
+
+    SUBCASE("record commands from multiple threads")
+    {
+        std::vector<std::vector<Entity>> created(4);
+        std::vector<std::thread> threads;
+        for (std::size_t i = 0; i < created.size(); ++i)
+        {
+            threads.emplace_back([&, i]() {
+                for (int j = 0; j < 100; ++j)
+                {
+                    created[i].push_back(cmds.create(IntegerComponent{j}).entity());
+                }
+                cmds.add(foo, ParentComponent{});
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        cmdBuffer.commit();
+        CHECK(world.has<ParentComponent>(foo));
+        for (const auto& entities : created)
+        {
+            for (int j = 0; j < 100; ++j)
+            {
+                auto entity = entities[static_cast<std::size_t>(j)];
+                REQUIRE(world.isAlive(entity));
+                CHECK(world.has<IntegerComponent>(entity));
+            }
+        }
+    }
+
+    SUBCASE("merge commands from multiple threads by sequence key")
+    {
+        // Threads record in the reverse order of their keys, but the commands of the highest key
+        // must still be the last ones applied.
+        for (int key = 4; key >= 1; --key)
+        {
+            std::thread([&, key]() {
+                CommandBuffer::setSequence(static_cast<std::size_t>(key));
+                cmds.add(foo, IntegerComponent{key});
+                CommandBuffer::setSequence(0);
+            }).join();
+        }
+
+        cmdBuffer.commit();
+        CHECK(std::get<0>(*Query<Read<IntegerComponent>>(world)[foo])->value == 4);
+    }
 }
@@ -1,12 +1,18 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
 #include <vector>
 
 #include <doctest/doctest.h>
 
+#include <cubos/core/ecs/commands.hpp>
 #include <cubos/core/ecs/dispatcher.hpp>
 
 #include "utils.hpp"
 
+using cubos::core::ThreadPool;
 using cubos::core::ecs::CommandBuffer;
+using cubos::core::ecs::Commands;
 using cubos::core::ecs::Dispatcher;
 using cubos::core::ecs::World;
 using cubos::core::ecs::Write;
@@ -37,6 +43,38 @@ static bool pushToOrderAndSucceed(Write<std::vector<int>> order)
     return true;
 }
 
+/// Number of systems which have started waiting in @ref waitForOthers.
+static std::atomic<int> waiting = 0;
+
+/// System which waits until N systems are waiting at the same time, or until a timeout.
+/// @tparam N
+template <int N>
+static void waitForOthers()
+{
+    waiting += 1;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (waiting < N && std::chrono::steady_clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+/// System which records commands and waits until N systems are waiting at the same time, or until
+/// a timeout.
+/// @tparam N
+template <int N>
+static void waitForOthersWithCommands(Commands cmds)
+{
+    cmds.create();
+    waitForOthers<N>();
+}
+
+/// System which stores the identifier of the thread it runs on.
+static void storeThreadId(Write<std::thread::id> id)
+{
+    *id = std::this_thread::get_id();
+}
+
 /// Asserts that the order vector contains the given values in order.
 /// @param world The world the order vector is in.
 /// @param values The values to check for.
@@ -217,3 +255,77 @@ TEST_CASE("ecs::Dispatcher")
         assertOrder(world, {1, 3});
     }
 }
+
+TEST_CASE("ecs::Dispatcher with a thread pool")
+{
+    World world{};
+    CommandBuffer cmdBuffer{world};
+    Dispatcher dispatcher{};
+    ThreadPool pool{2};
+    dispatcher.setThreadPool(&pool);
+    world.registerResource<std::vector<int>>();
+    world.registerResource<std::thread::id>();
+
+    SUBCASE("compatible systems run in parallel")
+    {
+        // Neither system would finish before the timeout if they didn't run at the same time.
+        waiting = 0;
+        dispatcher.addSystem(waitForOthers<2>);
+        dispatcher.addSystem(waitForOthers<2>);
+        singleDispatch(dispatcher, world, cmdBuffer);
+        CHECK(waiting == 2);
+    }
+
+    SUBCASE("systems share a stage with any system they don't conflict with")
+    {
+        // The chain is the first waiting system, two conflicting systems and the second waiting
+        // system, which must still run in parallel with the first one.
+        waiting = 0;
+        auto start = std::chrono::steady_clock::now();
+        dispatcher.addSystem(waitForOthers<2>);
+        dispatcher.addSystem(pushToOrder<2>);
+        dispatcher.addSystem(pushToOrder<1>);
+        dispatcher.addSystem(waitForOthers<2>);
+        singleDispatch(dispatcher, world, cmdBuffer);
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(4));
+        assertOrder(world, {1, 2});
+    }
+
+    SUBCASE("systems which only record commands run in parallel")
+    {
+        waiting = 0;
+        auto start = std::chrono::steady_clock::now();
+        dispatcher.addSystem(waitForOthersWithCommands<2>);
+        dispatcher.addSystem(waitForOthersWithCommands<2>);
+        singleDispatch(dispatcher, world, cmdBuffer);
+        CHECK(std::chrono::steady_clock::now() - start < std::chrono::seconds(4));
+        int count = 0;
+        for (auto entity : world)
+        {
+            (void)entity;
+            count += 1;
+        }
+        CHECK(count == 2);
+    }
+
+    SUBCASE("conflicting systems still run in order")
+    {
+        dispatcher.addSystem(pushToOrder<1>);
+        dispatcher.addSystem(pushToOrder<2>);
+        dispatcher.addSystem(pushToOrder<3>);
+        singleDispatch(dispatcher, world, cmdBuffer);
+        assertOrder(world, {3, 2, 1});
+    }
+
+    SUBCASE("main thread systems run on the calling thread")
+    {
+        waiting = 0;
+        dispatcher.addSystem(waitForOthers<1>);
+        dispatcher.addSystem(storeThreadId);
+        dispatcher.systemAddTag("main");
+        dispatcher.addTag("main");
+        dispatcher.tagSetMainThread();
+        singleDispatch(dispatcher, world, cmdBuffer);
+        CHECK(world.read<std::thread::id>().get() == std::this_thread::get_id());
+    }
+}
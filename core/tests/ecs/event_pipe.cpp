@@ -0,0 +1,119 @@
+/// @file
+/// @brief Covers the EventPipe, EventReader and EventWriter classes.
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/ecs/event_reader.hpp>
+#include <cubos/core/ecs/event_writer.hpp>
+
+using cubos::core::ecs::EventPipe;
+using cubos::core::ecs::EventReader;
+using cubos::core::ecs::EventWriter;
+
+TEST_CASE("ecs::EventPipe")
+{
+    EventPipe<std::string> pipe{};
+    EventWriter<std::string> writer{pipe};
+    std::size_t index = 0;
+
+    SUBCASE("events are kept until the end of the next frame")
+    {
+        writer.push("a", 1);
+        writer.push("b", 2);
+        CHECK(pipe.size() == 2);
+
+        {
+            EventReader<std::string, 2> reader{pipe, index};
+            auto event = reader.read();
+            REQUIRE(event.has_value());
+            CHECK(event->get() == "b");
+            CHECK_FALSE(reader.read().has_value());
+        }
+
+        pipe.update();
+        writer.push("c");
+        CHECK(pipe.size() == 3);
+        CHECK(pipe.firstEvent() == 0);
+
+        pipe.update();
+        CHECK(pipe.size() == 1);
+        CHECK(pipe.firstEvent() == 2);
+        CHECK(pipe.sentEvents() == 3);
+
+        // A reader which fell behind skips the discarded events.
+        std::size_t late = 0;
+        std::vector<std::string> read;
+        for (const auto& event : EventReader<std::string>(pipe, late))
+        {
+            read.push_back(event);
+        }
+        CHECK(read == std::vector<std::string>{"c"});
+        CHECK(late == 3);
+
+        pipe.update();
+        CHECK(pipe.size() == 0);
+        CHECK(pipe.sentEvents() == 3);
+    }
+
+    SUBCASE("batches are read contiguously across segments and frames")
+    {
+        std::vector<std::string> events;
+        for (int i = 0; i < 1000; ++i)
+        {
+            events.push_back(std::to_string(i));
+        }
+
+        writer.pushMany({events.data(), 100});
+        pipe.update();
+        writer.pushMany({events.data() + 100, 900});
+        CHECK(pipe.size() == 1000);
+
+        EventReader<std::string> reader{pipe, index};
+        std::vector<std::string> read;
+        std::size_t batches = 0;
+        for (auto batch = reader.readBatch(); !batch.empty(); batch = reader.readBatch())
+        {
+            read.insert(read.end(), batch.begin(), batch.end());
+            batches += 1;
+        }
+        CHECK(read == events);
+        CHECK(batches > 1);
+        CHECK(index == 1000);
+        CHECK(pipe.get(999).first == "999");
+    }
+
+    SUBCASE("multiple threads can push at the same time")
+    {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&pipe, t]() {
+                EventWriter<std::string> threadWriter{pipe};
+                for (int i = 0; i < 500; ++i)
+                {
+                    threadWriter.push(std::to_string(t * 1000 + i), static_cast<unsigned int>(t));
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        REQUIRE(pipe.size() == 2000);
+
+        // Each thread's events must all be there, in the order they were pushed.
+        int next[4] = {0, 0, 0, 0};
+        for (std::size_t i = 0; i < pipe.sentEvents(); ++i)
+        {
+            auto [event, mask] = pipe.get(i);
+            CHECK(event == std::to_string(static_cast<int>(mask) * 1000 + next[mask]));
+            next[mask] += 1;
+        }
+    }
+}
@@ -1,13 +1,26 @@
+#include <atomic>
+#include <numeric>
+#include <utility>
+#include <vector>
+
 #include <doctest/doctest.h>
 
+#include <cubos/core/ecs/commands.hpp>
 #include <cubos/core/ecs/query.hpp>
+#include <cubos/core/thread_pool.hpp>
 
 #include "utils.hpp"
 
+using cubos::core::ThreadPool;
+using cubos::core::ecs::Added;
+using cubos::core::ecs::Changed;
+using cubos::core::ecs::CommandBuffer;
 using cubos::core::ecs::Entity;
+using cubos::core::ecs::MaxTickAge;
 using cubos::core::ecs::OptRead;
 using cubos::core::ecs::OptWrite;
 using cubos::core::ecs::Query;
+using cubos::core::ecs::QueryState;
 using cubos::core::ecs::Read;
 using cubos::core::ecs::World;
 using cubos::core::ecs::Write;
@@ -74,6 +87,35 @@ TEST_CASE("ecs::Query")
     CHECK(queryCount<OptWrite<IntegerComponent>, Read<ParentComponent>>(world) == 3);
     CHECK(queryCount<Write<IntegerComponent>, OptRead<ParentComponent>>(world) == 4);
 
+    // Check if the queries are kept up to date when entities change archetypes or are destroyed.
+    world.remove<IntegerComponent>(int0);
+    world.destroy(int1);
+    CHECK(queryCount<>(world) == 5);
+    CHECK(queryCount<Read<IntegerComponent>>(world) == 2);
+    CHECK(queryCount<Write<IntegerComponent>, Read<ParentComponent>>(world) == 1);
+    CHECK_FALSE(Query<Read<IntegerComponent>>(world)[int0].has_value());
+    world.add(int0, IntegerComponent{4});
+    CHECK(queryCount<Read<IntegerComponent>>(world) == 3);
+    CHECK(queryOne<Read<IntegerComponent>>(world, int0)->value == 4);
+
+    // Check if a state shared between queries picks up archetypes created after it was filled.
+    QueryState state{};
+    std::size_t cachedCount = 0;
+    for (auto entity : Query<Read<IntegerComponent>>(world, &state))
+    {
+        (void)entity;
+        cachedCount += 1;
+    }
+    CHECK(cachedCount == 3);
+    world.create(IntegerComponent{5}, DetectDestructorComponent{});
+    cachedCount = 0;
+    for (auto entity : Query<Read<IntegerComponent>>(world, &state))
+    {
+        (void)entity;
+        cachedCount += 1;
+    }
+    CHECK(cachedCount == 4);
+
     // Check if QueryInfo objects correctly report the components being queried.
     auto info = Query<Write<IntegerComponent>, Read<ParentComponent>, OptWrite<DetectDestructorComponent>>::info();
     CHECK(info.read.size() == 1);
@@ -87,3 +129,197 @@ TEST_CASE("ecs::Query")
     CHECK(info.read.empty());
     CHECK(info.written.empty());
 }
+
+TEST_CASE("ecs::Query change detection")
+{
+    World world{};
+    setupWorld(world);
+
+    auto int0 = world.create(IntegerComponent{0});
+    auto int1 = world.create(IntegerComponent{1}, ParentComponent{});
+
+    QueryState changedState{};
+    QueryState addedState{};
+    auto countChanged = [&]() {
+        std::size_t counter = 0;
+        for (auto [entity, integer] : Query<Changed<IntegerComponent>>(world, &changedState))
+        {
+            (void)entity;
+            (void)integer;
+            counter += 1;
+        }
+        return counter;
+    };
+    auto countAdded = [&]() {
+        std::size_t counter = 0;
+        for (auto [entity, integer] : Query<Added<IntegerComponent>>(world, &addedState))
+        {
+            (void)entity;
+            (void)integer;
+            counter += 1;
+        }
+        return counter;
+    };
+
+    // On their first run, queries see every component as changed and added.
+    CHECK(countChanged() == 2);
+    CHECK(countAdded() == 2);
+    CHECK(countChanged() == 0);
+    CHECK(countAdded() == 0);
+
+    // Reading a component doesn't mark it as changed, but writing does.
+    for (auto [entity, integer] : Query<Read<IntegerComponent>>(world))
+    {
+        (void)entity;
+        (void)integer->value;
+    }
+    CHECK(countChanged() == 0);
+    queryOne<Write<IntegerComponent>>(world, int1)->value = 2;
+    CHECK(countChanged() == 1);
+    CHECK(countAdded() == 0);
+
+    // Added components are seen both as added and as changed.
+    world.add(int0, ParentComponent{});
+    auto int2 = world.create(IntegerComponent{3});
+    CHECK(countChanged() == 1);
+    CHECK(countAdded() == 1);
+
+    // Reading through a const write argument doesn't mark the component as changed.
+    auto access = queryOne<Write<IntegerComponent>>(world, int1);
+    CHECK(std::as_const(access)->value == (*std::as_const(access)).value);
+    CHECK(countChanged() == 0);
+
+    // Filters can be combined with other arguments, and are also applied to direct accesses.
+    QueryState combinedState{};
+    Query<Changed<IntegerComponent>, Read<ParentComponent>>(world, &combinedState);
+    queryOne<Write<IntegerComponent>>(world, int2)->value = 4;
+    queryOne<Write<IntegerComponent>>(world, int0)->value = 5;
+    auto query = Query<Changed<IntegerComponent>, Read<ParentComponent>>(world, &combinedState);
+    std::size_t counter = 0;
+    for (auto [entity, integer, parent] : query)
+    {
+        CHECK(entity == int0);
+        CHECK(integer->value == 5);
+        (void)parent;
+        counter += 1;
+    }
+    CHECK(counter == 1);
+    CHECK(query[int0].has_value());
+    CHECK_FALSE(query[int1].has_value());
+    CHECK_FALSE(query[int2].has_value());
+
+    // Checking a single entity's components.
+    auto direct = Query<Read<IntegerComponent>, OptRead<ParentComponent>>(world);
+    CHECK(direct.changed<IntegerComponent>(int0));
+    CHECK(direct.added<ParentComponent>(int0));
+    CHECK_FALSE(direct.changed<ParentComponent>(int2));
+
+    // Identifiers of destroyed entities are never matched, even if their index is reused.
+    CHECK(direct[int0].has_value());
+    CHECK_FALSE(direct[Entity{int0.index, int0.generation + 1}].has_value());
+
+    // Removed components are seen as removed until the query runs again.
+    QueryState removedState{};
+    Query<OptRead<ParentComponent>>(world, &removedState);
+    world.remove<ParentComponent>(int0);
+    auto removed = Query<OptRead<ParentComponent>>(world, &removedState);
+    CHECK(removed.removed<ParentComponent>(int0));
+    CHECK_FALSE(removed.removed<ParentComponent>(int1));
+    CHECK_FALSE(Query<OptRead<ParentComponent>>(world, &removedState).removed<ParentComponent>(int0));
+
+    // Adding components doesn't advance the tick, which only advances once per query run.
+    QueryState tickState{};
+    Query<Added<IntegerComponent>>(world, &tickState);
+    auto before = tickState.thisRun;
+    for (int i = 0; i < 100; ++i)
+    {
+        world.create(IntegerComponent{i});
+    }
+    std::size_t added = 0;
+    for (auto [entity, integer] : Query<Added<IntegerComponent>>(world, &tickState))
+    {
+        (void)entity;
+        (void)integer;
+        added += 1;
+    }
+    CHECK(added == 100);
+    CHECK(tickState.thisRun == before + 1);
+
+    // Runs too far apart to be ordered are treated as if they were just far enough apart.
+    tickState.thisRun -= MaxTickAge + 10;
+    Query<Added<IntegerComponent>>(world, &tickState);
+    CHECK(tickState.thisRun - tickState.lastRun == MaxTickAge);
+}
+
+TEST_CASE("ecs::Query::parEach")
+{
+    World world{};
+    setupWorld(world);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        world.create(IntegerComponent{i});
+    }
+    world.create(IntegerComponent{1000}, ParentComponent{});
+
+    auto increment = [](Entity /*entity*/, Write<IntegerComponent> integer) { integer->value += 1; };
+    auto sum = [&]() {
+        int total = 0;
+        for (auto [entity, integer] : Query<Read<IntegerComponent>>(world))
+        {
+            total += integer->value;
+        }
+        return total;
+    };
+
+    SUBCASE("without a thread pool")
+    {
+        Query<Write<IntegerComponent>>(world).parEach(increment, 64);
+        CHECK(sum() == 500500 + 1001);
+    }
+
+    SUBCASE("with a thread pool")
+    {
+        ThreadPool pool{4};
+        world.setThreadPool(&pool);
+        Query<Write<IntegerComponent>>(world).parEach(increment, 64);
+        CHECK(sum() == 500500 + 1001);
+
+        // Iterating from a task of the same pool must not deadlock.
+        pool.addTask([&]() { Query<Write<IntegerComponent>>(world).parEach(increment, 64); });
+        pool.wait();
+        CHECK(sum() == 500500 + 2002);
+
+        // Arbitrary ranges can be processed in parallel too.
+        std::vector<int> values(1000, 0);
+        Query<Read<IntegerComponent>>(world).parFor(
+            values.size(),
+            [&](std::size_t first, std::size_t last) {
+                for (std::size_t i = first; i < last; ++i)
+                {
+                    values[i] = static_cast<int>(i);
+                }
+            },
+            64);
+        CHECK(std::accumulate(values.begin(), values.end(), 0) == 499500);
+
+        // Chunks must record commands with the sequence key of the caller, whichever thread runs
+        // them, and leave the key of each thread as it was.
+        std::atomic<bool> sameSequence{true};
+        {
+            CommandBuffer::SequenceGuard guard{7};
+            Query<Read<IntegerComponent>>(world).parFor(
+                1000,
+                [&](std::size_t /*first*/, std::size_t /*last*/) {
+                    if (CommandBuffer::sequence() != 7)
+                    {
+                        sameSequence = false;
+                    }
+                },
+                64);
+        }
+        CHECK(sameSequence);
+        CHECK(CommandBuffer::sequence() == 0);
+        world.setThreadPool(nullptr);
+    }
+}
@@ -0,0 +1,57 @@
+#include <doctest/doctest.h>
+
+#include <cubos/core/ecs/sparse_set_storage.hpp>
+
+#include "utils.hpp"
+
+using cubos::core::ecs::SparseSetStorage;
+
+TEST_CASE("ecs::SparseSetStorage")
+{
+    SparseSetStorage<int> storage{};
+
+    SUBCASE("inserted values can be retrieved")
+    {
+        CHECK(*storage.insert(3, 30) == 30);
+        CHECK(*storage.insert(100000, 42) == 42);
+        CHECK(*storage.get(3) == 30);
+        CHECK(*storage.get(100000) == 42);
+
+        // Inserting into an index which already has a value replaces it.
+        storage.insert(3, 31);
+        CHECK(*storage.get(3) == 31);
+        CHECK(*storage.get(100000) == 42);
+    }
+
+    SUBCASE("erasing values keeps the others intact")
+    {
+        storage.insert(1, 10);
+        storage.insert(2, 20);
+        storage.insert(5000, 50);
+
+        storage.erase(1);
+        CHECK(*storage.get(2) == 20);
+        CHECK(*storage.get(5000) == 50);
+
+        // Erasing missing values does nothing.
+        storage.erase(1);
+        storage.erase(7);
+        CHECK(*storage.get(2) == 20);
+
+        storage.erase(5000);
+        storage.insert(1, 11);
+        CHECK(*storage.get(1) == 11);
+        CHECK(*storage.get(2) == 20);
+    }
+
+    SUBCASE("erased values are destructed")
+    {
+        SparseSetStorage<DetectDestructorComponent> detectStorage{};
+        bool destructed = false;
+        detectStorage.insert(0, DetectDestructorComponent{{&destructed}});
+        detectStorage.insert(1, DetectDestructorComponent{});
+        CHECK_FALSE(destructed);
+        detectStorage.erase(0);
+        CHECK(destructed);
+    }
+}
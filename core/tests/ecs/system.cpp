@@ -144,6 +144,12 @@ TEST_CASE("ecs::SystemInfo")
             infoB.resourcesWritten.insert(typeid(float));
         }
 
+        SUBCASE("both append to the same resource")
+        {
+            infoA.resourcesAppended.insert(typeid(int));
+            infoB.resourcesAppended.insert(typeid(int));
+        }
+
         SUBCASE("both use commands")
         {
             infoA.usesCommands = true;
@@ -180,6 +186,12 @@ TEST_CASE("ecs::SystemInfo")
             infoB.resourcesWritten.insert(typeid(int));
         }
 
+        SUBCASE("one reads and the other appends to the same resource")
+        {
+            infoA.resourcesRead.insert(typeid(int));
+            infoB.resourcesAppended.insert(typeid(int));
+        }
+
         SUBCASE("one accesses the world directly")
         {
             infoA.usesWorld = true;
@@ -25,7 +25,20 @@ struct [[cubos::component("detect_destructor")]] DetectDestructorComponent
     [[cubos::ignore]] DetectDestructor detect;
 };
 
-/// Adds the utility components to a world.
+/// A component which stores a single integer, in the archetypes of its entities.
+struct [[cubos::component("archetype_integer", ArchetypeStorage)]] ArchetypeIntegerComponent
+{
+    int value;
+};
+
+/// A component used to test if components stored in archetypes are destructed properly.
+struct [[cubos::component("archetype_detect_destructor", ArchetypeStorage)]] ArchetypeDetectDestructorComponent
+{
+    [[cubos::ignore]] DetectDestructor detect;
+};
+
+/// Adds the utility components to a world, except for the ones stored in archetypes, which the
+/// tests using them register themselves.
 inline void setupWorld(cubos::core::ecs::World& world)
 {
     world.registerComponent<IntegerComponent>();
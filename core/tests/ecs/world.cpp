@@ -1,12 +1,15 @@
 #include <doctest/doctest.h>
 
 #include <cubos/core/ecs/world.hpp>
+#include <cubos/core/memory/buffer_stream.hpp>
 
 #include "utils.hpp"
 
 using cubos::core::data::old::Package;
 using cubos::core::ecs::Entity;
 using cubos::core::ecs::World;
+using cubos::core::memory::BufferStream;
+using cubos::core::memory::SeekOrigin;
 
 TEST_CASE("ecs::World")
 {
@@ -142,6 +145,117 @@ TEST_CASE("ecs::World")
         CHECK(destroyed);
     }
 
+    SUBCASE("save and load a snapshot of the world")
+    {
+        bool destroyed = false;
+        auto foo = world.create(IntegerComponent{1});
+        auto bar = world.create(IntegerComponent{2}, ParentComponent{foo});
+        auto baz = world.create(DetectDestructorComponent{{&destroyed}});
+        world.destroy(world.create());
+
+        BufferStream stream{};
+        world.saveSnapshot(stream);
+
+        SUBCASE("into a world with components registered in a different order")
+        {
+            World other{};
+            other.registerComponent<DetectDestructorComponent>();
+            other.registerComponent<ParentComponent>();
+            other.registerComponent<IntegerComponent>();
+            stream.seek(0, SeekOrigin::Begin);
+            REQUIRE(other.loadSnapshot(stream));
+
+            // Entity identifiers, including generations of free slots, must be kept.
+            CHECK(other.isAlive(foo));
+            CHECK(other.isAlive(bar));
+            CHECK(other.isAlive(baz));
+            auto qux = other.create();
+            CHECK(qux.generation == 1);
+
+            CHECK(other.has<IntegerComponent>(foo));
+            CHECK_FALSE(other.has<ParentComponent>(foo));
+            CHECK(other.pack(foo).field("integer").get<int>() == 1);
+            CHECK(other.pack(bar).field("integer").get<int>() == 2);
+            CHECK(other.pack(bar).field("parent").get<Entity>() == foo);
+            CHECK(other.has<DetectDestructorComponent>(baz));
+            CHECK_FALSE(other.has<IntegerComponent>(baz));
+        }
+
+        SUBCASE("into the same world, replacing its entities")
+        {
+            world.destroy(foo);
+            auto qux = world.create(IntegerComponent{3});
+            CHECK_FALSE(destroyed);
+
+            stream.seek(0, SeekOrigin::Begin);
+            REQUIRE(world.loadSnapshot(stream));
+            CHECK(destroyed);
+            CHECK(world.isAlive(foo));
+            CHECK_FALSE(world.isAlive(qux));
+            CHECK(world.pack(foo).field("integer").get<int>() == 1);
+
+            std::size_t count = 0;
+            for (auto entity : world)
+            {
+                (void)entity;
+                count += 1;
+            }
+            CHECK(count == 3);
+        }
+
+        SUBCASE("from a stream which isn't a snapshot")
+        {
+            BufferStream garbage{};
+            garbage.print("not a snapshot");
+            garbage.seek(0, SeekOrigin::Begin);
+            CHECK_FALSE(world.loadSnapshot(garbage));
+            CHECK(world.isAlive(foo));
+        }
+
+        SUBCASE("into a world without one of its component types registered")
+        {
+            World other{};
+            other.registerComponent<IntegerComponent>();
+            other.registerComponent<ParentComponent>();
+            auto qux = other.create(IntegerComponent{3});
+
+            // The world must be left untouched.
+            stream.seek(0, SeekOrigin::Begin);
+            CHECK_FALSE(other.loadSnapshot(stream));
+            CHECK(other.isAlive(qux));
+            CHECK(other.pack(qux).field("integer").get<int>() == 3);
+        }
+
+        SUBCASE("from a snapshot which gives components to a free entity slot")
+        {
+            BufferStream corrupted{};
+            auto write = [&](uint32_t value) { corrupted.write(&value, sizeof(value)); };
+            write(0x43554253); // Magic.
+            write(1);          // Version.
+            write(2);          // Two slots, with generation zero.
+            write(0);
+            write(0);
+            write(1); // Only the first slot is alive.
+            write(0);
+            write(1); // One component column, which gives an integer to the second slot.
+            write(7);
+            corrupted.print("integer");
+            write(1);
+            write(1);
+            write(42);
+            corrupted.seek(0, SeekOrigin::Begin);
+
+            // The world must be left untouched.
+            CHECK_FALSE(world.loadSnapshot(corrupted));
+            CHECK(world.isAlive(foo));
+            CHECK(world.pack(foo).field("integer").get<int>() == 1);
+            CHECK_FALSE(destroyed);
+        }
+
+        // The detector must not outlive the flag it points to.
+        world.destroy(baz);
+    }
+
     SUBCASE("read and write resources")
     {
         // Register some resources.
@@ -0,0 +1,90 @@
+#include <string>
+#include <thread>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/memory/buffer_stream.hpp>
+#include <cubos/core/profiler.hpp>
+
+using cubos::core::Profiler;
+using cubos::core::memory::BufferStream;
+
+TEST_CASE("core::Profiler")
+{
+    Profiler::clear();
+    Profiler::endFrame(); // Discard zones recorded before the test.
+
+    SUBCASE("nothing is recorded while disabled")
+    {
+        {
+            CUBOS_PROFILE_SCOPE("disabled");
+        }
+        Profiler::endFrame();
+        CHECK(Profiler::frames().empty());
+    }
+
+    SUBCASE("zones are gathered into frames")
+    {
+        Profiler::setEnabled(true);
+        {
+            CUBOS_PROFILE_SCOPE("outer");
+            CUBOS_PROFILE_SCOPE("inner");
+        }
+        std::thread([]() { CUBOS_PROFILE_SCOPE("other"); }).join();
+        Profiler::endFrame();
+
+        {
+            CUBOS_PROFILE_SCOPE(Profiler::intern(std::string("dyn") + "amic"));
+        }
+        Profiler::endFrame();
+        Profiler::setEnabled(false);
+
+        auto frames = Profiler::frames();
+        REQUIRE(frames.size() == 2);
+        REQUIRE(frames[0].zones.size() == 3);
+        CHECK(std::string(frames[0].zones[0].name) == "outer");
+        CHECK(frames[0].zones[0].depth == 0);
+        CHECK(std::string(frames[0].zones[1].name) == "inner");
+        CHECK(frames[0].zones[1].depth == 1);
+        CHECK(frames[0].zones[0].start <= frames[0].zones[1].start);
+        CHECK(frames[0].zones[1].end <= frames[0].zones[0].end);
+        CHECK(std::string(frames[0].zones[2].name) == "other");
+        CHECK(frames[0].zones[2].thread != frames[0].zones[0].thread);
+        CHECK(frames[0].end == frames[1].start);
+
+        REQUIRE(frames[1].zones.size() == 1);
+        CHECK(std::string(frames[1].zones[0].name) == "dynamic");
+        CHECK(Profiler::intern("dynamic") == frames[1].zones[0].name);
+
+        // Check if the trace contains an event for each frame and zone.
+        BufferStream stream{};
+        Profiler::writeChromeTrace(stream);
+        stream.put('\0');
+        std::string trace = static_cast<const char*>(stream.getBuffer());
+        CHECK(trace.starts_with("{\"traceEvents\":["));
+        CHECK(trace.find("\"name\":\"inner\"") != std::string::npos);
+        CHECK(trace.find("\"name\":\"dynamic\"") != std::string::npos);
+
+        std::size_t events = 0;
+        for (auto pos = trace.find("\"ph\":\"X\""); pos != std::string::npos; pos = trace.find("\"ph\":\"X\"", pos + 1))
+        {
+            events += 1;
+        }
+        CHECK(events == 6);
+    }
+
+    SUBCASE("only the most recent frames are kept")
+    {
+        Profiler::setEnabled(true);
+        Profiler::setCapacity(3);
+        for (int i = 0; i < 5; ++i)
+        {
+            Profiler::endFrame();
+        }
+        Profiler::setEnabled(false);
+        CHECK(Profiler::frames().size() == 3);
+        Profiler::setCapacity(300);
+    }
+
+    Profiler::clear();
+}
@@ -0,0 +1,127 @@
+#include <array>
+#include <atomic>
+#include <memory>
+
+#include <doctest/doctest.h>
+
+#include <cubos/core/thread_pool.hpp>
+
+using cubos::core::Task;
+using cubos::core::TaskGroup;
+using cubos::core::ThreadPool;
+
+TEST_CASE("core::Task")
+{
+    int counter = 0;
+
+    SUBCASE("small callable")
+    {
+        Task task{[&]() { counter += 1; }};
+        Task moved{std::move(task)};
+        moved();
+        CHECK(counter == 1);
+    }
+
+    SUBCASE("big callable")
+    {
+        std::array<int, 64> values{};
+        values[63] = 5;
+        Task task{[&counter, values]() { counter += values[63]; }};
+        Task moved{std::move(task)};
+        moved();
+        CHECK(counter == 5);
+    }
+
+    SUBCASE("callable is destroyed with the task")
+    {
+        auto shared = std::make_shared<int>(0);
+        {
+            Task task{[shared]() { *shared += 1; }};
+            CHECK(shared.use_count() == 2);
+            task();
+        }
+        CHECK(*shared == 1);
+        CHECK(shared.use_count() == 1);
+    }
+}
+
+TEST_CASE("core::ThreadPool")
+{
+    std::atomic<int> counter{0};
+
+    SUBCASE("wait for all tasks")
+    {
+        ThreadPool pool{4};
+        for (int i = 0; i < 1000; ++i)
+        {
+            pool.addTask([&]() { counter += 1; });
+        }
+        pool.wait();
+        CHECK(counter == 1000);
+    }
+
+    SUBCASE("wait for a group")
+    {
+        ThreadPool pool{4};
+        TaskGroup group{};
+        for (int i = 0; i < 1000; ++i)
+        {
+            pool.addTask(group, [&]() { counter += 1; });
+        }
+        pool.wait(group);
+        CHECK(group.done());
+        CHECK(counter == 1000);
+    }
+
+    SUBCASE("tasks wait for tasks they submit")
+    {
+        // With a single thread, this only finishes if waiting runs pending tasks.
+        ThreadPool pool{1};
+        TaskGroup outer{};
+        for (int i = 0; i < 8; ++i)
+        {
+            pool.addTask(outer, [&]() {
+                TaskGroup inner{};
+                for (int j = 0; j < 100; ++j)
+                {
+                    pool.addTask(inner, [&]() { counter += 1; });
+                }
+                pool.wait(inner);
+            });
+        }
+        pool.wait(outer);
+        CHECK(counter == 800);
+    }
+
+    SUBCASE("tasks are released once they run")
+    {
+        // Jobs are recycled after running, but their captures must not stay alive with them.
+        ThreadPool pool{4};
+        auto shared = std::make_shared<int>(0);
+        for (int round = 0; round < 3; ++round)
+        {
+            TaskGroup group{};
+            for (int i = 0; i < 100; ++i)
+            {
+                pool.addTask(group, [&, shared]() {
+                    counter += 1;
+
+                    // Tasks submitted from the pool's threads are given back to them by thieves.
+                    pool.addTask(group, [&]() { counter += 1; });
+                });
+            }
+            pool.wait(group);
+            CHECK(shared.use_count() == 1);
+        }
+        CHECK(counter == 600);
+    }
+
+    SUBCASE("pool without threads")
+    {
+        // Tasks are run by the waiting thread.
+        ThreadPool pool{0};
+        pool.addTask([&]() { counter += 1; });
+        pool.wait();
+        CHECK(counter == 1);
+    }
+}
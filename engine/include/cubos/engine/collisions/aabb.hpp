@@ -15,7 +15,7 @@ namespace cubos::engine
 {
     /// @brief Component which stores the AABB of an entity with a collider component.
     /// @ingroup collisions-plugin
-    struct [[cubos::component("cubos/aabb", VecStorage)]] ColliderAABB
+    struct [[cubos::component("cubos/aabb", ArchetypeStorage)]] ColliderAABB
     {
         /// @brief Minimum point of the diagonal of the AABB.
         glm::vec3 min = glm::vec3{-INFINITY};
@@ -4,16 +4,46 @@
 
 #pragma once
 
+#include <cstdint>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include <cubos/core/ecs/entity_manager.hpp>
 
+#include <cubos/engine/collisions/aabb.hpp>
+
 using cubos::core::ecs::Entity;
 
 namespace cubos::engine
 {
+    /// @brief Sweep and prune markers of a single axis, stored as a structure of arrays sorted by
+    /// their coordinate on the axis.
+    /// @ingroup collisions-plugin
+    struct SweepAxis
+    {
+        /// @brief Coordinate of each marker.
+        std::vector<float> values;
+
+        /// @brief Slot of the collider of each marker, shifted left by one, with the lowest bit
+        /// set on min markers.
+        std::vector<uint32_t> markers;
+
+        /// @brief Pairs of slots whose overlap on this axis began or ended during the last sort,
+        /// in the order it happened.
+        std::vector<std::pair<uint32_t, uint32_t>> toggled;
+    };
+
+    /// @brief Resource which stores the sweep and prune markers of the axis @p Axis. Each axis is
+    /// a separate resource so that the axes can be sorted in parallel.
+    /// @tparam Axis Index of the axis.
+    /// @ingroup collisions-plugin
+    template <glm::length_t Axis>
+    struct SweepMarkers : SweepAxis
+    {
+    };
+
     /// @brief Resource which stores data used in broad phase collision detection.
     /// @ingroup collisions-plugin
     struct BroadPhaseCollisions
@@ -21,15 +51,6 @@ namespace cubos::engine
         /// @brief Pair of entities that may collide.
         using Candidate = std::pair<Entity, Entity>;
 
-        /// @brief Hash function to allow Candidates to be used as keys in an unordered_set.
-        struct CandidateHash
-        {
-            std::size_t operator()(const Candidate& candidate) const
-            {
-                return std::hash<Entity>()(candidate.first) ^ std::hash<Entity>()(candidate.second);
-            }
-        };
-
         /// @brief Collision type for each pair of colliders.
         enum class CollisionType
         {
@@ -37,51 +58,138 @@ namespace cubos::engine
             BoxCapsule,
             BoxPlane,
             BoxSimplex,
+            BoxVoxel,
             CapsuleCapsule,
             CapsulePlane,
             CapsuleSimplex,
+            CapsuleVoxel,
             PlanePlane,
             PlaneSimplex,
+            PlaneVoxel,
             SimplexSimplex,
+            SimplexVoxel,
+            VoxelVoxel,
 
             Count ///< Number of collision types.
         };
 
-        /// @brief Marker used for sweep and prune.
-        struct SweepMarker
+        /// @brief Algorithms which can be used to find collision candidates.
+        enum class Method
         {
-            Entity entity; ///< Entity referenced by the marker.
-            bool isMin;    ///< Whether the marker is a min or max marker.
+            /// @brief Sorts the bounds of the AABBs along each axis. Works best when colliders are
+            /// spread out.
+            SweepAndPrune,
+
+            /// @brief Places the AABBs in a uniform grid of cells, and only checks colliders which
+            /// share a cell. Works best with many colliders of similar size, such as voxel
+            /// objects, even if many of them are aligned along an axis.
+            SpatialHash,
         };
 
-        /// @brief List of ordered sweep markers for each axis. Stores the index of the marker in mMarkers.
-        std::vector<SweepMarker> markersPerAxis[3];
+        /// @brief Collider tracked by sweep and prune.
+        struct SweepCollider
+        {
+            Entity entity;        ///< Entity of the collider.
+            ColliderAABB aabb;    ///< AABB of the collider, cached on each update.
+            bool box = false;     ///< Whether the entity has a box collider.
+            bool capsule = false; ///< Whether the entity has a capsule collider.
+            bool plane = false;   ///< Whether the entity has a plane collider.
+            bool simplex = false; ///< Whether the entity has a simplex collider.
+            bool voxel = false;   ///< Whether the entity has a voxel collider.
+            bool tracked = false; ///< Whether the collider is tracked, or its slot is waiting to be freed.
+        };
+
+        /// @brief Collider placed in the spatial hash.
+        struct HashedCollider
+        {
+            Entity entity;      ///< Entity of the collider.
+            ColliderAABB aabb;  ///< AABB of the collider.
+            bool box;           ///< Whether the entity has a box collider.
+            bool capsule;       ///< Whether the entity has a capsule collider.
+            bool plane;         ///< Whether the entity has a plane collider.
+            bool simplex;       ///< Whether the entity has a simplex collider.
+            bool voxel;         ///< Whether the entity has a voxel collider.
+            bool oversized;     ///< Whether the collider covers too many cells to be hashed.
+        };
+
+        /// @brief Entry of the spatial hash, which places a collider in a cell.
+        struct HashEntry
+        {
+            uint64_t cell;     ///< Key of the cell.
+            uint32_t collider; ///< Index of the collider in @ref hashColliders.
+        };
+
+        /// @brief Algorithm used to find collision candidates. Can be changed at any time.
+        Method method = Method::SweepAndPrune;
+
+        /// @brief Size of the cells of the spatial hash, in world units. Should be close to the
+        /// size of the most common colliders.
+        float cellSize = 4.0F;
+
+        /// @brief Colliders which cover more cells than this on the spatial hash, such as planes,
+        /// are checked against every other collider instead.
+        std::size_t maxCellsPerCollider = 64;
+
+        /// @brief Colliders placed in the spatial hash on the last update.
+        std::vector<HashedCollider> hashColliders;
+
+        /// @brief Cells covered by each collider on the last update, sorted by cell.
+        std::vector<HashEntry> hashEntries;
+
+        /// @brief Whether colliders are being tracked by sweep and prune. While another method is
+        /// used, tracking stops, so that its state doesn't grow, and the next sweep and prune
+        /// update tracks every collider again.
+        bool sweepTracking = true;
+
+        /// @brief Colliders tracked by sweep and prune, indexed by their slot.
+        std::vector<SweepCollider> sweepColliders;
+
+        /// @brief Slot of each entity tracked by sweep and prune.
+        std::unordered_map<Entity, uint32_t> sweepSlots;
+
+        /// @brief Slots of @ref sweepColliders which can be reused.
+        std::vector<uint32_t> freeSweepSlots;
+
+        /// @brief Slots added since the last update, whose markers haven't been inserted yet.
+        std::vector<uint32_t> addedSweepSlots;
+
+        /// @brief Slots removed since the last update, whose markers and pairs haven't been
+        /// removed yet. They're only freed afterwards.
+        std::vector<uint32_t> removedSweepSlots;
+
+        /// @brief Pairs of slots which overlap on at least one axis, mapped to a mask of the axes
+        /// they overlap on. Keys hold the lower slot on the upper 32 bits.
+        std::unordered_map<uint64_t, uint8_t> sweepPairs;
+
+        /// @brief Keys of the pairs of @ref sweepPairs which overlap on every axis.
+        std::unordered_set<uint64_t> sweepOverlaps;
 
-        /// @brief Maps of overlapping entities for each axis calculated by sweep and prune.
-        ///
-        /// For each each map, the key is an entity and the value is a list of entities that
-        /// overlap with the key. Symmetrical pairs are not stored.
-        std::unordered_map<Entity, std::vector<Entity>> sweepOverlapMaps[3];
+        /// @brief Pairs of colliders which started overlapping on the last sweep and prune update.
+        std::vector<Candidate> overlapsBegan;
 
-        /// @brief Set of active entities during sweep for each axis.
-        std::unordered_set<Entity> activePerAxis[3];
+        /// @brief Pairs of colliders which stopped overlapping, or were removed, on the last
+        /// sweep and prune update.
+        std::vector<Candidate> overlapsEnded;
 
-        /// @brief Sets of collision candidates for each collision type. The index of the array is
-        /// the collision type.
-        std::unordered_set<Candidate, CandidateHash> candidatesPerType[static_cast<std::size_t>(CollisionType::Count)];
+        /// @brief Lists of collision candidates for each collision type. The index of the array is
+        /// the collision type. Each pair of colliders appears at most once.
+        std::vector<Candidate> candidatesPerType[static_cast<std::size_t>(CollisionType::Count)];
 
         /// @brief Adds an entity to the list of entities tracked by sweep and prune.
         /// @param entity Entity to add.
         void addEntity(Entity entity);
 
-        /// @brief Removes an entity from the list of entities tracked by sweep and prune.
+        /// @brief Removes an entity from the list of entities tracked by sweep and prune. Entities
+        /// which were destroyed are removed automatically.
         /// @param entity Entity to remove.
         void removeEntity(Entity entity);
 
-        /// @brief Clears the list of entities tracked by sweep and prune.
+        /// @brief Clears the list of entities tracked by sweep and prune. Their markers and
+        /// pairs are removed on the next update.
         void clearEntities();
 
         /// @brief Adds a collision candidate to the list of candidates for a specific collision type.
+        /// @note The same pair of colliders must not be added more than once.
         /// @param type Collision type.
         /// @param candidate Collision candidate.
         void addCandidate(CollisionType type, Candidate candidate);
@@ -89,7 +197,7 @@ namespace cubos::engine
         /// @brief Gets the collision candidates for a specific collision type.
         /// @param type Collision type.
         /// @return Collision candidates.
-        const std::unordered_set<Candidate, CandidateHash>& candidates(CollisionType type) const;
+        const std::vector<Candidate>& candidates(CollisionType type) const;
 
         /// @brief Clears the list of collision candidates.
         void clearCandidates();
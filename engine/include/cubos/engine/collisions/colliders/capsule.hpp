@@ -15,6 +15,8 @@ namespace cubos::engine
     /// - Convex: For any 2 points inside the shape, the line segment connecting those points lies
     /// inside the shape.
     /// - Zero margin: No margin is needed, since the shape has no sharp corners.
+    /// - Its length is along the Y axis of the collider's transform, and it is centered on its
+    ///   origin.
     ///
     /// @ingroup collisions-plugin
     struct [[cubos::component("cubos/capsule_collider", VecStorage)]] CapsuleCollider
@@ -0,0 +1,35 @@
+/// @file
+/// @brief Component @ref cubos::engine::VoxelCollider.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cubos/engine/voxels/occupancy.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Component which adds a voxel grid collider to an entity.
+    ///
+    /// - Concave: Each solid voxel of the grid is collided with as a separate box, and the contacts
+    ///   of all voxels are merged into a single manifold.
+    /// - Positive margin: Requires a positive margin to round off sharp corners. Defined in
+    ///   physics-space units.
+    ///
+    /// The voxel at `(x, y, z)` fills the unit cube between `(x, y, z)` and `(x + 1, y + 1, z + 1)`
+    /// in collider space, so the transform is usually used to center the grid.
+    ///
+    /// @ingroup collisions-plugin
+    struct [[cubos::component("cubos/voxel_collider", VecStorage)]] VoxelCollider
+    {
+        glm::mat4 transform{1.0F}; ///< Transform of the collider.
+        VoxelOccupancy shape;      ///< Solid voxels of the collider.
+
+        /// @brief Margin of the collider. Needed for collision stability.
+        ///
+        /// The collider margin avoids collision errors by rounding off sharp corners. It is
+        /// absolute so the collider's transform won't affect it.
+        float margin = 0.04F;
+    };
+} // namespace cubos::engine
@@ -0,0 +1,50 @@
+/// @file
+/// @brief Event @ref cubos::engine::CollisionEvent.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#include <cubos/core/ecs/entity_manager.hpp>
+
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Event sent by the narrow phase for each pair of colliders which are touching or
+    /// penetrating each other.
+    ///
+    /// The entities are ordered as in the name of the collision type, e.g., on a
+    /// @ref BroadPhaseCollisions::CollisionType::BoxPlane collision, @ref entity holds the box.
+    ///
+    /// @ingroup collisions-plugin
+    struct CollisionEvent
+    {
+        /// @brief Maximum number of points in a contact manifold.
+        static constexpr std::size_t MaxPoints = 4;
+
+        /// @brief Point of contact between the two colliders.
+        struct ContactPoint
+        {
+            glm::vec3 position; ///< Position in world space, halfway between both surfaces.
+            float penetration;  ///< Penetration depth along the normal at this point.
+        };
+
+        core::ecs::Entity entity;                 ///< First entity of the collision.
+        core::ecs::Entity other;                  ///< Second entity of the collision.
+        BroadPhaseCollisions::CollisionType type; ///< Type of the collision.
+
+        /// @brief Normal of the contact in world space, pointing from @ref entity to @ref other.
+        /// Moving @ref other along it separates the colliders.
+        glm::vec3 normal;
+
+        /// @brief Penetration depth of the deepest contact point.
+        float penetration;
+
+        ContactPoint points[MaxPoints]; ///< Contact points of the manifold.
+        std::size_t pointCount;         ///< Number of valid points in @ref points.
+    };
+} // namespace cubos::engine
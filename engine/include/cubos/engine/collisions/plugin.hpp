@@ -23,20 +23,28 @@ namespace cubos::engine
     /// - @ref CapsuleCollider - holds the capsule collider data.
     /// - @ref PlaneCollider - holds the plane collider data.
     /// - @ref SimplexCollider - holds the simplex collider data.
+    /// - @ref VoxelCollider - holds the voxel collider data.
     ///
     /// ## Events
-    /// - @ref CollisionEvent - (TODO) emitted when a collision occurs.
+    /// - @ref CollisionEvent - emitted for each pair of colliders which are touching, with their
+    ///   contact manifold.
     /// - @ref TriggerEvent - (TODO) emitted when a trigger is entered or exited.
     ///
     /// ## Resources
-    /// - @ref BroadPhaseCollisions - stores broad phase collision data.
+    /// - @ref BroadPhaseCollisions - stores broad phase collision data. Its `method` field selects
+    ///   the broad phase algorithm, either sweep and prune (the default) or a spatial hash.
+    /// - @ref SweepMarkers - stores the sweep and prune markers of each axis.
     ///
     /// ## Tags
     /// - `cubos.collisions.aabb.missing` - missing aabb colliders are added.
     /// - `cubos.collisions.aabb` - collider aabbs are updated.
-    /// - `cubos.collisions.broad.markers` - sweep markers are updated.
-    /// - `cubos.collisions.broad.sweep` - sweep is performed.
-    /// - `cubos.collisions.broad` - broad phase collision detection.
+    /// - `cubos.collisions.broad.markers` - the AABBs used by the sweep markers are updated, if
+    ///   using sweep and prune.
+    /// - `cubos.collisions.broad.sweep` - sweep is performed on each axis in parallel, if using
+    ///   sweep and prune.
+    /// - `cubos.collisions.broad` - broad phase collision detection, which fills the candidates.
+    /// - `cubos.collisions.narrow` - narrow phase collision detection, which checks the candidates
+    ///   of each collision type in parallel and emits the collision events.
     /// - `cubos.collisions` - collisions are resolved.
     ///
     /// ## Dependencies
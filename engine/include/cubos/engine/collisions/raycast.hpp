@@ -0,0 +1,62 @@
+/// @file
+/// @brief Functions @ref cubos::engine::raycast and @ref cubos::engine::boxcast.
+/// @ingroup collisions-plugin
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cubos/core/ecs/query.hpp>
+
+#include <cubos/engine/collisions/colliders/voxel.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Hit found by @ref raycast or @ref boxcast.
+    /// @ingroup collisions-plugin
+    struct RaycastHit
+    {
+        core::ecs::Entity entity; ///< Entity of the voxel collider which was hit.
+        glm::ivec3 voxel;         ///< Coordinates of the voxel which was hit, in the grid of the collider.
+        glm::vec3 point;          ///< Position of the ray, or of the center of the box, at the hit.
+        glm::vec3 normal;         ///< Normal of the face which was hit, or zero if the cast started overlapping.
+        float distance;           ///< Distance travelled along the direction until the hit.
+    };
+
+    /// @brief Query used to cast against voxel colliders. Systems which cast rays or boxes take it
+    /// as an argument and pass it to @ref raycast or @ref boxcast.
+    /// @ingroup collisions-plugin
+    using VoxelColliderQuery = core::ecs::Query<core::ecs::Read<LocalToWorld>, core::ecs::Read<VoxelCollider>>;
+
+    /// @brief Casts a ray against every voxel collider.
+    ///
+    /// The ray is transformed to the space of each grid, where it traverses the grid's occupancy
+    /// bitmasks, skipping over empty regions. Useful for picking, bullet hits and similar checks.
+    ///
+    /// @param query Voxel colliders.
+    /// @param origin Origin of the ray in world space.
+    /// @param direction Direction of the ray in world space.
+    /// @param maxDistance Maximum distance travelled by the ray.
+    /// @param[out] hit Closest hit, if any.
+    /// @return Whether a voxel was hit.
+    /// @ingroup collisions-plugin
+    bool raycast(VoxelColliderQuery& query, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                 RaycastHit& hit);
+
+    /// @brief Sweeps a world-aligned box against every voxel collider.
+    ///
+    /// On rotated grids, the box is replaced by the smallest box aligned with the grid which
+    /// contains it. Useful for character ground checks and similar queries.
+    ///
+    /// @param query Voxel colliders.
+    /// @param halfSize Half size of the box in world space.
+    /// @param origin Initial center of the box in world space.
+    /// @param direction Direction of the sweep in world space.
+    /// @param maxDistance Maximum distance travelled by the box.
+    /// @param[out] hit Closest hit, if any.
+    /// @return Whether a voxel was hit.
+    /// @ingroup collisions-plugin
+    bool boxcast(VoxelColliderQuery& query, const glm::vec3& halfSize, const glm::vec3& origin,
+                 const glm::vec3& direction, float maxDistance, RaycastHit& hit);
+} // namespace cubos::engine
@@ -11,6 +11,7 @@
 #include <cubos/core/ecs/event_pipe.hpp>
 #include <cubos/core/ecs/system.hpp>
 #include <cubos/core/ecs/world.hpp>
+#include <cubos/core/thread_pool.hpp>
 
 namespace cubos::engine
 {
@@ -25,6 +26,72 @@ namespace cubos::engine
         float value;
     };
 
+    /// @brief Resource which configures the fixed update stage.
+    ///
+    /// Systems added with @ref Cubos::fixedSystem run once for each @ref value seconds which pass,
+    /// regardless of the frame rate, and can use @ref value as their time step. If the simulation
+    /// falls behind, at most @ref maxSteps steps are run per frame, and the remaining time is
+    /// dropped.
+    ///
+    /// This resource is added by the @ref Cubos class, initially set to 60 steps per second.
+    ///
+    /// @ingroup engine
+    struct FixedDeltaTime
+    {
+        /// @brief Constructs. Aborts if @p value isn't positive.
+        /// @param value Duration of each fixed step, in seconds.
+        /// @param maxSteps Maximum number of fixed steps run per frame.
+        FixedDeltaTime(float value, int maxSteps);
+
+        /// @brief Takes the fixed steps covered by the time accumulated since the last step.
+        ///
+        /// If more than @ref maxSteps steps are covered, the time left behind is dropped, down
+        /// to less than one step. If @ref value isn't positive, no steps are taken and the
+        /// accumulated time is dropped.
+        ///
+        /// @param[in,out] accumulator Time accumulated since the last step, in seconds.
+        /// @return Number of fixed steps to run.
+        int take(float& accumulator) const;
+
+        /// @brief Gets how far, from 0 to 1, the accumulated time is from the next step.
+        /// @param accumulator Time accumulated since the last step, as left by @ref take().
+        /// @return Interpolation factor.
+        float alpha(float accumulator) const;
+
+        float value;  ///< Duration of each fixed step, in seconds.
+        int maxSteps; ///< Maximum number of fixed steps run per frame.
+    };
+
+    /// @brief Resource which stores how far, from 0 to 1, the time is between the last fixed step
+    /// and the next one.
+    ///
+    /// Useful to interpolate the state computed by fixed update systems when rendering. This
+    /// resource is added and updated by the @ref Cubos class.
+    ///
+    /// @ingroup engine
+    struct FixedInterpolation
+    {
+        FixedInterpolation(float alpha);
+        float alpha;
+    };
+
+    /// @brief Resource which limits how many times per second the main loop runs.
+    ///
+    /// When set to zero, the main loop runs as fast as possible. This resource is added by the
+    /// @ref Cubos class, initially set to @ref Default, so that applications without a window,
+    /// such as servers, sleep between iterations instead of using up a whole core. The window
+    /// plugin replaces it with its own setting, which has no limit by default.
+    ///
+    /// @ingroup engine
+    struct MaxFrameRate
+    {
+        /// @brief Limit used by applications without a window.
+        static constexpr float Default = 60.0F;
+
+        MaxFrameRate(float value);
+        float value;
+    };
+
     /// @brief Resource used as a flag to indicate whether the main loop should stop running.
     ///
     /// This resource is added by the @ref Cubos class, initially set to true.
@@ -76,6 +143,11 @@ namespace cubos::engine
         template <typename F>
         TagBuilder& runIf(F func);
 
+        /// @brief Forces systems with the current tag to run on the main thread. Necessary for
+        /// systems which use thread-bound APIs, such as the window or the render device.
+        /// @return Reference to this object, for chaining.
+        TagBuilder& onMainThread();
+
     private:
         core::ecs::Dispatcher& mDispatcher;
         std::vector<std::string>& mTags;
@@ -114,6 +186,16 @@ namespace cubos::engine
         template <typename F>
         SystemBuilder& runIf(F func);
 
+        /// @brief Forces the current system to run on the main thread. Necessary for systems which
+        /// use thread-bound APIs, such as the window or the render device.
+        /// @return Reference to this object, for chaining.
+        SystemBuilder& onMainThread();
+
+        /// @brief Sets the name of the current system, which identifies it in the profiler.
+        /// @param name Name.
+        /// @return Reference to this object, for chaining.
+        SystemBuilder& named(const std::string& name);
+
     private:
         core::ecs::Dispatcher& mDispatcher;
         std::vector<std::string>& mTags;
@@ -157,6 +239,9 @@ namespace cubos::engine
         Cubos& addComponent();
 
         /// @brief Adds a new event type to the engine.
+        ///
+        /// Events are kept until the end of the frame after the one they were sent in.
+        ///
         /// @tparam E Type of the event.
         /// @return Reference to this object, for chaining.
         template <typename E>
@@ -172,6 +257,11 @@ namespace cubos::engine
         /// @return @ref TagBuilder used to configure the tag.
         TagBuilder startupTag(const std::string& tag);
 
+        /// @brief Returns a @ref TagBuilder to configure the given fixed update tag.
+        /// @param tag Tag to configure.
+        /// @return @ref TagBuilder used to configure the tag.
+        TagBuilder fixedTag(const std::string& tag);
+
         /// @brief Adds a new system to the engine, which will be executed at every iteration of
         /// the main loop.
         /// @tparam F Type of the system function.
@@ -188,19 +278,33 @@ namespace cubos::engine
         template <typename F>
         SystemBuilder startupSystem(F func);
 
+        /// @brief Adds a new fixed update system to the engine, which will be executed at a fixed
+        /// rate, configured through the @ref FixedDeltaTime resource.
+        /// @tparam F Type of the system function.
+        /// @param func System function.
+        /// @return @ref SystemBuilder used to configure the system.
+        template <typename F>
+        SystemBuilder fixedSystem(F func);
+
         /// @brief Runs the engine.
         ///
         /// Initially, dispatches all of the startup systems.
-        /// Then, while @ref ShouldQuit is false, dispatches all other systems.
+        /// Then, while @ref ShouldQuit is false, dispatches the fixed update systems as many times
+        /// as the elapsed time requires, followed by all other systems.
+        /// Systems which don't conflict with each other are run in parallel.
         void run();
 
     private:
+        core::ThreadPool mThreadPool;
         core::ecs::Dispatcher mMainDispatcher;
+        core::ecs::Dispatcher mFixedDispatcher;
         core::ecs::Dispatcher mStartupDispatcher;
         core::ecs::World mWorld;
         std::set<void (*)(Cubos&)> mPlugins;
         std::vector<std::string> mMainTags;
+        std::vector<std::string> mFixedTags;
         std::vector<std::string> mStartupTags;
+        std::vector<void (*)(core::ecs::World&)> mEventUpdaters;
     };
 
     // Implementation.
@@ -238,6 +342,8 @@ namespace cubos::engine
     {
         // The user could register this manually, but using this method is more convenient.
         mWorld.registerResource<core::ecs::EventPipe<E>>();
+        mEventUpdaters.push_back(
+            [](core::ecs::World& world) { world.write<core::ecs::EventPipe<E>>().get().update(); });
         return *this;
     }
 
@@ -254,4 +360,11 @@ namespace cubos::engine
         mStartupDispatcher.addSystem(func);
         return {mStartupDispatcher, mMainTags};
     }
+
+    template <typename F>
+    SystemBuilder Cubos::fixedSystem(F func)
+    {
+        mFixedDispatcher.addSystem(func);
+        return {mFixedDispatcher, mMainTags};
+    }
 } // namespace cubos::engine
@@ -11,7 +11,7 @@ namespace cubos::engine
     /// @brief Component which defines parameters of a camera used to render the world.
     /// @note Should be used with @ref LocalToWorld.
     /// @ingroup renderer-plugin
-    struct [[cubos::component("cubos/camera", VecStorage)]] Camera
+    struct [[cubos::component("cubos/camera", SparseSetStorage)]] Camera
     {
         float fovY;  ///< Vertical field of view in degrees.
         float zNear; ///< Near clipping plane.
@@ -40,12 +40,12 @@ namespace cubos::engine
 
         // Implement interface methods.
 
-        RendererGrid upload(const VoxelGrid& grid) override;
         void setPalette(const VoxelPalette& palette) override;
 
     protected:
         // Implement interface methods.
 
+        RendererGrid onUpload(const VoxelMesh& mesh) override;
         void onResize(glm::uvec2 size) override;
         void onRender(const glm::mat4& view, const Viewport& viewport, const Camera& camera, const RendererFrame& frame,
                       core::gl::Framebuffer target) override;
@@ -68,6 +68,11 @@ namespace cubos::engine
         core::gl::ShaderPipeline mGeometryPipeline;
         core::gl::ShaderBindingPoint mVpBp;
         core::gl::ConstantBuffer mVpBuffer;
+        core::gl::ShaderBindingPoint mInstancesBp;
+        core::gl::ShaderBindingPoint mBaseInstanceBp;
+        core::gl::Texture2D mInstancesTex;
+        std::size_t mInstancesTexRows = 0;
+        std::vector<glm::mat4> mInstances;
         core::gl::RasterState mGeometryRasterState;
         core::gl::BlendState mGeometryBlendState;
         core::gl::DepthStencilState mGeometryDepthStencilState;
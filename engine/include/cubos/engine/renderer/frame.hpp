@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <unordered_map>
 #include <vector>
 
 #include <cubos/engine/renderer/directional_light.hpp>
@@ -18,6 +19,9 @@ namespace cubos::engine
     /// Each frame, the @ref renderer-plugin will query entities with renderer components, such as
     /// @ref RenderableGrid and @ref PointLight, and add them to the @ref RendererFrame.
     ///
+    /// Draw commands are grouped by grid as they're submitted, so that renderers can draw every
+    /// instance of the same grid at once.
+    ///
     /// @ingroup renderer-plugin
     class RendererFrame final
     {
@@ -25,14 +29,14 @@ namespace cubos::engine
         RendererFrame() = default;
         ~RendererFrame() = default;
 
-        /// @brief Data of a single draw command.
-        struct DrawCmd
+        /// @brief Draw commands of a single grid.
+        struct DrawBatch
         {
-            RendererGrid grid;  ///< Grid to be drawn.
-            glm::mat4 modelMat; ///< Model transform matrix.
+            RendererGrid grid;                ///< Grid to be drawn.
+            std::vector<glm::mat4> instances; ///< Model transform matrix of each instance of the grid.
         };
 
-        /// @brief Submits a draw command.
+        /// @brief Submits a draw command, adding an instance to the batch of its grid.
         /// @param grid Handle of the grid to draw.
         /// @param modelMat Model matrix of the grid, used for applying transformations.
         void draw(RendererGrid grid, glm::mat4 modelMat);
@@ -64,9 +68,29 @@ namespace cubos::engine
         /// @brief Clears the frame, removing all draw calls and lights.
         void clear();
 
-        /// @brief Gets all of the draw commands stored in the frame.
-        /// @return Draw commands.
-        const std::vector<DrawCmd>& drawCmds() const;
+        /// @brief Replaces this frame by the part of another frame which is visible from a camera.
+        ///
+        /// Lights are copied as they are. Draw commands whose grid bounding boxes are outside of
+        /// the camera frustum are dropped, and the remaining ones are replaced by the coarsest
+        /// versions of their grids whose voxels are at most as large on screen as the given threshold.
+        ///
+        /// @param frame Frame to cull.
+        /// @param view View matrix of the camera.
+        /// @param projection Projection matrix of the camera.
+        /// @param viewportHeight Height of the viewport, in pixels.
+        /// @param lodThreshold Size of a voxel on screen, in pixels, up to which coarser grids are
+        /// drawn.
+        void cull(const RendererFrame& frame, const glm::mat4& view, const glm::mat4& projection,
+                  float viewportHeight, float lodThreshold);
+
+        /// @brief Gets the draw commands stored in the frame, grouped by grid, in the order each
+        /// grid was first drawn.
+        /// @return Draw batches.
+        const std::vector<DrawBatch>& drawBatches() const;
+
+        /// @brief Gets the number of draw commands stored in the frame, across all batches.
+        /// @return Instance count.
+        std::size_t instanceCount() const;
 
         /// @brief Gets the ambient light of the scene.
         /// @return Dmbient light.
@@ -92,7 +116,9 @@ namespace cubos::engine
     private:
         glm::vec3 mAmbientColor;
         glm::vec3 mSkyGradient[2];
-        std::vector<DrawCmd> mDrawCmds;
+        std::vector<DrawBatch> mDrawBatches;
+        std::unordered_map<const impl::RendererGrid*, std::size_t> mBatchIndices;
+        std::size_t mInstanceCount = 0;
         std::vector<std::pair<glm::mat4, SpotLight>> mSpotLights;
         std::vector<std::pair<glm::mat4, DirectionalLight>> mDirectionalLights;
         std::vector<std::pair<glm::mat4, PointLight>> mPointLights;
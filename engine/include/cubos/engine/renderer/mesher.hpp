@@ -0,0 +1,125 @@
+/// @file
+/// @brief Resource @ref cubos::engine::GridMesher and class @ref cubos::engine::MeshingJob.
+/// @ingroup renderer-plugin
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include <cubos/core/thread_pool.hpp>
+
+#include <cubos/engine/renderer/vertex.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Triangulation of chunks of a voxel grid, running on the threads of a @ref GridMesher.
+    /// @ingroup renderer-plugin
+    class MeshingJob final
+    {
+    public:
+        /// @brief Checks if the meshes of all chunks are ready.
+        /// @return Whether the job finished.
+        bool done() const;
+
+        /// @brief Gets the origins of the chunks triangulated by the job, as passed to
+        /// @ref GridMesher::submit.
+        /// @return Chunk origins.
+        const std::vector<glm::ivec3>& chunks() const;
+
+        /// @brief Gets a mesh produced by the job.
+        ///
+        /// Level of detail 0 is the chunk itself. Each of the following levels has voxels twice as
+        /// large as the previous, which take the most common material of the voxels they cover,
+        /// and so must be scaled by `2^lod` to match the grid.
+        ///
+        /// @note Must only be called after @ref done returns true.
+        /// @param chunk Index of the chunk in @ref chunks.
+        /// @param lod Level of detail, less than @ref GridMesher::LodCount.
+        /// @return Mesh, with positions relative to the origin of the chunk, in units of its voxels.
+        const VoxelMesh& mesh(std::size_t chunk, std::size_t lod) const;
+
+        /// @brief Gets the total size of the meshes of every level of detail of a chunk, which is
+        /// how many bytes uploading the chunk takes.
+        /// @note Must only be called after @ref done returns true.
+        /// @param chunk Index of the chunk in @ref chunks.
+        /// @return Size in bytes.
+        std::size_t size(std::size_t chunk) const;
+
+        /// @brief Skips the triangulation of the chunks which haven't started yet, as their
+        /// results are no longer needed.
+        void cancel();
+
+        /// @brief Number of chunks, in the order of @ref chunks, whose meshes were already uploaded.
+        std::size_t uploadedChunks = 0;
+
+    private:
+        friend class GridMesher;
+
+        std::vector<glm::ivec3> mChunks;        ///< Origins of the chunks.
+        std::vector<VoxelMesh> mMeshes;         ///< Meshes produced by the job, grouped by chunk.
+        std::atomic<std::size_t> mRemaining{0}; ///< Number of chunks not yet triangulated.
+        std::atomic<bool> mCancel{false};       ///< Set when the result is no longer needed.
+    };
+
+    /// @brief Resource which triangulates voxel grids on its own worker threads.
+    ///
+    /// Grids are split into chunks of @ref ChunkSize voxels per axis, which are meshed separately,
+    /// so that changing a few voxels only requires the chunks around them to be triangulated and
+    /// uploaded again. Each chunk is also triangulated at @ref LodCount levels of detail, to be
+    /// drawn when it's far away. The renderer plugin submits the chunks which changed here, and keeps
+    /// drawing their previous meshes until the new ones are done. Finished meshes are then
+    /// uploaded a chunk at a time, at most @ref uploadBudget bytes per frame.
+    ///
+    /// The workers are separate from the engine's thread pool, so that the systems of a frame
+    /// never end up waiting on a long triangulation.
+    ///
+    /// @ingroup renderer-plugin
+    class GridMesher final
+    {
+    public:
+        /// @brief Number of voxels of a chunk on each axis.
+        static constexpr int ChunkSize = 32;
+
+        /// @brief Number of levels of detail each chunk is triangulated at.
+        static constexpr int LodCount = 3;
+
+        /// @brief Number of voxels around a chunk on each side which its meshes depend on.
+        static constexpr int ChunkMargin = 1 << (LodCount - 1);
+
+        /// @brief Constructs with a single worker thread.
+        GridMesher();
+
+        /// @brief Replaces the worker threads, waiting for the submitted jobs to finish.
+        /// @param count Number of worker threads, at least one.
+        void setThreadCount(std::size_t count);
+
+        /// @brief Starts triangulating chunks of a grid, each on its own task.
+        ///
+        /// The grid may be a copy of just a region of a larger grid, as long as it includes the
+        /// @ref ChunkMargin voxels around the chunks, which are needed to cull their faces.
+        ///
+        /// @param grid Copy of the grid to triangulate, owned by the job until it finishes.
+        /// @param origin Coordinates of the first voxel of the grid, in the same space as the chunks.
+        /// @param chunks Origins of the chunks to triangulate. Chunks span @ref ChunkSize voxels
+        /// on each axis, or less where they reach the end of the grid.
+        /// @return Job, which can be polled for the meshes.
+        std::shared_ptr<MeshingJob> submit(VoxelGrid grid, const glm::ivec3& origin, std::vector<glm::ivec3> chunks);
+
+        /// @brief Blocks until every submitted job finishes.
+        void wait();
+
+        /// @brief Maximum number of bytes of finished meshes uploaded to the GPU per frame, at
+        /// least one.
+        std::size_t uploadBudget = 16 * 1024 * 1024;
+
+        /// @brief Bytes by which a chunk larger than @ref uploadBudget went over it, which are taken
+        /// from the budgets of the next frames - set automatically.
+        std::size_t uploadDebt = 0;
+
+    private:
+        std::unique_ptr<core::ThreadPool> mPool; ///< Worker threads.
+    };
+} // namespace cubos::engine
@@ -10,6 +10,7 @@
 #pragma once
 
 #include <cubos/engine/assets/plugin.hpp>
+#include <cubos/engine/renderer/mesher.hpp>
 #include <cubos/engine/renderer/renderer.hpp>
 #include <cubos/engine/voxels/grid.hpp>
 #include <cubos/engine/voxels/palette.hpp>
@@ -35,12 +36,17 @@ namespace cubos::engine
     /// ## Settings
     /// - `cubos.renderer.ssao.enabled` - whether SSAO is enabled.
     /// - `cubos.renderer.bloom.enabled` - whether bloom is enabled.
+    /// - `cubos.renderer.meshing.threads` - number of threads which triangulate grids (default: 1).
+    /// - `cubos.renderer.meshing.budget` - maximum bytes of meshes uploaded per frame (default: 16 MiB).
+    /// - `cubos.renderer.lod.threshold` - size in pixels of voxels on screen below which coarser
+    ///   meshes are drawn, or 0 to always draw full detail (default: 1).
     ///
     /// ## Resources
     /// - @ref Renderer - handle to the renderer.
     /// - @ref RendererFrame - holds the current frame information.
     /// - @ref RendererEnvironment - holds the environment information (ambient light, sky gradient).
     /// - @ref ActiveCameras - holds the entities which represents the active cameras.
+    /// - @ref GridMesher - triangulates grids in the background, before they're uploaded.
     ///
     /// ## Components
     /// - @ref RenderableGrid - a grid to be rendered.
@@ -67,9 +73,24 @@ namespace cubos::engine
     /// @ingroup renderer-plugin
     struct [[cubos::component("cubos/renderable_grid", VecStorage)]] RenderableGrid
     {
-        Asset<VoxelGrid> asset;                          ///< Handle to the grid asset to be rendered.
-        glm::vec3 offset = {0.0F, 0.0F, 0.0F};           ///< Translation applied to the voxel grid before any other.
-        [[cubos::ignore]] RendererGrid handle = nullptr; ///< Handle to the uploaded grid - set automatically.
+        Asset<VoxelGrid> asset;                ///< Handle to the grid asset to be rendered.
+        glm::vec3 offset = {0.0F, 0.0F, 0.0F}; ///< Translation applied to the voxel grid before any other.
+
+        /// @brief Handles to the uploaded meshes of the chunks of the grid, of
+        /// @ref GridMesher::ChunkSize voxels per axis, ordered by X, then Y, then Z - set
+        /// automatically. Chunks without any faces have null handles.
+        [[cubos::ignore]] std::vector<RendererGrid> chunks{};
+
+        /// @brief Size of the grid which @ref chunks were made for - set automatically.
+        [[cubos::ignore]] glm::uvec3 chunkedSize = {0, 0, 0};
+
+        /// @brief Revision of the grid when its changed chunks were last submitted for meshing -
+        /// set automatically.
+        [[cubos::ignore]] uint64_t revision = 0;
+
+        /// @brief Chunks being triangulated since the grid last changed, which replace their entries
+        /// in @ref chunks once uploaded - set automatically.
+        [[cubos::ignore]] std::shared_ptr<MeshingJob> meshing = nullptr;
     };
 
     /// @brief Resource which identifies the camera entities to be used by the renderer.
@@ -11,7 +11,7 @@ namespace cubos::engine
     /// @brief Component which makes an entity behave like a point light.
     /// @note Should be used with @ref LocalToWorld.
     /// @ingroup renderer-plugin
-    struct [[cubos::component("cubos/point_light", VecStorage)]] PointLight
+    struct [[cubos::component("cubos/point_light", SparseSetStorage)]] PointLight
     {
         glm::vec3 color;
         float intensity;
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <memory>
+
 #include <glm/glm.hpp>
 
 #include <cubos/core/gl/render_device.hpp>
@@ -48,6 +50,10 @@ namespace cubos::engine
     /// away renderer implementations using different plugins which would just switch the systems
     /// being run, keeping the same components which are effectively its API.
     ///
+    /// Before being drawn, frames go through a culling stage which drops the draw commands whose
+    /// grids are outside of the camera's frustum, and replaces grids whose voxels are smaller on
+    /// screen than the LOD threshold by their coarser versions.
+    ///
     /// @see PostProcessingManager
     /// @ingroup renderer-plugin
     class BaseRenderer
@@ -60,7 +66,7 @@ namespace cubos::engine
             glm::ivec2 size;
         };
 
-        virtual ~BaseRenderer() = default;
+        virtual ~BaseRenderer();
 
         /// @brief Constructs.
         /// @warning @p renderDevice must be valid during the lifetime of the renderer.
@@ -71,10 +77,29 @@ namespace cubos::engine
         /// @brief Deleted copy constructor.
         BaseRenderer(const BaseRenderer&) = delete;
 
-        /// @brief Uploads a grid to the GPU and returns an handle which can be used to draw it.
+        /// @brief Triangulates a grid and uploads it to the GPU, returning an handle which can be
+        /// used to draw it.
+        /// @note Blocks while the grid is triangulated. Use a @ref GridMesher to triangulate it
+        /// in the background and upload the resulting mesh instead.
         /// @param grid Grid to upload.
         /// @return Handle of the grid.
-        virtual RendererGrid upload(const VoxelGrid& grid) = 0;
+        RendererGrid upload(const VoxelGrid& grid);
+
+        /// @brief Uploads the mesh of a grid to the GPU and returns an handle which can be used to
+        /// draw it. The bounding box of the mesh is computed and stored in the handle, for culling.
+        /// @param mesh Mesh to upload.
+        /// @param lod Handle of a coarser version of the mesh, with voxels twice as large, to be
+        /// drawn instead when the mesh is small on screen, or null.
+        /// @return Handle of the grid.
+        RendererGrid upload(const VoxelMesh& mesh, RendererGrid lod = nullptr);
+
+        /// @brief Sets how large voxels must be on screen for grids to be drawn with full detail.
+        ///
+        /// Grids whose voxels are smaller than this are drawn with their coarser versions, for as
+        /// long as the voxels of those are still smaller than this as well.
+        ///
+        /// @param pixels Size of a voxel on screen, in pixels. Zero disables levels of detail.
+        void setLodThreshold(float pixels);
 
         /// @brief Sets the current palette of the renderer.
         /// @param palette Palette to set.
@@ -106,6 +131,14 @@ namespace cubos::engine
     protected:
         core::gl::RenderDevice& mRenderDevice; ///< Render device being used.
 
+        /// @brief Called when upload() is called.
+        ///
+        /// Renderer implementations should implement this function to upload the mesh to the GPU.
+        ///
+        /// @param mesh Mesh to upload.
+        /// @return Handle of the grid.
+        virtual RendererGrid onUpload(const VoxelMesh& mesh) = 0;
+
         /// @brief Called when resize() is called.
         ///
         /// Renderer implementations should override this function to resize their framebuffers.
@@ -115,7 +148,8 @@ namespace cubos::engine
 
         /// @brief Called when render() is called, before applying post processing effects.
         ///
-        /// Renderer implementations should implement this function to draw the frame.
+        /// Renderer implementations should implement this function to draw the frame. The frame
+        /// is already culled, so every one of its draw commands should be drawn.
         /// When post processing is enabled, the target framebuffer will be the internal texture
         /// which will be used for post processing.
         ///
@@ -131,9 +165,11 @@ namespace cubos::engine
         /// @brief Called when the internal texture used for post processing needs to be resized.
         void resizeTex(glm::uvec2 size);
 
-        PostProcessingManager mPpsManager;  ///< Post processing manager.
-        core::gl::Framebuffer mFramebuffer; ///< Framebuffer where the frame is drawn.
-        core::gl::Texture2D mTexture;       ///< Texture where the frame is drawn.
+        PostProcessingManager mPpsManager;           ///< Post processing manager.
+        core::gl::Framebuffer mFramebuffer;          ///< Framebuffer where the frame is drawn.
+        core::gl::Texture2D mTexture;                ///< Texture where the frame is drawn.
+        std::unique_ptr<RendererFrame> mCulledFrame; ///< Part of the frame visible from the camera.
+        float mLodThreshold;                         ///< Voxel size on screen below which LODs are drawn.
         glm::uvec2 mSize;
     };
 
@@ -146,6 +182,13 @@ namespace cubos::engine
         public:
             virtual ~RendererGrid() = default;
 
+            glm::vec3 min{0.0F}; ///< Minimum corner of the bounding box of the mesh, in its local space.
+            glm::vec3 max{0.0F}; ///< Maximum corner of the bounding box of the mesh, in its local space.
+
+            /// @brief Coarser version of the grid, with voxels twice as large, drawn instead when
+            /// the grid is small on screen, or null.
+            std::shared_ptr<RendererGrid> lod;
+
         protected:
             RendererGrid() = default;
         };
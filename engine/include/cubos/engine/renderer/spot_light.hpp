@@ -12,7 +12,7 @@ namespace cubos::engine
     /// @note Should be used with @ref LocalToWorld.
     /// @todo In what direction does the spot light point for an identity transform?
     /// @ingroup renderer-plugin
-    struct [[cubos::component("cubos/spot_light", VecStorage)]] SpotLight
+    struct [[cubos::component("cubos/spot_light", SparseSetStorage)]] SpotLight
     {
         glm::vec3 color;
         float intensity;
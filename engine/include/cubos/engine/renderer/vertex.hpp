@@ -1,9 +1,12 @@
 /// @file
-/// @brief Class @ref cubos::engine::VoxelVertex and function @ref cubos::engine::triangulate.
+/// @brief Classes @ref cubos::engine::VoxelVertex and @ref cubos::engine::VoxelMesh, and function @ref
+/// cubos::engine::triangulate.
 /// @ingroup renderer-plugin
 
 #pragma once
 
+#include <vector>
+
 #include <glm/glm.hpp>
 
 #include <cubos/core/data/old/deserializer.hpp>
@@ -13,21 +16,67 @@ namespace cubos::engine
 {
     class VoxelGrid;
 
-    /// @brief Represents a voxel vertex.
+    /// @brief Represents a voxel vertex, packed into 8 bytes.
+    ///
+    /// Positions are stored with 10 bits per axis, so vertices can't be further than
+    /// @ref MaxCoordinate from the origin of their grid. Normals are always aligned with one of
+    /// the axes, so only the index of the face direction is stored.
+    ///
     /// @ingroup renderer-plugin
     struct VoxelVertex
     {
-        glm::uvec3 position; ///< Position of the vertex.
-        glm::vec3 normal;    ///< Normal of the vertex.
-        uint16_t material;   ///< Index of the material on the palette.
+        /// @brief Maximum coordinate of a vertex on each axis.
+        static constexpr uint32_t MaxCoordinate = (1U << 10) - 1;
+
+        uint32_t position; ///< Position of the vertex, as `x | (y << 10) | (z << 20)`.
+        uint16_t face;     ///< Face direction, in the order +X, -X, +Y, -Y, +Z, -Z.
+        uint16_t material; ///< Index of the material on the palette.
+
+        /// @brief Packs a position with 10 bits per axis.
+        /// @param position Position, at most @ref MaxCoordinate on each axis.
+        /// @return Packed position.
+        static uint32_t packPosition(const glm::uvec3& position);
+
+        /// @brief Gets the unpacked position of the vertex.
+        /// @return Position.
+        glm::uvec3 unpackPosition() const;
+
+        /// @brief Gets the normal of the face the vertex belongs to.
+        /// @return Normal.
+        glm::vec3 normal() const;
+    };
+
+    /// @brief Indexed mesh of a voxel grid, produced by @ref triangulate.
+    /// @ingroup renderer-plugin
+    struct VoxelMesh
+    {
+        std::vector<VoxelVertex> vertices; ///< Vertices of the mesh.
+        std::vector<uint32_t> indices;     ///< Indices of the mesh.
     };
 
     /// @brief Triangulates a grid of voxels into an indexed mesh.
+    /// @note Grids larger than @ref VoxelVertex::MaxCoordinate on any axis produce an empty mesh.
     /// @param grid Grid to triangulate.
     /// @param vertices Vertices of the mesh.
     /// @param indices Indices of the mesh.
     /// @ingroup renderer-plugin
     void triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices);
+
+    /// @brief Triangulates a region of a grid into an indexed mesh, with positions relative to the
+    /// first voxel of the region.
+    ///
+    /// Only faces of voxels inside the region are generated, but they're culled against their
+    /// neighbours outside of it, so that the meshes of adjacent regions fit together seamlessly.
+    ///
+    /// @note Regions larger than @ref VoxelVertex::MaxCoordinate on any axis produce an empty mesh.
+    /// @param grid Grid to triangulate.
+    /// @param min Coordinates of the first voxel of the region.
+    /// @param size Size of the region.
+    /// @param vertices Vertices of the mesh.
+    /// @param indices Indices of the mesh.
+    /// @ingroup renderer-plugin
+    void triangulate(const VoxelGrid& grid, const glm::ivec3& min, const glm::uvec3& size,
+                     std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices);
 } // namespace cubos::engine
 
 namespace cubos::core::data::old
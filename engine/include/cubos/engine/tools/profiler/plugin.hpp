@@ -0,0 +1,30 @@
+/// @dir
+/// @brief @ref profiler-tool-plugin plugin directory.
+
+/// @file
+/// @brief Plugin entry point.
+/// @ingroup profiler-tool-plugin
+
+#pragma once
+
+#include <cubos/engine/cubos.hpp>
+
+namespace cubos::engine::tools
+{
+    /// @defgroup profiler-tool-plugin Profiler
+    /// @ingroup tool-plugins
+    /// @brief Shows frame times and how long each system and profiled zone takes through a ImGui
+    /// window, and allows exporting them as a Chrome trace.
+    ///
+    /// ## Settings
+    /// - `cubos.tools.profiler.path` - path of the exported trace (default: `profile.json`).
+    ///
+    /// ## Dependencies
+    /// - @ref imgui-plugin
+    /// - @ref settings-plugin
+
+    /// @brief Plugin entry function.
+    /// @param cubos @b CUBOS. main class
+    /// @ingroup profiler-tool-plugin
+    void profilerPlugin(Cubos& cubos);
+} // namespace cubos::engine::tools
@@ -0,0 +1,26 @@
+/// @file
+/// @brief Component @ref cubos::engine::Children.
+/// @ingroup transform-plugin
+
+#pragma once
+
+#include <vector>
+
+#include <cubos/core/ecs/entity_manager.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Component which lists the entities attached to an entity through their @ref Parent
+    /// component.
+    ///
+    /// Entities which are destroyed or detached are only removed from the list the next time an
+    /// entity is attached to the same parent, and are ignored until then.
+    ///
+    /// @note This component is managed by the @ref transform-plugin "transform plugin", and
+    /// shouldn't be modified manually. Add or change @ref Parent components instead.
+    /// @ingroup transform-plugin
+    struct [[cubos::component("cubos/children", SparseSetStorage)]] Children
+    {
+        std::vector<core::ecs::Entity> entities; ///< Entities attached to this entity.
+    };
+} // namespace cubos::engine
@@ -0,0 +1,22 @@
+/// @file
+/// @brief Component @ref cubos::engine::LocalToParent.
+/// @ingroup transform-plugin
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Component which stores the transformation matrix of an entity with a @ref Parent,
+    /// from local to parent space.
+    ///
+    /// @note This component is managed by the @ref transform-plugin "transform plugin", which
+    /// computes it from the @ref Position, @ref Rotation and @ref Scale components, and then
+    /// multiplies it by the parent's @ref LocalToWorld.
+    /// @ingroup transform-plugin
+    struct [[cubos::component("cubos/local_to_parent", SparseSetStorage)]] LocalToParent
+    {
+        glm::mat4 mat = glm::mat4(1.0F); ///< Local to parent space matrix.
+    };
+} // namespace cubos::engine
@@ -19,7 +19,7 @@ namespace cubos::engine
     /// @sa Rotation Applies a rotation to this matrix.
     /// @sa Scale Applies a scaling to this matrix.
     /// @ingroup transform-plugin
-    struct [[cubos::component("cubos/local_to_world", VecStorage)]] LocalToWorld
+    struct [[cubos::component("cubos/local_to_world", ArchetypeStorage)]] LocalToWorld
     {
         glm::mat4 mat = glm::mat4(1.0F); ///< Local to world space matrix.
     };
@@ -0,0 +1,24 @@
+/// @file
+/// @brief Component @ref cubos::engine::Parent.
+/// @ingroup transform-plugin
+
+#pragma once
+
+#include <cubos/core/ecs/entity_manager.hpp>
+
+namespace cubos::engine
+{
+    /// @brief Component which attaches an entity to another, making its transform relative to the
+    /// transform of the other entity.
+    ///
+    /// The @ref Position, @ref Rotation and @ref Scale of an entity with this component are
+    /// applied in the space of its parent, which must have a @ref LocalToWorld component.
+    ///
+    /// @note If the parent is destroyed, the entity stays where it was, but stops following it.
+    /// @sa Children Lists the entities attached to an entity.
+    /// @ingroup transform-plugin
+    struct [[cubos::component("cubos/parent", SparseSetStorage)]] Parent
+    {
+        core::ecs::Entity entity; ///< Entity this entity is attached to.
+    };
+} // namespace cubos::engine
@@ -8,7 +8,10 @@
 #pragma once
 
 #include <cubos/engine/cubos.hpp>
+#include <cubos/engine/transform/children.hpp>
+#include <cubos/engine/transform/local_to_parent.hpp>
 #include <cubos/engine/transform/local_to_world.hpp>
+#include <cubos/engine/transform/parent.hpp>
 #include <cubos/engine/transform/position.hpp>
 #include <cubos/engine/transform/rotation.hpp>
 #include <cubos/engine/transform/scale.hpp>
@@ -24,18 +27,29 @@ namespace cubos::engine
     /// entity which doesn't need rotation, but has a position and a scale, you do not need to add
     /// the @ref Rotation component, and its transform will still be updated.
     ///
-    /// @note Any entity with either a @ref Position, @ref Rotation or @ref Scale component
-    /// automatically gets a @ref LocalToWorld component.
+    /// Entities can be attached to other entities with the @ref Parent component, which makes
+    /// their transform relative to their parent's. The resulting matrices are propagated down
+    /// each hierarchy breadth-first, and only recomputed for the subtrees which changed.
+    ///
+    /// @note Any entity with either a @ref Position, @ref Rotation, @ref Scale or @ref Parent
+    /// component automatically gets a @ref LocalToWorld component. Entities with a @ref Parent
+    /// also get a @ref LocalToParent component.
     ///
     /// ## Components
     /// - @ref LocalToWorld - holds the local to world transform matrix.
+    /// - @ref LocalToParent - holds the local to parent transform matrix.
     /// - @ref Position - holds the position of an entity.
     /// - @ref Rotation - holds the rotation of an entity.
     /// - @ref Scale - holds the scaling of an entity.
+    /// - @ref Parent - attaches an entity to another.
+    /// - @ref Children - lists the entities attached to an entity.
     ///
     /// ## Tags
-    /// - `cubos.transform.update` - the @ref LocalToWorld components are updated with the
-    ///    information from the @ref Position, @ref Rotation and @ref Scale components.
+    /// - `cubos.transform.local` - the @ref LocalToWorld and @ref LocalToParent components are
+    ///    updated with the information from the @ref Position, @ref Rotation and @ref Scale
+    ///    components.
+    /// - `cubos.transform.update` - the @ref LocalToWorld components are updated, including the
+    ///    ones of entities with a @ref Parent. Includes `cubos.transform.local`.
 
     /// @brief Plugin entry function.
     /// @param cubos @b CUBOS. main class
@@ -11,7 +11,7 @@ namespace cubos::engine
     /// @brief Component which assigns a position to an entity.
     /// @sa LocalToWorld Holds the resulting transform matrix.
     /// @ingroup transform-plugin
-    struct [[cubos::component("cubos/position", VecStorage)]] Position
+    struct [[cubos::component("cubos/position", ArchetypeStorage)]] Position
     {
         glm::vec3 vec = {0.0F, 0.0F, 0.0F}; ///< Position of the entity.
     };
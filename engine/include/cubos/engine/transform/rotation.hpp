@@ -11,7 +11,7 @@ namespace cubos::engine
     /// @brief Component which assigns a rotation to an entity.
     /// @sa LocalToWorld Holds the resulting transform matrix.
     /// @ingroup transform-plugin
-    struct [[cubos::component("cubos/rotation", VecStorage)]] Rotation
+    struct [[cubos::component("cubos/rotation", ArchetypeStorage)]] Rotation
     {
         glm::quat quat = glm::quat(1.0F, 0.0F, 0.0F, 0.0F); ///< Rotation of the entity.
     };
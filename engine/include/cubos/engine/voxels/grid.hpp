@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -26,11 +27,68 @@ namespace cubos::core::data::old
 namespace cubos::engine
 {
     /// @brief Represents a voxel object using a 3D grid.
+    ///
+    /// Voxels are stored in bricks of 8x8x8 voxels. Bricks whose voxels all have the same
+    /// material, such as empty space, are stored as a single material index, and only the others
+    /// store their voxels. This keeps large and mostly empty grids small in memory.
+    ///
+    /// When serialized, the voxels are run-length encoded in their flat order, and each run is
+    /// packed into as few bits as the grid's largest material index and longest runs need.
+    ///
+    /// Each brick also stores the @ref revision of the grid when it last changed, so that users
+    /// such as the renderer can find which regions changed since they last looked at the grid.
+    ///
     /// @see Each voxel stores a material index to be used with a @ref VoxelPalette.
     /// @ingroup voxels-plugin
     class VoxelGrid final
     {
     public:
+        /// @brief Non-empty voxel, returned by @ref Iterator.
+        struct Voxel
+        {
+            glm::ivec3 position; ///< Voxel coordinates.
+            uint16_t material;   ///< Material index of the voxel, never 0.
+        };
+
+        /// @brief Iterates over the non-empty voxels of a grid, skipping empty bricks entirely.
+        ///
+        /// Voxels are visited brick by brick, so they aren't ordered by their flat index. The
+        /// iterator is invalidated by any change to the grid.
+        class Iterator
+        {
+        public:
+            /// @brief Constructs.
+            /// @param grid Grid to iterate over.
+            /// @param brick Index of the first brick to visit.
+            Iterator(const VoxelGrid& grid, std::size_t brick);
+
+            /// @brief Compares two iterators.
+            /// @param other Other iterator.
+            /// @return Whether the iterators point to the same voxel.
+            bool operator==(const Iterator& other) const;
+
+            /// @brief Accesses the voxel pointed to by the iterator.
+            /// @return Voxel.
+            const Voxel& operator*() const;
+
+            /// @brief Accesses the voxel pointed to by the iterator.
+            /// @return Voxel.
+            const Voxel* operator->() const;
+
+            /// @brief Advances to the next non-empty voxel.
+            /// @return Reference to this.
+            Iterator& operator++();
+
+        private:
+            /// @brief Moves to the first non-empty voxel at or after the current position.
+            void seek();
+
+            const VoxelGrid* mGrid; ///< Grid being iterated.
+            std::size_t mBrick;     ///< Index of the current brick.
+            uint32_t mVoxel;        ///< Index of the current voxel in the brick.
+            Voxel mCurrent;         ///< Current voxel.
+        };
+
         ~VoxelGrid() = default;
 
         /// @brief Constructs an empty single-voxel grid.
@@ -47,6 +105,13 @@ namespace cubos::engine
         /// @param indices Material indices of the voxels.
         VoxelGrid(const glm::uvec3& size, const std::vector<uint16_t>& indices);
 
+        /// @brief Constructs a grid with a copy of a region of another grid.
+        /// @note Voxels of the region which are outside of the other grid are set to 0.
+        /// @param other Grid to copy from.
+        /// @param min Coordinates on the other grid of the first voxel of the region.
+        /// @param size Size of the region, and thus of the new grid.
+        VoxelGrid(const VoxelGrid& other, const glm::ivec3& min, const glm::uvec3& size);
+
         /// @brief Move constructs.
         /// @param other Other grid.
         VoxelGrid(VoxelGrid&& other) noexcept;
@@ -77,6 +142,41 @@ namespace cubos::engine
         /// @return Material index of the voxel.
         uint16_t get(const glm::ivec3& position) const;
 
+        /// @brief Gets an iterator to the first non-empty voxel.
+        /// @return Iterator.
+        Iterator begin() const;
+
+        /// @brief Gets an iterator past the last non-empty voxel.
+        /// @return Iterator.
+        Iterator end() const;
+
+        /// @brief Gets the current revision of the grid, which increases whenever a voxel changes.
+        ///
+        /// Revisions of unrelated grids never overlap: copies, resets and conversions take a range
+        /// of revisions newer than any handed out before, and mark every voxel as changed. Thus,
+        /// a revision read from a grid can be compared with any grid later stored in its place.
+        ///
+        /// @return Revision.
+        uint64_t revision() const;
+
+        /// @brief Checks if any voxel in a region may have changed after the given revision.
+        ///
+        /// Changes are tracked per brick, so this may also report changes to voxels of the region's
+        /// bricks which are outside of the region.
+        ///
+        /// @param min Minimum voxel coordinates of the region, inclusive.
+        /// @param max Maximum voxel coordinates of the region, exclusive.
+        /// @param revision Revision to compare against, as returned by @ref revision.
+        /// @return Whether the region changed.
+        bool changedSince(const glm::ivec3& min, const glm::ivec3& max, uint64_t revision) const;
+
+        /// @brief Collapses the bricks whose voxels all share the same material, releasing their
+        /// storage.
+        ///
+        /// Bricks are only split by @ref set, so grids which are mostly filled and then cleared
+        /// voxel by voxel can call this to get their memory back.
+        void compact();
+
         /// @brief Converts the material indices of this grid from one palette to another.
         ///
         /// For each material, it will search for another material in the second palette which is
@@ -93,7 +193,56 @@ namespace cubos::engine
                                                const char* /*name*/);
         friend void core::data::old::deserialize(core::data::old::Deserializer& /*deserializer*/, VoxelGrid& /*grid*/);
 
-        glm::uvec3 mSize;               ///< Size of the grid.
-        std::vector<uint16_t> mIndices; ///< Indices of the grid.
+        /// @brief Set on brick entries which store a single material instead of a brick slot.
+        static constexpr uint32_t UniformBit = 1U << 31;
+
+        /// @brief Number of voxels in a brick.
+        static constexpr uint32_t BrickVolume = 8 * 8 * 8;
+
+        /// @brief Gets the index of the entry of a brick in @ref mBricks.
+        /// @param brick Brick coordinates.
+        /// @return Entry index.
+        std::size_t brickIndex(const glm::ivec3& brick) const;
+
+        /// @brief Gets the coordinates of the first voxel of a brick.
+        /// @param index Entry index of the brick.
+        /// @return Voxel coordinates.
+        glm::ivec3 brickOrigin(std::size_t index) const;
+
+        /// @brief Gets the index of a voxel inside its brick.
+        /// @param position Voxel coordinates.
+        /// @return Index of the voxel in the brick.
+        static uint32_t voxelIndex(const glm::ivec3& position);
+
+        /// @brief Resets the grid to the given size, with every voxel set to 0.
+        /// @param size Size of the grid, which must be valid.
+        void reset(const glm::uvec3& size);
+
+        /// @brief Takes a new range of revisions, and marks every brick as changed in its first.
+        void markAllChanged();
+
+        /// @brief Replaces the contents of the grid with a flat array of material indices.
+        /// @param indices Material indices, which must match the size of the grid.
+        void fill(const std::vector<uint16_t>& indices);
+
+        /// @brief Sets a run of voxels, in the flat order of @ref fill, whose voxels are all 0.
+        ///
+        /// Bricks fully covered by the run are made uniform, and the others are filled span by span.
+        ///
+        /// @param begin Flat index of the first voxel of the run.
+        /// @param end Flat index past the last voxel of the run.
+        /// @param mat Material index to set.
+        void fillRun(uint64_t begin, uint64_t end, uint16_t mat);
+
+        /// @brief Gives a uniform brick a slot in @ref mVoxels, filled with its material.
+        /// @param entry Entry of the brick in @ref mBricks.
+        void split(uint32_t& entry);
+
+        glm::uvec3 mSize;                 ///< Size of the grid.
+        glm::uvec3 mBrickCount;           ///< Number of bricks on each axis.
+        std::vector<uint32_t> mBricks;    ///< Uniform material or slot in @ref mVoxels of each brick.
+        std::vector<uint16_t> mVoxels;    ///< Material indices of the non-uniform bricks, one slot per brick.
+        uint64_t mRevision;               ///< Revision of the last change to the grid.
+        std::vector<uint64_t> mRevisions; ///< Revision of the last change to each brick.
     };
 } // namespace cubos::engine
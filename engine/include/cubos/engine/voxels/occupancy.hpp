@@ -0,0 +1,220 @@
+/// @file
+/// @brief Class @ref cubos::engine::VoxelOccupancy.
+/// @ingroup voxels-plugin
+
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/deserializer.hpp>
+#include <cubos/core/data/old/serializer.hpp>
+
+namespace cubos::engine
+{
+    class VoxelGrid;
+    class VoxelOccupancy;
+} // namespace cubos::engine
+
+namespace cubos::core::data::old
+{
+    void serialize(Serializer& serializer, const engine::VoxelOccupancy& occupancy, const char* name);
+    void deserialize(Deserializer& deserializer, engine::VoxelOccupancy& occupancy);
+} // namespace cubos::core::data::old
+
+namespace cubos::engine
+{
+    /// @brief Hit found by a ray or shape cast against a @ref VoxelOccupancy.
+    /// @ingroup voxels-plugin
+    struct VoxelHit
+    {
+        glm::ivec3 voxel; ///< Coordinates of the voxel which was hit.
+        glm::vec3 normal; ///< Normal of the face which was hit, or zero if the cast started overlapping a voxel.
+        float distance;   ///< Parameter along the direction of the cast at which the hit happened.
+    };
+
+    /// @brief Stores which voxels of a @ref VoxelGrid are solid as a hierarchy of bitmasks, which
+    /// lets collision queries skip empty space.
+    ///
+    /// Voxels are grouped in bricks of 4x4x4, whose occupancy fits in a single 64-bit mask. Bricks
+    /// are in turn grouped in regions of 4x4x4 bricks, each with a mask of its non-empty bricks.
+    ///
+    /// The voxel at `(x, y, z)` fills the unit cube between `(x, y, z)` and `(x + 1, y + 1, z + 1)`.
+    /// Ranges of voxels include their minimum and exclude their maximum.
+    ///
+    /// @ingroup voxels-plugin
+    class VoxelOccupancy final
+    {
+    public:
+        ~VoxelOccupancy() = default;
+
+        /// @brief Constructs an occupancy without any voxels.
+        VoxelOccupancy();
+
+        /// @brief Constructs the occupancy of a grid. Voxels with a material index other than 0 are solid.
+        /// @param grid Grid.
+        VoxelOccupancy(const VoxelGrid& grid);
+
+        /// @brief Gets the size of the grid.
+        /// @return Size of the grid.
+        const glm::uvec3& size() const;
+
+        /// @brief Checks if a voxel is solid.
+        /// @param position Voxel coordinates.
+        /// @return Whether the voxel is solid, or false if it's out of bounds.
+        bool get(const glm::ivec3& position) const;
+
+        /// @brief Checks if any voxel in a range is solid.
+        /// @param min Minimum voxel coordinates.
+        /// @param max Maximum voxel coordinates.
+        /// @return Whether any voxel is solid.
+        bool any(const glm::ivec3& min, const glm::ivec3& max) const;
+
+        /// @brief Calls a function for each solid voxel in a range. Empty bricks and regions are skipped.
+        /// @tparam F Function type.
+        /// @param min Minimum voxel coordinates.
+        /// @param max Maximum voxel coordinates.
+        /// @param func Function called with the coordinates of each solid voxel.
+        template <typename F>
+        void forEach(const glm::ivec3& min, const glm::ivec3& max, F func) const
+        {
+            this->visitBricks(min, max, [&](const glm::ivec3& brick, uint64_t mask) {
+                for (; mask != 0; mask &= mask - 1)
+                {
+                    auto bit = std::countr_zero(mask);
+                    func(glm::ivec3{brick.x * 4 + (bit & 3), brick.y * 4 + ((bit >> 2) & 3), brick.z * 4 + (bit >> 4)});
+                }
+                return true;
+            });
+        }
+
+        /// @brief Calls a function for each non-empty brick in a range, with the mask of its solid
+        /// voxels within the range. Empty regions are skipped.
+        ///
+        /// Bit `x | (y << 2) | (z << 4)` of the mask is set if the voxel at `brick * 4 + (x, y, z)`
+        /// is solid.
+        ///
+        /// @tparam F Function type.
+        /// @param min Minimum voxel coordinates.
+        /// @param max Maximum voxel coordinates.
+        /// @param func Function called with the coordinates of each brick and its mask.
+        template <typename F>
+        void forEachBrick(const glm::ivec3& min, const glm::ivec3& max, F func) const
+        {
+            this->visitBricks(min, max, [&](const glm::ivec3& brick, uint64_t mask) {
+                func(brick, mask);
+                return true;
+            });
+        }
+
+        /// @brief Casts a ray against the solid voxels, using a DDA traversal which steps through
+        /// whole regions and bricks while they're empty.
+        /// @param origin Origin of the ray.
+        /// @param direction Direction of the ray. Doesn't have to be normalized.
+        /// @param maxDistance Maximum parameter along the direction.
+        /// @param[out] hit Closest hit, if any.
+        /// @return Whether a solid voxel was hit.
+        bool raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, VoxelHit& hit) const;
+
+        /// @brief Sweeps an axis-aligned box against the solid voxels.
+        ///
+        /// Each time a face of the box crosses into a new layer of voxels, only that layer is
+        /// checked for solid voxels.
+        ///
+        /// @param halfSize Half size of the box.
+        /// @param origin Initial center of the box.
+        /// @param direction Direction of the sweep. Doesn't have to be normalized.
+        /// @param maxDistance Maximum parameter along the direction.
+        /// @param[out] hit First hit, if any. Holds one of the voxels which were hit.
+        /// @return Whether a solid voxel was hit.
+        bool boxcast(const glm::vec3& halfSize, const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                     VoxelHit& hit) const;
+
+    private:
+        friend void core::data::old::serialize(core::data::old::Serializer& /*serializer*/,
+                                               const VoxelOccupancy& /*occupancy*/, const char* /*name*/);
+        friend void core::data::old::deserialize(core::data::old::Deserializer& /*deserializer*/,
+                                                 VoxelOccupancy& /*occupancy*/);
+
+        /// @brief Calls a function for each non-empty brick in a range, with the mask of its
+        /// solid voxels within the range.
+        /// @tparam F Function type, which returns whether to keep going.
+        /// @param min Minimum voxel coordinates.
+        /// @param max Maximum voxel coordinates.
+        /// @param func Function.
+        /// @return Whether every brick was visited.
+        template <typename F>
+        bool visitBricks(glm::ivec3 min, glm::ivec3 max, F func) const
+        {
+            min = glm::max(min, glm::ivec3{0, 0, 0});
+            max = glm::min(max, glm::ivec3{mSize});
+            if (min.x >= max.x || min.y >= max.y || min.z >= max.z)
+            {
+                return true;
+            }
+
+            auto minBrick = min / 4;
+            auto maxBrick = (max - 1) / 4;
+            for (int rz = minBrick.z / 4; rz <= maxBrick.z / 4; ++rz)
+            {
+                for (int ry = minBrick.y / 4; ry <= maxBrick.y / 4; ++ry)
+                {
+                    for (int rx = minBrick.x / 4; rx <= maxBrick.x / 4; ++rx)
+                    {
+                        if (mRegions[this->regionIndex({rx, ry, rz})] == 0)
+                        {
+                            continue;
+                        }
+
+                        for (int z = std::max(rz * 4, minBrick.z); z <= std::min(rz * 4 + 3, maxBrick.z); ++z)
+                        {
+                            for (int y = std::max(ry * 4, minBrick.y); y <= std::min(ry * 4 + 3, maxBrick.y); ++y)
+                            {
+                                for (int x = std::max(rx * 4, minBrick.x); x <= std::min(rx * 4 + 3, maxBrick.x); ++x)
+                                {
+                                    glm::ivec3 brick{x, y, z};
+                                    auto mask = mBricks[this->brickIndex(brick)] & rangeMask(brick, min, max);
+                                    if (mask != 0 && !func(brick, mask))
+                                    {
+                                        return false;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /// @brief Finds any solid voxel in a range.
+        /// @param min Minimum voxel coordinates.
+        /// @param max Maximum voxel coordinates.
+        /// @param[out] voxel Solid voxel found, if any.
+        /// @return Whether a solid voxel was found.
+        bool findVoxel(const glm::ivec3& min, const glm::ivec3& max, glm::ivec3& voxel) const;
+
+        /// @brief Gets the mask of the voxels of a brick which are within a range.
+        static uint64_t rangeMask(const glm::ivec3& brick, const glm::ivec3& min, const glm::ivec3& max);
+
+        /// @brief Gets the index of a brick in @ref mBricks.
+        std::size_t brickIndex(const glm::ivec3& brick) const;
+
+        /// @brief Gets the index of a region in @ref mRegions.
+        std::size_t regionIndex(const glm::ivec3& region) const;
+
+        /// @brief Fills @ref mRegions from @ref mBricks.
+        void buildRegions();
+
+        glm::uvec3 mSize;               ///< Size of the grid.
+        glm::uvec3 mBrickCount;         ///< Number of bricks along each axis.
+        glm::uvec3 mRegionCount;        ///< Number of regions along each axis.
+        std::vector<uint64_t> mBricks;  ///< Mask of the solid voxels of each brick.
+        std::vector<uint64_t> mRegions; ///< Mask of the non-empty bricks of each region.
+    };
+} // namespace cubos::engine
@@ -18,12 +18,14 @@ namespace cubos::engine
     /// @brief Creates and handles the lifecycle of a window.
     ///
     /// Initially sets @ref ShouldQuit to `false`, and sets it to `true` only when the window is
-    /// closed.
+    /// closed. Also replaces the default @ref MaxFrameRate, meant for applications without a
+    /// window, with the `window.maxFrameRate` setting.
     ///
     /// ## Settings
     /// - `window.title` - the window's title (default: `CUBOS.`).
     /// - `window.width` - the window's width (default: `800`).
     /// - `window.height` - the window's height (default: `600`).
+    /// - `window.maxFrameRate` - maximum frame rate, or zero for no limit (default: `0`).
     ///
     /// ## Events
     /// - @ref core::io::WindowEvent - event polled from the window.
@@ -5,6 +5,7 @@
 #include <cubos/core/data/old/json_deserializer.hpp>
 #include <cubos/core/data/old/json_serializer.hpp>
 #include <cubos/core/log.hpp>
+#include <cubos/core/profiler.hpp>
 
 #include <cubos/engine/assets/assets.hpp>
 
@@ -580,7 +581,13 @@ void Assets::loader()
         mLoaderQueue.pop_front();
         loaderLock.unlock(); // Unlock the mutex before loading the asset.
 
-        if (!task.bridge->load(*this, task.handle))
+        bool loaded;
+        {
+            CUBOS_PROFILE_SCOPE("Assets::load");
+            loaded = task.bridge->load(*this, task.handle);
+        }
+
+        if (!loaded)
         {
             CUBOS_ERROR("Failed to load asset '{}'", core::data::old::Debug(task.handle));
 
@@ -1,11 +1,17 @@
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
 #include "broad_phase.hpp"
 
+using Candidate = BroadPhaseCollisions::Candidate;
 using CollisionType = BroadPhaseCollisions::CollisionType;
 
 void updateBoxAABBs(Query<Read<LocalToWorld>, Read<BoxCollider>, Write<ColliderAABB>> query)
 {
-    for (auto [entity, localToWorld, collider, aabb] : query)
-    {
+    // Each AABB only depends on its own entity's components, so they can be computed in parallel.
+    query.parEach([](Entity /*entity*/, Read<LocalToWorld> localToWorld, Read<BoxCollider> collider,
+                     Write<ColliderAABB> aabb) {
         // Get the 4 points of the collider.
         glm::vec3 corners[4];
         collider->shape.corners4(corners);
@@ -35,70 +41,281 @@ void updateBoxAABBs(Query<Read<LocalToWorld>, Read<BoxCollider>, Write<ColliderA
         // Set the AABB.
         aabb->max = translation + max;
         aabb->min = translation - max;
-    }
+    });
 }
 
-void updateCapsuleAABBs(Query<Read<LocalToWorld>, Read<CapsuleCollider>, Write<ColliderAABB>> query,
-                        Write<BroadPhaseCollisions> collisions)
+void updateCapsuleAABBs(Query<Read<LocalToWorld>, Read<CapsuleCollider>, Write<ColliderAABB>> query)
 {
-    (void)query;
-    (void)collisions;
+    query.parEach([](Entity /*entity*/, Read<LocalToWorld> localToWorld, Read<CapsuleCollider> collider,
+                     Write<ColliderAABB> aabb) {
+        // Transforms collider space to world space.
+        auto transform = localToWorld->mat * collider->transform;
+
+        // The radius is scaled by the largest scale of the transform, so that the capsule stays round.
+        auto scale = std::max({glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[1]}),
+                               glm::length(glm::vec3{transform[2]})});
+        auto radius = glm::vec3{collider->shape.radius * scale};
+
+        // Get the ends of the capsule's segment, which lies along its local Y axis.
+        auto halfLength = collider->shape.length / 2.0F;
+        auto a = glm::vec3{transform * glm::vec4{0.0F, -halfLength, 0.0F, 1.0F}};
+        auto b = glm::vec3{transform * glm::vec4{0.0F, halfLength, 0.0F, 1.0F}};
+
+        // Set the AABB.
+        aabb->min = glm::min(a, b) - radius;
+        aabb->max = glm::max(a, b) + radius;
+    });
 }
 
-void updateSimplexAABBs(Query<Read<LocalToWorld>, Read<SimplexCollider>, Write<ColliderAABB>> query,
-                        Write<BroadPhaseCollisions> collisions)
+void updateSimplexAABBs(Query<Read<LocalToWorld>, Read<SimplexCollider>, Write<ColliderAABB>> query)
 {
-    (void)query;
-    (void)collisions;
+    query.parEach([](Entity /*entity*/, Read<LocalToWorld> localToWorld, Read<SimplexCollider> collider,
+                     Write<ColliderAABB> aabb) {
+        // An empty simplex is reduced to its offset.
+        auto min = glm::vec3{localToWorld->mat * glm::vec4{collider->offset, 1.0F}};
+        auto max = min;
+
+        for (std::size_t i = 0; i < collider->shape.points.size(); ++i)
+        {
+            auto point = glm::vec3{localToWorld->mat * glm::vec4{collider->shape.points[i] + collider->offset, 1.0F}};
+            min = i == 0 ? point : glm::min(min, point);
+            max = i == 0 ? point : glm::max(max, point);
+        }
+
+        // Add the collider's margin.
+        aabb->min = min - glm::vec3{collider->margin};
+        aabb->max = max + glm::vec3{collider->margin};
+    });
 }
 
-void updateMarkers(Query<Read<ColliderAABB>> query, Write<BroadPhaseCollisions> collisions)
+void updateVoxelAABBs(Query<Read<LocalToWorld>, Read<VoxelCollider>, Write<ColliderAABB>> query)
 {
-    // TODO: This is parallelizable.
-    for (glm::length_t axis = 0; axis < 3; axis++)
+    query.parEach([](Entity /*entity*/, Read<LocalToWorld> localToWorld, Read<VoxelCollider> collider,
+                     Write<ColliderAABB> aabb) {
+        // Transforms collider space to world space.
+        auto transform = localToWorld->mat * collider->transform;
+
+        // The grid spans from the origin to its size in collider space, so its AABB is the one of
+        // its 8 transformed corners.
+        auto size = glm::vec3{collider->shape.size()};
+        auto min = glm::vec3{transform[3]};
+        auto max = min;
+        for (int i = 1; i < 8; ++i)
+        {
+            auto corner = glm::vec3{(i & 1) != 0 ? size.x : 0.0F, (i & 2) != 0 ? size.y : 0.0F,
+                                    (i & 4) != 0 ? size.z : 0.0F};
+            auto point = glm::vec3{transform * glm::vec4{corner, 1.0F}};
+            min = glm::min(min, point);
+            max = glm::max(max, point);
+        }
+
+        // Add the collider's margin.
+        aabb->min = min - glm::vec3{collider->margin};
+        aabb->max = max + glm::vec3{collider->margin};
+    });
+}
+
+void updateMarkers(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>,
+                         OptRead<SimplexCollider>, OptRead<VoxelCollider>, Read<ColliderAABB>>
+                       query,
+                   Write<BroadPhaseCollisions> collisions)
+{
+    if (!collisions->sweepTracking)
+    {
+        // Another method was used since the last update, so colliders weren't being tracked.
+        for (auto [entity, box, capsule, plane, simplex, voxel, aabb] : query)
+        {
+            collisions->addEntity(entity);
+        }
+        collisions->sweepTracking = true;
+    }
+
+    // Each AABB is fetched once here, so that sorting the markers never has to go through the
+    // query.
+    for (auto& collider : collisions->sweepColliders)
     {
-        // TODO: Should use insert sort to leverage spatial coherence.
-        std::sort(
-            collisions->markersPerAxis[axis].begin(), collisions->markersPerAxis[axis].end(),
-            [axis, &query](const BroadPhaseCollisions::SweepMarker& a, const BroadPhaseCollisions::SweepMarker& b) {
-                auto [aAABB] = query[a.entity].value();
-                auto [bAABB] = query[b.entity].value();
-                auto aPos = a.isMin ? aAABB->min : aAABB->max;
-                auto bPos = b.isMin ? bAABB->min : bAABB->max;
-                return aPos[axis] < bPos[axis];
-            });
+        if (!collider.tracked)
+        {
+            continue;
+        }
+
+        auto components = query[collider.entity];
+        if (!components)
+        {
+            collisions->removeEntity(collider.entity);
+            continue;
+        }
+
+        auto [box, capsule, plane, simplex, voxel, aabb] = *components;
+        collider.aabb = *aabb;
+        collider.box = box;
+        collider.capsule = capsule;
+        collider.plane = plane;
+        collider.simplex = simplex;
+        collider.voxel = voxel;
     }
 }
 
-void sweep(Write<BroadPhaseCollisions> collisions)
+/// @brief Gets the key of a pair of slots on BroadPhaseCollisions::sweepPairs.
+static uint64_t pairKey(uint32_t a, uint32_t b)
 {
-    // TODO: This is parallelizable.
-    for (glm::length_t axis = 0; axis < 3; axis++)
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+/// @brief Checks if a marker must be placed before another on its axis. At equal coordinates, min
+/// markers come first, so that touching AABBs are considered to overlap.
+static bool goesBefore(float value, uint32_t marker, float otherValue, uint32_t otherMarker)
+{
+    return value < otherValue || (value == otherValue && (marker & 1) != 0 && (otherMarker & 1) == 0);
+}
+
+/// @brief Sorts the markers of an axis from scratch, and records the pairs whose overlap on the
+/// axis differs from the one stored in BroadPhaseCollisions::sweepPairs.
+static void rebuildAxis(const BroadPhaseCollisions& collisions, glm::length_t axis, SweepAxis& markers)
+{
+    std::vector<std::size_t> order(markers.values.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
     {
-        CUBOS_ASSERT(collisions->activePerAxis[axis].empty(), "Last sweep entered an entity but never exited");
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&markers](std::size_t a, std::size_t b) {
+        return goesBefore(markers.values[a], markers.markers[a], markers.values[b], markers.markers[b]);
+    });
 
-        collisions->sweepOverlapMaps[axis].clear();
+    std::vector<float> values(order.size());
+    std::vector<uint32_t> sorted(order.size());
+    for (std::size_t i = 0; i < order.size(); ++i)
+    {
+        values[i] = markers.values[order[i]];
+        sorted[i] = markers.markers[order[i]];
+    }
+    markers.values = std::move(values);
+    markers.markers = std::move(sorted);
 
-        for (auto& marker : collisions->markersPerAxis[axis])
+    // Find every pair which overlaps on the axis.
+    std::unordered_set<uint64_t> overlaps;
+    std::vector<uint32_t> active;
+    for (auto marker : markers.markers)
+    {
+        auto slot = marker >> 1;
+        if ((marker & 1) != 0)
         {
-            if (marker.isMin)
+            for (auto other : active)
             {
-                for (const auto& other : collisions->activePerAxis[axis])
-                {
-                    collisions->sweepOverlapMaps[axis][marker.entity].push_back(other);
-                }
+                overlaps.insert(pairKey(slot, other));
+            }
+            active.push_back(slot);
+        }
+        else
+        {
+            active.erase(std::find(active.begin(), active.end(), slot));
+        }
+    }
 
-                collisions->activePerAxis[axis].insert(marker.entity);
+    // Toggle the pairs whose state changed.
+    auto bit = static_cast<uint8_t>(1 << axis);
+    for (const auto& [key, mask] : collisions.sweepPairs)
+    {
+        auto a = static_cast<uint32_t>(key >> 32);
+        auto b = static_cast<uint32_t>(key);
+        if ((mask & bit) != 0 && !overlaps.contains(key) && collisions.sweepColliders[a].tracked &&
+            collisions.sweepColliders[b].tracked)
+        {
+            markers.toggled.emplace_back(a, b);
+        }
+    }
+
+    for (auto key : overlaps)
+    {
+        auto it = collisions.sweepPairs.find(key);
+        if (it == collisions.sweepPairs.end() || (it->second & bit) == 0)
+        {
+            markers.toggled.emplace_back(static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key));
+        }
+    }
+}
+
+void sweepAxis(const BroadPhaseCollisions& collisions, glm::length_t axis, SweepAxis& markers)
+{
+    auto& values = markers.values;
+    auto& slots = markers.markers;
+    markers.toggled.clear();
+
+    // Drop the markers of removed colliders. Their pairs are forgotten by findPairs.
+    if (!collisions.removedSweepSlots.empty())
+    {
+        std::size_t kept = 0;
+        for (std::size_t i = 0; i < slots.size(); ++i)
+        {
+            if (collisions.sweepColliders[slots[i] >> 1].tracked)
+            {
+                values[kept] = values[i];
+                slots[kept] = slots[i];
+                ++kept;
             }
-            else
+        }
+        values.resize(kept);
+        slots.resize(kept);
+    }
+
+    // New colliders are appended after every other marker, which means they overlap nothing, and
+    // are then moved into place by the sort, which records their overlaps.
+    std::size_t existing = slots.size();
+    for (auto slot : collisions.addedSweepSlots)
+    {
+        values.push_back(0.0F);
+        slots.push_back((slot << 1) | 1);
+        values.push_back(0.0F);
+        slots.push_back(slot << 1);
+    }
+
+    for (std::size_t i = 0; i < slots.size(); ++i)
+    {
+        const auto& aabb = collisions.sweepColliders[slots[i] >> 1].aabb;
+        values[i] = (slots[i] & 1) != 0 ? aabb.min[axis] : aabb.max[axis];
+
+        // NaNs can't be ordered, which would break the sort.
+        if (std::isnan(values[i]))
+        {
+            values[i] = INFINITY;
+        }
+    }
+
+    // Inserting many markers one at a time would take quadratic time, so it's faster to start over.
+    if ((slots.size() - existing) * 2 > existing)
+    {
+        rebuildAxis(collisions, axis, markers);
+        return;
+    }
+
+    // Colliders move little between frames, so the markers are nearly sorted already, and an
+    // insertion sort only has to do a few swaps. Each time a min marker passes a max marker, the
+    // two colliders start or stop overlapping on this axis.
+    for (std::size_t i = 1; i < slots.size(); ++i)
+    {
+        auto value = values[i];
+        auto marker = slots[i];
+
+        std::size_t j = i;
+        for (; j > 0 && goesBefore(value, marker, values[j - 1], slots[j - 1]); --j)
+        {
+            auto other = slots[j - 1];
+            if ((marker & 1) != (other & 1) && (marker >> 1) != (other >> 1))
             {
-                collisions->activePerAxis[axis].erase(marker.entity);
+                markers.toggled.emplace_back(marker >> 1, other >> 1);
             }
+
+            values[j] = values[j - 1];
+            slots[j] = other;
         }
+
+        values[j] = value;
+        slots[j] = marker;
     }
 }
 
-CollisionType getCollisionType(bool box, bool capsule, bool plane, bool simplex)
+CollisionType getCollisionType(bool box, bool capsule, bool plane, bool simplex, bool voxel)
 {
     if (box && capsule)
     {
@@ -115,6 +332,11 @@ CollisionType getCollisionType(bool box, bool capsule, bool plane, bool simplex)
         return CollisionType::BoxSimplex;
     }
 
+    if (box && voxel)
+    {
+        return CollisionType::BoxVoxel;
+    }
+
     if (box)
     {
         return CollisionType::BoxBox;
@@ -130,6 +352,11 @@ CollisionType getCollisionType(bool box, bool capsule, bool plane, bool simplex)
         return CollisionType::CapsuleSimplex;
     }
 
+    if (capsule && voxel)
+    {
+        return CollisionType::CapsuleVoxel;
+    }
+
     if (capsule)
     {
         return CollisionType::CapsuleCapsule;
@@ -140,56 +367,256 @@ CollisionType getCollisionType(bool box, bool capsule, bool plane, bool simplex)
         return CollisionType::PlaneSimplex;
     }
 
+    if (plane && voxel)
+    {
+        return CollisionType::PlaneVoxel;
+    }
+
     if (plane)
     {
         return CollisionType::PlanePlane;
     }
 
-    return CollisionType::SimplexSimplex;
+    if (simplex && voxel)
+    {
+        return CollisionType::SimplexVoxel;
+    }
+
+    if (simplex)
+    {
+        return CollisionType::SimplexSimplex;
+    }
+
+    return CollisionType::VoxelVoxel;
+}
+
+void findPairs(Write<BroadPhaseCollisions> collisions, Read<SweepMarkers<0>> xMarkers,
+               Read<SweepMarkers<1>> yMarkers, Read<SweepMarkers<2>> zMarkers)
+{
+    // The lower 3 bits of each mask hold the axes the pair overlaps on. While the toggles of this
+    // update are applied, the next bits mark the pair as touched and hold whether it overlapped on
+    // every axis before.
+    constexpr uint8_t AllAxes = 0b111;
+    constexpr uint8_t Touched = 0b1000;
+    constexpr uint8_t WasOverlapping = 0b10000;
+
+    auto& colliders = collisions->sweepColliders;
+    auto& pairs = collisions->sweepPairs;
+    collisions->overlapsBegan.clear();
+    collisions->overlapsEnded.clear();
+
+    // Forget the pairs of removed colliders, which can then be reused.
+    if (!collisions->removedSweepSlots.empty())
+    {
+        for (auto it = pairs.begin(); it != pairs.end();)
+        {
+            const auto& a = colliders[static_cast<uint32_t>(it->first >> 32)];
+            const auto& b = colliders[static_cast<uint32_t>(it->first)];
+            if (a.tracked && b.tracked)
+            {
+                ++it;
+                continue;
+            }
+
+            if (it->second == AllAxes)
+            {
+                collisions->overlapsEnded.push_back({a.entity, b.entity});
+                collisions->sweepOverlaps.erase(it->first);
+            }
+            it = pairs.erase(it);
+        }
+
+        collisions->freeSweepSlots.insert(collisions->freeSweepSlots.end(), collisions->removedSweepSlots.begin(),
+                                          collisions->removedSweepSlots.end());
+        collisions->removedSweepSlots.clear();
+    }
+    collisions->addedSweepSlots.clear();
+
+    std::vector<uint64_t> touched;
+    const SweepAxis* axes[3] = {&*xMarkers, &*yMarkers, &*zMarkers};
+    for (glm::length_t axis = 0; axis < 3; axis++)
+    {
+        auto bit = static_cast<uint8_t>(1 << axis);
+        for (auto [a, b] : axes[axis]->toggled)
+        {
+            auto key = pairKey(a, b);
+            auto& mask = pairs[key];
+            if ((mask & Touched) == 0)
+            {
+                mask |= static_cast<uint8_t>(Touched | (mask == AllAxes ? WasOverlapping : 0));
+                touched.push_back(key);
+            }
+            mask ^= bit;
+        }
+    }
+
+    for (auto key : touched)
+    {
+        auto it = pairs.find(key);
+        bool overlapping = (it->second & AllAxes) == AllAxes;
+        bool wasOverlapping = (it->second & WasOverlapping) != 0;
+        Candidate candidate{colliders[static_cast<uint32_t>(key >> 32)].entity,
+                            colliders[static_cast<uint32_t>(key)].entity};
+        if (overlapping && !wasOverlapping)
+        {
+            collisions->overlapsBegan.push_back(candidate);
+            collisions->sweepOverlaps.insert(key);
+        }
+        else if (!overlapping && wasOverlapping)
+        {
+            collisions->overlapsEnded.push_back(candidate);
+            collisions->sweepOverlaps.erase(key);
+        }
+
+        if ((it->second & AllAxes) == 0)
+        {
+            pairs.erase(it);
+        }
+        else
+        {
+            it->second &= AllAxes;
+        }
+    }
+
+    collisions->clearCandidates();
+    for (auto key : collisions->sweepOverlaps)
+    {
+        const auto& a = colliders[static_cast<uint32_t>(key >> 32)];
+        const auto& b = colliders[static_cast<uint32_t>(key)];
+        auto type = getCollisionType(a.box || b.box, a.capsule || b.capsule, a.plane || b.plane, a.simplex || b.simplex,
+                                     a.voxel || b.voxel);
+        collisions->addCandidate(type, {a.entity, b.entity});
+    }
+}
+
+/// @brief Number of bits used by each axis on the keys of the spatial hash cells.
+static constexpr int CellBits = 21;
+
+/// @brief Cells further away from the origin than this are never hashed.
+static constexpr float MaxCell = static_cast<float>(1 << (CellBits - 1));
+
+/// @brief Packs the coordinates of a cell into a key. Coordinates must be less than @ref MaxCell
+/// away from the origin, so that each cell has its own key.
+static uint64_t cellKey(glm::ivec3 cell)
+{
+    constexpr uint64_t Mask = (uint64_t{1} << CellBits) - 1;
+    return ((static_cast<uint64_t>(cell.x) & Mask) << (2 * CellBits)) |
+           ((static_cast<uint64_t>(cell.y) & Mask) << CellBits) | (static_cast<uint64_t>(cell.z) & Mask);
 }
 
-void findPairs(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>, OptRead<SimplexCollider>,
-                     Read<ColliderAABB>>
+/// @brief Adds a pair of colliders as a candidate.
+static void addHashedCandidate(BroadPhaseCollisions& collisions, const BroadPhaseCollisions::HashedCollider& a,
+                               const BroadPhaseCollisions::HashedCollider& b)
+{
+    auto type = getCollisionType(a.box || b.box, a.capsule || b.capsule, a.plane || b.plane, a.simplex || b.simplex,
+                                 a.voxel || b.voxel);
+    collisions.addCandidate(type, {a.entity, b.entity});
+}
+
+void hashPairs(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>, OptRead<SimplexCollider>,
+                     OptRead<VoxelCollider>, Read<ColliderAABB>>
                    query,
                Write<BroadPhaseCollisions> collisions)
 {
+    // Colliders stop being tracked by sweep and prune, whose state would otherwise grow with
+    // every collider added while it isn't used. Their markers are removed if it's used again.
+    if (collisions->sweepTracking)
+    {
+        collisions->clearEntities();
+        collisions->sweepTracking = false;
+    }
+
     collisions->clearCandidates();
 
-    for (glm::length_t axis = 0; axis < 3; axis++)
+    auto& colliders = collisions->hashColliders;
+    auto& entries = collisions->hashEntries;
+    colliders.clear();
+    entries.clear();
+
+    // Place each collider in every cell its AABB touches. Colliders which would touch too many
+    // cells, such as planes, whose AABBs are infinite, are kept aside instead.
+    float invCellSize = 1.0F / collisions->cellSize;
+    std::vector<uint32_t> oversized;
+    for (auto [entity, box, capsule, plane, simplex, voxel, aabb] : query)
     {
-        for (auto& [entity, overlaps] : collisions->sweepOverlapMaps[axis])
+        auto index = static_cast<uint32_t>(colliders.size());
+        colliders.push_back({entity, *aabb, box, capsule, plane, simplex, voxel, false});
+
+        auto minCell = glm::floor(aabb->min * invCellSize);
+        auto maxCell = glm::floor(aabb->max * invCellSize);
+        auto extent = maxCell - minCell + 1.0F;
+        bool inRange = minCell.x >= -MaxCell && minCell.y >= -MaxCell && minCell.z >= -MaxCell &&
+                       maxCell.x < MaxCell && maxCell.y < MaxCell && maxCell.z < MaxCell;
+        if (!inRange || extent.x * extent.y * extent.z > static_cast<float>(collisions->maxCellsPerCollider))
+        {
+            colliders.back().oversized = true;
+            oversized.push_back(index);
+            continue;
+        }
+
+        auto min = glm::ivec3{minCell};
+        auto max = glm::ivec3{maxCell};
+        for (int x = min.x; x <= max.x; ++x)
         {
-            auto [box, capsule, plane, simplex, aabb] = query[entity].value();
-            for (auto& other : overlaps)
+            for (int y = min.y; y <= max.y; ++y)
             {
-                auto [otherBox, otherCapsule, otherPlane, otherSimplex, otherAabb] = query[other].value();
+                for (int z = min.z; z <= max.z; ++z)
+                {
+                    entries.push_back({cellKey({x, y, z}), index});
+                }
+            }
+        }
+    }
+
+    // Group the entries by cell. Sorting by collider too keeps the output deterministic.
+    std::sort(entries.begin(), entries.end(),
+              [](const BroadPhaseCollisions::HashEntry& a, const BroadPhaseCollisions::HashEntry& b) {
+                  return a.cell < b.cell || (a.cell == b.cell && a.collider < b.collider);
+              });
 
-                // TODO: Should this be inside the if statement?
-                auto type = getCollisionType(box || otherBox, capsule || otherCapsule, plane || otherPlane,
-                                             simplex || otherSimplex);
+    for (std::size_t begin = 0; begin < entries.size();)
+    {
+        std::size_t end = begin + 1;
+        while (end < entries.size() && entries[end].cell == entries[begin].cell)
+        {
+            ++end;
+        }
 
-                switch (axis)
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            const auto& a = colliders[entries[i].collider];
+            for (std::size_t j = i + 1; j < end; ++j)
+            {
+                const auto& b = colliders[entries[j].collider];
+                if (!a.aabb.overlaps(b.aabb))
                 {
-                case 0: // X
-                    if (aabb->overlapsY(*otherAabb) && aabb->overlapsZ(*otherAabb))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
-                case 1: // Y
-                    if (aabb->overlapsX(*otherAabb) && aabb->overlapsZ(*otherAabb))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
-                case 2: // Z
-                    if (aabb->overlapsX(*otherAabb) && aabb->overlapsY(*otherAabb))
-                    {
-                        collisions->addCandidate(type, {entity, other});
-                    }
-                    break;
+                    continue;
+                }
+
+                // Overlapping colliders may share many cells, but the pair is only reported on
+                // the cell which contains the minimum corner of their intersection.
+                auto corner = glm::ivec3{glm::floor(glm::max(a.aabb.min, b.aabb.min) * invCellSize)};
+                if (cellKey(corner) == entries[begin].cell)
+                {
+                    addHashedCandidate(*collisions, a, b);
                 }
             }
         }
+
+        begin = end;
     }
-}
\ No newline at end of file
+
+    // Oversized colliders are checked against every other collider.
+    for (auto index : oversized)
+    {
+        const auto& a = colliders[index];
+        for (uint32_t other = 0; other < static_cast<uint32_t>(colliders.size()); ++other)
+        {
+            const auto& b = colliders[other];
+            if (other != index && (!b.oversized || other > index) && a.aabb.overlaps(b.aabb))
+            {
+                addHashedCandidate(*collisions, a, b);
+            }
+        }
+    }
+}
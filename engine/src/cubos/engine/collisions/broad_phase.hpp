@@ -11,9 +11,11 @@
 #include <cubos/engine/collisions/colliders/capsule.hpp>
 #include <cubos/engine/collisions/colliders/plane.hpp>
 #include <cubos/engine/collisions/colliders/simplex.hpp>
+#include <cubos/engine/collisions/colliders/voxel.hpp>
 #include <cubos/engine/transform/plugin.hpp>
 
 using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
 using cubos::core::ecs::OptRead;
 using cubos::core::ecs::Query;
 using cubos::core::ecs::Read;
@@ -26,6 +28,16 @@ using cubos::engine::ColliderAABB;
 using cubos::engine::LocalToWorld;
 using cubos::engine::PlaneCollider;
 using cubos::engine::SimplexCollider;
+using cubos::engine::SweepAxis;
+using cubos::engine::SweepMarkers;
+using cubos::engine::VoxelCollider;
+
+/// @brief Checks if the given broad phase method is the one currently selected.
+template <BroadPhaseCollisions::Method M>
+bool usesMethod(Read<BroadPhaseCollisions> collisions)
+{
+    return collisions->method == M;
+}
 
 /// @brief Adds collision tracking to all new entities with colliders.
 template <typename C>
@@ -39,7 +51,10 @@ void trackNewEntities(Query<Read<C>, OptRead<ColliderAABB>> query, Write<BroadPh
         if (!aabb)
         {
             commands.add(entity, ColliderAABB{});
-            collisions->addEntity(entity);
+            if (collisions->sweepTracking)
+            {
+                collisions->addEntity(entity);
+            }
         }
     }
 }
@@ -48,25 +63,42 @@ void trackNewEntities(Query<Read<C>, OptRead<ColliderAABB>> query, Write<BroadPh
 void updateBoxAABBs(Query<Read<LocalToWorld>, Read<BoxCollider>, Write<ColliderAABB>> query);
 
 /// @brief Updates the AABBs of all capsule colliders.
-void updateCapsuleAABBs(Query<Read<LocalToWorld>, Read<CapsuleCollider>, Write<ColliderAABB>> query,
-                        Write<BroadPhaseCollisions> collisions);
+void updateCapsuleAABBs(Query<Read<LocalToWorld>, Read<CapsuleCollider>, Write<ColliderAABB>> query);
 
 /// @brief Updates the AABBs of all simplex colliders.
-void updateSimplexAABBs(Query<Read<LocalToWorld>, Read<SimplexCollider>, Write<ColliderAABB>> query,
-                        Write<BroadPhaseCollisions> collisions);
-
-/// @brief Updates the sweep markers of all colliders.
-void updateMarkers(Query<Read<ColliderAABB>> query, Write<BroadPhaseCollisions> collisions);
-
-/// @brief Performs a sweep of all colliders.
-void sweep(Write<BroadPhaseCollisions> collisions);
-
-/// @brief Finds all pairs of colliders which may be colliding.
-///
-/// @details
-/// TODO: This query is disgusting. We need a way to find if a component is present without reading it.
-/// Maybe something like Commands but for reads?
-void findPairs(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>, OptRead<SimplexCollider>,
-                     Read<ColliderAABB>>
+void updateSimplexAABBs(Query<Read<LocalToWorld>, Read<SimplexCollider>, Write<ColliderAABB>> query);
+
+/// @brief Updates the AABBs of all voxel colliders.
+void updateVoxelAABBs(Query<Read<LocalToWorld>, Read<VoxelCollider>, Write<ColliderAABB>> query);
+
+/// @brief Caches the AABBs of the colliders tracked by sweep and prune, and stops tracking
+/// destroyed colliders. Tracks every collider again if another method was used since the last
+/// update.
+void updateMarkers(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>,
+                         OptRead<SimplexCollider>, OptRead<VoxelCollider>, Read<ColliderAABB>>
+                       query,
+                   Write<BroadPhaseCollisions> collisions);
+
+/// @brief Inserts and removes the markers of an axis, and sorts them.
+/// @param collisions Broad phase collisions resource.
+/// @param axis Index of the axis.
+/// @param markers Markers of the axis.
+void sweepAxis(const BroadPhaseCollisions& collisions, glm::length_t axis, SweepAxis& markers);
+
+/// @brief Performs a sweep of the colliders on the axis @p Axis.
+template <glm::length_t Axis>
+void sweep(Read<BroadPhaseCollisions> collisions, Write<SweepMarkers<Axis>> markers)
+{
+    sweepAxis(*collisions, Axis, *markers);
+}
+
+/// @brief Combines the overlaps found on each axis into pairs of colliders which may be colliding.
+void findPairs(Write<BroadPhaseCollisions> collisions, Read<SweepMarkers<0>> xMarkers,
+               Read<SweepMarkers<1>> yMarkers, Read<SweepMarkers<2>> zMarkers);
+
+/// @brief Finds all pairs of colliders which may be colliding, using a spatial hash. Stops the
+/// colliders from being tracked by sweep and prune.
+void hashPairs(Query<OptRead<BoxCollider>, OptRead<CapsuleCollider>, OptRead<PlaneCollider>, OptRead<SimplexCollider>,
+                     OptRead<VoxelCollider>, Read<ColliderAABB>>
                    query,
-               Write<BroadPhaseCollisions> collisions);
\ No newline at end of file
+               Write<BroadPhaseCollisions> collisions);
@@ -1,3 +1,5 @@
+#include <algorithm>
+
 #include <cubos/core/log.hpp>
 
 #include <cubos/engine/collisions/broad_phase_collisions.hpp>
@@ -5,43 +7,74 @@
 using cubos::engine::BroadPhaseCollisions;
 
 using Candidate = BroadPhaseCollisions::Candidate;
-using CandidateHash = BroadPhaseCollisions::CandidateHash;
 using CollisionType = BroadPhaseCollisions::CollisionType;
-using SweepMarker = BroadPhaseCollisions::SweepMarker;
+using SweepCollider = BroadPhaseCollisions::SweepCollider;
 
 void BroadPhaseCollisions::addEntity(Entity entity)
 {
-    for (auto& markers : markersPerAxis)
+    if (sweepSlots.contains(entity))
+    {
+        return;
+    }
+
+    uint32_t slot;
+    if (freeSweepSlots.empty())
     {
-        markers.push_back({entity, true});
-        markers.push_back({entity, false});
+        slot = static_cast<uint32_t>(sweepColliders.size());
+        sweepColliders.emplace_back();
     }
+    else
+    {
+        slot = freeSweepSlots.back();
+        freeSweepSlots.pop_back();
+    }
+
+    sweepColliders[slot] = SweepCollider{};
+    sweepColliders[slot].entity = entity;
+    sweepColliders[slot].tracked = true;
+    sweepSlots.emplace(entity, slot);
+    addedSweepSlots.push_back(slot);
 }
 
 void BroadPhaseCollisions::removeEntity(Entity entity)
 {
-    for (auto& markers : markersPerAxis)
+    auto it = sweepSlots.find(entity);
+    if (it == sweepSlots.end())
+    {
+        return;
+    }
+
+    auto slot = it->second;
+    sweepSlots.erase(it);
+    sweepColliders[slot].tracked = false;
+
+    // If the markers of the collider weren't inserted yet, there's nothing else to clean up.
+    auto added = std::find(addedSweepSlots.begin(), addedSweepSlots.end(), slot);
+    if (added != addedSweepSlots.end())
+    {
+        addedSweepSlots.erase(added);
+        freeSweepSlots.push_back(slot);
+    }
+    else
     {
-        markers.erase(std::remove_if(markers.begin(), markers.end(),
-                                     [entity](const SweepMarker& m) { return m.entity == entity; }),
-                      markers.end());
+        removedSweepSlots.push_back(slot);
     }
 }
 
 void BroadPhaseCollisions::clearEntities()
 {
-    for (auto& markers : markersPerAxis)
+    while (!sweepSlots.empty())
     {
-        markers.clear();
+        this->removeEntity(sweepSlots.begin()->first);
     }
 }
 
 void BroadPhaseCollisions::addCandidate(CollisionType type, Candidate candidate)
 {
-    candidatesPerType[static_cast<std::size_t>(type)].insert(candidate);
+    candidatesPerType[static_cast<std::size_t>(type)].push_back(candidate);
 }
 
-const std::unordered_set<Candidate, CandidateHash>& BroadPhaseCollisions::candidates(CollisionType type) const
+const std::vector<Candidate>& BroadPhaseCollisions::candidates(CollisionType type) const
 {
     return candidatesPerType[static_cast<std::size_t>(type)];
 }
@@ -0,0 +1,1697 @@
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <vector>
+
+#include "narrow_phase.hpp"
+
+using cubos::core::ecs::Entity;
+using cubos::engine::VoxelOccupancy;
+
+using Candidate = BroadPhaseCollisions::Candidate;
+using CollisionType = BroadPhaseCollisions::CollisionType;
+using ContactPoint = CollisionEvent::ContactPoint;
+
+/// @brief Squared lengths below this are treated as zero.
+static constexpr float Epsilon = 1e-12F;
+
+/// @brief Maximum number of iterations of GJK and EPA before they give up on converging further.
+static constexpr int MaxIterations = 64;
+
+/// @brief Relative improvement below which GJK and EPA consider they have converged.
+static constexpr float Tolerance = 1e-4F;
+
+/// @brief Box collider in world space.
+struct BoxShape
+{
+    glm::vec3 center;   ///< Center of the box.
+    glm::vec3 axes[3];  ///< Normalized local axes of the box.
+    glm::vec3 halfSize; ///< Half size of the box along each axis.
+    float margin;       ///< Margin which rounds the box.
+};
+
+/// @brief Capsule collider in world space, the set of points within a radius of a segment.
+struct CapsuleShape
+{
+    glm::vec3 a;  ///< First end of the segment.
+    glm::vec3 b;  ///< Second end of the segment.
+    float radius; ///< Radius of the capsule.
+};
+
+/// @brief Plane collider in world space. Everything behind the plane is considered solid.
+struct PlaneShape
+{
+    glm::vec3 normal; ///< Normalized normal of the plane.
+    float offset;     ///< Distance of the plane to the origin along the normal.
+};
+
+/// @brief Simplex collider in world space.
+struct SimplexShape
+{
+    glm::vec3 points[4]; ///< Points of the simplex.
+    std::size_t count;   ///< Number of points of the simplex.
+    float margin;        ///< Margin which rounds the simplex.
+};
+
+/// @brief Voxel collider in world space. Each solid voxel is treated as a box.
+struct VoxelShape
+{
+    const VoxelOccupancy* occupancy; ///< Solid voxels of the collider.
+    glm::mat4 transform;             ///< Transforms grid space to world space.
+    glm::mat4 inverse;               ///< Transforms world space to grid space.
+    glm::vec3 axes[3];               ///< Normalized axes of the grid.
+    glm::vec3 scale;                 ///< Size of a voxel along each axis.
+    float margin;                    ///< Margin which rounds each voxel.
+};
+
+/// @brief Maps collider components to their world space shapes.
+template <typename C>
+struct ShapeOf;
+
+template <>
+struct ShapeOf<BoxCollider>
+{
+    using Type = BoxShape;
+};
+
+template <>
+struct ShapeOf<CapsuleCollider>
+{
+    using Type = CapsuleShape;
+};
+
+template <>
+struct ShapeOf<PlaneCollider>
+{
+    using Type = PlaneShape;
+};
+
+template <>
+struct ShapeOf<SimplexCollider>
+{
+    using Type = SimplexShape;
+};
+
+template <>
+struct ShapeOf<VoxelCollider>
+{
+    using Type = VoxelShape;
+};
+
+/// @brief Maps collision types to the collider components of each entity.
+template <CollisionType Type>
+struct CollidersOf;
+
+#define COLLIDERS_OF(TYPE, FIRST, SECOND)                                                                              \
+    template <>                                                                                                        \
+    struct CollidersOf<CollisionType::TYPE>                                                                            \
+    {                                                                                                                  \
+        using First = FIRST;                                                                                           \
+        using Second = SECOND;                                                                                         \
+    }
+
+COLLIDERS_OF(BoxBox, BoxCollider, BoxCollider);
+COLLIDERS_OF(BoxCapsule, BoxCollider, CapsuleCollider);
+COLLIDERS_OF(BoxPlane, BoxCollider, PlaneCollider);
+COLLIDERS_OF(BoxSimplex, BoxCollider, SimplexCollider);
+COLLIDERS_OF(BoxVoxel, BoxCollider, VoxelCollider);
+COLLIDERS_OF(CapsuleCapsule, CapsuleCollider, CapsuleCollider);
+COLLIDERS_OF(CapsulePlane, CapsuleCollider, PlaneCollider);
+COLLIDERS_OF(CapsuleSimplex, CapsuleCollider, SimplexCollider);
+COLLIDERS_OF(CapsuleVoxel, CapsuleCollider, VoxelCollider);
+COLLIDERS_OF(PlaneSimplex, PlaneCollider, SimplexCollider);
+COLLIDERS_OF(PlaneVoxel, PlaneCollider, VoxelCollider);
+COLLIDERS_OF(SimplexSimplex, SimplexCollider, SimplexCollider);
+COLLIDERS_OF(SimplexVoxel, SimplexCollider, VoxelCollider);
+COLLIDERS_OF(VoxelVoxel, VoxelCollider, VoxelCollider);
+
+#undef COLLIDERS_OF
+
+static glm::vec3 transformPoint(const glm::mat4& mat, const glm::vec3& point)
+{
+    return glm::vec3{mat * glm::vec4{point, 1.0F}};
+}
+
+static glm::vec3 transformVector(const glm::mat4& mat, const glm::vec3& vector)
+{
+    return glm::vec3{mat * glm::vec4{vector, 0.0F}};
+}
+
+static BoxShape worldShape(const glm::mat4& localToWorld, const BoxCollider& collider)
+{
+    auto transform = localToWorld * collider.transform;
+
+    BoxShape shape;
+    shape.center = glm::vec3{transform[3]};
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        auto axis = glm::vec3{transform[i]};
+        auto scale = glm::length(axis);
+        shape.axes[i] = axis / scale;
+        shape.halfSize[i] = collider.shape.halfSize[i] * scale;
+    }
+    shape.margin = collider.margin;
+    return shape;
+}
+
+static CapsuleShape worldShape(const glm::mat4& localToWorld, const CapsuleCollider& collider)
+{
+    auto transform = localToWorld * collider.transform;
+    auto scale = std::max({glm::length(glm::vec3{transform[0]}), glm::length(glm::vec3{transform[1]}),
+                           glm::length(glm::vec3{transform[2]})});
+
+    auto halfLength = collider.shape.length / 2.0F;
+    return {transformPoint(transform, {0.0F, -halfLength, 0.0F}), transformPoint(transform, {0.0F, halfLength, 0.0F}),
+            collider.shape.radius * scale};
+}
+
+static PlaneShape worldShape(const glm::mat4& localToWorld, const PlaneCollider& collider)
+{
+    auto normal = glm::normalize(transformVector(localToWorld, collider.shape.normal));
+    return {normal, glm::dot(normal, transformPoint(localToWorld, collider.offset))};
+}
+
+static SimplexShape worldShape(const glm::mat4& localToWorld, const SimplexCollider& collider)
+{
+    SimplexShape shape;
+    shape.count = std::min(collider.shape.points.size(), std::size_t{4});
+    for (std::size_t i = 0; i < shape.count; ++i)
+    {
+        shape.points[i] = transformPoint(localToWorld, collider.shape.points[i] + collider.offset);
+    }
+    shape.margin = collider.margin;
+    return shape;
+}
+
+static VoxelShape worldShape(const glm::mat4& localToWorld, const VoxelCollider& collider)
+{
+    VoxelShape shape;
+    shape.occupancy = &collider.shape;
+    shape.transform = localToWorld * collider.transform;
+    shape.inverse = glm::inverse(shape.transform);
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        auto axis = glm::vec3{shape.transform[i]};
+        shape.scale[i] = glm::length(axis);
+        shape.axes[i] = axis / shape.scale[i];
+    }
+    shape.margin = collider.margin;
+    return shape;
+}
+
+/// @brief Gets the world space shape of a collider of an entity.
+/// @tparam C Collider component type.
+/// @param query Collider query.
+/// @param entity Entity.
+/// @param shape Shape to fill.
+/// @return Whether the entity has a collider of the given type.
+template <typename C>
+static bool fetchShape(ColliderQuery& query, Entity entity, typename ShapeOf<C>::Type& shape)
+{
+    auto components = query[entity];
+    if (!components)
+    {
+        return false;
+    }
+
+    auto& [localToWorld, box, capsule, plane, simplex, voxel] = *components;
+    const C* collider;
+    if constexpr (std::is_same_v<C, BoxCollider>)
+    {
+        collider = box ? &*box : nullptr;
+    }
+    else if constexpr (std::is_same_v<C, CapsuleCollider>)
+    {
+        collider = capsule ? &*capsule : nullptr;
+    }
+    else if constexpr (std::is_same_v<C, PlaneCollider>)
+    {
+        collider = plane ? &*plane : nullptr;
+    }
+    else if constexpr (std::is_same_v<C, SimplexCollider>)
+    {
+        collider = simplex ? &*simplex : nullptr;
+    }
+    else
+    {
+        collider = voxel ? &*voxel : nullptr;
+    }
+
+    if (collider == nullptr)
+    {
+        return false;
+    }
+
+    // Colliders without a transform, such as planes, are placed at the origin.
+    shape = worldShape(localToWorld ? localToWorld->mat : glm::mat4{1.0F}, *collider);
+    return true;
+}
+
+// Support functions of the cores of the convex shapes, that is, without their margins or radii,
+// which are added later.
+
+static glm::vec3 support(const BoxShape& box, const glm::vec3& dir)
+{
+    auto point = box.center;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        point += box.axes[i] * (glm::dot(box.axes[i], dir) >= 0.0F ? box.halfSize[i] : -box.halfSize[i]);
+    }
+    return point;
+}
+
+static glm::vec3 support(const CapsuleShape& capsule, const glm::vec3& dir)
+{
+    return glm::dot(capsule.b - capsule.a, dir) >= 0.0F ? capsule.b : capsule.a;
+}
+
+static glm::vec3 support(const SimplexShape& simplex, const glm::vec3& dir)
+{
+    auto best = simplex.points[0];
+    for (std::size_t i = 1; i < simplex.count; ++i)
+    {
+        if (glm::dot(simplex.points[i], dir) > glm::dot(best, dir))
+        {
+            best = simplex.points[i];
+        }
+    }
+    return best;
+}
+
+static float radius(const BoxShape& box)
+{
+    return box.margin;
+}
+
+static float radius(const CapsuleShape& capsule)
+{
+    return capsule.radius;
+}
+
+static float radius(const SimplexShape& simplex)
+{
+    return simplex.margin;
+}
+
+static bool isEmpty(const BoxShape& /*box*/)
+{
+    return false;
+}
+
+static bool isEmpty(const CapsuleShape& /*capsule*/)
+{
+    return false;
+}
+
+static bool isEmpty(const SimplexShape& simplex)
+{
+    return simplex.count == 0;
+}
+
+static glm::vec3 center(const BoxShape& box)
+{
+    return box.center;
+}
+
+static glm::vec3 center(const CapsuleShape& capsule)
+{
+    return (capsule.a + capsule.b) / 2.0F;
+}
+
+static glm::vec3 center(const SimplexShape& simplex)
+{
+    glm::vec3 sum{0.0F};
+    for (std::size_t i = 0; i < simplex.count; ++i)
+    {
+        sum += simplex.points[i];
+    }
+    return sum / static_cast<float>(simplex.count);
+}
+
+/// @brief Computes the closest points between two segments.
+/// @param p1 Start of the first segment.
+/// @param q1 End of the first segment.
+/// @param p2 Start of the second segment.
+/// @param q2 End of the second segment.
+/// @param[out] c1 Closest point on the first segment.
+/// @param[out] c2 Closest point on the second segment.
+static void closestSegmentPoints(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2,
+                                 glm::vec3& c1, glm::vec3& c2)
+{
+    auto d1 = q1 - p1;
+    auto d2 = q2 - p2;
+    auto r = p1 - p2;
+    float a = glm::dot(d1, d1);
+    float e = glm::dot(d2, d2);
+    float f = glm::dot(d2, r);
+
+    float s = 0.0F;
+    float t = 0.0F;
+    if (a <= Epsilon && e > Epsilon)
+    {
+        t = std::clamp(f / e, 0.0F, 1.0F);
+    }
+    else if (a > Epsilon)
+    {
+        float c = glm::dot(d1, r);
+        if (e <= Epsilon)
+        {
+            s = std::clamp(-c / a, 0.0F, 1.0F);
+        }
+        else
+        {
+            float b = glm::dot(d1, d2);
+            float denom = a * e - b * b;
+            s = denom > Epsilon ? std::clamp((b * f - c * e) / denom, 0.0F, 1.0F) : 0.0F;
+            t = (b * s + f) / e;
+            if (t < 0.0F)
+            {
+                t = 0.0F;
+                s = std::clamp(-c / a, 0.0F, 1.0F);
+            }
+            else if (t > 1.0F)
+            {
+                t = 1.0F;
+                s = std::clamp((b - c) / a, 0.0F, 1.0F);
+            }
+        }
+    }
+
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+}
+
+/// @brief Point of the Minkowski difference of two shapes, and the points of each shape which
+/// produced it.
+struct SupportPoint
+{
+    glm::vec3 w; ///< Point of the difference.
+    glm::vec3 a; ///< Point of the first shape.
+    glm::vec3 b; ///< Point of the second shape.
+};
+
+template <typename A, typename B>
+static SupportPoint support(const A& a, const B& b, const glm::vec3& dir)
+{
+    auto pa = support(a, dir);
+    auto pb = support(b, -dir);
+    return {pa - pb, pa, pb};
+}
+
+/// @brief Simplex built by GJK, and the barycentric weights of its point closest to the origin.
+struct GjkSimplex
+{
+    SupportPoint points[4];
+    float weights[4];
+    int count;
+};
+
+/// @brief Keeps only the given points of a simplex, with the given weights.
+static void keep(GjkSimplex& simplex, std::initializer_list<int> indices, std::initializer_list<float> weights)
+{
+    SupportPoint points[4];
+    int count = 0;
+    for (auto index : indices)
+    {
+        points[count++] = simplex.points[index];
+    }
+
+    count = 0;
+    for (auto weight : weights)
+    {
+        simplex.points[count] = points[count];
+        simplex.weights[count++] = weight;
+    }
+    simplex.count = count;
+}
+
+/// @brief Reduces a triangle simplex to the feature closest to the origin.
+/// @return Point closest to the origin.
+static glm::vec3 closestOnTriangle(GjkSimplex& simplex)
+{
+    auto a = simplex.points[0].w;
+    auto b = simplex.points[1].w;
+    auto c = simplex.points[2].w;
+    auto ab = b - a;
+    auto ac = c - a;
+
+    float d1 = glm::dot(ab, -a);
+    float d2 = glm::dot(ac, -a);
+    if (d1 <= 0.0F && d2 <= 0.0F)
+    {
+        keep(simplex, {0}, {1.0F});
+        return a;
+    }
+
+    float d3 = glm::dot(ab, -b);
+    float d4 = glm::dot(ac, -b);
+    if (d3 >= 0.0F && d4 <= d3)
+    {
+        keep(simplex, {1}, {1.0F});
+        return b;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0F && d1 >= 0.0F && d3 <= 0.0F)
+    {
+        float v = d1 / (d1 - d3);
+        keep(simplex, {0, 1}, {1.0F - v, v});
+        return a + ab * v;
+    }
+
+    float d5 = glm::dot(ab, -c);
+    float d6 = glm::dot(ac, -c);
+    if (d6 >= 0.0F && d5 <= d6)
+    {
+        keep(simplex, {2}, {1.0F});
+        return c;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0F && d2 >= 0.0F && d6 <= 0.0F)
+    {
+        float w = d2 / (d2 - d6);
+        keep(simplex, {0, 2}, {1.0F - w, w});
+        return a + ac * w;
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0F && d4 - d3 >= 0.0F && d5 - d6 >= 0.0F)
+    {
+        float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        keep(simplex, {1, 2}, {1.0F - w, w});
+        return b + (c - b) * w;
+    }
+
+    float denom = 1.0F / (va + vb + vc);
+    float v = vb * denom;
+    float w = vc * denom;
+    keep(simplex, {0, 1, 2}, {1.0F - v - w, v, w});
+    return a + ab * v + ac * w;
+}
+
+/// @brief Reduces a simplex to the smallest subset which contains its point closest to the
+/// origin.
+/// @return Point closest to the origin, or zero if the simplex contains the origin.
+static glm::vec3 closestOnSimplex(GjkSimplex& simplex)
+{
+    switch (simplex.count)
+    {
+    case 1:
+        simplex.weights[0] = 1.0F;
+        return simplex.points[0].w;
+    case 2: {
+        auto a = simplex.points[0].w;
+        auto ab = simplex.points[1].w - a;
+        float t = glm::dot(-a, ab) / std::max(glm::dot(ab, ab), Epsilon);
+        if (t <= 0.0F)
+        {
+            keep(simplex, {0}, {1.0F});
+            return a;
+        }
+        if (t >= 1.0F)
+        {
+            keep(simplex, {1}, {1.0F});
+            return simplex.points[0].w;
+        }
+        keep(simplex, {0, 1}, {1.0F - t, t});
+        return a + ab * t;
+    }
+    case 3:
+        return closestOnTriangle(simplex);
+    default: {
+        // Check which faces of the tetrahedron have the origin on their outer side. A flat
+        // tetrahedron can't contain the origin, so all of its faces are checked instead.
+        static constexpr int Faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+        auto e1 = simplex.points[1].w - simplex.points[0].w;
+        auto e2 = simplex.points[2].w - simplex.points[0].w;
+        auto e3 = simplex.points[3].w - simplex.points[0].w;
+        float scale = std::max({glm::length(e1), glm::length(e2), glm::length(e3)});
+        bool flat = std::abs(glm::dot(glm::cross(e1, e2), e3)) <= Tolerance * scale * scale * scale;
+
+        GjkSimplex best{};
+        glm::vec3 bestPoint{0.0F};
+        float bestDistance = INFINITY;
+        for (const auto& face : Faces)
+        {
+            auto a = simplex.points[face[0]].w;
+            auto normal = glm::cross(simplex.points[face[1]].w - a, simplex.points[face[2]].w - a);
+            float origin = glm::dot(-a, normal);
+            float opposite = glm::dot(simplex.points[face[3]].w - a, normal);
+            if (!flat && origin * opposite >= 0.0F)
+            {
+                continue;
+            }
+
+            GjkSimplex triangle{};
+            keep(triangle = simplex, {face[0], face[1], face[2]}, {0.0F, 0.0F, 0.0F});
+            auto point = closestOnTriangle(triangle);
+            if (glm::dot(point, point) < bestDistance)
+            {
+                bestDistance = glm::dot(point, point);
+                bestPoint = point;
+                best = triangle;
+            }
+        }
+
+        if (bestDistance == INFINITY)
+        {
+            return glm::vec3{0.0F};
+        }
+
+        simplex = best;
+        return bestPoint;
+    }
+    }
+}
+
+/// @brief Result of running GJK on two shapes.
+struct GjkResult
+{
+    bool intersecting;  ///< Whether the cores of the shapes intersect.
+    glm::vec3 pointA;   ///< Point of the first shape closest to the second.
+    glm::vec3 pointB;   ///< Point of the second shape closest to the first.
+    GjkSimplex simplex; ///< Last simplex, which contains the origin if the shapes intersect.
+};
+
+/// @brief Finds the closest points between the cores of two convex shapes, using the
+/// Gilbert-Johnson-Keerthi algorithm.
+template <typename A, typename B>
+static GjkResult gjk(const A& a, const B& b)
+{
+    GjkResult result{};
+    auto dir = center(a) - center(b);
+    if (glm::dot(dir, dir) <= Epsilon)
+    {
+        dir = {1.0F, 0.0F, 0.0F};
+    }
+
+    auto& simplex = result.simplex;
+    simplex.points[0] = support(a, b, dir);
+    simplex.weights[0] = 1.0F;
+    simplex.count = 1;
+    auto v = simplex.points[0].w;
+
+    for (int i = 0; i < MaxIterations; ++i)
+    {
+        float distance = glm::dot(v, v);
+        if (distance <= Epsilon)
+        {
+            result.intersecting = true;
+            return result;
+        }
+
+        // Stop when no point of the difference is noticeably closer to the origin than v.
+        auto point = support(a, b, -v);
+        if (distance - glm::dot(v, point.w) <= distance * Tolerance)
+        {
+            break;
+        }
+
+        simplex.points[simplex.count++] = point;
+        v = closestOnSimplex(simplex);
+        if (simplex.count == 4)
+        {
+            result.intersecting = true;
+            return result;
+        }
+    }
+
+    for (int i = 0; i < simplex.count; ++i)
+    {
+        result.pointA += simplex.points[i].a * simplex.weights[i];
+        result.pointB += simplex.points[i].b * simplex.weights[i];
+    }
+    return result;
+}
+
+/// @brief Face of the polytope expanded by EPA.
+struct EpaFace
+{
+    int vertices[3];  ///< Indices of the vertices, in counter-clockwise order seen from outside.
+    glm::vec3 normal; ///< Normalized outward normal.
+    float distance;   ///< Distance of the face's plane to the origin.
+};
+
+/// @brief Maximum number of vertices of the polytope expanded by EPA.
+static constexpr int EpaMaxVertices = MaxIterations + 4;
+
+/// @brief Maximum number of faces of the polytope expanded by EPA.
+static constexpr int EpaMaxFaces = 2 * EpaMaxVertices;
+
+/// @brief Finds the penetration of two intersecting convex shape cores, using the Expanding
+/// Polytope Algorithm.
+/// @param a First shape.
+/// @param b Second shape.
+/// @param simplex Simplex containing the origin, found by GJK.
+/// @param[out] normal Normal of the penetration, from the first to the second shape.
+/// @param[out] depth Penetration depth.
+/// @param[out] pointA Deepest point of the first shape.
+/// @param[out] pointB Deepest point of the second shape.
+/// @return Whether the penetration could be found, which fails if the shapes are degenerate.
+template <typename A, typename B>
+static bool epa(const A& a, const B& b, const GjkSimplex& simplex, glm::vec3& normal, float& depth,
+                glm::vec3& pointA, glm::vec3& pointB)
+{
+    SupportPoint vertices[EpaMaxVertices];
+    int vertexCount = simplex.count;
+    std::copy(simplex.points, simplex.points + simplex.count, vertices);
+
+    // Drop the points of the simplex which are degenerate, i.e., repeated, collinear or coplanar
+    // with the previous ones.
+    int kept = 1;
+    for (int i = 1; i < vertexCount; ++i)
+    {
+        auto edge = vertices[i].w - vertices[0].w;
+        float scale = std::max(glm::dot(edge, edge), 1.0F);
+        bool degenerate;
+        if (kept == 1)
+        {
+            degenerate = glm::dot(edge, edge) <= Epsilon;
+        }
+        else if (kept == 2)
+        {
+            auto c = glm::cross(vertices[1].w - vertices[0].w, edge);
+            degenerate = glm::dot(c, c) <= Tolerance * Tolerance * scale * scale;
+        }
+        else
+        {
+            auto n = glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w);
+            degenerate = std::abs(glm::dot(n, edge)) <= Tolerance * scale * glm::length(n);
+        }
+
+        if (!degenerate)
+        {
+            vertices[kept++] = vertices[i];
+        }
+    }
+    vertexCount = kept;
+
+    // GJK may have stopped with less than a tetrahedron if the origin was on its boundary, in
+    // which case the simplex is blown up into a tetrahedron.
+    static const glm::vec3 Axes[3] = {{1.0F, 0.0F, 0.0F}, {0.0F, 1.0F, 0.0F}, {0.0F, 0.0F, 1.0F}};
+    auto tryAdd = [&](const glm::vec3& dir, auto isNew) {
+        for (float sign : {1.0F, -1.0F})
+        {
+            auto point = support(a, b, dir * sign);
+            if (isNew(point.w))
+            {
+                vertices[vertexCount++] = point;
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (int i = 0; vertexCount == 1 && i < 3; ++i)
+    {
+        tryAdd(Axes[i], [&](const glm::vec3& w) {
+            auto d = w - vertices[0].w;
+            return glm::dot(d, d) > Epsilon;
+        });
+    }
+
+    if (vertexCount == 2)
+    {
+        auto line = vertices[1].w - vertices[0].w;
+        auto isNew = [&](const glm::vec3& w) {
+            auto c = glm::cross(w - vertices[0].w, line);
+            return glm::dot(c, c) > Epsilon * glm::dot(line, line);
+        };
+        for (int i = 0; vertexCount == 2 && i < 3; ++i)
+        {
+            auto perpendicular = glm::cross(line, Axes[i]);
+            if (glm::dot(perpendicular, perpendicular) > Epsilon)
+            {
+                tryAdd(perpendicular, isNew) || tryAdd(glm::cross(line, perpendicular), isNew);
+            }
+        }
+    }
+
+    if (vertexCount == 3)
+    {
+        auto triangleNormal = glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w);
+        tryAdd(triangleNormal, [&](const glm::vec3& w) {
+            return std::abs(glm::dot(w - vertices[0].w, triangleNormal)) > Tolerance * glm::length(triangleNormal);
+        });
+    }
+
+    if (vertexCount < 4)
+    {
+        return false;
+    }
+
+    EpaFace faces[EpaMaxFaces];
+    int faceCount = 0;
+    auto addFace = [&](int i, int j, int k) {
+        auto faceNormal = glm::cross(vertices[j].w - vertices[i].w, vertices[k].w - vertices[i].w);
+        float length = glm::length(faceNormal);
+        if (length * length <= Epsilon || faceCount == EpaMaxFaces)
+        {
+            return false;
+        }
+
+        faceNormal /= length;
+        faces[faceCount++] = {{i, j, k}, faceNormal, glm::dot(faceNormal, vertices[i].w)};
+        return true;
+    };
+
+    // Wind the faces of the initial tetrahedron so that their normals point outwards.
+    static constexpr int Tetrahedron[4][4] = {{0, 1, 2, 3}, {0, 3, 1, 2}, {0, 2, 3, 1}, {1, 3, 2, 0}};
+    for (const auto& face : Tetrahedron)
+    {
+        auto faceNormal = glm::cross(vertices[face[1]].w - vertices[face[0]].w,
+                                     vertices[face[2]].w - vertices[face[0]].w);
+        bool ok = glm::dot(faceNormal, vertices[face[3]].w - vertices[face[0]].w) < 0.0F
+                      ? addFace(face[0], face[1], face[2])
+                      : addFace(face[0], face[2], face[1]);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+
+    int closest = 0;
+    for (int iteration = 0; iteration < MaxIterations; ++iteration)
+    {
+        closest = 0;
+        for (int i = 1; i < faceCount; ++i)
+        {
+            if (faces[i].distance < faces[closest].distance)
+            {
+                closest = i;
+            }
+        }
+
+        auto point = support(a, b, faces[closest].normal);
+        float distance = glm::dot(point.w, faces[closest].normal);
+        if (distance - faces[closest].distance <= Tolerance * std::max(distance, 1.0F) ||
+            vertexCount == EpaMaxVertices)
+        {
+            break;
+        }
+
+        // Remove the faces which see the new point, keeping the edges on their boundary.
+        int edges[EpaMaxFaces * 3][2];
+        int edgeCount = 0;
+        for (int i = 0; i < faceCount;)
+        {
+            const auto& face = faces[i];
+            if (glm::dot(face.normal, point.w - vertices[face.vertices[0]].w) <= 0.0F)
+            {
+                ++i;
+                continue;
+            }
+
+            for (int e = 0; e < 3; ++e)
+            {
+                int from = face.vertices[e];
+                int to = face.vertices[(e + 1) % 3];
+
+                // An edge shared with another removed face isn't on the boundary.
+                bool shared = false;
+                for (int j = 0; j < edgeCount; ++j)
+                {
+                    if (edges[j][0] == to && edges[j][1] == from)
+                    {
+                        edges[j][0] = edges[edgeCount - 1][0];
+                        edges[j][1] = edges[edgeCount - 1][1];
+                        --edgeCount;
+                        shared = true;
+                        break;
+                    }
+                }
+
+                if (!shared)
+                {
+                    edges[edgeCount][0] = from;
+                    edges[edgeCount][1] = to;
+                    ++edgeCount;
+                }
+            }
+
+            faces[i] = faces[--faceCount];
+        }
+
+        vertices[vertexCount] = point;
+        for (int i = 0; i < edgeCount; ++i)
+        {
+            addFace(edges[i][0], edges[i][1], vertexCount);
+        }
+        ++vertexCount;
+
+        if (faceCount == 0)
+        {
+            return false;
+        }
+    }
+
+    // Find the point of the closest face nearest to the origin, and map it back to each shape.
+    const auto& face = faces[closest];
+    normal = face.normal;
+    depth = face.distance;
+
+    auto v0 = vertices[face.vertices[1]].w - vertices[face.vertices[0]].w;
+    auto v1 = vertices[face.vertices[2]].w - vertices[face.vertices[0]].w;
+    auto v2 = normal * depth - vertices[face.vertices[0]].w;
+    float d00 = glm::dot(v0, v0);
+    float d01 = glm::dot(v0, v1);
+    float d11 = glm::dot(v1, v1);
+    float d20 = glm::dot(v2, v0);
+    float d21 = glm::dot(v2, v1);
+    float denom = d00 * d11 - d01 * d01;
+    float v = denom > Epsilon ? (d11 * d20 - d01 * d21) / denom : 0.0F;
+    float w = denom > Epsilon ? (d00 * d21 - d01 * d20) / denom : 0.0F;
+    float u = 1.0F - v - w;
+
+    pointA = vertices[face.vertices[0]].a * u + vertices[face.vertices[1]].a * v + vertices[face.vertices[2]].a * w;
+    pointB = vertices[face.vertices[0]].b * u + vertices[face.vertices[1]].b * v + vertices[face.vertices[2]].b * w;
+    return true;
+}
+
+/// @brief Fills a single point contact from the closest or deepest points of the cores of two
+/// rounded shapes.
+/// @param normal Normal from the first to the second shape.
+/// @param depth Penetration depth of the rounded shapes.
+/// @param pointA Point of the core of the first shape.
+/// @param radiusA Radius of the first shape.
+/// @param pointB Point of the core of the second shape.
+/// @param radiusB Radius of the second shape.
+/// @param event Event to fill.
+static void singleContact(const glm::vec3& normal, float depth, const glm::vec3& pointA, float radiusA,
+                          const glm::vec3& pointB, float radiusB, CollisionEvent& event)
+{
+    event.normal = normal;
+    event.penetration = depth;
+    event.points[0] = {((pointA + normal * radiusA) + (pointB - normal * radiusB)) / 2.0F, depth};
+    event.pointCount = 1;
+}
+
+/// @brief Checks if two rounded convex shapes collide, using GJK for the distance between their
+/// cores, and EPA when the cores themselves intersect.
+template <typename A, typename B>
+static bool collideConvex(const A& a, const B& b, CollisionEvent& event)
+{
+    if (isEmpty(a) || isEmpty(b))
+    {
+        return false;
+    }
+
+    float radiusA = radius(a);
+    float radiusB = radius(b);
+    auto result = gjk(a, b);
+    if (!result.intersecting)
+    {
+        auto difference = result.pointB - result.pointA;
+        float distance = glm::length(difference);
+        if (distance >= radiusA + radiusB)
+        {
+            return false;
+        }
+
+        singleContact(difference / distance, radiusA + radiusB - distance, result.pointA, radiusA, result.pointB,
+                      radiusB, event);
+        return true;
+    }
+
+    glm::vec3 normal;
+    glm::vec3 pointA;
+    glm::vec3 pointB;
+    float depth;
+    if (!epa(a, b, result.simplex, normal, depth, pointA, pointB))
+    {
+        // The cores are flat and touching, so only the radii overlap.
+        normal = center(b) - center(a);
+        float length = glm::length(normal);
+        normal = length * length > Epsilon ? normal / length : glm::vec3{0.0F, 1.0F, 0.0F};
+        depth = 0.0F;
+        pointA = pointB = (center(a) + center(b)) / 2.0F;
+    }
+
+    singleContact(normal, depth + radiusA + radiusB, pointA, radiusA, pointB, radiusB, event);
+    return true;
+}
+
+/// @brief Reduces a set of contact points to at most @ref CollisionEvent::MaxPoints, keeping the
+/// deepest one, and then those which are the furthest away from the ones already kept.
+/// @note Reorders the candidates, moving the kept ones to the front.
+static void reduceManifold(ContactPoint* candidates, std::size_t total, CollisionEvent& event)
+{
+    event.pointCount = 0;
+    event.penetration = 0.0F;
+    if (total == 0)
+    {
+        return;
+    }
+
+    std::size_t deepest = 0;
+    for (std::size_t i = 1; i < total; ++i)
+    {
+        if (candidates[i].penetration > candidates[deepest].penetration)
+        {
+            deepest = i;
+        }
+    }
+    std::swap(candidates[0], candidates[deepest]);
+    event.points[event.pointCount++] = candidates[0];
+    event.penetration = candidates[0].penetration;
+
+    while (event.pointCount < CollisionEvent::MaxPoints && event.pointCount < total)
+    {
+        std::size_t furthest = 0;
+        float furthestDistance = -1.0F;
+        for (std::size_t i = event.pointCount; i < total; ++i)
+        {
+            float distance = INFINITY;
+            for (std::size_t j = 0; j < event.pointCount; ++j)
+            {
+                auto d = candidates[i].position - event.points[j].position;
+                distance = std::min(distance, glm::dot(d, d));
+            }
+
+            if (distance > furthestDistance)
+            {
+                furthest = i;
+                furthestDistance = distance;
+            }
+        }
+
+        std::swap(candidates[event.pointCount], candidates[furthest]);
+        event.points[event.pointCount] = candidates[event.pointCount];
+        ++event.pointCount;
+    }
+}
+
+/// @brief Clips a polygon against the plane `dot(normal, p) <= offset`.
+/// @return Number of vertices of the clipped polygon.
+static std::size_t clipPolygon(const glm::vec3* in, std::size_t count, const glm::vec3& normal, float offset,
+                               glm::vec3* out)
+{
+    std::size_t outCount = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto& current = in[i];
+        const auto& next = in[(i + 1) % count];
+        float currentDistance = glm::dot(normal, current) - offset;
+        float nextDistance = glm::dot(normal, next) - offset;
+
+        if (currentDistance <= 0.0F)
+        {
+            out[outCount++] = current;
+        }
+
+        if ((currentDistance < 0.0F && nextDistance > 0.0F) || (currentDistance > 0.0F && nextDistance < 0.0F))
+        {
+            float t = currentDistance / (currentDistance - nextDistance);
+            out[outCount++] = current + (next - current) * t;
+        }
+    }
+    return outCount;
+}
+
+/// @brief Gets the radius of the projection of a box on an axis.
+static float projectedRadius(const BoxShape& box, const glm::vec3& axis)
+{
+    return box.halfSize.x * std::abs(glm::dot(box.axes[0], axis)) +
+           box.halfSize.y * std::abs(glm::dot(box.axes[1], axis)) +
+           box.halfSize.z * std::abs(glm::dot(box.axes[2], axis));
+}
+
+/// @brief Generates the contacts of a box face against the closest face of another box.
+/// @param reference Box which owns the face.
+/// @param axis Index of the axis of the reference box which is normal to the face.
+/// @param faceNormal Normal of the face, pointing towards the incident box.
+/// @param incident Other box.
+/// @param event Event to fill with the contacts.
+static void clipBoxFaces(const BoxShape& reference, glm::length_t axis, const glm::vec3& faceNormal,
+                         const BoxShape& incident, CollisionEvent& event)
+{
+    // Find the face of the incident box which faces the reference face the most.
+    glm::length_t incidentAxis = 0;
+    for (glm::length_t i = 1; i < 3; ++i)
+    {
+        if (std::abs(glm::dot(incident.axes[i], faceNormal)) >
+            std::abs(glm::dot(incident.axes[incidentAxis], faceNormal)))
+        {
+            incidentAxis = i;
+        }
+    }
+
+    float side = glm::dot(incident.axes[incidentAxis], faceNormal) > 0.0F ? -1.0F : 1.0F;
+    auto incidentCenter = incident.center + incident.axes[incidentAxis] * (side * incident.halfSize[incidentAxis]);
+    auto u = incident.axes[(incidentAxis + 1) % 3] * incident.halfSize[(incidentAxis + 1) % 3];
+    auto v = incident.axes[(incidentAxis + 2) % 3] * incident.halfSize[(incidentAxis + 2) % 3];
+
+    glm::vec3 polygon[8] = {incidentCenter + u + v, incidentCenter - u + v, incidentCenter - u - v,
+                            incidentCenter + u - v};
+    glm::vec3 clipped[8];
+    std::size_t count = 4;
+
+    // Clip the incident face against the side planes of the reference face.
+    for (glm::length_t i = 1; i < 3 && count > 0; ++i)
+    {
+        auto sideAxis = reference.axes[(axis + i) % 3];
+        float extent = reference.halfSize[(axis + i) % 3];
+        float offset = glm::dot(sideAxis, reference.center);
+        count = clipPolygon(polygon, count, sideAxis, offset + extent, clipped);
+        count = clipPolygon(clipped, count, -sideAxis, extent - offset, polygon);
+    }
+
+    // Keep the points which are behind the reference face, including the margins.
+    float faceOffset = glm::dot(faceNormal, reference.center) + reference.halfSize[axis];
+    ContactPoint candidates[8];
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float depth = faceOffset - glm::dot(faceNormal, polygon[i]) + reference.margin + incident.margin;
+        if (depth >= 0.0F)
+        {
+            auto onReference = polygon[i] + faceNormal * (depth - incident.margin);
+            auto onIncident = polygon[i] - faceNormal * incident.margin;
+            candidates[total++] = {(onReference + onIncident) / 2.0F, depth};
+        }
+    }
+
+    reduceManifold(candidates, total, event);
+}
+
+static bool collide(const BoxShape& a, const BoxShape& b, CollisionEvent& event)
+{
+    // Find the axis of least penetration among the face normals of both boxes and the cross
+    // products of their edges. Face axes are preferred, as they produce more stable manifolds.
+    auto offset = b.center - a.center;
+    float margins = a.margin + b.margin;
+    float bestSeparation = -INFINITY;
+    glm::vec3 bestAxis{0.0F};
+    int bestIndex = -1;
+
+    auto test = [&](glm::vec3 axis, int index) {
+        float length = glm::length(axis);
+        if (length * length <= Epsilon)
+        {
+            return true;
+        }
+        axis /= length;
+
+        float distance = glm::dot(offset, axis);
+        float separation = std::abs(distance) - projectedRadius(a, axis) - projectedRadius(b, axis) - margins;
+        if (separation > 0.0F)
+        {
+            return false;
+        }
+
+        if (bestIndex == -1 || separation > 0.95F * bestSeparation + 0.001F)
+        {
+            bestSeparation = separation;
+            bestAxis = distance < 0.0F ? -axis : axis;
+            bestIndex = index;
+        }
+        return true;
+    };
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!test(a.axes[i], i))
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        if (!test(b.axes[i], 3 + i))
+        {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+        {
+            if (!test(glm::cross(a.axes[i], b.axes[j]), 6 + i * 3 + j))
+            {
+                return false;
+            }
+        }
+    }
+
+    event.normal = bestAxis;
+    if (bestIndex < 3)
+    {
+        clipBoxFaces(a, bestIndex, bestAxis, b, event);
+    }
+    else if (bestIndex < 6)
+    {
+        clipBoxFaces(b, bestIndex - 3, -bestAxis, a, event);
+    }
+    else
+    {
+        // Find the edges of each box which are closest to the other box.
+        auto i = static_cast<glm::length_t>((bestIndex - 6) / 3);
+        auto j = static_cast<glm::length_t>((bestIndex - 6) % 3);
+        auto edgeA = a.center;
+        auto edgeB = b.center;
+        for (glm::length_t k = 0; k < 3; ++k)
+        {
+            if (k != i)
+            {
+                edgeA += a.axes[k] * (glm::dot(a.axes[k], bestAxis) > 0.0F ? a.halfSize[k] : -a.halfSize[k]);
+            }
+
+            if (k != j)
+            {
+                edgeB += b.axes[k] * (glm::dot(b.axes[k], bestAxis) < 0.0F ? b.halfSize[k] : -b.halfSize[k]);
+            }
+        }
+
+        glm::vec3 pointA;
+        glm::vec3 pointB;
+        closestSegmentPoints(edgeA - a.axes[i] * a.halfSize[i], edgeA + a.axes[i] * a.halfSize[i],
+                             edgeB - b.axes[j] * b.halfSize[j], edgeB + b.axes[j] * b.halfSize[j], pointA, pointB);
+        singleContact(bestAxis, -bestSeparation, pointA, a.margin, pointB, b.margin, event);
+    }
+
+    return event.pointCount > 0;
+}
+
+static bool collide(const CapsuleShape& a, const CapsuleShape& b, CollisionEvent& event)
+{
+    glm::vec3 pointA;
+    glm::vec3 pointB;
+    closestSegmentPoints(a.a, a.b, b.a, b.b, pointA, pointB);
+
+    auto difference = pointB - pointA;
+    float distance = glm::length(difference);
+    if (distance >= a.radius + b.radius)
+    {
+        return false;
+    }
+
+    // If the segments intersect, any direction perpendicular to them separates the capsules.
+    glm::vec3 normal;
+    if (distance * distance > Epsilon)
+    {
+        normal = difference / distance;
+    }
+    else
+    {
+        normal = glm::cross(a.b - a.a, b.b - b.a);
+        float length = glm::length(normal);
+        normal = length * length > Epsilon ? normal / length : glm::vec3{0.0F, 1.0F, 0.0F};
+    }
+
+    singleContact(normal, a.radius + b.radius - distance, pointA, a.radius, pointB, b.radius, event);
+    return true;
+}
+
+/// @brief Generates the contacts of a set of rounded points against a plane.
+/// @param plane Plane.
+/// @param points Points.
+/// @param count Number of points.
+/// @param pointRadius Radius of the points.
+/// @param planeFirst Whether the plane is the first entity of the collision.
+/// @param event Event to fill.
+/// @return Whether any point is touching the plane.
+static bool collidePlane(const PlaneShape& plane, const glm::vec3* points, std::size_t count, float pointRadius,
+                         bool planeFirst, CollisionEvent& event)
+{
+    ContactPoint candidates[8];
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        float distance = glm::dot(plane.normal, points[i]) - plane.offset;
+        float depth = pointRadius - distance;
+        if (depth >= 0.0F)
+        {
+            auto onPlane = points[i] - plane.normal * distance;
+            auto onShape = points[i] - plane.normal * pointRadius;
+            candidates[total++] = {(onPlane + onShape) / 2.0F, depth};
+        }
+    }
+
+    event.normal = planeFirst ? plane.normal : -plane.normal;
+    reduceManifold(candidates, total, event);
+    return event.pointCount > 0;
+}
+
+static bool collide(const BoxShape& a, const PlaneShape& b, CollisionEvent& event)
+{
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; ++i)
+    {
+        corners[i] = a.center + a.axes[0] * ((i & 1) != 0 ? a.halfSize.x : -a.halfSize.x) +
+                     a.axes[1] * ((i & 2) != 0 ? a.halfSize.y : -a.halfSize.y) +
+                     a.axes[2] * ((i & 4) != 0 ? a.halfSize.z : -a.halfSize.z);
+    }
+    return collidePlane(b, corners, 8, a.margin, false, event);
+}
+
+static bool collide(const CapsuleShape& a, const PlaneShape& b, CollisionEvent& event)
+{
+    glm::vec3 ends[2] = {a.a, a.b};
+    return collidePlane(b, ends, 2, a.radius, false, event);
+}
+
+static bool collide(const PlaneShape& a, const SimplexShape& b, CollisionEvent& event)
+{
+    return collidePlane(a, b.points, b.count, b.margin, true, event);
+}
+
+static bool collide(const BoxShape& a, const CapsuleShape& b, CollisionEvent& event)
+{
+    return collideConvex(a, b, event);
+}
+
+static bool collide(const BoxShape& a, const SimplexShape& b, CollisionEvent& event)
+{
+    return collideConvex(a, b, event);
+}
+
+static bool collide(const CapsuleShape& a, const SimplexShape& b, CollisionEvent& event)
+{
+    return collideConvex(a, b, event);
+}
+
+static bool collide(const SimplexShape& a, const SimplexShape& b, CollisionEvent& event)
+{
+    return collideConvex(a, b, event);
+}
+
+// Voxel colliders are collided voxel by voxel, with each solid voxel near the other shape treated
+// as a box. The bounds of the other shape are used to find those voxels.
+
+static void bounds(const BoxShape& box, glm::vec3& min, glm::vec3& max)
+{
+    auto extent = glm::vec3{box.margin};
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        extent += glm::abs(box.axes[i]) * box.halfSize[i];
+    }
+    min = box.center - extent;
+    max = box.center + extent;
+}
+
+static void bounds(const CapsuleShape& capsule, glm::vec3& min, glm::vec3& max)
+{
+    min = glm::min(capsule.a, capsule.b) - capsule.radius;
+    max = glm::max(capsule.a, capsule.b) + capsule.radius;
+}
+
+static void bounds(const SimplexShape& simplex, glm::vec3& min, glm::vec3& max)
+{
+    // Empty simplices never collide, so their bounds don't matter.
+    min = max = simplex.count > 0 ? simplex.points[0] : glm::vec3{0.0F};
+    for (std::size_t i = 1; i < simplex.count; ++i)
+    {
+        min = glm::min(min, simplex.points[i]);
+        max = glm::max(max, simplex.points[i]);
+    }
+    min -= simplex.margin;
+    max += simplex.margin;
+}
+
+/// @brief Gets the world space bounds of a box in the grid space of a voxel collider, including
+/// its margin.
+/// @param voxels Voxel collider.
+/// @param gridMin Minimum corner of the box in grid space.
+/// @param gridMax Maximum corner of the box in grid space.
+/// @param[out] min Minimum corner of the bounds.
+/// @param[out] max Maximum corner of the bounds.
+static void gridBounds(const VoxelShape& voxels, const glm::vec3& gridMin, const glm::vec3& gridMax, glm::vec3& min,
+                       glm::vec3& max)
+{
+    for (int i = 0; i < 8; ++i)
+    {
+        auto corner = transformPoint(voxels.transform, {(i & 1) != 0 ? gridMax.x : gridMin.x,
+                                                        (i & 2) != 0 ? gridMax.y : gridMin.y,
+                                                        (i & 4) != 0 ? gridMax.z : gridMin.z});
+        min = i == 0 ? corner : glm::min(min, corner);
+        max = i == 0 ? corner : glm::max(max, corner);
+    }
+    min -= voxels.margin;
+    max += voxels.margin;
+}
+
+static void bounds(const VoxelShape& voxels, glm::vec3& min, glm::vec3& max)
+{
+    gridBounds(voxels, glm::vec3{0.0F}, glm::vec3{voxels.occupancy->size()}, min, max);
+}
+
+/// @brief Gets the range of voxels of a voxel collider which may touch a box in world space.
+/// @param voxels Voxel collider.
+/// @param worldMin Minimum corner of the box.
+/// @param worldMax Maximum corner of the box.
+/// @param[out] min Minimum voxel coordinates.
+/// @param[out] max Maximum voxel coordinates.
+static void voxelRange(const VoxelShape& voxels, glm::vec3 worldMin, glm::vec3 worldMax, glm::ivec3& min,
+                       glm::ivec3& max)
+{
+    worldMin -= voxels.margin;
+    worldMax += voxels.margin;
+
+    glm::vec3 gridMin;
+    glm::vec3 gridMax;
+    for (int i = 0; i < 8; ++i)
+    {
+        auto corner = transformPoint(voxels.inverse, {(i & 1) != 0 ? worldMax.x : worldMin.x,
+                                                      (i & 2) != 0 ? worldMax.y : worldMin.y,
+                                                      (i & 4) != 0 ? worldMax.z : worldMin.z});
+        gridMin = i == 0 ? corner : glm::min(gridMin, corner);
+        gridMax = i == 0 ? corner : glm::max(gridMax, corner);
+    }
+
+    // Clamp before converting to integers, so that huge shapes don't overflow.
+    auto size = glm::vec3{voxels.occupancy->size()};
+    min = glm::ivec3{glm::clamp(glm::floor(gridMin), glm::vec3{0.0F}, size)};
+    max = glm::ivec3{glm::clamp(glm::floor(gridMax) + 1.0F, glm::vec3{0.0F}, size)};
+}
+
+/// @brief Gets the box of a single voxel of a voxel collider.
+static BoxShape voxelBox(const VoxelShape& voxels, const glm::ivec3& voxel)
+{
+    BoxShape box;
+    box.center = transformPoint(voxels.transform, glm::vec3{voxel} + 0.5F);
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        box.axes[i] = voxels.axes[i];
+    }
+    box.halfSize = voxels.scale / 2.0F;
+    box.margin = voxels.margin;
+    return box;
+}
+
+static bool collide(const BoxShape& a, const VoxelShape& b, CollisionEvent& event);
+
+/// @brief Calls a function for each solid voxel of a voxel collider within the bounds of another shape.
+/// @param voxels Voxel collider.
+/// @param other Other shape.
+/// @param func Function called with the coordinates of each voxel.
+template <typename S, typename F>
+static void forEachNear(const VoxelShape& voxels, const S& other, F func)
+{
+    glm::vec3 worldMin;
+    glm::vec3 worldMax;
+    glm::ivec3 min;
+    glm::ivec3 max;
+    bounds(other, worldMin, worldMax);
+    voxelRange(voxels, worldMin, worldMax, min, max);
+    voxels.occupancy->forEach(min, max, func);
+}
+
+/// @brief Calls a function for each solid voxel of a voxel collider which may touch a plane.
+///
+/// Planes have no bounds, so instead the plane is moved to grid space, where the distance of a
+/// voxel to it is linear on its coordinates. Each row of bricks along the X axis is then clipped
+/// to the voxels which reach the half-space behind the plane.
+///
+/// @param voxels Voxel collider.
+/// @param plane Plane.
+/// @param func Function called with the coordinates of each voxel.
+template <typename F>
+static void forEachNear(const VoxelShape& voxels, const PlaneShape& plane, F func)
+{
+    // The distance of the grid point p to the plane is dot(normal, p) - offset.
+    glm::vec3 normal;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        normal[i] = glm::dot(plane.normal, glm::vec3{voxels.transform[i]});
+    }
+    float offset = plane.offset - glm::dot(plane.normal, glm::vec3{voxels.transform[3]});
+
+    // A voxel touches the plane if its closest corner is within its margin of the plane. The
+    // closest corner is at the minimum along the axes where the normal is positive. Widening the
+    // margin by the size of a voxel absorbs rounding errors.
+    auto closest = glm::min(normal, glm::vec3{0.0F});
+    float margin = voxels.margin + glm::length(normal);
+    auto size = glm::ivec3{voxels.occupancy->size()};
+    for (int z = 0; z < size.z; z += 4)
+    {
+        for (int y = 0; y < size.y; y += 4)
+        {
+            // Pick the voxel of the brick row closest to the plane along the Y and Z axes.
+            float rowY = static_cast<float>(normal.y > 0.0F ? y : std::min(y + 4, size.y) - 1);
+            float rowZ = static_cast<float>(normal.z > 0.0F ? z : std::min(z + 4, size.z) - 1);
+            float reach = offset + margin - normal.y * rowY - normal.z * rowZ - closest.x - closest.y - closest.z;
+
+            // Find the range of X coordinates for which normal.x * x <= reach.
+            float minX = 0.0F;
+            float maxX = static_cast<float>(size.x);
+            if (normal.x > Epsilon)
+            {
+                maxX = std::clamp(std::floor(reach / normal.x) + 1.0F, minX, maxX);
+            }
+            else if (normal.x < -Epsilon)
+            {
+                minX = std::clamp(std::ceil(reach / normal.x), minX, maxX);
+            }
+            else if (reach < 0.0F)
+            {
+                continue;
+            }
+
+            voxels.occupancy->forEach({static_cast<int>(minX), y, z}, {static_cast<int>(maxX), y + 4, z + 4}, func);
+        }
+    }
+}
+
+/// @brief Contact points of the voxels of a collision, reused by the collisions checked on each
+/// thread so that they don't allocate.
+static thread_local std::vector<ContactPoint> voxelContacts;
+
+/// @brief Merges the contacts of many voxels into a single event.
+///
+/// The normal is the average of the normals of each voxel, weighted by their penetration, which
+/// smooths out the edges between neighbouring voxels.
+struct VoxelContacts
+{
+    std::vector<ContactPoint>& candidates; ///< Contact points of every voxel.
+    glm::vec3 normal{0.0F};                ///< Sum of the normals weighted by their penetration.
+    glm::vec3 deepestNormal{0.0F};         ///< Normal of the deepest contact.
+    float deepest = -INFINITY;             ///< Penetration of the deepest contact.
+
+    /// @brief Constructs, clearing the candidates.
+    /// @param candidates Buffer to gather the contact points in.
+    VoxelContacts(std::vector<ContactPoint>& candidates)
+        : candidates(candidates)
+    {
+        candidates.clear();
+    }
+
+    /// @brief Adds the contact of a voxel.
+    /// @param contact Contact.
+    void add(const CollisionEvent& contact)
+    {
+        normal += contact.normal * contact.penetration;
+        if (contact.penetration > deepest)
+        {
+            deepest = contact.penetration;
+            deepestNormal = contact.normal;
+        }
+        candidates.insert(candidates.end(), contact.points, contact.points + contact.pointCount);
+    }
+
+    /// @brief Fills an event with the merged contacts.
+    /// @param event Event to fill.
+    /// @return Whether any contact was added.
+    bool merge(CollisionEvent& event)
+    {
+        if (candidates.empty())
+        {
+            return false;
+        }
+
+        // Contacts which are merely touching have no weight, so fall back to the deepest normal.
+        float length = glm::length(normal);
+        event.normal = length * length > Epsilon ? normal / length : deepestNormal;
+        reduceManifold(candidates.data(), candidates.size(), event);
+        return true;
+    }
+};
+
+/// @brief Collides a shape with every solid voxel of a voxel collider near it, and merges their
+/// contacts.
+/// @param voxels Voxel collider.
+/// @param other Other shape.
+/// @param event Event to fill, with the normal pointing from the voxels to the other shape.
+/// @return Whether any voxel collides with the other shape.
+template <typename S>
+static bool collideVoxels(const VoxelShape& voxels, const S& other, CollisionEvent& event)
+{
+    VoxelContacts contacts{voxelContacts};
+    forEachNear(voxels, other, [&](const glm::ivec3& voxel) {
+        CollisionEvent contact{};
+        if (collide(voxelBox(voxels, voxel), other, contact))
+        {
+            contacts.add(contact);
+        }
+    });
+
+    return contacts.merge(event);
+}
+
+/// @brief Collides a shape with a voxel collider, with the normal pointing from the shape to the
+/// voxels.
+template <typename S>
+static bool collideWithVoxels(const S& a, const VoxelShape& b, CollisionEvent& event)
+{
+    if (!collideVoxels(b, a, event))
+    {
+        return false;
+    }
+
+    event.normal = -event.normal;
+    return true;
+}
+
+static bool collide(const BoxShape& a, const VoxelShape& b, CollisionEvent& event)
+{
+    return collideWithVoxels(a, b, event);
+}
+
+static bool collide(const CapsuleShape& a, const VoxelShape& b, CollisionEvent& event)
+{
+    return collideWithVoxels(a, b, event);
+}
+
+static bool collide(const PlaneShape& a, const VoxelShape& b, CollisionEvent& event)
+{
+    return collideWithVoxels(a, b, event);
+}
+
+static bool collide(const SimplexShape& a, const VoxelShape& b, CollisionEvent& event)
+{
+    return collideWithVoxels(a, b, event);
+}
+
+static bool collide(const VoxelShape& a, const VoxelShape& b, CollisionEvent& event)
+{
+    // Only the voxels within the overlap of the bounds of both grids may collide.
+    glm::vec3 aMin;
+    glm::vec3 aMax;
+    glm::vec3 bMin;
+    glm::vec3 bMax;
+    bounds(a, aMin, aMax);
+    bounds(b, bMin, bMax);
+    auto overlapMin = glm::max(aMin, bMin);
+    auto overlapMax = glm::min(aMax, bMax);
+    if (overlapMin.x > overlapMax.x || overlapMin.y > overlapMax.y || overlapMin.z > overlapMax.z)
+    {
+        return false;
+    }
+
+    // Bricks of the first grid are skipped unless the masks of the second have solid voxels near
+    // them. Only the pairs of voxels which survive are tested against each other.
+    glm::ivec3 min;
+    glm::ivec3 max;
+    voxelRange(a, overlapMin, overlapMax, min, max);
+    VoxelContacts contacts{voxelContacts};
+    a.occupancy->forEachBrick(min, max, [&](const glm::ivec3& brick, uint64_t mask) {
+        glm::vec3 brickMin;
+        glm::vec3 brickMax;
+        glm::ivec3 otherMin;
+        glm::ivec3 otherMax;
+        gridBounds(a, glm::vec3{brick * 4}, glm::vec3{brick * 4 + 4}, brickMin, brickMax);
+        voxelRange(b, brickMin, brickMax, otherMin, otherMax);
+        if (!b.occupancy->any(otherMin, otherMax))
+        {
+            return;
+        }
+
+        for (; mask != 0; mask &= mask - 1)
+        {
+            auto bit = std::countr_zero(mask);
+            auto voxel = brick * 4 + glm::ivec3{bit & 3, (bit >> 2) & 3, bit >> 4};
+            auto box = voxelBox(a, voxel);
+            forEachNear(b, box, [&](const glm::ivec3& otherVoxel) {
+                CollisionEvent contact{};
+                if (collide(box, voxelBox(b, otherVoxel), contact))
+                {
+                    contacts.add(contact);
+                }
+            });
+        }
+    });
+
+    return contacts.merge(event);
+}
+
+template <CollisionType Type>
+void narrowPhase(ColliderQuery query, Read<BroadPhaseCollisions> collisions, EventWriter<CollisionEvent> events)
+{
+    using First = typename CollidersOf<Type>::First;
+    using Second = typename CollidersOf<Type>::Second;
+
+    const auto& candidates = collisions->candidates(Type);
+    query.parFor(
+        candidates.size(),
+        [&](std::size_t begin, std::size_t end) {
+            std::vector<CollisionEvent> found;
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                // The entities of mixed type candidates may come in any order.
+                auto [entity, other] = candidates[i];
+                typename ShapeOf<First>::Type first;
+                typename ShapeOf<Second>::Type second;
+                if (!fetchShape<First>(query, entity, first) || !fetchShape<Second>(query, other, second))
+                {
+                    if constexpr (std::is_same_v<First, Second>)
+                    {
+                        continue;
+                    }
+                    else
+                    {
+                        std::swap(entity, other);
+                        if (!fetchShape<First>(query, entity, first) || !fetchShape<Second>(query, other, second))
+                        {
+                            continue;
+                        }
+                    }
+                }
+
+                CollisionEvent event{};
+                if (collide(first, second, event))
+                {
+                    event.entity = entity;
+                    event.other = other;
+                    event.type = Type;
+                    found.push_back(event);
+                }
+            }
+
+            if (!found.empty())
+            {
+                events.pushMany(found);
+            }
+        },
+        256);
+}
+
+template void narrowPhase<CollisionType::BoxBox>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                 EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::BoxCapsule>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                     EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::BoxPlane>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                   EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::BoxSimplex>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                     EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::BoxVoxel>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                   EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::CapsuleCapsule>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                         EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::CapsulePlane>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                       EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::CapsuleSimplex>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                         EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::CapsuleVoxel>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                       EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::PlaneSimplex>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                       EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::PlaneVoxel>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                     EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::SimplexSimplex>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                         EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::SimplexVoxel>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                       EventWriter<CollisionEvent>);
+template void narrowPhase<CollisionType::VoxelVoxel>(ColliderQuery, Read<BroadPhaseCollisions>,
+                                                     EventWriter<CollisionEvent>);
@@ -0,0 +1,44 @@
+/// @file
+/// @brief Narrow phase collision detection systems.
+
+#pragma once
+
+#include <cubos/core/ecs/event_writer.hpp>
+#include <cubos/core/ecs/query.hpp>
+
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/colliders/box.hpp>
+#include <cubos/engine/collisions/colliders/capsule.hpp>
+#include <cubos/engine/collisions/colliders/plane.hpp>
+#include <cubos/engine/collisions/colliders/simplex.hpp>
+#include <cubos/engine/collisions/colliders/voxel.hpp>
+#include <cubos/engine/collisions/collision_event.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::EventWriter;
+using cubos::core::ecs::OptRead;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+
+using cubos::engine::BoxCollider;
+using cubos::engine::BroadPhaseCollisions;
+using cubos::engine::CapsuleCollider;
+using cubos::engine::CollisionEvent;
+using cubos::engine::LocalToWorld;
+using cubos::engine::PlaneCollider;
+using cubos::engine::SimplexCollider;
+using cubos::engine::VoxelCollider;
+
+/// @brief Query used by the narrow phase to access the colliders of each candidate.
+using ColliderQuery = Query<OptRead<LocalToWorld>, OptRead<BoxCollider>, OptRead<CapsuleCollider>,
+                            OptRead<PlaneCollider>, OptRead<SimplexCollider>, OptRead<VoxelCollider>>;
+
+/// @brief Checks which of the collision candidates of the given type are actually colliding, and
+/// sends a @ref CollisionEvent with the contact manifold of each of them.
+///
+/// Each collision type is handled by its own system, with its own specialized algorithm, and the
+/// candidates are split in chunks which are processed in parallel.
+///
+/// @tparam Type Collision type.
+template <BroadPhaseCollisions::CollisionType Type>
+void narrowPhase(ColliderQuery query, Read<BroadPhaseCollisions> collisions, EventWriter<CollisionEvent> events);
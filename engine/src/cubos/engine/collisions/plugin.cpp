@@ -1,35 +1,87 @@
 #include <cubos/engine/collisions/aabb.hpp>
 #include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/collision_event.hpp>
 #include <cubos/engine/collisions/plugin.hpp>
 
 #include "broad_phase.hpp"
+#include "narrow_phase.hpp"
 
 void cubos::engine::collisionsPlugin(Cubos& cubos)
 {
     cubos.addPlugin(transformPlugin);
 
     cubos.addResource<BroadPhaseCollisions>();
+    cubos.addResource<SweepMarkers<0>>();
+    cubos.addResource<SweepMarkers<1>>();
+    cubos.addResource<SweepMarkers<2>>();
+
+    cubos.addEvent<CollisionEvent>();
 
     cubos.addComponent<ColliderAABB>();
     cubos.addComponent<BoxCollider>();
     cubos.addComponent<SimplexCollider>();
     cubos.addComponent<CapsuleCollider>();
     cubos.addComponent<PlaneCollider>();
+    cubos.addComponent<VoxelCollider>();
 
     cubos.system(trackNewEntities<BoxCollider>).tagged("cubos.collisions.aabb.missing");
     cubos.system(trackNewEntities<SimplexCollider>).tagged("cubos.collisions.aabb.missing");
     cubos.system(trackNewEntities<CapsuleCollider>).tagged("cubos.collisions.aabb.missing");
     cubos.system(trackNewEntities<PlaneCollider>).tagged("cubos.collisions.aabb.missing");
+    cubos.system(trackNewEntities<VoxelCollider>).tagged("cubos.collisions.aabb.missing");
     cubos.tag("cubos.collisions.aabb.missing").before("cubos.collisions.aabb");
 
     cubos.system(updateBoxAABBs).tagged("cubos.collisions.aabb");
     cubos.system(updateCapsuleAABBs).tagged("cubos.collisions.aabb");
     cubos.system(updateSimplexAABBs).tagged("cubos.collisions.aabb");
+    cubos.system(updateVoxelAABBs).tagged("cubos.collisions.aabb");
     cubos.tag("cubos.collisions.aabb").after("cubos.transform.update");
 
-    cubos.system(updateMarkers).tagged("cubos.collisions.broad.markers").after("cubos.collisions.aabb");
-    cubos.system(sweep).tagged("cubos.collisions.broad.sweep").after("cubos.collisions.broad.markers");
-    cubos.system(findPairs).tagged("cubos.collisions.broad").after("cubos.collisions.broad.sweep");
+    using Method = BroadPhaseCollisions::Method;
+
+    cubos.system(updateMarkers)
+        .tagged("cubos.collisions.broad.markers")
+        .after("cubos.collisions.aabb")
+        .runIf(usesMethod<Method::SweepAndPrune>);
+    cubos.system(sweep<0>)
+        .tagged("cubos.collisions.broad.sweep")
+        .after("cubos.collisions.broad.markers")
+        .runIf(usesMethod<Method::SweepAndPrune>);
+    cubos.system(sweep<1>)
+        .tagged("cubos.collisions.broad.sweep")
+        .after("cubos.collisions.broad.markers")
+        .runIf(usesMethod<Method::SweepAndPrune>);
+    cubos.system(sweep<2>)
+        .tagged("cubos.collisions.broad.sweep")
+        .after("cubos.collisions.broad.markers")
+        .runIf(usesMethod<Method::SweepAndPrune>);
+    cubos.system(findPairs)
+        .tagged("cubos.collisions.broad")
+        .after("cubos.collisions.broad.sweep")
+        .runIf(usesMethod<Method::SweepAndPrune>);
+
+    cubos.system(hashPairs)
+        .tagged("cubos.collisions.broad")
+        .after("cubos.collisions.aabb")
+        .runIf(usesMethod<Method::SpatialHash>);
 
     cubos.tag("cubos.collisions.broad").before("cubos.collisions");
+
+    using CollisionType = BroadPhaseCollisions::CollisionType;
+
+    cubos.system(narrowPhase<CollisionType::BoxBox>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::BoxCapsule>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::BoxPlane>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::BoxSimplex>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::BoxVoxel>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::CapsuleCapsule>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::CapsulePlane>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::CapsuleSimplex>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::CapsuleVoxel>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::PlaneSimplex>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::PlaneVoxel>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::SimplexSimplex>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::SimplexVoxel>).tagged("cubos.collisions.narrow");
+    cubos.system(narrowPhase<CollisionType::VoxelVoxel>).tagged("cubos.collisions.narrow");
+    cubos.tag("cubos.collisions.narrow").after("cubos.collisions.broad").before("cubos.collisions");
 }
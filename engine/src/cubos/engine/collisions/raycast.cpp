@@ -0,0 +1,83 @@
+#include <cmath>
+
+#include <cubos/engine/collisions/raycast.hpp>
+
+using namespace cubos::engine;
+
+/// @brief Casts against every voxel collider, in the space of each collider's grid.
+/// @tparam F Function type.
+/// @param query Voxel colliders.
+/// @param origin Origin of the cast in world space.
+/// @param direction Direction of the cast in world space.
+/// @param maxDistance Maximum distance travelled.
+/// @param hit Closest hit, if any.
+/// @param castGrid Function which casts against a grid, given the occupancy, the world to grid
+/// transform, the origin and direction in grid space, the maximum distance and the hit to fill.
+/// @return Whether a voxel was hit.
+template <typename F>
+static bool castAll(VoxelColliderQuery& query, const glm::vec3& origin, glm::vec3 direction, float maxDistance,
+                    RaycastHit& hit, F castGrid)
+{
+    float length = glm::length(direction);
+    if (length == 0.0F)
+    {
+        return false;
+    }
+    direction /= length;
+
+    // The direction isn't normalized in grid space, so that distances along it are the same as in
+    // world space. The maximum distance shrinks with each hit, to skip further grids early.
+    bool found = false;
+    for (auto [entity, localToWorld, collider] : query)
+    {
+        auto inverse = glm::inverse(localToWorld->mat * collider->transform);
+        auto localOrigin = glm::vec3{inverse * glm::vec4{origin, 1.0F}};
+        auto localDirection = glm::vec3{inverse * glm::vec4{direction, 0.0F}};
+
+        VoxelHit voxelHit;
+        if (castGrid(collider->shape, inverse, localOrigin, localDirection, maxDistance, voxelHit))
+        {
+            found = true;
+            maxDistance = voxelHit.distance;
+            hit.entity = entity;
+            hit.voxel = voxelHit.voxel;
+            hit.point = origin + direction * voxelHit.distance;
+            hit.distance = voxelHit.distance;
+
+            // Normals are transformed by the inverse transpose.
+            hit.normal = voxelHit.normal;
+            if (voxelHit.normal != glm::vec3{0.0F})
+            {
+                hit.normal = glm::normalize(glm::vec3{glm::transpose(inverse) * glm::vec4{voxelHit.normal, 0.0F}});
+            }
+        }
+    }
+
+    return found;
+}
+
+bool cubos::engine::raycast(VoxelColliderQuery& query, const glm::vec3& origin, const glm::vec3& direction,
+                            float maxDistance, RaycastHit& hit)
+{
+    return castAll(query, origin, direction, maxDistance, hit,
+                   [](const VoxelOccupancy& occupancy, const glm::mat4& /*inverse*/, const glm::vec3& localOrigin,
+                      const glm::vec3& localDirection, float distance, VoxelHit& voxelHit) {
+                       return occupancy.raycast(localOrigin, localDirection, distance, voxelHit);
+                   });
+}
+
+bool cubos::engine::boxcast(VoxelColliderQuery& query, const glm::vec3& halfSize, const glm::vec3& origin,
+                            const glm::vec3& direction, float maxDistance, RaycastHit& hit)
+{
+    return castAll(query, origin, direction, maxDistance, hit,
+                   [&](const VoxelOccupancy& occupancy, const glm::mat4& inverse, const glm::vec3& localOrigin,
+                       const glm::vec3& localDirection, float distance, VoxelHit& voxelHit) {
+                       // Find the half size of the box aligned with the grid which contains the world box.
+                       glm::vec3 localHalfSize{0.0F};
+                       for (glm::length_t i = 0; i < 3; ++i)
+                       {
+                           localHalfSize += glm::abs(glm::vec3{inverse[i]}) * halfSize[i];
+                       }
+                       return occupancy.boxcast(localHalfSize, localOrigin, localDirection, distance, voxelHit);
+                   });
+}
@@ -1,7 +1,12 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
 #include <utility>
 
 #include <cubos/core/ecs/commands.hpp>
 #include <cubos/core/log.hpp>
+#include <cubos/core/profiler.hpp>
 
 #include <cubos/engine/cubos.hpp>
 
@@ -12,6 +17,59 @@ DeltaTime::DeltaTime(float value)
 {
 }
 
+FixedDeltaTime::FixedDeltaTime(float value, int maxSteps)
+    : value(value)
+    , maxSteps(maxSteps)
+{
+    if (!(value > 0.0F))
+    {
+        CUBOS_CRITICAL("Fixed delta time must be positive, got {}", value);
+        abort();
+    }
+}
+
+int FixedDeltaTime::take(float& accumulator) const
+{
+    // Also catches steps which were set to zero, negative or NaN values after construction, which
+    // would otherwise run every step allowed and make the accumulator NaN.
+    if (!(value > 0.0F))
+    {
+        accumulator = 0.0F;
+        return 0;
+    }
+
+    int steps = 0;
+    while (steps < maxSteps && accumulator >= value)
+    {
+        accumulator -= value;
+        steps += 1;
+    }
+
+    // If the simulation can't keep up, drop the time left behind instead of trying to catch up
+    // on the following frames, which would only make them slower.
+    if (accumulator >= value)
+    {
+        accumulator = std::fmod(accumulator, value);
+    }
+
+    return steps;
+}
+
+float FixedDeltaTime::alpha(float accumulator) const
+{
+    return value > 0.0F ? accumulator / value : 0.0F;
+}
+
+FixedInterpolation::FixedInterpolation(float alpha)
+    : alpha(alpha)
+{
+}
+
+MaxFrameRate::MaxFrameRate(float value)
+    : value(value)
+{
+}
+
 ShouldQuit::ShouldQuit(bool value)
     : value(value)
 {
@@ -42,6 +100,12 @@ TagBuilder& TagBuilder::after(const std::string& tag)
     return *this;
 }
 
+TagBuilder& TagBuilder::onMainThread()
+{
+    mDispatcher.tagSetMainThread();
+    return *this;
+}
+
 SystemBuilder::SystemBuilder(core::ecs::Dispatcher& dispatcher, std::vector<std::string>& tags)
     : mDispatcher(dispatcher)
     , mTags(tags)
@@ -81,6 +145,18 @@ SystemBuilder& SystemBuilder::after(const std::string& tag)
     return *this;
 }
 
+SystemBuilder& SystemBuilder::onMainThread()
+{
+    mDispatcher.systemSetMainThread();
+    return *this;
+}
+
+SystemBuilder& SystemBuilder::named(const std::string& name)
+{
+    mDispatcher.systemSetName(name);
+    return *this;
+}
+
 Cubos& Cubos::addPlugin(void (*func)(Cubos&))
 {
     if (!mPlugins.contains(func))
@@ -111,18 +187,30 @@ TagBuilder Cubos::startupTag(const std::string& tag)
     return builder;
 }
 
+TagBuilder Cubos::fixedTag(const std::string& tag)
+{
+    mFixedDispatcher.addTag(tag);
+    TagBuilder builder(mFixedDispatcher, mFixedTags);
+
+    return builder;
+}
+
 Cubos::Cubos()
     : Cubos(1, nullptr)
 {
 }
 
 Cubos::Cubos(int argc, char** argv)
+    : mThreadPool(std::max(2U, std::thread::hardware_concurrency()) - 1) // Leave a core for the main thread.
 {
     std::vector<std::string> arguments(argv + 1, argv + argc);
 
     core::initializeLogger();
 
     this->addResource<DeltaTime>(0.0F);
+    this->addResource<FixedDeltaTime>(1.0F / 60.0F, 5);
+    this->addResource<FixedInterpolation>(0.0F);
+    this->addResource<MaxFrameRate>(MaxFrameRate::Default);
     this->addResource<ShouldQuit>(true);
     this->addResource<Arguments>(arguments);
 }
@@ -131,11 +219,17 @@ void Cubos::run()
 {
     mPlugins.clear();
     mMainTags.clear();
+    mFixedTags.clear();
     mStartupTags.clear();
 
     // Compile execution chain
     mStartupDispatcher.compileChain();
+    mFixedDispatcher.compileChain();
     mMainDispatcher.compileChain();
+    mStartupDispatcher.setThreadPool(&mThreadPool);
+    mFixedDispatcher.setThreadPool(&mThreadPool);
+    mMainDispatcher.setThreadPool(&mThreadPool);
+    mWorld.setThreadPool(&mThreadPool);
 
     cubos::core::ecs::CommandBuffer cmds(mWorld);
 
@@ -143,11 +237,41 @@ void Cubos::run()
 
     auto currentTime = std::chrono::steady_clock::now();
     auto previousTime = std::chrono::steady_clock::now();
+    float accumulator = 0.0F;
     do
     {
-        mMainDispatcher.callSystems(mWorld, cmds);
+        // Run as many fixed steps as the time elapsed since the last one covers. The resource is
+        // copied, as fixed systems may change it.
+        auto fixed = mWorld.read<FixedDeltaTime>().get();
+        accumulator += mWorld.read<DeltaTime>().get().value;
+        for (int i = fixed.take(accumulator); i > 0; --i)
+        {
+            CUBOS_PROFILE_SCOPE("Fixed update");
+            mFixedDispatcher.callSystems(mWorld, cmds);
+        }
+
+        mWorld.write<FixedInterpolation>().get().alpha = fixed.alpha(accumulator);
+        {
+            CUBOS_PROFILE_SCOPE("Update");
+            mMainDispatcher.callSystems(mWorld, cmds);
+        }
+
+        // Discard the events sent during the previous frame.
+        for (auto* update : mEventUpdaters)
+        {
+            update(mWorld);
+        }
+
+        // Sleep for the rest of the frame, if the frame rate is limited.
+        if (float maxFrameRate = mWorld.read<MaxFrameRate>().get().value; maxFrameRate > 0.0F)
+        {
+            std::this_thread::sleep_until(previousTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                             std::chrono::duration<float>(1.0F / maxFrameRate)));
+        }
+
         currentTime = std::chrono::steady_clock::now();
         mWorld.write<DeltaTime>().get().value = std::chrono::duration<float>(currentTime - previousTime).count();
         previousTime = currentTime;
+        core::Profiler::endFrame();
     } while (!mWorld.read<ShouldQuit>().get().value);
 }
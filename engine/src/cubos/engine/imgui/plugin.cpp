@@ -39,10 +39,10 @@ void cubos::engine::imguiPlugin(Cubos& cubos)
 {
     cubos.addPlugin(windowPlugin);
 
-    cubos.startupTag("cubos.imgui.init").after("cubos.window.init");
-    cubos.tag("cubos.imgui.begin").after("cubos.window.poll");
-    cubos.tag("cubos.imgui.end").before("cubos.window.render").after("cubos.imgui.begin");
-    cubos.tag("cubos.imgui").after("cubos.imgui.begin").before("cubos.imgui.end");
+    cubos.startupTag("cubos.imgui.init").after("cubos.window.init").onMainThread();
+    cubos.tag("cubos.imgui.begin").after("cubos.window.poll").onMainThread();
+    cubos.tag("cubos.imgui.end").before("cubos.window.render").after("cubos.imgui.begin").onMainThread();
+    cubos.tag("cubos.imgui").after("cubos.imgui.begin").before("cubos.imgui.end").onMainThread();
 
     cubos.startupSystem(init).tagged("cubos.imgui.init");
     cubos.system(begin).tagged("cubos.imgui.begin");
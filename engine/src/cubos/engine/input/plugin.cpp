@@ -35,5 +35,5 @@ void cubos::engine::inputPlugin(Cubos& cubos)
     cubos.addResource<Input>();
 
     cubos.startupSystem(bridge).tagged("cubos.assets.bridge");
-    cubos.system(update).tagged("cubos.input.update").after("cubos.window.poll");
+    cubos.system(update).tagged("cubos.input.update").after("cubos.window.poll").onMainThread();
 }
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <bit>
 #include <random>
 
 #include <glm/gtc/matrix_transform.hpp>
@@ -8,6 +10,7 @@
 #include <cubos/core/gl/debug.hpp>
 #include <cubos/core/gl/util.hpp>
 #include <cubos/core/log.hpp>
+#include <cubos/core/profiler.hpp>
 
 #include <cubos/engine/renderer/deferred_renderer.hpp>
 #include <cubos/engine/renderer/frame.hpp>
@@ -24,14 +27,17 @@ struct DeferredGrid : public cubos::engine::impl::RendererGrid
     std::size_t indexCount;
 };
 
-/// Holds the model view matrix sent to the GPU.
-struct MVP
+/// Holds the view and projection matrices sent to the GPU.
+struct VP
 {
-    glm::mat4 m;
     glm::mat4 v;
     glm::mat4 p;
 };
 
+/// Number of instances whose model matrices are stored in each row of the instance texture. Must
+/// match the geometry pass vertex shader.
+static constexpr std::size_t InstancesPerRow = 256;
+
 // Holds the data of a spot light, ready to be sent to the lighting pass pipeline.
 struct SpotLightData
 {
@@ -79,29 +85,44 @@ struct LightsData
 static const char* geometryPassVs = R"glsl(
 #version 330 core
 
-in uvec3 position;
-in vec3 normal;
+in uint position;
+in uint face;
 in uint material;
 
 out vec3 fragPosition;
 out vec3 fragNormal;
 flat out uint fragMaterial;
 
-uniform MVP
+uniform VP
 {
-    mat4 M;
     mat4 V;
     mat4 P;
 };
 
+// Model matrices of every instance drawn this frame, with one column per texel and 256 instances
+// per row. The instances of each grid are consecutive, starting at baseInstance.
+uniform sampler2D instances;
+uniform int baseInstance;
+
+const vec3 normals[6] = vec3[6](vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0), vec3(0.0, 1.0, 0.0),
+                                vec3(0.0, -1.0, 0.0), vec3(0.0, 0.0, 1.0), vec3(0.0, 0.0, -1.0));
+
 void main()
 {
-    vec4 worldPosition = M * vec4(position, 1.0);
+    // Positions are packed with 10 bits per axis.
+    uvec3 unpacked = uvec3(position & 1023u, (position >> 10u) & 1023u, (position >> 20u) & 1023u);
+
+    int instance = baseInstance + gl_InstanceID;
+    ivec2 texel = ivec2((instance % 256) * 4, instance / 256);
+    mat4 M = mat4(texelFetch(instances, texel, 0), texelFetch(instances, texel + ivec2(1, 0), 0),
+                  texelFetch(instances, texel + ivec2(2, 0), 0), texelFetch(instances, texel + ivec2(3, 0), 0));
+
+    vec4 worldPosition = M * vec4(unpacked, 1.0);
     vec4 viewPosition = V * worldPosition;
     fragPosition = vec3(worldPosition);
 
     mat3 N = transpose(inverse(mat3(M)));
-    fragNormal = N * normal;
+    fragNormal = N * normals[face];
 
     gl_Position = P * viewPosition;
 
@@ -417,10 +438,12 @@ DeferredRenderer::DeferredRenderer(RenderDevice& renderDevice, glm::uvec2 size,
     auto geometryVS = mRenderDevice.createShaderStage(Stage::Vertex, geometryPassVs);
     auto geometryPS = mRenderDevice.createShaderStage(Stage::Pixel, geometryPassPs);
     mGeometryPipeline = mRenderDevice.createShaderPipeline(geometryVS, geometryPS);
-    mVpBp = mGeometryPipeline->getBindingPoint("MVP");
+    mVpBp = mGeometryPipeline->getBindingPoint("VP");
+    mInstancesBp = mGeometryPipeline->getBindingPoint("instances");
+    mBaseInstanceBp = mGeometryPipeline->getBindingPoint("baseInstance");
 
-    // Create the MVP constant buffer.
-    mVpBuffer = renderDevice.createConstantBuffer(sizeof(MVP), nullptr, Usage::Dynamic);
+    // Create the VP constant buffer.
+    mVpBuffer = renderDevice.createConstantBuffer(sizeof(VP), nullptr, Usage::Dynamic);
 
     // Create the lighting pipeline.
     auto lightingVS = mRenderDevice.createShaderStage(Stage::Vertex, lightingPassVs);
@@ -504,31 +527,26 @@ DeferredRenderer::~DeferredRenderer()
     core::gl::Debug::terminate();
 }
 
-cubos::engine::RendererGrid DeferredRenderer::upload(const VoxelGrid& grid)
+cubos::engine::RendererGrid DeferredRenderer::onUpload(const VoxelMesh& mesh)
 {
     auto deferredGrid = std::make_shared<DeferredGrid>();
-
-    // First, triangulate the grid.
-    // This may be improved in the future by doing it in a separate thread and only blocking on it when the grid needs
-    // to be drawn.
-    std::vector<VoxelVertex> vertices;
-    std::vector<uint32_t> indices;
-    triangulate(grid, vertices, indices);
+    const auto& vertices = mesh.vertices;
+    const auto& indices = mesh.indices;
 
     // Create the vertex array, vertex buffer and index buffer.
     VertexArrayDesc vaDesc;
     vaDesc.elementCount = 3;
     vaDesc.elements[0].name = "position";
     vaDesc.elements[0].type = Type::UInt;
-    vaDesc.elements[0].size = 3;
+    vaDesc.elements[0].size = 1;
     vaDesc.elements[0].buffer.index = 0;
     vaDesc.elements[0].buffer.offset = offsetof(VoxelVertex, position);
     vaDesc.elements[0].buffer.stride = sizeof(VoxelVertex);
-    vaDesc.elements[1].name = "normal";
-    vaDesc.elements[1].type = Type::Float;
-    vaDesc.elements[1].size = 3;
+    vaDesc.elements[1].name = "face";
+    vaDesc.elements[1].type = Type::UShort;
+    vaDesc.elements[1].size = 1;
     vaDesc.elements[1].buffer.index = 0;
-    vaDesc.elements[1].buffer.offset = offsetof(VoxelVertex, normal);
+    vaDesc.elements[1].buffer.offset = offsetof(VoxelVertex, face);
     vaDesc.elements[1].buffer.stride = sizeof(VoxelVertex);
     vaDesc.elements[2].name = "material";
     vaDesc.elements[2].type = Type::UShort;
@@ -610,23 +628,22 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
                                 const RendererFrame& frame, Framebuffer target)
 {
     // Steps:
-    // 1. Prepare the MVP matrix.
+    // 1. Prepare the VP matrices.
     // 2. Fill the light buffer with the light data.
     // 3. Set the renderer state.
     // 4. Geometry pass:
     //   1. Set the geometry pass state.
     //   2. Clear the GBuffer.
-    //   3. For each draw command:
-    //     1. Update the MVP constant buffer with the model matrix.
-    //     2. Draw the geometry.
+    //   3. Upload the model matrices of every instance.
+    //   4. For each grid, draw all of its instances at once.
     // 5. Lighting pass:
     //   1. Set the lighting pass state.
     //   2. Draw the screen quad.
 
-    // 1. Prepare the MVP matrix.
-    MVP mvp;
-    mvp.v = view;
-    mvp.p = glm::perspective(glm::radians(camera.fovY), float(viewport.size.x) / float(viewport.size.y), camera.zNear,
+    // 1. Prepare the VP matrices.
+    VP vp;
+    vp.v = view;
+    vp.p = glm::perspective(glm::radians(camera.fovY), float(viewport.size.x) / float(viewport.size.y), camera.zNear,
                              camera.zFar);
 
     // 2. Fill the light buffer with the light data.
@@ -706,6 +723,8 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
     mRenderDevice.setBlendState(mGeometryBlendState);
     mRenderDevice.setDepthStencilState(mGeometryDepthStencilState);
     mRenderDevice.setShaderPipeline(mGeometryPipeline);
+    memcpy(mVpBuffer->map(), &vp, sizeof(VP));
+    mVpBuffer->unmap();
     mVpBp->bind(mVpBuffer);
 
     // 4.2. Clear the GBuffer.
@@ -714,24 +733,52 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
     mRenderDevice.clearTargetColor(2, 0.0F, 0.0F, 0.0F, 0.0F);
     mRenderDevice.clearDepth(1.0F);
 
-    // 4.3. For each draw command:
-    for (const auto& drawCmd : frame.drawCmds())
+    // 4.3. Upload the model matrices of every instance, with the instances of each grid next to each other. The
+    // texture is only recreated when it runs out of rows.
+    {
+        CUBOS_PROFILE_SCOPE("DeferredRenderer::instances");
+        auto rows = std::max((frame.instanceCount() + InstancesPerRow - 1) / InstancesPerRow, std::size_t{1});
+        mInstances.clear();
+        for (const auto& batch : frame.drawBatches())
+        {
+            mInstances.insert(mInstances.end(), batch.instances.begin(), batch.instances.end());
+        }
+        mInstances.resize(rows * InstancesPerRow);
+
+        if (mInstancesTexRows < rows)
+        {
+            mInstancesTexRows = std::bit_ceil(rows);
+            Texture2DDesc texDesc;
+            texDesc.width = InstancesPerRow * 4;
+            texDesc.height = mInstancesTexRows;
+            texDesc.format = TextureFormat::RGBA32Float;
+            texDesc.usage = Usage::Dynamic;
+            mInstancesTex = mRenderDevice.createTexture2D(texDesc);
+        }
+        mInstancesTex->update(0, 0, InstancesPerRow * 4, rows, mInstances.data());
+        mInstancesBp->bind(mInstancesTex);
+        mInstancesBp->bind(mSampler);
+    }
+
+    // 4.4. For each grid, draw all of its instances at once.
     {
-        // 4.3.1. Update the MVP constant buffer with the model matrix.
-        mvp.m = drawCmd.modelMat;
-        memcpy(mVpBuffer->map(), &mvp, sizeof(MVP));
-        mVpBuffer->unmap();
-
-        // 4.3.2. Draw the geometry.
-        auto grid = std::static_pointer_cast<DeferredGrid>(drawCmd.grid);
-        mRenderDevice.setVertexArray(grid->va);
-        mRenderDevice.setIndexBuffer(grid->ib);
-        mRenderDevice.drawTrianglesIndexed(0, grid->indexCount);
+        CUBOS_PROFILE_SCOPE("DeferredRenderer::geometryPass");
+        std::size_t baseInstance = 0;
+        for (const auto& batch : frame.drawBatches())
+        {
+            auto grid = std::static_pointer_cast<DeferredGrid>(batch.grid);
+            mBaseInstanceBp->setConstant(static_cast<int>(baseInstance));
+            mRenderDevice.setVertexArray(grid->va);
+            mRenderDevice.setIndexBuffer(grid->ib);
+            mRenderDevice.drawTrianglesIndexedInstanced(0, grid->indexCount, batch.instances.size());
+            baseInstance += batch.instances.size();
+        }
     }
 
     // 5. SSAO pass.
     if (mSsaoEnabled)
     {
+        CUBOS_PROFILE_SCOPE("DeferredRenderer::ssaoPass");
         // 5.1. Set the SSAO pass state.
         mRenderDevice.setFramebuffer(mSsaoFb);
         mRenderDevice.setRasterState(nullptr);
@@ -744,8 +791,8 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
         mSsaoNormalBp->bind(mSampler);
         mSsaoNoiseBp->bind(mSsaoNoiseTex);
         mSsaoNoiseBp->bind(mSsaoNoiseSampler);
-        mSsaoViewBp->setConstant(mvp.v);
-        mSsaoProjectionBp->setConstant(mvp.p);
+        mSsaoViewBp->setConstant(vp.v);
+        mSsaoProjectionBp->setConstant(vp.p);
         mSsaoScreenSizeBp->setConstant(glm::vec2(mSize));
 
         // Samples
@@ -792,15 +839,15 @@ void DeferredRenderer::onRender(const glm::mat4& view, const Viewport& viewport,
         glm::vec2((float)viewport.position.x / (float)mSize.x, (float)viewport.position.y / (float)mSize.y));
     mSkyGradientBottomBp->setConstant(frame.skyGradient(0));
     mSkyGradientTopBp->setConstant(frame.skyGradient(1));
-    mInvVBp->setConstant(glm::inverse(mvp.v));
-    mInvPBp->setConstant(glm::inverse(mvp.p));
+    mInvVBp->setConstant(glm::inverse(vp.v));
+    mInvPBp->setConstant(glm::inverse(vp.p));
 
     // 6.3. Draw the screen quad.
     mRenderDevice.setVertexArray(mScreenQuadVa);
     mRenderDevice.drawTriangles(0, 6);
 
     /// FIXME: This should not be on production code.
-    core::gl::Debug::flush(mvp.p * mvp.v, 1 / 60.0F);
+    core::gl::Debug::flush(vp.p * vp.v, 1 / 60.0F);
 
     // Provide custom inputs to the PPS manager.
     this->pps().provideInput(PostProcessingInput::Position, mPositionTex);
@@ -1,10 +1,38 @@
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
 #include <cubos/engine/renderer/frame.hpp>
 
 using namespace cubos::engine;
 
+/// @brief Checks whether a box is completely behind any of the planes of a frustum.
+/// @param planes Planes of the frustum, with normals pointing inwards.
+/// @param center Center of the box.
+/// @param extent Half of the size of the box on each axis.
+/// @return Whether the box is outside.
+static bool outside(const glm::vec4 (&planes)[6], const glm::vec3& center, const glm::vec3& extent)
+{
+    for (const auto& plane : planes)
+    {
+        glm::vec3 normal{plane};
+        if (glm::dot(normal, center) + glm::dot(glm::abs(normal), extent) + plane.w < 0.0F)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
 void RendererFrame::draw(RendererGrid grid, glm::mat4 modelMat)
 {
-    mDrawCmds.push_back(DrawCmd{std::move(grid), modelMat});
+    auto [it, inserted] = mBatchIndices.try_emplace(grid.get(), mDrawBatches.size());
+    if (inserted)
+    {
+        mDrawBatches.push_back(DrawBatch{std::move(grid), {}});
+    }
+    mDrawBatches[it->second].instances.push_back(modelMat);
+    mInstanceCount += 1;
 }
 
 void RendererFrame::ambient(const glm::vec3& color)
@@ -35,15 +63,87 @@ void RendererFrame::light(glm::mat4 transform, const PointLight& light)
 
 void RendererFrame::clear()
 {
-    mDrawCmds.clear();
+    mDrawBatches.clear();
+    mBatchIndices.clear();
+    mInstanceCount = 0;
     mSpotLights.clear();
     mDirectionalLights.clear();
     mPointLights.clear();
 }
 
-const std::vector<RendererFrame::DrawCmd>& RendererFrame::drawCmds() const
+void RendererFrame::cull(const RendererFrame& frame, const glm::mat4& view, const glm::mat4& projection,
+                         float viewportHeight, float lodThreshold)
+{
+    this->clear();
+    mAmbientColor = frame.mAmbientColor;
+    mSkyGradient[0] = frame.mSkyGradient[0];
+    mSkyGradient[1] = frame.mSkyGradient[1];
+    mSpotLights = frame.mSpotLights;
+    mDirectionalLights = frame.mDirectionalLights;
+    mPointLights = frame.mPointLights;
+
+    // Extract the planes of the frustum in world space from the rows of the view projection matrix.
+    auto viewProj = projection * view;
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            planes[i * 2][j] = viewProj[j][3] + viewProj[j][i];
+            planes[i * 2 + 1][j] = viewProj[j][3] - viewProj[j][i];
+        }
+    }
+
+    // Distance from the camera at which a world unit covers a single pixel on screen.
+    float pixelDistance = projection[1][1] * viewportHeight * 0.5F;
+
+    for (const auto& batch : frame.mDrawBatches)
+    {
+        auto localCenter = (batch.grid->min + batch.grid->max) * 0.5F;
+        auto localExtent = (batch.grid->max - batch.grid->min) * 0.5F;
+
+        for (const auto& transform : batch.instances)
+        {
+            // Transform the bounding box to world space, keeping it axis aligned.
+            glm::vec3 axes[3] = {glm::vec3{transform[0]}, glm::vec3{transform[1]}, glm::vec3{transform[2]}};
+            glm::vec3 center{transform * glm::vec4{localCenter, 1.0F}};
+            auto extent = glm::abs(axes[0]) * localExtent.x + glm::abs(axes[1]) * localExtent.y +
+                          glm::abs(axes[2]) * localExtent.z;
+            if (outside(planes, center, extent))
+            {
+                continue;
+            }
+
+            // Pick the coarsest version of the grid whose voxels are at most as large as the threshold on
+            // screen. The grid itself is drawn if even its voxels are larger than that.
+            auto grid = batch.grid;
+            auto model = transform;
+            float distance = -glm::vec3{view * glm::vec4{center, 1.0F}}.z - glm::length(extent);
+            if (distance > 0.0F)
+            {
+                auto voxelSize = std::max({glm::length(axes[0]), glm::length(axes[1]), glm::length(axes[2])});
+                auto pixels = voxelSize * pixelDistance / distance;
+                while (grid->lod != nullptr && pixels * 2.0F <= lodThreshold)
+                {
+                    grid = grid->lod;
+                    model = glm::scale(model, glm::vec3{2.0F});
+                    pixels *= 2.0F;
+                }
+            }
+
+            this->draw(grid, model);
+        }
+    }
+}
+
+const std::vector<RendererFrame::DrawBatch>& RendererFrame::drawBatches() const
+{
+    return mDrawBatches;
+}
+
+std::size_t RendererFrame::instanceCount() const
 {
-    return mDrawCmds;
+    return mInstanceCount;
 }
 
 const glm::vec3& RendererFrame::ambient() const
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include <cubos/engine/renderer/mesher.hpp>
+
+using namespace cubos::engine;
+
+/// @brief Builds a coarser copy of a region of a grid, where each voxel covers `2^lod` voxels of
+/// the grid on each axis, and takes the most common material among the non-empty ones.
+///
+/// The copy has an extra voxel on each side of the region, so that the faces of the region can
+/// still be culled against its neighbours.
+///
+/// @param grid Grid to copy from.
+/// @param min Coordinates of the first voxel of the region.
+/// @param size Size of the region.
+/// @param lod Level of detail.
+/// @return Coarse grid.
+static VoxelGrid downsample(const VoxelGrid& grid, const glm::ivec3& min, const glm::uvec3& size, int lod)
+{
+    int factor = 1 << lod;
+    auto coarseSize = (glm::ivec3{size} + (factor - 1)) / factor + 2;
+    auto from = glm::max(min - factor, glm::ivec3{0});
+    auto to = glm::min(min + (coarseSize - 1) * factor, glm::ivec3{grid.size()});
+    VoxelGrid coarse{glm::uvec3{coarseSize}};
+
+    // Count the materials of each coarse voxel, from the grid voxels it covers.
+    std::vector<std::vector<std::pair<uint16_t, int>>> counts(static_cast<std::size_t>(coarseSize.x) *
+                                                              static_cast<std::size_t>(coarseSize.y) *
+                                                              static_cast<std::size_t>(coarseSize.z));
+    glm::ivec3 position;
+    for (position.z = from.z; position.z < to.z; ++position.z)
+    {
+        for (position.y = from.y; position.y < to.y; ++position.y)
+        {
+            for (position.x = from.x; position.x < to.x; ++position.x)
+            {
+                auto material = grid.get(position);
+                if (material == 0)
+                {
+                    continue;
+                }
+
+                auto cell = (position - min + factor) / factor;
+                auto& cellCounts = counts[static_cast<std::size_t>(cell.x) +
+                                          static_cast<std::size_t>(cell.y) * static_cast<std::size_t>(coarseSize.x) +
+                                          static_cast<std::size_t>(cell.z) * static_cast<std::size_t>(coarseSize.x) *
+                                              static_cast<std::size_t>(coarseSize.y)];
+                auto it = std::find_if(cellCounts.begin(), cellCounts.end(),
+                                       [&](const auto& count) { return count.first == material; });
+                if (it == cellCounts.end())
+                {
+                    cellCounts.emplace_back(material, 1);
+                }
+                else
+                {
+                    it->second += 1;
+                }
+            }
+        }
+    }
+
+    std::size_t index = 0;
+    for (position.z = 0; position.z < coarseSize.z; ++position.z)
+    {
+        for (position.y = 0; position.y < coarseSize.y; ++position.y)
+        {
+            for (position.x = 0; position.x < coarseSize.x; ++position.x, ++index)
+            {
+                auto best = std::max_element(counts[index].begin(), counts[index].end(),
+                                             [](const auto& a, const auto& b) { return a.second < b.second; });
+                if (best != counts[index].end())
+                {
+                    coarse.set(position, best->first);
+                }
+            }
+        }
+    }
+
+    coarse.compact();
+    return coarse;
+}
+
+bool MeshingJob::done() const
+{
+    return mRemaining.load(std::memory_order_acquire) == 0;
+}
+
+const std::vector<glm::ivec3>& MeshingJob::chunks() const
+{
+    return mChunks;
+}
+
+const VoxelMesh& MeshingJob::mesh(std::size_t chunk, std::size_t lod) const
+{
+    return mMeshes[chunk * GridMesher::LodCount + lod];
+}
+
+std::size_t MeshingJob::size(std::size_t chunk) const
+{
+    std::size_t size = 0;
+    for (std::size_t lod = 0; lod < GridMesher::LodCount; ++lod)
+    {
+        const auto& mesh = this->mesh(chunk, lod);
+        size += mesh.vertices.size() * sizeof(VoxelVertex) + mesh.indices.size() * sizeof(uint32_t);
+    }
+    return size;
+}
+
+void MeshingJob::cancel()
+{
+    mCancel.store(true, std::memory_order_relaxed);
+}
+
+GridMesher::GridMesher()
+    : mPool(std::make_unique<core::ThreadPool>(1))
+{
+    // Do nothing.
+}
+
+void GridMesher::setThreadCount(std::size_t count)
+{
+    // Destroying the old pool waits for its jobs to finish.
+    mPool.reset();
+    mPool = std::make_unique<core::ThreadPool>(std::max(count, std::size_t{1}));
+}
+
+std::shared_ptr<MeshingJob> GridMesher::submit(VoxelGrid grid, const glm::ivec3& origin,
+                                               std::vector<glm::ivec3> chunks)
+{
+    auto job = std::make_shared<MeshingJob>();
+    job->mChunks = std::move(chunks);
+    job->mMeshes.resize(job->mChunks.size() * LodCount);
+    job->mRemaining.store(job->mChunks.size(), std::memory_order_release);
+
+    // The grid is shared by the tasks of the job, each of which writes only to its own mesh.
+    auto shared = std::make_shared<const VoxelGrid>(std::move(grid));
+    for (std::size_t i = 0; i < job->mChunks.size(); ++i)
+    {
+        mPool->addTask([job, shared, origin, i]() {
+            if (!job->mCancel.load(std::memory_order_relaxed))
+            {
+                auto min = job->mChunks[i] - origin;
+                auto size = glm::uvec3{glm::min(glm::ivec3{ChunkSize}, glm::ivec3{shared->size()} - min)};
+                for (int lod = 0; lod < LodCount; ++lod)
+                {
+                    auto& mesh = job->mMeshes[i * LodCount + static_cast<std::size_t>(lod)];
+                    if (lod == 0)
+                    {
+                        triangulate(*shared, min, size, mesh.vertices, mesh.indices);
+                    }
+                    else
+                    {
+                        auto coarse = downsample(*shared, min, size, lod);
+                        triangulate(coarse, {1, 1, 1}, coarse.size() - 2U, mesh.vertices, mesh.indices);
+                    }
+                }
+            }
+            job->mRemaining.fetch_sub(1, std::memory_order_acq_rel);
+        });
+    }
+
+    return job;
+}
+
+void GridMesher::wait()
+{
+    mPool->wait();
+}
@@ -1,9 +1,12 @@
+#include <algorithm>
+
 #include <cubos/core/ecs/query.hpp>
 
 #include <cubos/engine/renderer/deferred_renderer.hpp>
 #include <cubos/engine/renderer/directional_light.hpp>
 #include <cubos/engine/renderer/environment.hpp>
 #include <cubos/engine/renderer/frame.hpp>
+#include <cubos/engine/renderer/mesher.hpp>
 #include <cubos/engine/renderer/plugin.hpp>
 #include <cubos/engine/renderer/point_light.hpp>
 #include <cubos/engine/renderer/pps/bloom.hpp>
@@ -22,7 +25,7 @@ using cubos::core::io::WindowEvent;
 
 using namespace cubos::engine;
 
-static void init(Write<Renderer> renderer, Read<Window> window, Write<Settings> settings)
+static void init(Write<Renderer> renderer, Read<Window> window, Write<Settings> settings, Write<GridMesher> mesher)
 {
     auto& renderDevice = (*window)->renderDevice();
     *renderer = std::make_shared<DeferredRenderer>(renderDevice, (*window)->framebufferSize(), *settings);
@@ -31,6 +34,14 @@ static void init(Write<Renderer> renderer, Read<Window> window, Write<Settings>
     {
         (*renderer)->pps().addPass<PostProcessingBloom>();
     }
+
+    auto lodThreshold = settings->getDouble("cubos.renderer.lod.threshold", 1.0);
+    (*renderer)->setLodThreshold(static_cast<float>(std::max(lodThreshold, 0.0)));
+
+    auto threads = settings->getInteger("cubos.renderer.meshing.threads", 1);
+    auto budget = settings->getInteger("cubos.renderer.meshing.budget", static_cast<int>(mesher->uploadBudget));
+    mesher->setThreadCount(static_cast<std::size_t>(std::max(threads, 1)));
+    mesher->uploadBudget = static_cast<std::size_t>(std::max(budget, 1));
 }
 
 static void resize(Write<Renderer> renderer, EventReader<WindowEvent> evs)
@@ -44,21 +55,183 @@ static void resize(Write<Renderer> renderer, EventReader<WindowEvent> evs)
     }
 }
 
-static void frameGrids(Read<Assets> assets, Write<Renderer> renderer, Write<RendererFrame> frame,
-                       Query<Write<RenderableGrid>, Read<LocalToWorld>> query)
+/// @brief Gets the number of chunks of a grid on each axis.
+/// @param size Size of the grid.
+/// @return Number of chunks.
+static glm::uvec3 chunkCount(const glm::uvec3& size)
+{
+    return (size + static_cast<unsigned>(GridMesher::ChunkSize - 1)) / static_cast<unsigned>(GridMesher::ChunkSize);
+}
+
+/// @brief Gets the coordinates of the first voxel of a chunk.
+/// @param index Index of the chunk in @ref RenderableGrid::chunks.
+/// @param count Number of chunks on each axis.
+/// @return Voxel coordinates.
+static glm::ivec3 chunkOrigin(std::size_t index, const glm::uvec3& count)
+{
+    auto x = index % count.x;
+    auto y = (index / count.x) % count.y;
+    auto z = index / (static_cast<std::size_t>(count.x) * count.y);
+    return glm::ivec3{static_cast<int>(x), static_cast<int>(y), static_cast<int>(z)} * GridMesher::ChunkSize;
+}
+
+/// @brief Gets the index of a chunk in @ref RenderableGrid::chunks.
+/// @param origin Coordinates of the first voxel of the chunk.
+/// @param count Number of chunks on each axis.
+/// @return Chunk index.
+static std::size_t chunkIndex(const glm::ivec3& origin, const glm::uvec3& count)
+{
+    auto chunk = origin / GridMesher::ChunkSize;
+    return static_cast<std::size_t>(chunk.x) + static_cast<std::size_t>(chunk.y) * count.x +
+           static_cast<std::size_t>(chunk.z) * count.x * count.y;
+}
+
+/// @brief Submits the chunks of a grid which changed since they were last submitted for meshing.
+///
+/// A job which is still triangulating the grid is stale, and so is cancelled. Its chunks are
+/// submitted again along with the ones which changed.
+///
+/// @param renderable Component of the grid.
+/// @param grid Current grid.
+/// @param mesher Mesher to submit the chunks to.
+static void remesh(RenderableGrid& renderable, const VoxelGrid& grid, GridMesher& mesher)
 {
+    auto count = chunkCount(grid.size());
+    if (grid.size() != renderable.chunkedSize)
+    {
+        // The chunks no longer match the grid, so they're all meshed again.
+        renderable.chunks.assign(static_cast<std::size_t>(count.x) * count.y * count.z, nullptr);
+        renderable.chunkedSize = grid.size();
+        renderable.revision = 0;
+    }
+
+    std::vector<bool> stale(renderable.chunks.size(), false);
+    if (renderable.meshing != nullptr)
+    {
+        renderable.meshing->cancel();
+        if (renderable.revision != 0)
+        {
+            for (const auto& origin : renderable.meshing->chunks())
+            {
+                stale[chunkIndex(origin, count)] = true;
+            }
+        }
+        renderable.meshing = nullptr;
+    }
+
+    // Chunks are meshed again if any of their voxels changed, or any of the voxels around them,
+    // which may have uncovered or hidden their faces.
+    std::vector<glm::ivec3> changed;
+    glm::ivec3 min{grid.size()};
+    glm::ivec3 max{0};
+    for (std::size_t i = 0; i < renderable.chunks.size(); ++i)
+    {
+        auto origin = chunkOrigin(i, count);
+        auto from = origin - GridMesher::ChunkMargin;
+        auto to = origin + GridMesher::ChunkSize + GridMesher::ChunkMargin;
+        if (stale[i] || grid.changedSince(from, to, renderable.revision))
+        {
+            changed.push_back(origin);
+            min = glm::min(min, from);
+            max = glm::max(max, to);
+        }
+    }
+
+    renderable.revision = grid.revision();
+    if (changed.empty())
+    {
+        return;
+    }
+
+    // Only the region around the changed chunks is copied for the mesher, unless it's the whole grid.
+    min = glm::max(min, glm::ivec3{0});
+    max = glm::min(max, glm::ivec3{grid.size()});
+    if (min == glm::ivec3{0} && max == glm::ivec3{grid.size()})
+    {
+        VoxelGrid copy;
+        copy = grid;
+        renderable.meshing = mesher.submit(std::move(copy), min, std::move(changed));
+    }
+    else
+    {
+        renderable.meshing = mesher.submit(VoxelGrid{grid, min, glm::uvec3{max - min}}, min, std::move(changed));
+    }
+}
+
+static void frameGrids(Read<Assets> assets, Write<Renderer> renderer, Write<GridMesher> mesher,
+                       Write<RendererFrame> frame, Query<Write<RenderableGrid>, Read<LocalToWorld>> query)
+{
+    // Bytes of finished meshes uploaded this frame, starting with those previous frames went over
+    // the budget by.
+    std::size_t uploaded = mesher->uploadDebt;
+
     for (auto [entity, grid, localToWorld] : query)
     {
-        if (grid->handle == nullptr || assets->update(grid->asset))
+        // Changes are looked for once the previous ones are uploaded, so that edits made while
+        // uploading are gathered into a single job, or while the job is still running, as it's
+        // then stale and is replaced.
+        bool meshing = grid->meshing != nullptr;
+        if ((!meshing && grid->chunks.empty()) || ((!meshing || !grid->meshing->done()) && assets->update(grid->asset)))
         {
-            // If the grid wasn't already uploaded, we need to upload it now.
             grid->asset = assets->load(grid->asset);
-            auto gridRead = assets->read(grid->asset);
-            grid->handle = (*renderer)->upload(gridRead.get());
+            remesh(*grid, assets->read(grid->asset).get(), *mesher);
         }
 
-        frame->draw(grid->handle, localToWorld->mat * glm::translate(glm::mat4(1.0F), grid->offset));
+        // Upload the chunks of finished jobs in order, until the budget runs out, leaving the rest
+        // for the next frames. The previous meshes of the chunks are drawn until then.
+        if (grid->meshing != nullptr && grid->meshing->done())
+        {
+            auto count = chunkCount(grid->chunkedSize);
+            auto& job = *grid->meshing;
+            for (; job.uploadedChunks < job.chunks().size(); ++job.uploadedChunks)
+            {
+                // A chunk larger than the whole budget is uploaded on a frame of its own, and the
+                // bytes it goes over by are taken from the next frames, so that it isn't stuck.
+                auto i = job.uploadedChunks;
+                auto size = job.size(i);
+                if (uploaded != 0 && uploaded + size > mesher->uploadBudget)
+                {
+                    break;
+                }
+                uploaded += size;
+
+                // Each level of detail is uploaded with a link to the next, coarser, one. An empty
+                // level cuts the chain there, as the levels after it would no longer be twice as
+                // coarse.
+                RendererGrid handle = nullptr;
+                for (auto lod = static_cast<std::size_t>(GridMesher::LodCount); lod-- > 0;)
+                {
+                    const auto& mesh = job.mesh(i, lod);
+                    if (mesh.indices.empty())
+                    {
+                        handle = nullptr;
+                        continue;
+                    }
+
+                    handle = (*renderer)->upload(mesh, handle);
+                }
+                grid->chunks[chunkIndex(job.chunks()[i], count)] = handle;
+            }
+
+            if (job.uploadedChunks == job.chunks().size())
+            {
+                grid->meshing = nullptr;
+            }
+        }
+
+        auto count = chunkCount(grid->chunkedSize);
+        auto transform = localToWorld->mat * glm::translate(glm::mat4(1.0F), grid->offset);
+        for (std::size_t i = 0; i < grid->chunks.size(); ++i)
+        {
+            if (grid->chunks[i] != nullptr)
+            {
+                auto origin = glm::vec3{chunkOrigin(i, count)};
+                frame->draw(grid->chunks[i], transform * glm::translate(glm::mat4(1.0F), origin));
+            }
+        }
     }
+
+    mesher->uploadDebt = uploaded > mesher->uploadBudget ? uploaded - mesher->uploadBudget : 0;
 }
 
 static void frameSpotLights(Write<RendererFrame> frame, Query<Read<SpotLight>, Read<LocalToWorld>> query)
@@ -177,6 +350,7 @@ void cubos::engine::rendererPlugin(Cubos& cubos)
     cubos.addResource<Renderer>();
     cubos.addResource<ActiveCameras>();
     cubos.addResource<RendererEnvironment>();
+    cubos.addResource<GridMesher>();
 
     cubos.addComponent<RenderableGrid>();
     cubos.addComponent<Camera>();
@@ -184,8 +358,9 @@ void cubos::engine::rendererPlugin(Cubos& cubos)
     cubos.addComponent<DirectionalLight>();
     cubos.addComponent<PointLight>();
 
-    cubos.startupTag("cubos.renderer.init").after("cubos.window.init");
-    cubos.tag("cubos.renderer.frame").after("cubos.transform.update");
+    cubos.startupTag("cubos.renderer.init").after("cubos.window.init").onMainThread();
+    cubos.tag("cubos.renderer.frame").after("cubos.transform.update").onMainThread();
+    cubos.tag("cubos.renderer.draw").onMainThread();
     cubos.tag("cubos.renderer.render").after("cubos.renderer.frame").before("cubos.window.render");
 
     cubos.startupSystem(init).tagged("cubos.renderer.init");
@@ -195,5 +370,5 @@ void cubos::engine::rendererPlugin(Cubos& cubos)
     cubos.system(framePointLights).tagged("cubos.renderer.frame");
     cubos.system(frameEnvironment).tagged("cubos.renderer.frame");
     cubos.system(draw).tagged("cubos.renderer.draw");
-    cubos.system(resize).after("cubos.window.poll").before("cubos.renderer.draw");
+    cubos.system(resize).after("cubos.window.poll").before("cubos.renderer.draw").onMainThread();
 }
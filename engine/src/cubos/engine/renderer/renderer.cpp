@@ -1,3 +1,8 @@
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cubos/core/profiler.hpp>
+
+#include <cubos/engine/renderer/frame.hpp>
 #include <cubos/engine/renderer/renderer.hpp>
 
 using cubos::core::gl::RenderDevice;
@@ -6,11 +11,45 @@ using cubos::engine::BaseRenderer;
 BaseRenderer::BaseRenderer(RenderDevice& renderDevice, glm::uvec2 size)
     : mRenderDevice(renderDevice)
     , mPpsManager(renderDevice, size)
+    , mCulledFrame(std::make_unique<RendererFrame>())
+    , mLodThreshold(1.0F)
     , mSize(size)
 {
     this->resizeTex(size);
 }
 
+BaseRenderer::~BaseRenderer() = default;
+
+cubos::engine::RendererGrid BaseRenderer::upload(const VoxelGrid& grid)
+{
+    VoxelMesh mesh;
+    triangulate(grid, mesh.vertices, mesh.indices);
+    return this->upload(mesh);
+}
+
+cubos::engine::RendererGrid BaseRenderer::upload(const VoxelMesh& mesh, RendererGrid lod)
+{
+    auto grid = this->onUpload(mesh);
+    if (!mesh.vertices.empty())
+    {
+        grid->min = glm::vec3{mesh.vertices[0].unpackPosition()};
+        grid->max = grid->min;
+        for (const auto& vertex : mesh.vertices)
+        {
+            glm::vec3 position{vertex.unpackPosition()};
+            grid->min = glm::min(grid->min, position);
+            grid->max = glm::max(grid->max, position);
+        }
+    }
+    grid->lod = std::move(lod);
+    return grid;
+}
+
+void BaseRenderer::setLodThreshold(float pixels)
+{
+    mLodThreshold = pixels;
+}
+
 void BaseRenderer::resize(glm::uvec2 size)
 {
     mSize = size;
@@ -27,15 +66,27 @@ glm::uvec2 BaseRenderer::size() const
 void BaseRenderer::render(const glm::mat4& view, const Viewport& viewport, const engine::Camera& camera,
                           const RendererFrame& frame, bool usePostProcessing, const core::gl::Framebuffer& target)
 {
+    CUBOS_PROFILE_SCOPE("Renderer::render");
+
+    {
+        CUBOS_PROFILE_SCOPE("Renderer::cull");
+        auto projection =
+            glm::perspective(glm::radians(camera.fovY), float(viewport.size.x) / float(viewport.size.y), camera.zNear,
+                             camera.zFar);
+        mCulledFrame->cull(frame, view, projection, float(viewport.size.y), mLodThreshold);
+    }
+
     if (usePostProcessing && mPpsManager.passCount() > 0)
     {
-        this->onRender(view, viewport, camera, frame, mFramebuffer);
+        this->onRender(view, viewport, camera, *mCulledFrame, mFramebuffer);
         mPpsManager.provideInput(PostProcessingInput::Lighting, mTexture);
+
+        CUBOS_PROFILE_SCOPE("Renderer::postProcessing");
         mPpsManager.execute(target);
     }
     else
     {
-        this->onRender(view, viewport, camera, frame, target);
+        this->onRender(view, viewport, camera, *mCulledFrame, target);
     }
 }
 
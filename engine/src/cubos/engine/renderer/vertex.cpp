@@ -1,5 +1,7 @@
 #include <vector>
 
+#include <cubos/core/log.hpp>
+
 #include <cubos/engine/renderer/vertex.hpp>
 #include <cubos/engine/voxels/grid.hpp>
 
@@ -9,7 +11,7 @@ void cubos::core::data::old::serialize(Serializer& serializer, const VoxelVertex
 {
     serializer.beginObject(name);
     serializer.write(vertex.position, "position");
-    serializer.write(vertex.normal, "normal");
+    serializer.write(vertex.face, "face");
     serializer.write(vertex.material, "material");
     serializer.endObject();
 }
@@ -18,17 +20,58 @@ void cubos::core::data::old::deserialize(Deserializer& deserializer, VoxelVertex
 {
     deserializer.beginObject();
     deserializer.read(vertex.position);
-    deserializer.read(vertex.normal);
+    deserializer.read(vertex.face);
     deserializer.read(vertex.material);
     deserializer.endObject();
 }
 
+uint32_t VoxelVertex::packPosition(const glm::uvec3& position)
+{
+    return position.x | (position.y << 10) | (position.z << 20);
+}
+
+glm::uvec3 VoxelVertex::unpackPosition() const
+{
+    return {position & MaxCoordinate, (position >> 10) & MaxCoordinate, (position >> 20) & MaxCoordinate};
+}
+
+glm::vec3 VoxelVertex::normal() const
+{
+    glm::vec3 normal{0.0F};
+    normal[face / 2] = face % 2 == 0 ? 1.0F : -1.0F;
+    return normal;
+}
+
 void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>& vertices,
                                 std::vector<uint32_t>& indices)
+{
+    triangulate(grid, {0, 0, 0}, grid.size(), vertices, indices);
+}
+
+void cubos::engine::triangulate(const VoxelGrid& grid, const glm::ivec3& min, const glm::uvec3& sz,
+                                std::vector<VoxelVertex>& vertices, std::vector<uint32_t>& indices)
 {
     std::vector<uint16_t> mask;
 
-    const auto& sz = grid.size();
+    if (sz.x > VoxelVertex::MaxCoordinate || sz.y > VoxelVertex::MaxCoordinate || sz.z > VoxelVertex::MaxCoordinate)
+    {
+        CUBOS_ERROR("Region of size ({}, {}, {}) is too large to triangulate, at most {} voxels per axis are supported",
+                    sz.x, sz.y, sz.z, VoxelVertex::MaxCoordinate);
+        return;
+    }
+
+    // Gets a voxel given its coordinates relative to the region, treating voxels outside of the
+    // grid as empty.
+    const auto& gridSize = grid.size();
+    auto at = [&](const glm::ivec3& position) -> uint16_t {
+        auto p = min + position;
+        if (p.x < 0 || p.y < 0 || p.z < 0 || p.x >= static_cast<int>(gridSize.x) ||
+            p.y >= static_cast<int>(gridSize.y) || p.z >= static_cast<int>(gridSize.z))
+        {
+            return 0;
+        }
+        return grid.get(p);
+    };
 
     // For both back and front faces.
     bool backFace = true;
@@ -56,21 +99,17 @@ void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>&
                 {
                     for (x[u] = 0; x[u] < int(sz[u]); ++x[u])
                     {
-                        if (x[d] < 0)
-                        {
-                            mask[n++] = backFace ? grid.get(x + q) : 0;
-                        }
-                        else if (x[d] == int(sz[d]) - 1)
-                        {
-                            mask[n++] = backFace ? 0 : grid.get(x);
-                        }
-                        else if (grid.get(x) == 0 || grid.get(x + q) == 0)
+                        // Each face between x and x + q belongs to the solid voxel next to it, and is only
+                        // generated if that voxel is inside the region.
+                        auto first = at(x);
+                        auto second = at(x + q);
+                        if (backFace)
                         {
-                            mask[n++] = backFace ? grid.get(x + q) : grid.get(x);
+                            mask[n++] = x[d] + 1 < int(sz[d]) && first == 0 ? second : 0;
                         }
                         else
                         {
-                            mask[n++] = 0;
+                            mask[n++] = x[d] >= 0 && second == 0 ? first : 0;
                         }
                     }
                 }
@@ -120,11 +159,12 @@ void cubos::engine::triangulate(const VoxelGrid& grid, std::vector<VoxelVertex>&
                                 dv[v] = static_cast<int>(h);
 
                                 auto vi = vertices.size();
-                                vertices.resize(vi + 4, {{}, backFace ? -q : q, mask[n]});
-                                vertices[vi + 0].position = x;
-                                vertices[vi + 1].position = x + du;
-                                vertices[vi + 2].position = x + du + dv;
-                                vertices[vi + 3].position = x + dv;
+                                auto face = static_cast<uint16_t>(d * 2 + (backFace ? 1 : 0));
+                                vertices.resize(vi + 4, {0, face, mask[n]});
+                                vertices[vi + 0].position = VoxelVertex::packPosition(x);
+                                vertices[vi + 1].position = VoxelVertex::packPosition(x + du);
+                                vertices[vi + 2].position = VoxelVertex::packPosition(x + du + dv);
+                                vertices[vi + 3].position = VoxelVertex::packPosition(x + dv);
 
                                 auto ii = indices.size();
                                 indices.resize(ii + 6);
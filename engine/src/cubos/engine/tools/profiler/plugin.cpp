@@ -0,0 +1,173 @@
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <imgui.h>
+
+#include <cubos/core/log.hpp>
+#include <cubos/core/memory/standard_stream.hpp>
+#include <cubos/core/profiler.hpp>
+
+#include <cubos/engine/imgui/plugin.hpp>
+#include <cubos/engine/settings/plugin.hpp>
+#include <cubos/engine/tools/profiler/plugin.hpp>
+
+using cubos::core::Profiler;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+using cubos::core::memory::StandardStream;
+
+using namespace cubos::engine;
+
+/// @brief Time spent in all zones with the same name, over the recorded frames.
+struct ZoneStats
+{
+    std::string_view name;
+    double total = 0.0; ///< Total time, in milliseconds.
+    double max = 0.0;   ///< Longest time spent in a single frame, in milliseconds.
+    std::size_t calls = 0;
+};
+
+/// @brief Sums the time spent in each zone over the given frames.
+/// @param frames Frames.
+/// @return Statistics of each zone, from the zone which took the longest to the shortest.
+static std::vector<ZoneStats> zoneStats(const std::vector<Profiler::Frame>& frames)
+{
+    std::unordered_map<std::string_view, ZoneStats> byName;
+    for (const auto& frame : frames)
+    {
+        std::unordered_map<std::string_view, double> frameTotals;
+        for (const auto& zone : frame.zones)
+        {
+            auto& stats = byName[zone.name];
+            double time = static_cast<double>(zone.end - zone.start) / 1e6;
+            stats.name = zone.name;
+            stats.total += time;
+            stats.calls += 1;
+            frameTotals[zone.name] += time;
+        }
+
+        for (const auto& [name, total] : frameTotals)
+        {
+            byName[name].max = std::max(byName[name].max, total);
+        }
+    }
+
+    std::vector<ZoneStats> stats;
+    stats.reserve(byName.size());
+    for (const auto& [name, zoneStats] : byName)
+    {
+        stats.push_back(zoneStats);
+    }
+
+    std::sort(stats.begin(), stats.end(), [](const ZoneStats& a, const ZoneStats& b) { return a.total > b.total; });
+    return stats;
+}
+
+/// @brief Default path to which traces are exported.
+static constexpr const char* DefaultPath = "profile.json";
+
+static void init(Write<Settings> settings)
+{
+    // Define the setting, so that it shows up with its default value before a trace is exported.
+    settings->getString("cubos.tools.profiler.path", DefaultPath);
+}
+
+static void profiler(Read<Settings> settings)
+{
+    ImGui::Begin("Profiler");
+    if (!ImGui::IsWindowCollapsed())
+    {
+        bool enabled = Profiler::enabled();
+        if (ImGui::Checkbox("Enabled", &enabled))
+        {
+            Profiler::setEnabled(enabled);
+        }
+
+        ImGui::SameLine();
+        if (ImGui::Button("Clear"))
+        {
+            Profiler::clear();
+        }
+
+        ImGui::SameLine();
+        if (ImGui::Button("Export trace"))
+        {
+            const auto& values = settings->getValues();
+            auto it = values.find("cubos.tools.profiler.path");
+            std::string path = it != values.end() ? it->second : DefaultPath;
+            if (FILE* file = std::fopen(path.c_str(), "w"))
+            {
+                StandardStream stream{file, true};
+                Profiler::writeChromeTrace(stream);
+                CUBOS_INFO("Exported profiler trace to '{}'", path);
+            }
+            else
+            {
+                CUBOS_ERROR("Couldn't open '{}' to export the profiler trace", path);
+            }
+        }
+
+        auto frames = Profiler::frames();
+        if (frames.empty())
+        {
+            ImGui::Text("No frames recorded.");
+        }
+        else
+        {
+            std::vector<float> frameTimes;
+            frameTimes.reserve(frames.size());
+            for (const auto& frame : frames)
+            {
+                frameTimes.push_back(static_cast<float>(frame.end - frame.start) / 1e6F);
+            }
+
+            float average = 0.0F;
+            for (float time : frameTimes)
+            {
+                average += time;
+            }
+            average /= static_cast<float>(frameTimes.size());
+
+            ImGui::Text("Last frame: %.2f ms, average over %d frames: %.2f ms", frameTimes.back(),
+                        static_cast<int>(frameTimes.size()), average);
+            ImGui::PlotLines("##frames", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr, 0.0F,
+                             FLT_MAX, ImVec2(0.0F, 60.0F));
+
+            auto frameCount = static_cast<double>(frames.size());
+            ImGui::BeginTable("zones", 4, ImGuiTableFlags_BordersOuter | ImGuiTableFlags_Resizable);
+            ImGui::TableSetupColumn("Zone");
+            ImGui::TableSetupColumn("Calls per frame");
+            ImGui::TableSetupColumn("Average (ms)");
+            ImGui::TableSetupColumn("Max (ms)");
+            ImGui::TableHeadersRow();
+            for (const auto& stats : zoneStats(frames))
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(stats.name.data(), stats.name.data() + stats.name.size());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", static_cast<double>(stats.calls) / frameCount);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.total / frameCount);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.3f", stats.max);
+            }
+            ImGui::EndTable();
+        }
+    }
+    ImGui::End();
+}
+
+void cubos::engine::tools::profilerPlugin(Cubos& cubos)
+{
+    cubos.addPlugin(imguiPlugin);
+    cubos.addPlugin(settingsPlugin);
+
+    cubos.startupSystem(init).after("cubos.settings");
+    cubos.system(profiler).tagged("cubos.imgui");
+}
@@ -1,42 +1,210 @@
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
 #include <cubos/engine/transform/plugin.hpp>
 
 using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
 using cubos::core::ecs::OptRead;
+using cubos::core::ecs::OptWrite;
 using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
 using cubos::core::ecs::Write;
 using namespace cubos::engine;
 
-static void autoLocalToWorld(Commands cmds,
-                             Query<OptRead<LocalToWorld>, OptRead<Position>, OptRead<Rotation>, OptRead<Scale>> query)
+static void autoLocalToWorld(Commands cmds, Query<OptRead<LocalToWorld>, OptRead<LocalToParent>, OptRead<Parent>,
+                                                  OptRead<Position>, OptRead<Rotation>, OptRead<Scale>>
+                                                query)
 {
-    for (auto [entity, localToWorld, position, rotation, scale] : query)
+    for (auto [entity, localToWorld, localToParent, parent, position, rotation, scale] : query)
     {
-        if (!localToWorld && (position || rotation || scale))
+        if (parent && !query[parent->entity])
         {
+            // The parent was destroyed, so the entity becomes a root. Adding its matrix again
+            // makes sure it's recomputed relative to the world.
+            cmds.remove<Parent, LocalToParent>(entity);
+            cmds.add(entity, LocalToWorld{});
+            continue;
+        }
+
+        if (!localToWorld && (parent || position || rotation || scale))
+        {
+            cmds.add(entity, LocalToWorld{});
+        }
+
+        if (!localToParent && parent)
+        {
+            cmds.add(entity, LocalToParent{});
+        }
+        else if (localToParent && !parent)
+        {
+            // The entity was detached from its parent. Adding its matrix again makes sure it's
+            // recomputed relative to the world.
+            cmds.remove<LocalToParent>(entity);
             cmds.add(entity, LocalToWorld{});
         }
     }
 }
 
-static void applyTransform(Query<Write<LocalToWorld>, OptRead<Position>, OptRead<Rotation>, OptRead<Scale>> query)
+static void updateChildren(Commands cmds, Query<Read<Parent>> parents, Query<OptRead<Children>> children)
 {
-    for (auto [entity, localToWorld, position, rotation, scale] : query)
+    // Entities whose children lists must be replaced, and their new lists.
+    std::unordered_map<Entity, std::vector<Entity>> updated;
+
+    for (auto [entity, parent] : parents)
+    {
+        if (!parents.changed<Parent>(entity))
+        {
+            continue;
+        }
+
+        auto it = updated.find(parent->entity);
+        if (it == updated.end())
+        {
+            auto components = children[parent->entity];
+            if (!components)
+            {
+                // The parent isn't alive.
+                continue;
+            }
+
+            it = updated.emplace(parent->entity, std::vector<Entity>{}).first;
+            if (auto& list = std::get<0>(*components))
+            {
+                // Drop entities which were destroyed, detached or attached to another parent
+                // since the list was last updated. Entities whose parent changed are added back
+                // below, if they're still attached to this parent.
+                for (auto child : list->entities)
+                {
+                    auto childParent = parents[child];
+                    if (childParent && std::get<0>(*childParent)->entity == parent->entity &&
+                        !parents.changed<Parent>(child))
+                    {
+                        it->second.push_back(child);
+                    }
+                }
+            }
+        }
+
+        it->second.push_back(entity);
+    }
+
+    for (auto& [entity, list] : updated)
     {
-        localToWorld->mat = glm::mat4(1.0F);
+        cmds.add(entity, Children{std::move(list)});
+    }
+}
+
+static void applyTransform(Query<Write<LocalToWorld>, OptWrite<LocalToParent>, OptRead<Position>, OptRead<Rotation>,
+                                 OptRead<Scale>>
+                               query)
+{
+    // Each entity's matrix only depends on its own components, so they can be computed in parallel.
+    query.parEach([&query](Entity entity, Write<LocalToWorld> localToWorld, OptWrite<LocalToParent> localToParent,
+                           OptRead<Position> position, OptRead<Rotation> rotation, OptRead<Scale> scale) {
+        // Only recompute matrices which may be out of date, including when one of the components
+        // was removed. This must be checked before writing to the matrix, as writing marks it as
+        // changed.
+        if (!query.added<LocalToWorld>(entity) && !query.added<LocalToParent>(entity) &&
+            !query.changed<Position>(entity) && !query.changed<Rotation>(entity) && !query.changed<Scale>(entity) &&
+            !query.removed<Position>(entity) && !query.removed<Rotation>(entity) && !query.removed<Scale>(entity))
+        {
+            return;
+        }
+
+        auto mat = glm::mat4(1.0F);
         if (position)
         {
-            localToWorld->mat = glm::translate(localToWorld->mat, position->vec);
+            mat = glm::translate(mat, position->vec);
         }
 
         if (rotation)
         {
-            localToWorld->mat *= glm::toMat4(rotation->quat);
+            mat *= glm::toMat4(rotation->quat);
         }
 
         if (scale)
         {
-            localToWorld->mat = glm::scale(localToWorld->mat, glm::vec3(scale->factor));
+            mat = glm::scale(mat, glm::vec3(scale->factor));
         }
+
+        // Entities with a parent are only placed in the world once their parent's matrix is known.
+        if (localToParent)
+        {
+            localToParent->mat = mat;
+        }
+        else
+        {
+            localToWorld->mat = mat;
+        }
+    });
+}
+
+static void propagateTransform(
+    Query<Write<LocalToWorld>, OptRead<LocalToParent>, OptRead<Parent>, OptRead<Children>> query)
+{
+    /// @brief Entity whose children are yet to be visited.
+    struct Node
+    {
+        Entity entity;
+        const Children* children; ///< Children of the entity.
+        glm::mat4 mat;            ///< Local to world matrix of the entity.
+        bool dirty;               ///< Whether the matrices of the children must be recomputed.
+    };
+
+    // The hierarchies are traversed breadth-first, one level at a time, starting from the entities
+    // which have children but no parent. Subtrees whose matrices didn't change are still visited,
+    // but their matrices aren't recomputed.
+    std::vector<Node> level;
+    std::vector<Node> next;
+    for (auto [entity, localToWorld, localToParent, parent, children] : query)
+    {
+        if (children && !parent)
+        {
+            bool dirty = query.changed<LocalToWorld>(entity) || query.changed<Children>(entity);
+            level.push_back({entity, &*children, std::as_const(localToWorld)->mat, dirty});
+        }
+    }
+
+    while (!level.empty())
+    {
+        for (const auto& node : level)
+        {
+            for (auto child : node.children->entities)
+            {
+                auto components = query[child];
+                if (!components)
+                {
+                    // The child was destroyed, or doesn't have a matrix yet.
+                    continue;
+                }
+
+                auto& [localToWorld, localToParent, parent, children] = *components;
+                if (!parent || parent->entity != node.entity)
+                {
+                    // The child was detached or attached to another parent since the list was
+                    // last updated.
+                    continue;
+                }
+
+                bool dirty = node.dirty || query.added<LocalToWorld>(child) || query.changed<LocalToParent>(child) ||
+                             query.changed<Parent>(child);
+                if (dirty)
+                {
+                    localToWorld->mat = node.mat * (localToParent ? localToParent->mat : glm::mat4(1.0F));
+                }
+
+                if (children)
+                {
+                    next.push_back({child, &*children, std::as_const(localToWorld)->mat,
+                                    dirty || query.changed<Children>(child)});
+                }
+            }
+        }
+
+        level.swap(next);
+        next.clear();
     }
 }
 
@@ -46,7 +214,12 @@ void cubos::engine::transformPlugin(Cubos& cubos)
     cubos.addComponent<Rotation>();
     cubos.addComponent<Scale>();
     cubos.addComponent<LocalToWorld>();
+    cubos.addComponent<LocalToParent>();
+    cubos.addComponent<Parent>();
+    cubos.addComponent<Children>();
 
     cubos.system(autoLocalToWorld).before("cubos.transform.update");
-    cubos.system(applyTransform).tagged("cubos.transform.update");
+    cubos.system(updateChildren).before("cubos.transform.update");
+    cubos.system(applyTransform).tagged("cubos.transform.update").tagged("cubos.transform.local");
+    cubos.system(propagateTransform).tagged("cubos.transform.update").after("cubos.transform.local");
 }
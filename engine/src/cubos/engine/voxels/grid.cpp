@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 
 #include <cubos/core/log.hpp>
@@ -7,21 +9,123 @@
 
 using namespace cubos::engine;
 
+/// @brief Number of revisions in the range taken by a grid when all of its voxels change.
+static constexpr uint64_t RevisionRange = uint64_t{1} << 32;
+
+/// @brief First revision of the next range to be taken.
+static std::atomic<uint64_t> nextRevision{RevisionRange};
+
+/// @brief Version of the serialization format of grids, written after a 0 which tells it apart from
+/// the format used before versions, which started with the width of the grid. Later versions must
+/// keep the fields which follow it and store their data as an array of words, so that readers of
+/// older versions can skip grids they don't support.
+static constexpr uint8_t FormatVersion = 1;
+
+/// @brief Largest size of each dimension of a deserialized grid.
+static constexpr uint32_t MaxDimension = 1U << 16;
+
+/// @brief Largest number of voxels of a deserialized grid.
+static constexpr uint64_t MaxVoxels = uint64_t{1} << 30;
+
+/// @brief Calls a function for the index of every voxel of a brick which is inside the grid.
+/// @tparam F Function type.
+/// @param origin Coordinates of the first voxel of the brick.
+/// @param size Size of the grid.
+/// @param func Function to call.
+template <typename F>
+static void forEachInBrick(const glm::ivec3& origin, const glm::uvec3& size, F func)
+{
+    auto extent = glm::min(glm::ivec3{8}, glm::ivec3{size} - origin);
+    for (int z = 0; z < extent.z; ++z)
+    {
+        for (int y = 0; y < extent.y; ++y)
+        {
+            for (int x = 0; x < extent.x; ++x)
+            {
+                func(static_cast<uint32_t>(x | (y << 3) | (z << 6)));
+            }
+        }
+    }
+}
+
+VoxelGrid::Iterator::Iterator(const VoxelGrid& grid, std::size_t brick)
+    : mGrid(&grid)
+    , mBrick(brick)
+    , mVoxel(0)
+    , mCurrent{}
+{
+    this->seek();
+}
+
+bool VoxelGrid::Iterator::operator==(const Iterator& other) const
+{
+    return mGrid == other.mGrid && mBrick == other.mBrick && mVoxel == other.mVoxel;
+}
+
+const VoxelGrid::Voxel& VoxelGrid::Iterator::operator*() const
+{
+    return mCurrent;
+}
+
+const VoxelGrid::Voxel* VoxelGrid::Iterator::operator->() const
+{
+    return &mCurrent;
+}
+
+VoxelGrid::Iterator& VoxelGrid::Iterator::operator++()
+{
+    ++mVoxel;
+    this->seek();
+    return *this;
+}
+
+void VoxelGrid::Iterator::seek()
+{
+    for (; mBrick < mGrid->mBricks.size(); ++mBrick, mVoxel = 0)
+    {
+        auto entry = mGrid->mBricks[mBrick];
+        if (entry == UniformBit)
+        {
+            // Empty bricks are skipped without looking at their voxels.
+            continue;
+        }
+
+        auto origin = mGrid->brickOrigin(mBrick);
+        for (; mVoxel < BrickVolume; ++mVoxel)
+        {
+            auto position = origin + glm::ivec3{static_cast<int>(mVoxel & 7), static_cast<int>((mVoxel >> 3) & 7),
+                                                static_cast<int>(mVoxel >> 6)};
+            if (position.x >= static_cast<int>(mGrid->mSize.x) || position.y >= static_cast<int>(mGrid->mSize.y) ||
+                position.z >= static_cast<int>(mGrid->mSize.z))
+            {
+                continue;
+            }
+
+            auto material = (entry & UniformBit) != 0 ? static_cast<uint16_t>(entry)
+                                                      : mGrid->mVoxels[entry * BrickVolume + mVoxel];
+            if (material != 0)
+            {
+                mCurrent = {position, material};
+                return;
+            }
+        }
+    }
+
+    mVoxel = 0;
+}
+
 VoxelGrid::VoxelGrid(const glm::uvec3& size)
 {
     if (size.x < 1 || size.y < 1 || size.z < 1)
     {
         CUBOS_WARN("Grid size must be at least 1 in each dimension: was ({}, {}, {}), defaulting to (1, 1, 1).", size.x,
                    size.y, size.z);
-        mSize = {1, 1, 1};
+        this->reset({1, 1, 1});
     }
     else
     {
-        mSize = size;
+        this->reset(size);
     }
-
-    mIndices.resize(
-        static_cast<std::size_t>(mSize.x) * static_cast<std::size_t>(mSize.y) * static_cast<std::size_t>(mSize.z), 0);
 }
 
 VoxelGrid::VoxelGrid(const glm::uvec3& size, const std::vector<uint16_t>& indices)
@@ -30,36 +134,95 @@ VoxelGrid::VoxelGrid(const glm::uvec3& size, const std::vector<uint16_t>& indice
     {
         CUBOS_WARN("Grid size must be at least 1 in each dimension: was ({}, {}, {}), defaulting to (1, 1, 1).", size.x,
                    size.y, size.z);
-        mSize = {1, 1, 1};
+        this->reset({1, 1, 1});
     }
     else if (indices.size() !=
              static_cast<std::size_t>(size.x) * static_cast<std::size_t>(size.y) * static_cast<std::size_t>(size.z))
     {
         CUBOS_WARN("Grid size and indices size mismatch: was ({}, {}, {}), indices size is {}.", size.x, size.y, size.z,
                    indices.size());
-        mSize = {1, 1, 1};
+        this->reset({1, 1, 1});
     }
     else
     {
-        mSize = size;
+        this->reset(size);
+        this->fill(indices);
     }
-
-    mIndices = indices;
 }
 
 VoxelGrid::VoxelGrid(VoxelGrid&& other) noexcept
     : mSize(other.mSize)
+    , mBrickCount(other.mBrickCount)
+    , mBricks(std::move(other.mBricks))
+    , mVoxels(std::move(other.mVoxels))
+    , mRevision(other.mRevision)
+    , mRevisions(std::move(other.mRevisions))
 {
-    new (&mIndices) std::vector<uint16_t>(std::move(other.mIndices));
+    // Do nothing.
+}
+
+VoxelGrid::VoxelGrid(const VoxelGrid& other, const glm::ivec3& min, const glm::uvec3& size)
+    : VoxelGrid(size)
+{
+    auto from = glm::max(min, glm::ivec3{0});
+    auto to = glm::min(min + glm::ivec3{mSize}, glm::ivec3{other.mSize});
+    if (from.x >= to.x || from.y >= to.y || from.z >= to.z)
+    {
+        return;
+    }
+
+    // This grid starts empty, so only the voxels of the other grid's non-empty bricks are copied.
+    auto firstBrick = from / 8;
+    auto lastBrick = (to - 1) / 8;
+    glm::ivec3 brick;
+    for (brick.z = firstBrick.z; brick.z <= lastBrick.z; ++brick.z)
+    {
+        for (brick.y = firstBrick.y; brick.y <= lastBrick.y; ++brick.y)
+        {
+            for (brick.x = firstBrick.x; brick.x <= lastBrick.x; ++brick.x)
+            {
+                if (other.mBricks[other.brickIndex(brick)] == UniformBit)
+                {
+                    continue;
+                }
+
+                auto brickFrom = glm::max(from, brick * 8);
+                auto brickTo = glm::min(to, brick * 8 + 8);
+                glm::ivec3 position;
+                for (position.z = brickFrom.z; position.z < brickTo.z; ++position.z)
+                {
+                    for (position.y = brickFrom.y; position.y < brickTo.y; ++position.y)
+                    {
+                        for (position.x = brickFrom.x; position.x < brickTo.x; ++position.x)
+                        {
+                            this->set(position - min, other.get(position));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Bricks filled with a single non-zero material were split by set.
+    this->compact();
 }
 
 VoxelGrid::VoxelGrid()
 {
-    mSize = {1, 1, 1};
-    mIndices.resize(1, 0);
+    this->reset({1, 1, 1});
 }
 
-VoxelGrid& VoxelGrid::operator=(const VoxelGrid& rhs) = default;
+VoxelGrid& VoxelGrid::operator=(const VoxelGrid& rhs)
+{
+    mSize = rhs.mSize;
+    mBrickCount = rhs.mBrickCount;
+    mBricks = rhs.mBricks;
+    mVoxels = rhs.mVoxels;
+
+    // The copy may diverge from the original, so it can't share its revisions.
+    this->markAllChanged();
+    return *this;
+}
 
 void VoxelGrid::setSize(const glm::uvec3& size)
 {
@@ -75,10 +238,7 @@ void VoxelGrid::setSize(const glm::uvec3& size)
         return;
     }
 
-    mSize = size;
-    mIndices.clear();
-    mIndices.resize(
-        static_cast<std::size_t>(mSize.x) * static_cast<std::size_t>(mSize.y) * static_cast<std::size_t>(mSize.z), 0);
+    this->reset(size);
 }
 
 const glm::uvec3& VoxelGrid::size() const
@@ -88,10 +248,7 @@ const glm::uvec3& VoxelGrid::size() const
 
 void VoxelGrid::clear()
 {
-    for (auto& i : mIndices)
-    {
-        i = 0;
-    }
+    this->reset(mSize);
 }
 
 uint16_t VoxelGrid::get(const glm::ivec3& position) const
@@ -99,8 +256,12 @@ uint16_t VoxelGrid::get(const glm::ivec3& position) const
     assert(position.x >= 0 && position.x < static_cast<int>(mSize.x));
     assert(position.y >= 0 && position.y < static_cast<int>(mSize.y));
     assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
-    auto index = position.x + position.y * static_cast<int>(mSize.x) + position.z * static_cast<int>(mSize.x * mSize.y);
-    return mIndices[static_cast<std::size_t>(index)];
+    auto entry = mBricks[this->brickIndex(position / 8)];
+    if ((entry & UniformBit) != 0)
+    {
+        return static_cast<uint16_t>(entry);
+    }
+    return mVoxels[entry * BrickVolume + voxelIndex(position)];
 }
 
 void VoxelGrid::set(const glm::ivec3& position, uint16_t mat)
@@ -108,8 +269,100 @@ void VoxelGrid::set(const glm::ivec3& position, uint16_t mat)
     assert(position.x >= 0 && position.x < static_cast<int>(mSize.x));
     assert(position.y >= 0 && position.y < static_cast<int>(mSize.y));
     assert(position.z >= 0 && position.z < static_cast<int>(mSize.z));
-    auto index = position.x + position.y * static_cast<int>(mSize.x) + position.z * static_cast<int>(mSize.x * mSize.y);
-    mIndices[static_cast<std::size_t>(index)] = mat;
+    auto brick = this->brickIndex(position / 8);
+    auto& entry = mBricks[brick];
+    if ((entry & UniformBit) != 0)
+    {
+        if (static_cast<uint16_t>(entry) == mat)
+        {
+            return;
+        }
+
+        // The brick no longer has a single material, so it needs a slot to store its voxels.
+        this->split(entry);
+    }
+    else if (mVoxels[entry * BrickVolume + voxelIndex(position)] == mat)
+    {
+        return;
+    }
+
+    mVoxels[entry * BrickVolume + voxelIndex(position)] = mat;
+    mRevisions[brick] = ++mRevision;
+}
+
+VoxelGrid::Iterator VoxelGrid::begin() const
+{
+    return {*this, 0};
+}
+
+VoxelGrid::Iterator VoxelGrid::end() const
+{
+    return {*this, mBricks.size()};
+}
+
+uint64_t VoxelGrid::revision() const
+{
+    return mRevision;
+}
+
+bool VoxelGrid::changedSince(const glm::ivec3& min, const glm::ivec3& max, uint64_t revision) const
+{
+    auto from = glm::max(min, glm::ivec3{0});
+    auto to = glm::min(max, glm::ivec3{mSize});
+    if (from.x >= to.x || from.y >= to.y || from.z >= to.z)
+    {
+        return false;
+    }
+
+    auto firstBrick = from / 8;
+    auto lastBrick = (to - 1) / 8;
+    glm::ivec3 brick;
+    for (brick.z = firstBrick.z; brick.z <= lastBrick.z; ++brick.z)
+    {
+        for (brick.y = firstBrick.y; brick.y <= lastBrick.y; ++brick.y)
+        {
+            for (brick.x = firstBrick.x; brick.x <= lastBrick.x; ++brick.x)
+            {
+                if (mRevisions[this->brickIndex(brick)] > revision)
+                {
+                    return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+void VoxelGrid::compact()
+{
+    // Collapse uniform bricks and move the remaining ones to the start of the storage, so that
+    // no slots are left unused.
+    std::vector<uint16_t> voxels;
+    for (std::size_t i = 0; i < mBricks.size(); ++i)
+    {
+        auto& entry = mBricks[i];
+        if ((entry & UniformBit) != 0)
+        {
+            continue;
+        }
+
+        const auto* brick = &mVoxels[entry * BrickVolume];
+        bool uniform = true;
+        forEachInBrick(this->brickOrigin(i), mSize, [&](uint32_t voxel) { uniform &= brick[voxel] == brick[0]; });
+        if (uniform)
+        {
+            entry = UniformBit | brick[0];
+        }
+        else
+        {
+            auto slot = static_cast<uint32_t>(voxels.size() / BrickVolume);
+            voxels.insert(voxels.end(), brick, brick + BrickVolume);
+            entry = slot;
+        }
+    }
+
+    mVoxels = std::move(voxels);
 }
 
 bool VoxelGrid::convert(const VoxelPalette& src, const VoxelPalette& dst, float minSimilarity)
@@ -126,44 +379,428 @@ bool VoxelGrid::convert(const VoxelPalette& src, const VoxelPalette& dst, float
     }
 
     // Check if the mappings are complete for every material being used in the grid.
-    for (uint32_t i = 0; i < mSize.x * mSize.y * mSize.z; ++i)
+    bool complete = true;
+    for (std::size_t i = 0; i < mBricks.size(); ++i)
     {
-        if (mappings.find(mIndices[i]) == mappings.end())
+        auto entry = mBricks[i];
+        if ((entry & UniformBit) != 0)
         {
-            return false;
+            complete &= mappings.contains(static_cast<uint16_t>(entry));
         }
+        else
+        {
+            const auto* brick = &mVoxels[entry * BrickVolume];
+            forEachInBrick(this->brickOrigin(i), mSize,
+                           [&](uint32_t voxel) { complete &= mappings.contains(brick[voxel]); });
+        }
+    }
+
+    if (!complete)
+    {
+        return false;
     }
 
-    // Apply the mappings.
-    for (uint32_t i = 0; i < mSize.x * mSize.y * mSize.z; ++i)
+    // Apply the mappings. Voxels of non-uniform bricks which are outside the grid may not have
+    // one, and are left unchanged.
+    for (auto& entry : mBricks)
     {
-        mIndices[i] = mappings[mIndices[i]];
+        if ((entry & UniformBit) != 0)
+        {
+            entry = UniformBit | mappings[static_cast<uint16_t>(entry)];
+        }
+    }
+    for (auto& voxel : mVoxels)
+    {
+        if (auto it = mappings.find(voxel); it != mappings.end())
+        {
+            voxel = it->second;
+        }
     }
 
+    this->markAllChanged();
     return true;
 }
 
+std::size_t VoxelGrid::brickIndex(const glm::ivec3& brick) const
+{
+    return static_cast<std::size_t>(brick.x) + static_cast<std::size_t>(brick.y) * mBrickCount.x +
+           static_cast<std::size_t>(brick.z) * mBrickCount.x * mBrickCount.y;
+}
+
+glm::ivec3 VoxelGrid::brickOrigin(std::size_t index) const
+{
+    auto x = index % mBrickCount.x;
+    auto y = (index / mBrickCount.x) % mBrickCount.y;
+    auto z = index / (static_cast<std::size_t>(mBrickCount.x) * mBrickCount.y);
+    return glm::ivec3{static_cast<int>(x), static_cast<int>(y), static_cast<int>(z)} * 8;
+}
+
+uint32_t VoxelGrid::voxelIndex(const glm::ivec3& position)
+{
+    return static_cast<uint32_t>((position.x & 7) | ((position.y & 7) << 3) | ((position.z & 7) << 6));
+}
+
+void VoxelGrid::reset(const glm::uvec3& size)
+{
+    mSize = size;
+    mBrickCount = (size + 7U) / 8U;
+    mBricks.assign(static_cast<std::size_t>(mBrickCount.x) * mBrickCount.y * mBrickCount.z, UniformBit);
+    mVoxels.clear();
+    mVoxels.shrink_to_fit();
+    this->markAllChanged();
+}
+
+void VoxelGrid::markAllChanged()
+{
+    mRevision = nextRevision.fetch_add(RevisionRange, std::memory_order_relaxed);
+    mRevisions.assign(mBricks.size(), mRevision);
+}
+
+void VoxelGrid::fill(const std::vector<uint16_t>& indices)
+{
+    std::size_t index = 0;
+    for (int z = 0; z < static_cast<int>(mSize.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(mSize.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(mSize.x); ++x, ++index)
+            {
+                this->set({x, y, z}, indices[index]);
+            }
+        }
+    }
+
+    // Bricks filled with a single non-zero material were split by set.
+    this->compact();
+}
+
+void VoxelGrid::fillRun(uint64_t begin, uint64_t end, uint16_t mat)
+{
+    auto width = static_cast<uint64_t>(mSize.x);
+    auto layer = width * mSize.y;
+    auto flatIndex = [&](const glm::ivec3& position) {
+        return static_cast<uint64_t>(position.x) + static_cast<uint64_t>(position.y) * width +
+               static_cast<uint64_t>(position.z) * layer;
+    };
+
+    for (auto row = begin / width; row * width < end; ++row)
+    {
+        auto rowBegin = row * width;
+        auto spanBegin = static_cast<int>(std::max(begin, rowBegin) - rowBegin);
+        auto spanEnd = static_cast<int>(std::min(end, rowBegin + width) - rowBegin);
+        glm::ivec3 position{spanBegin, static_cast<int>(row % mSize.y), static_cast<int>(row / mSize.y)};
+        for (; position.x < spanEnd; position.x = (position.x / 8 + 1) * 8)
+        {
+            auto& entry = mBricks[this->brickIndex(position / 8)];
+
+            // Every voxel of a brick lies between its first and last voxels in the flat order, so if
+            // both are in the run, so is the whole brick.
+            auto first = position / 8 * 8;
+            auto last = glm::min(first + 7, glm::ivec3{mSize} - 1);
+            if (flatIndex(first) >= begin && flatIndex(last) < end)
+            {
+                entry = UniformBit | mat;
+                continue;
+            }
+
+            if ((entry & UniformBit) != 0)
+            {
+                this->split(entry);
+            }
+            auto length = std::min(spanEnd, (position.x / 8 + 1) * 8) - position.x;
+            std::fill_n(mVoxels.begin() + entry * BrickVolume + voxelIndex(position), length, mat);
+        }
+    }
+}
+
+void VoxelGrid::split(uint32_t& entry)
+{
+    // Slots are only released by compact, so new ones always go at the end of the storage.
+    auto slot = static_cast<uint32_t>(mVoxels.size() / BrickVolume);
+    mVoxels.resize(mVoxels.size() + BrickVolume, static_cast<uint16_t>(entry));
+    entry = slot;
+}
+
+namespace
+{
+    /// @brief Run of voxels with the same material, in the flat order of a grid.
+    struct Run
+    {
+        uint16_t material; ///< Material of the voxels.
+        uint64_t length;   ///< Number of voxels.
+    };
+
+    /// @brief Packs fixed width fields into 64-bit words, starting from the least significant bits.
+    struct BitWriter
+    {
+        std::vector<uint64_t> words; ///< Words written so far.
+        uint32_t offset = 0;         ///< Number of bits used in the last word.
+
+        /// @brief Appends a field.
+        /// @param value Value of the field, which must fit in the given width.
+        /// @param width Width of the field in bits, at most 64.
+        void write(uint64_t value, uint32_t width)
+        {
+            if (width == 0)
+            {
+                return;
+            }
+
+            if (offset == 0)
+            {
+                words.push_back(0);
+            }
+            words.back() |= value << offset;
+            if (offset + width > 64)
+            {
+                words.push_back(value >> (64 - offset));
+            }
+            offset = (offset + width) % 64;
+        }
+    };
+
+    /// @brief Unpacks fields written by @ref BitWriter, reading each word from a deserializer only
+    /// when it's needed.
+    struct BitReader
+    {
+        cubos::core::data::old::Deserializer& deserializer; ///< Deserializer to read words from.
+        std::size_t remaining;                               ///< Number of words left to read.
+        uint64_t current = 0;                                ///< Last word read.
+        uint32_t offset = 64;                                ///< Number of bits consumed from the last word.
+        bool failed = false;                                 ///< Whether a field went past the last word.
+
+        /// @brief Reads a field.
+        /// @param width Width of the field in bits, at most 64.
+        /// @return Value of the field.
+        uint64_t read(uint32_t width)
+        {
+            if (width == 0)
+            {
+                return 0;
+            }
+
+            uint64_t value = offset < 64 ? current >> offset : 0;
+            uint32_t available = 64 - offset;
+            if (available < width)
+            {
+                if (remaining == 0 || deserializer.failed())
+                {
+                    failed = true;
+                    return 0;
+                }
+
+                deserializer.readU64(current);
+                --remaining;
+                value |= current << available;
+                offset = width - available;
+            }
+            else
+            {
+                offset += width;
+            }
+
+            return width == 64 ? value : value & ((uint64_t{1} << width) - 1);
+        }
+    };
+} // namespace
+
 void cubos::core::data::old::serialize(Serializer& serializer, const VoxelGrid& grid, const char* name)
 {
+    // Split the voxels into runs along the X axis, which is the fastest in the flat order. Runs
+    // continue onto the next row, so empty space costs a single run no matter its shape.
+    std::vector<Run> runs;
+    uint16_t maxMaterial = 0;
+    for (int z = 0; z < static_cast<int>(grid.mSize.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(grid.mSize.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(grid.mSize.x); ++x)
+            {
+                auto material = grid.get({x, y, z});
+                if (!runs.empty() && runs.back().material == material)
+                {
+                    runs.back().length += 1;
+                }
+                else
+                {
+                    runs.push_back({material, 1});
+                    maxMaterial = std::max(maxMaterial, material);
+                }
+            }
+        }
+    }
+
+    // Materials take as many bits as needed to store the largest one used. Lengths are stored
+    // minus one with a fixed width, chosen to minimize the total size. Longer runs are split.
+    uint32_t materialBits = 0;
+    while (materialBits < 16 && (1U << materialBits) <= maxMaterial)
+    {
+        ++materialBits;
+    }
+
+    uint32_t lengthBits = 1;
+    uint64_t bestSize = UINT64_MAX;
+    for (uint32_t bits = 1; bits <= 32; ++bits)
+    {
+        uint64_t fields = 0;
+        for (const auto& run : runs)
+        {
+            fields += ((run.length - 1) >> bits) + 1;
+        }
+
+        if (fields * (materialBits + bits) < bestSize)
+        {
+            bestSize = fields * (materialBits + bits);
+            lengthBits = bits;
+        }
+    }
+
+    BitWriter writer;
+    uint64_t maxLength = uint64_t{1} << lengthBits;
+    for (auto run : runs)
+    {
+        for (; run.length > 0; run.length -= std::min(run.length, maxLength))
+        {
+            writer.write(run.material, materialBits);
+            writer.write(std::min(run.length, maxLength) - 1, lengthBits);
+        }
+    }
+
     serializer.beginObject(name);
+    serializer.write(uint32_t{0}, "tag");
+    serializer.write(FormatVersion, "version");
     serializer.write(grid.mSize, "size");
-    serializer.write(grid.mIndices, "data");
+    serializer.write(static_cast<uint8_t>(materialBits), "materialBits");
+    serializer.write(static_cast<uint8_t>(lengthBits), "lengthBits");
+    serializer.beginArray(writer.words.size(), "runs");
+    for (auto word : writer.words)
+    {
+        serializer.writeU64(word, nullptr);
+    }
+    serializer.endArray();
     serializer.endObject();
 }
 
+/// @brief Reads the rest of a grid in the format used before runs, where the first field, the width
+/// of the grid, was already read.
+/// @param deserializer Deserializer.
+/// @param grid Grid to read into.
+/// @param width Width of the grid.
+static void deserializeLegacy(cubos::core::data::old::Deserializer& deserializer, VoxelGrid& grid, uint32_t width)
+{
+    glm::uvec3 size{width, 0, 0};
+    std::vector<uint16_t> indices;
+    deserializer.read(size.y);
+    deserializer.read(size.z);
+    deserializer.endObject();
+    deserializer.read(indices);
+    deserializer.endObject();
+
+    // The constructor checks that the indices match the size.
+    grid = VoxelGrid{size, indices};
+}
+
 void cubos::core::data::old::deserialize(Deserializer& deserializer, VoxelGrid& grid)
 {
+    // Grids used to start with their size, whose width is never 0. Those grids can only be told
+    // apart from binary data, which is how grid assets are stored.
+    uint32_t tag = 0;
     deserializer.beginObject();
-    deserializer.read(grid.mSize);
-    deserializer.read(grid.mIndices);
+    deserializer.read(tag);
+    if (tag != 0)
+    {
+        deserializeLegacy(deserializer, grid, tag);
+        return;
+    }
+
+    uint8_t version = 0;
+    glm::uvec3 size;
+    uint8_t materialBits;
+    uint8_t lengthBits;
+    deserializer.read(version);
+    deserializer.read(size);
+    deserializer.read(materialBits);
+    deserializer.read(lengthBits);
+    BitReader reader{deserializer, deserializer.beginArray()};
+
+    // Check the size before allocating anything: it must be within the limits, and the words must
+    // be able to hold enough runs to cover every voxel, so that malformed data can't make the grid
+    // allocate more than the data could ever fill.
+    bool supported = version == FormatVersion;
+    bool valid = supported && materialBits <= 16 && lengthBits >= 1 && lengthBits <= 32;
+    auto total = static_cast<uint64_t>(size.x) * size.y * size.z;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        valid = valid && size[i] >= 1 && size[i] <= MaxDimension;
+    }
+    if (valid)
+    {
+        auto words = static_cast<uint64_t>(std::min<std::size_t>(reader.remaining, MaxVoxels));
+        auto runs = words * 64 / (materialBits + lengthBits);
+        valid = total <= MaxVoxels && ((total - 1) >> lengthBits) + 1 <= runs;
+    }
+
+    if (valid)
+    {
+        grid.reset(size);
+    }
+
+    // Decode the runs as their words are read, writing them straight into the grid's bricks. Runs
+    // split by the serializer are merged back first, so that they can cover whole bricks. Empty
+    // runs are skipped, as the grid starts empty.
+    Run run{0, 0};
+    for (uint64_t index = 0; valid && index < total;)
+    {
+        auto material = static_cast<uint16_t>(reader.read(materialBits));
+        auto length = reader.read(lengthBits) + 1;
+        if (reader.failed || length > total - index)
+        {
+            valid = false;
+            break;
+        }
+
+        if (material != run.material)
+        {
+            if (run.material != 0)
+            {
+                grid.fillRun(index - run.length, index, run.material);
+            }
+            run = {material, 0};
+        }
+        run.length += length;
+        index += length;
+    }
+
+    if (valid && run.material != 0)
+    {
+        grid.fillRun(total - run.length, total, run.material);
+    }
+
+    // Skip any words which weren't needed, so that the deserializer stays in sync.
+    uint64_t word;
+    for (; reader.remaining > 0 && !deserializer.failed(); --reader.remaining)
+    {
+        deserializer.readU64(word);
+    }
+    deserializer.endArray();
     deserializer.endObject();
 
-    if (grid.mSize.x * grid.mSize.y * grid.mSize.z != static_cast<unsigned int>(grid.mIndices.size()))
+    if (!supported)
     {
-        CUBOS_WARN("Grid size and indices size mismatch: was ({}, {}, {}), indices size is {}.", grid.mSize.x,
-                   grid.mSize.y, grid.mSize.z, grid.mIndices.size());
-        grid.mSize = {1, 1, 1};
-        grid.mIndices.clear();
-        grid.mIndices.resize(1, 0);
+        CUBOS_WARN("Unsupported voxel grid format version {}, expected {}.", version, FormatVersion);
+        grid.reset({1, 1, 1});
+        return;
     }
+
+    if (!valid || deserializer.failed())
+    {
+        CUBOS_WARN("Invalid voxel grid data: size was ({}, {}, {}), with {} bits per material and {} bits per run "
+                   "length.",
+                   size.x, size.y, size.z, materialBits, lengthBits);
+        grid.reset({1, 1, 1});
+        return;
+    }
+
+    // Bricks covered by several runs of the same material were split by them.
+    grid.compact();
 }
@@ -0,0 +1,372 @@
+#include <cmath>
+
+#include <cubos/core/log.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+#include <cubos/engine/voxels/occupancy.hpp>
+
+using namespace cubos::engine;
+
+VoxelOccupancy::VoxelOccupancy()
+    : mSize{0, 0, 0}
+    , mBrickCount{0, 0, 0}
+    , mRegionCount{0, 0, 0}
+{
+    // Do nothing.
+}
+
+VoxelOccupancy::VoxelOccupancy(const VoxelGrid& grid)
+    : mSize(grid.size())
+{
+    mBrickCount = (mSize + 3U) / 4U;
+    mBricks.resize(static_cast<std::size_t>(mBrickCount.x) * mBrickCount.y * mBrickCount.z, 0);
+
+    // Only the non-empty voxels are visited, so empty bricks of the grid are skipped.
+    for (const auto& voxel : grid)
+    {
+        const auto& p = voxel.position;
+        auto bit = (p.x & 3) | ((p.y & 3) << 2) | ((p.z & 3) << 4);
+        mBricks[this->brickIndex(p / 4)] |= uint64_t{1} << bit;
+    }
+
+    this->buildRegions();
+}
+
+const glm::uvec3& VoxelOccupancy::size() const
+{
+    return mSize;
+}
+
+bool VoxelOccupancy::get(const glm::ivec3& position) const
+{
+    if (position.x < 0 || position.y < 0 || position.z < 0 || position.x >= static_cast<int>(mSize.x) ||
+        position.y >= static_cast<int>(mSize.y) || position.z >= static_cast<int>(mSize.z))
+    {
+        return false;
+    }
+
+    auto bit = (position.x & 3) | ((position.y & 3) << 2) | ((position.z & 3) << 4);
+    return ((mBricks[this->brickIndex(position / 4)] >> bit) & 1) != 0;
+}
+
+bool VoxelOccupancy::any(const glm::ivec3& min, const glm::ivec3& max) const
+{
+    return !this->visitBricks(min, max, [](const glm::ivec3& /*brick*/, uint64_t /*mask*/) { return false; });
+}
+
+bool VoxelOccupancy::findVoxel(const glm::ivec3& min, const glm::ivec3& max, glm::ivec3& voxel) const
+{
+    return !this->visitBricks(min, max, [&](const glm::ivec3& brick, uint64_t mask) {
+        auto bit = std::countr_zero(mask);
+        voxel = {brick.x * 4 + (bit & 3), brick.y * 4 + ((bit >> 2) & 3), brick.z * 4 + (bit >> 4)};
+        return false;
+    });
+}
+
+bool VoxelOccupancy::raycast(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                             VoxelHit& hit) const
+{
+    // Clip the ray against the bounds of the grid.
+    float enter = 0.0F;
+    float exit = maxDistance;
+    glm::length_t enterAxis = -1;
+    glm::ivec3 step;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        step[i] = direction[i] >= 0.0F ? 1 : -1;
+        if (direction[i] == 0.0F)
+        {
+            if (origin[i] < 0.0F || origin[i] > static_cast<float>(mSize[i]))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float near = ((direction[i] > 0.0F ? 0.0F : static_cast<float>(mSize[i])) - origin[i]) / direction[i];
+        float far = ((direction[i] > 0.0F ? static_cast<float>(mSize[i]) : 0.0F) - origin[i]) / direction[i];
+        if (near > enter)
+        {
+            enter = near;
+            enterAxis = i;
+        }
+        exit = std::min(exit, far);
+    }
+
+    if (enter > exit || mBricks.empty())
+    {
+        return false;
+    }
+
+    glm::ivec3 cell;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        cell[i] = std::clamp(static_cast<int>(std::floor(origin[i] + direction[i] * enter)), 0,
+                             static_cast<int>(mSize[i]) - 1);
+    }
+
+    float t = enter;
+    glm::vec3 normal{0.0F};
+    if (enterAxis != -1)
+    {
+        cell[enterAxis] = step[enterAxis] > 0 ? 0 : static_cast<int>(mSize[enterAxis]) - 1;
+        normal[enterAxis] = static_cast<float>(-step[enterAxis]);
+    }
+
+    // Step through the grid at the coarsest level which is empty around the current cell. Each step
+    // leaves a cell of that level through one of its faces, and moves the other coordinates along
+    // the ray, without ever moving them backwards or out of the cell they were in.
+    while (true)
+    {
+        auto brick = cell / 4;
+        int level;
+        if (mRegions[this->regionIndex(brick / 4)] == 0)
+        {
+            level = 16;
+        }
+        else if (mBricks[this->brickIndex(brick)] == 0)
+        {
+            level = 4;
+        }
+        else if (this->get(cell))
+        {
+            hit.voxel = cell;
+            hit.normal = normal;
+            hit.distance = t;
+            return true;
+        }
+        else
+        {
+            level = 1;
+        }
+
+        glm::length_t axis = 0;
+        float next = INFINITY;
+        for (glm::length_t i = 0; i < 3; ++i)
+        {
+            if (direction[i] != 0.0F)
+            {
+                int boundary = (cell[i] / level + (step[i] > 0 ? 1 : 0)) * level;
+                float candidate = (static_cast<float>(boundary) - origin[i]) / direction[i];
+                if (candidate < next)
+                {
+                    next = candidate;
+                    axis = i;
+                }
+            }
+        }
+
+        if (std::isinf(next) || next > exit)
+        {
+            return false;
+        }
+
+        for (glm::length_t i = 0; i < 3; ++i)
+        {
+            if (i == axis)
+            {
+                cell[i] = (cell[i] / level + (step[i] > 0 ? 1 : 0)) * level - (step[i] > 0 ? 0 : 1);
+            }
+            else if (level > 1 && direction[i] != 0.0F)
+            {
+                int moved = static_cast<int>(std::floor(origin[i] + direction[i] * next));
+                moved = step[i] > 0 ? std::max(moved, cell[i]) : std::min(moved, cell[i]);
+                int first = cell[i] / level * level;
+                cell[i] = std::clamp(moved, first, std::min(first + level, static_cast<int>(mSize[i])) - 1);
+            }
+        }
+
+        if (cell[axis] < 0 || cell[axis] >= static_cast<int>(mSize[axis]))
+        {
+            return false;
+        }
+
+        t = next;
+        normal = glm::vec3{0.0F};
+        normal[axis] = static_cast<float>(-step[axis]);
+    }
+}
+
+bool VoxelOccupancy::boxcast(const glm::vec3& halfSize, const glm::vec3& origin, const glm::vec3& direction,
+                             float maxDistance, VoxelHit& hit) const
+{
+    auto lo = origin - halfSize;
+    auto hi = origin + halfSize;
+
+    // For each axis, the voxel layers the box has entered so far go up to, but exclude, the next
+    // layer boundary its leading face crosses. Boundaries are tracked as integers so that layers
+    // entered at the same time on different axes are never missed.
+    glm::ivec3 boundary{0, 0, 0};
+    glm::ivec3 min;
+    glm::ivec3 max;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        min[i] = static_cast<int>(std::floor(lo[i]));
+        max[i] = static_cast<int>(std::ceil(hi[i]));
+        if (direction[i] > 0.0F)
+        {
+            boundary[i] = std::max(max[i], 0);
+        }
+        else if (direction[i] < 0.0F)
+        {
+            boundary[i] = std::min(min[i], static_cast<int>(mSize[i]));
+        }
+    }
+
+    if (this->findVoxel(min, max, hit.voxel))
+    {
+        hit.normal = glm::vec3{0.0F};
+        hit.distance = 0.0F;
+        return true;
+    }
+
+    while (true)
+    {
+        // Find the next boundary crossed by a leading face.
+        glm::length_t axis = 0;
+        float t = INFINITY;
+        for (glm::length_t i = 0; i < 3; ++i)
+        {
+            bool inside = direction[i] > 0.0F ? boundary[i] < static_cast<int>(mSize[i]) : boundary[i] > 0;
+            if (direction[i] != 0.0F && inside)
+            {
+                float face = direction[i] > 0.0F ? hi[i] : lo[i];
+                float candidate = std::max((static_cast<float>(boundary[i]) - face) / direction[i], 0.0F);
+                if (candidate < t)
+                {
+                    t = candidate;
+                    axis = i;
+                }
+            }
+        }
+
+        if (std::isinf(t) || t > maxDistance)
+        {
+            return false;
+        }
+
+        // Check the newly entered layer, over the range of voxels the box covers on other axes.
+        for (glm::length_t i = 0; i < 3; ++i)
+        {
+            if (i == axis)
+            {
+                min[i] = direction[i] > 0.0F ? boundary[i] : boundary[i] - 1;
+                max[i] = min[i] + 1;
+            }
+            else if (direction[i] > 0.0F)
+            {
+                min[i] = static_cast<int>(std::floor(lo[i] + direction[i] * t));
+                max[i] = boundary[i];
+            }
+            else if (direction[i] < 0.0F)
+            {
+                min[i] = boundary[i];
+                max[i] = static_cast<int>(std::ceil(hi[i] + direction[i] * t));
+            }
+            else
+            {
+                min[i] = static_cast<int>(std::floor(lo[i]));
+                max[i] = static_cast<int>(std::ceil(hi[i]));
+            }
+        }
+
+        if (this->findVoxel(min, max, hit.voxel))
+        {
+            hit.normal = glm::vec3{0.0F};
+            hit.normal[axis] = direction[axis] > 0.0F ? -1.0F : 1.0F;
+            hit.distance = t;
+            return true;
+        }
+
+        boundary[axis] += direction[axis] > 0.0F ? 1 : -1;
+    }
+}
+
+uint64_t VoxelOccupancy::rangeMask(const glm::ivec3& brick, const glm::ivec3& min, const glm::ivec3& max)
+{
+    // Get the 4-bit masks of the coordinates within the range on each axis.
+    unsigned int axes[3];
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        int lo = std::clamp(min[i] - brick[i] * 4, 0, 4);
+        int hi = std::clamp(max[i] - brick[i] * 4, 0, 4);
+        axes[i] = ((1U << hi) - 1U) & ~((1U << lo) - 1U);
+    }
+
+    if (axes[0] == 0xF && axes[1] == 0xF && axes[2] == 0xF)
+    {
+        return ~uint64_t{0};
+    }
+
+    // Spread each axis mask over the bits of the brick.
+    uint64_t x = axes[0] * 0x1111111111111111ULL;
+    uint64_t y = 0;
+    uint64_t z = 0;
+    for (unsigned int i = 0; i < 4; ++i)
+    {
+        y |= ((axes[1] >> i) & 1U) != 0 ? 0x000F000F000F000FULL << (4 * i) : 0;
+        z |= ((axes[2] >> i) & 1U) != 0 ? 0xFFFFULL << (16 * i) : 0;
+    }
+    return x & y & z;
+}
+
+std::size_t VoxelOccupancy::brickIndex(const glm::ivec3& brick) const
+{
+    return static_cast<std::size_t>(brick.x) +
+           static_cast<std::size_t>(mBrickCount.x) *
+               (static_cast<std::size_t>(brick.y) + static_cast<std::size_t>(mBrickCount.y) * brick.z);
+}
+
+std::size_t VoxelOccupancy::regionIndex(const glm::ivec3& region) const
+{
+    return static_cast<std::size_t>(region.x) +
+           static_cast<std::size_t>(mRegionCount.x) *
+               (static_cast<std::size_t>(region.y) + static_cast<std::size_t>(mRegionCount.y) * region.z);
+}
+
+void VoxelOccupancy::buildRegions()
+{
+    mRegionCount = (mBrickCount + 3U) / 4U;
+    mRegions.assign(static_cast<std::size_t>(mRegionCount.x) * mRegionCount.y * mRegionCount.z, 0);
+    for (int z = 0; z < static_cast<int>(mBrickCount.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(mBrickCount.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(mBrickCount.x); ++x)
+            {
+                if (mBricks[this->brickIndex({x, y, z})] != 0)
+                {
+                    auto bit = (x & 3) | ((y & 3) << 2) | ((z & 3) << 4);
+                    mRegions[this->regionIndex({x / 4, y / 4, z / 4})] |= uint64_t{1} << bit;
+                }
+            }
+        }
+    }
+}
+
+void cubos::core::data::old::serialize(Serializer& serializer, const VoxelOccupancy& occupancy, const char* name)
+{
+    serializer.beginObject(name);
+    serializer.write(occupancy.mSize, "size");
+    serializer.write(occupancy.mBricks, "bricks");
+    serializer.endObject();
+}
+
+void cubos::core::data::old::deserialize(Deserializer& deserializer, VoxelOccupancy& occupancy)
+{
+    deserializer.beginObject();
+    deserializer.read(occupancy.mSize);
+    deserializer.read(occupancy.mBricks);
+    deserializer.endObject();
+
+    occupancy.mBrickCount = (occupancy.mSize + 3U) / 4U;
+    if (occupancy.mBricks.size() != static_cast<std::size_t>(occupancy.mBrickCount.x) * occupancy.mBrickCount.y *
+                                        occupancy.mBrickCount.z)
+    {
+        CUBOS_WARN("Occupancy size and bricks size mismatch: was ({}, {}, {}), bricks size is {}.", occupancy.mSize.x,
+                   occupancy.mSize.y, occupancy.mSize.z, occupancy.mBricks.size());
+        occupancy = VoxelOccupancy{};
+    }
+
+    occupancy.buildRegions();
+}
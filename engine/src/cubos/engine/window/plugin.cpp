@@ -10,9 +10,11 @@ using cubos::core::io::WindowEvent;
 
 using namespace cubos::engine;
 
-static void init(Write<Window> window, Write<ShouldQuit> quit, Write<Settings> settings)
+static void init(Write<Window> window, Write<ShouldQuit> quit, Write<MaxFrameRate> maxFrameRate,
+                 Write<Settings> settings)
 {
     quit->value = false;
+    maxFrameRate->value = static_cast<float>(settings->getDouble("window.maxFrameRate", 0.0));
     *window = openWindow(settings->getString("window.title", "CUBOS."),
                          {settings->getInteger("window.width", 800), settings->getInteger("window.height", 600)});
 }
@@ -43,8 +45,9 @@ void cubos::engine::windowPlugin(Cubos& cubos)
     cubos.addResource<Window>();
     cubos.addEvent<WindowEvent>();
 
-    cubos.startupTag("cubos.window.init").after("cubos.settings");
-    cubos.tag("cubos.window.poll").before("cubos.window.render");
+    cubos.startupTag("cubos.window.init").after("cubos.settings").onMainThread();
+    cubos.tag("cubos.window.poll").before("cubos.window.render").onMainThread();
+    cubos.tag("cubos.window.render").onMainThread();
 
     cubos.startupSystem(init).tagged("cubos.window.init");
     cubos.system(poll).tagged("cubos.window.poll");
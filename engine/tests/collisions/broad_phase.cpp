@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <set>
+#include <utility>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/collisions/aabb.hpp>
+#include <cubos/engine/collisions/broad_phase_collisions.hpp>
+#include <cubos/engine/collisions/colliders/box.hpp>
+#include <cubos/engine/collisions/colliders/plane.hpp>
+#include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+using cubos::core::geom::Box;
+using cubos::core::geom::Plane;
+using namespace cubos::engine;
+
+using CollisionType = BroadPhaseCollisions::CollisionType;
+
+/// @brief Number of frames which have run, and the pairs of colliders reported to overlap by the
+/// sweep and prune events.
+struct Frame
+{
+    int count = 0;
+    std::set<std::pair<uint32_t, uint32_t>> overlaps;
+    Entity first;
+};
+
+/// @brief Orders the indices of the entities of a pair.
+static std::pair<uint32_t, uint32_t> indices(const BroadPhaseCollisions::Candidate& candidate)
+{
+    return {std::min(candidate.first.index, candidate.second.index),
+            std::max(candidate.first.index, candidate.second.index)};
+}
+
+static void setup(Commands commands, Write<Frame> frame)
+{
+    // A row of boxes where each box overlaps only its neighbours.
+    for (int i = 0; i < 8; ++i)
+    {
+        auto entity = commands
+                          .create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}},
+                                  Position{{0.75F * static_cast<float>(i), 0.0F, 0.0F}})
+                          .entity();
+        if (i == 0)
+        {
+            frame->first = entity;
+        }
+    }
+
+    // A box spanning many cells, another which spans too many to be hashed, and an infinite plane.
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{1.5F}}}, Position{{3.0F, 1.0F, 0.0F}});
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{6.0F}}}, Position{{-8.0F, 0.0F, 0.0F}});
+    commands.create(PlaneCollider{glm::vec3{0.0F}, Plane{glm::vec3{0.0F, 1.0F, 0.0F}}});
+}
+
+static void useSpatialHash(Write<BroadPhaseCollisions> collisions)
+{
+    collisions->method = BroadPhaseCollisions::Method::SpatialHash;
+    collisions->cellSize = 1.0F;
+}
+
+static void switchToSweepAndPrune(Write<BroadPhaseCollisions> collisions, Read<Frame> frame)
+{
+    if (frame->count == 1)
+    {
+        collisions->method = BroadPhaseCollisions::Method::SweepAndPrune;
+    }
+}
+
+static void check(Write<Frame> frame, Write<ShouldQuit> quit, Read<BroadPhaseCollisions> collisions,
+                  Query<Read<ColliderAABB>> query, Query<Write<Position>> positions)
+{
+    for (const auto& candidate : collisions->overlapsBegan)
+    {
+        CHECK(frame->overlaps.insert(indices(candidate)).second);
+    }
+
+    for (const auto& candidate : collisions->overlapsEnded)
+    {
+        CHECK(frame->overlaps.erase(indices(candidate)) == 1);
+    }
+
+    // Wait for the AABBs of the new colliders to be computed, and then for the moved box.
+    quit->value = false;
+    switch (frame->count++)
+    {
+    case 2:
+        std::get<0>(*positions[frame->first])->vec = {-1.0F, 20.0F, 0.0F};
+        break;
+    case 4:
+        quit->value = true;
+        break;
+    default:
+        return;
+    }
+
+    std::set<std::pair<uint32_t, uint32_t>> expected;
+    std::size_t colliders = 0;
+    for (auto [a, aAabb] : query)
+    {
+        colliders += 1;
+        for (auto [b, bAabb] : query)
+        {
+            if (a.index < b.index && aAabb->overlaps(*bAabb))
+            {
+                expected.emplace(a.index, b.index);
+            }
+        }
+    }
+
+    std::set<std::pair<uint32_t, uint32_t>> found;
+    std::size_t count = 0;
+    for (std::size_t type = 0; type < static_cast<std::size_t>(CollisionType::Count); ++type)
+    {
+        for (const auto& candidate : collisions->candidates(static_cast<CollisionType>(type)))
+        {
+            found.insert(indices(candidate));
+            count += 1;
+        }
+    }
+
+    CHECK(expected.size() > 10);
+    CHECK(found == expected);
+    CHECK(count == found.size()); // No pair was reported twice.
+    CHECK(collisions->candidates(CollisionType::BoxPlane).size() == 10);
+
+    if (collisions->method == BroadPhaseCollisions::Method::SweepAndPrune)
+    {
+        CHECK(frame->overlaps == expected);
+    }
+    else
+    {
+        // Sweep and prune mustn't keep tracking colliders while it isn't used.
+        CHECK(collisions->sweepSlots.empty());
+        CHECK(collisions->addedSweepSlots.empty());
+        CHECK(collisions->sweepColliders.size() <= colliders);
+    }
+}
+
+TEST_CASE("collisions.broad")
+{
+    auto cubos = Cubos{};
+    cubos.addPlugin(collisionsPlugin);
+    cubos.addResource<Frame>();
+    cubos.startupSystem(setup);
+
+    SUBCASE("sweep and prune")
+    {
+    }
+
+    SUBCASE("spatial hash")
+    {
+        cubos.startupSystem(useSpatialHash);
+    }
+
+    SUBCASE("spatial hash, and then sweep and prune")
+    {
+        cubos.startupSystem(useSpatialHash);
+        cubos.system(switchToSweepAndPrune).before("cubos.collisions.broad");
+    }
+
+    cubos.system(check).after("cubos.collisions.broad");
+    cubos.run();
+}
@@ -0,0 +1,196 @@
+#include <cmath>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cubos/engine/collisions/colliders/box.hpp>
+#include <cubos/engine/collisions/colliders/capsule.hpp>
+#include <cubos/engine/collisions/colliders/plane.hpp>
+#include <cubos/engine/collisions/colliders/simplex.hpp>
+#include <cubos/engine/collisions/colliders/voxel.hpp>
+#include <cubos/engine/collisions/collision_event.hpp>
+#include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::EventReader;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+using cubos::core::geom::Box;
+using cubos::core::geom::Capsule;
+using cubos::core::geom::Plane;
+using cubos::core::geom::Simplex;
+using namespace cubos::engine;
+
+using CollisionType = BroadPhaseCollisions::CollisionType;
+
+/// @brief Number of frames which have run.
+struct Frame
+{
+    int count = 0;
+};
+
+static void setup(Commands commands)
+{
+    // Each pair is far away from the others, and only the first box touches the plane.
+    commands.create(PlaneCollider{glm::vec3{0.0F}, Plane{glm::vec3{0.0F, 1.0F, 0.0F}}});
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{0.0F, 0.45F, 0.0F}});
+
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{10.0F, 10.0F, 0.0F}});
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{10.9F, 10.0F, 0.0F}});
+
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{20.0F, 10.0F, 0.0F}});
+    commands.create(CapsuleCollider{glm::mat4{1.0F}, Capsule{0.5F, 1.0F}}, Position{{20.9F, 10.0F, 0.0F}});
+
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{30.0F, 10.0F, 0.0F}});
+    commands.create(SimplexCollider{glm::vec3{0.0F}, Simplex::tetrahedron({0.3F, 0.0F, 0.0F}, {2.0F, 1.0F, 0.0F},
+                                                                          {2.0F, -1.0F, 1.0F}, {2.0F, -1.0F, -1.0F})},
+                    Position{{30.0F, 10.0F, 0.0F}});
+
+    commands.create(CapsuleCollider{glm::mat4{1.0F}, Capsule{0.5F, 1.0F}}, Position{{40.0F, 10.0F, 0.0F}});
+    commands.create(CapsuleCollider{glm::mat4{1.0F}, Capsule{0.5F, 1.0F}}, Position{{40.8F, 10.0F, 0.0F}});
+
+    // A box resting on the corner where four voxels of a flat grid meet.
+    VoxelGrid grid{{4, 1, 4}};
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int z = 0; z < 4; ++z)
+        {
+            grid.set({x, 0, z}, 1);
+        }
+    }
+    auto transform = glm::translate(glm::mat4{1.0F}, glm::vec3{-2.0F, -1.0F, -2.0F});
+    commands.create(VoxelCollider{transform, VoxelOccupancy{grid}}, Position{{50.0F, 10.0F, 0.0F}});
+    commands.create(BoxCollider{glm::mat4{1.0F}, Box{glm::vec3{0.5F}}}, Position{{50.0F, 10.45F, 0.0F}});
+
+    // Two copies of the flat grid, one sinking into the other.
+    commands.create(VoxelCollider{transform, VoxelOccupancy{grid}}, Position{{70.0F, 10.0F, 0.0F}});
+    commands.create(VoxelCollider{transform, VoxelOccupancy{grid}}, Position{{70.0F, 10.95F, 0.0F}});
+
+    // A rotated solid cube sinking into the plane, where only its bottom layer touches it.
+    VoxelGrid cube{{8, 8, 8}};
+    for (int x = 0; x < 8; ++x)
+    {
+        for (int y = 0; y < 8; ++y)
+        {
+            for (int z = 0; z < 8; ++z)
+            {
+                cube.set({x, y, z}, 1);
+            }
+        }
+    }
+    transform = glm::translate(glm::mat4{1.0F}, glm::vec3{0.0F, -0.05F, 0.0F}) *
+                glm::rotate(glm::mat4{1.0F}, glm::radians(90.0F), glm::vec3{0.0F, 0.0F, 1.0F});
+    commands.create(VoxelCollider{transform, VoxelOccupancy{cube}}, Position{{60.0F, 0.0F, 0.0F}});
+}
+
+/// @brief Finds the single event of the given type received on the last frame.
+static const CollisionEvent& find(const std::vector<CollisionEvent>& events, CollisionType type)
+{
+    const CollisionEvent* found = nullptr;
+    for (const auto& event : events)
+    {
+        if (event.type == type)
+        {
+            REQUIRE(found == nullptr);
+            found = &event;
+        }
+    }
+
+    REQUIRE(found != nullptr);
+    return *found;
+}
+
+static void check(Write<ShouldQuit> quit, Write<Frame> frame, EventReader<CollisionEvent> reader,
+                  Query<Read<Position>> positions)
+{
+    std::vector<CollisionEvent> events;
+    for (const auto& event : reader)
+    {
+        events.push_back(event);
+    }
+
+    // Wait for the AABBs of the new colliders to be computed.
+    quit->value = false;
+    if (frame->count++ != 2)
+    {
+        return;
+    }
+    quit->value = true;
+
+    CHECK(events.size() == 8);
+
+    // The box sinks 0.05 into the plane, plus its margin.
+    const auto& boxPlane = find(events, CollisionType::BoxPlane);
+    CHECK(boxPlane.pointCount == 4);
+    CHECK(boxPlane.penetration == doctest::Approx(0.09F));
+    CHECK(boxPlane.normal.y == doctest::Approx(-1.0F));
+    for (std::size_t i = 0; i < boxPlane.pointCount; ++i)
+    {
+        CHECK(boxPlane.points[i].penetration == doctest::Approx(0.09F));
+    }
+
+    // The boxes overlap by 0.1, plus both margins, along the X axis.
+    const auto& boxBox = find(events, CollisionType::BoxBox);
+    CHECK(boxBox.pointCount == 4);
+    CHECK(boxBox.penetration == doctest::Approx(0.18F));
+    CHECK(std::abs(boxBox.normal.x) == doctest::Approx(1.0F));
+
+    // The normal always points from the first to the second entity.
+    auto first = std::get<0>(*positions[boxBox.entity])->vec;
+    auto second = std::get<0>(*positions[boxBox.other])->vec;
+    CHECK(glm::dot(boxBox.normal, second - first) > 0.0F);
+
+    // The capsule's segment is 0.4 away from the box's core.
+    const auto& boxCapsule = find(events, CollisionType::BoxCapsule);
+    CHECK(boxCapsule.pointCount == 1);
+    CHECK(boxCapsule.penetration == doctest::Approx(0.14F).epsilon(0.01));
+    CHECK(boxCapsule.normal.x == doctest::Approx(1.0F).epsilon(0.01));
+
+    // The tip of the tetrahedron is 0.2 inside the box's core, which is found through EPA.
+    const auto& boxSimplex = find(events, CollisionType::BoxSimplex);
+    CHECK(boxSimplex.pointCount == 1);
+    CHECK(boxSimplex.penetration == doctest::Approx(0.28F).epsilon(0.01));
+    CHECK(boxSimplex.normal.x == doctest::Approx(1.0F).epsilon(0.01));
+
+    const auto& capsuleCapsule = find(events, CollisionType::CapsuleCapsule);
+    CHECK(capsuleCapsule.pointCount == 1);
+    CHECK(capsuleCapsule.penetration == doctest::Approx(0.2F));
+    CHECK(std::abs(capsuleCapsule.normal.x) == doctest::Approx(1.0F));
+
+    // The contacts of the four voxels under the box are merged into a single flat manifold.
+    const auto& boxVoxel = find(events, CollisionType::BoxVoxel);
+    CHECK(boxVoxel.pointCount == 4);
+    CHECK(boxVoxel.penetration == doctest::Approx(0.13F));
+    CHECK(boxVoxel.normal.y == doctest::Approx(-1.0F));
+
+    // The grids overlap by 0.05, plus both margins, and only the voxels above each other are
+    // deep enough to matter.
+    const auto& voxelVoxel = find(events, CollisionType::VoxelVoxel);
+    CHECK(voxelVoxel.pointCount == 4);
+    CHECK(voxelVoxel.penetration == doctest::Approx(0.13F));
+    CHECK(std::abs(voxelVoxel.normal.y) == doctest::Approx(1.0F));
+    first = std::get<0>(*positions[voxelVoxel.entity])->vec;
+    second = std::get<0>(*positions[voxelVoxel.other])->vec;
+    CHECK(glm::dot(voxelVoxel.normal, second - first) > 0.0F);
+
+    // The cube sinks 0.05 into the plane, plus the margin of its voxels.
+    const auto& planeVoxel = find(events, CollisionType::PlaneVoxel);
+    CHECK(planeVoxel.pointCount == 4);
+    CHECK(planeVoxel.penetration == doctest::Approx(0.09F));
+    CHECK(std::abs(planeVoxel.normal.y) == doctest::Approx(1.0F));
+}
+
+TEST_CASE("collisions.narrow")
+{
+    auto cubos = Cubos{};
+    cubos.addPlugin(collisionsPlugin);
+    cubos.addResource<Frame>();
+    cubos.startupSystem(setup);
+    cubos.system(check).after("cubos.collisions");
+    cubos.run();
+}
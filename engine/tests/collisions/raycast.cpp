@@ -0,0 +1,117 @@
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cubos/engine/collisions/colliders/voxel.hpp>
+#include <cubos/engine/collisions/plugin.hpp>
+#include <cubos/engine/collisions/raycast.hpp>
+#include <cubos/engine/transform/plugin.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::Write;
+using namespace cubos::engine;
+
+/// @brief Number of frames which have run, and the entities of the colliders.
+struct Frame
+{
+    int count = 0;
+    Entity floor;
+    Entity cube;
+};
+
+static void setup(Commands commands, Write<Frame> frame)
+{
+    // A 16x16 floor whose top is at y = 0, with a single solid voxel above its center.
+    VoxelGrid floor{{16, 2, 16}};
+    for (int x = 0; x < 16; ++x)
+    {
+        for (int z = 0; z < 16; ++z)
+        {
+            floor.set({x, 0, z}, 1);
+        }
+    }
+    floor.set({8, 1, 8}, 1);
+    auto transform = glm::translate(glm::mat4{1.0F}, glm::vec3{-8.0F, -1.0F, -8.0F});
+    frame->floor =
+        commands.create(VoxelCollider{transform, VoxelOccupancy{floor}}, Position{{0.0F, 0.0F, 0.0F}}).entity();
+
+    // A solid cube with half sized voxels, spanning from (20, 0, 0) to (22, 2, 2).
+    VoxelGrid cube{{4, 4, 4}};
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 4; ++y)
+        {
+            for (int z = 0; z < 4; ++z)
+            {
+                cube.set({x, y, z}, 1);
+            }
+        }
+    }
+    frame->cube = commands.create(VoxelCollider{glm::mat4{1.0F}, VoxelOccupancy{cube}}, Position{{20.0F, 0.0F, 0.0F}},
+                                  Scale{0.5F})
+                      .entity();
+}
+
+static void check(Write<ShouldQuit> quit, Write<Frame> frame, VoxelColliderQuery query)
+{
+    // Wait for the transforms of the new colliders to be computed.
+    quit->value = false;
+    if (frame->count++ != 1)
+    {
+        return;
+    }
+    quit->value = true;
+
+    RaycastHit hit;
+
+    // Straight down onto the floor, which is found even though the ray starts far away.
+    REQUIRE(raycast(query, {3.5F, 10.0F, 3.5F}, {0.0F, -1.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.entity == frame->floor);
+    CHECK(hit.voxel == glm::ivec3{11, 0, 11});
+    CHECK(hit.distance == doctest::Approx(10.0F));
+    CHECK(hit.normal.y == doctest::Approx(1.0F));
+
+    // Too short to reach the floor.
+    CHECK_FALSE(raycast(query, {3.5F, 10.0F, 3.5F}, {0.0F, -1.0F, 0.0F}, 9.0F, hit));
+
+    // Sideways into the voxel above the floor's center.
+    REQUIRE(raycast(query, {-5.0F, 0.5F, 0.5F}, {1.0F, 0.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.voxel == glm::ivec3{8, 1, 8});
+    CHECK(hit.distance == doctest::Approx(5.0F));
+    CHECK(hit.normal.x == doctest::Approx(-1.0F));
+    CHECK(hit.point.x == doctest::Approx(0.0F));
+
+    // The closest of both grids is hit, and distances account for the cube's scale.
+    REQUIRE(raycast(query, {21.0F, 10.0F, 1.0F}, {0.0F, -1.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.entity == frame->cube);
+    CHECK(hit.distance == doctest::Approx(8.0F));
+    CHECK(hit.normal.y == doctest::Approx(1.0F));
+
+    // A box falling next to the voxel above the center lands on the floor, while a wider one
+    // lands on that voxel.
+    REQUIRE(boxcast(query, glm::vec3{0.4F}, {1.5F, 5.0F, 0.5F}, {0.0F, -1.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.entity == frame->floor);
+    CHECK(hit.distance == doctest::Approx(4.6F));
+    CHECK(hit.normal.y == doctest::Approx(1.0F));
+
+    REQUIRE(boxcast(query, glm::vec3{0.6F}, {1.5F, 5.0F, 0.5F}, {0.0F, -1.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.voxel == glm::ivec3{8, 1, 8});
+    CHECK(hit.distance == doctest::Approx(3.4F));
+
+    // A box which starts overlapping the floor hits it right away.
+    REQUIRE(boxcast(query, glm::vec3{0.5F}, {3.5F, 0.0F, 3.5F}, {1.0F, 0.0F, 0.0F}, 100.0F, hit));
+    CHECK(hit.distance == 0.0F);
+    CHECK(hit.normal == glm::vec3{0.0F});
+}
+
+TEST_CASE("collisions.raycast")
+{
+    auto cubos = Cubos{};
+    cubos.addPlugin(collisionsPlugin);
+    cubos.addResource<Frame>();
+    cubos.startupSystem(setup);
+    cubos.system(check).after("cubos.transform.update");
+    cubos.run();
+}
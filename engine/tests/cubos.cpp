@@ -0,0 +1,56 @@
+#include <cmath>
+
+#include <doctest/doctest.h>
+
+#include <cubos/engine/cubos.hpp>
+
+using cubos::engine::FixedDeltaTime;
+
+TEST_CASE("cubos.fixed")
+{
+    FixedDeltaTime fixed{0.25F, 4};
+    float accumulator = 0.0F;
+
+    SUBCASE("runs one step for each step duration which passed")
+    {
+        accumulator = 0.6F;
+        CHECK(fixed.take(accumulator) == 2);
+        CHECK(accumulator == doctest::Approx(0.1F));
+        CHECK(fixed.alpha(accumulator) == doctest::Approx(0.4F));
+
+        // The time left over is carried to the next frame.
+        accumulator += 0.2F;
+        CHECK(fixed.take(accumulator) == 1);
+        CHECK(accumulator == doctest::Approx(0.05F));
+    }
+
+    SUBCASE("runs no steps if not enough time passed")
+    {
+        accumulator = 0.2F;
+        CHECK(fixed.take(accumulator) == 0);
+        CHECK(accumulator == doctest::Approx(0.2F));
+        CHECK(fixed.alpha(accumulator) == doctest::Approx(0.8F));
+    }
+
+    SUBCASE("caps the steps and drops the time left behind")
+    {
+        accumulator = 1.6F;
+        CHECK(fixed.take(accumulator) == 4);
+        CHECK(accumulator == doctest::Approx(0.1F));
+        CHECK(fixed.alpha(accumulator) == doctest::Approx(0.4F));
+    }
+
+    SUBCASE("runs no steps if the step duration isn't positive")
+    {
+        fixed.value = 0.0F;
+        accumulator = 1.0F;
+        CHECK(fixed.take(accumulator) == 0);
+        CHECK(accumulator == 0.0F);
+        CHECK(fixed.alpha(accumulator) == 0.0F);
+
+        fixed.value = -1.0F;
+        accumulator = 1.0F;
+        CHECK(fixed.take(accumulator) == 0);
+        CHECK_FALSE(std::isnan(fixed.alpha(accumulator)));
+    }
+}
@@ -0,0 +1,102 @@
+#include <cmath>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cubos/engine/renderer/frame.hpp>
+
+using cubos::engine::PointLight;
+using cubos::engine::RendererFrame;
+using cubos::engine::RendererGrid;
+
+/// @brief Stand-in for a grid uploaded by a renderer.
+struct FakeGrid : cubos::engine::impl::RendererGrid
+{
+};
+
+TEST_CASE("renderer.frame")
+{
+    RendererGrid a = std::make_shared<FakeGrid>();
+    RendererGrid b = std::make_shared<FakeGrid>();
+
+    SUBCASE("draws are grouped by grid")
+    {
+        // Draws of the same grid end up in the same batch, in the order they were submitted.
+        RendererFrame frame{};
+        frame.draw(a, glm::mat4{1.0F});
+        frame.draw(b, glm::mat4{2.0F});
+        frame.draw(a, glm::mat4{3.0F});
+        frame.draw(a, glm::mat4{4.0F});
+        CHECK(frame.instanceCount() == 4);
+
+        const auto& batches = frame.drawBatches();
+        REQUIRE(batches.size() == 2);
+        CHECK(batches[0].grid == a);
+        REQUIRE(batches[0].instances.size() == 3);
+        CHECK(batches[0].instances[0] == glm::mat4{1.0F});
+        CHECK(batches[0].instances[1] == glm::mat4{3.0F});
+        CHECK(batches[0].instances[2] == glm::mat4{4.0F});
+        CHECK(batches[1].grid == b);
+        REQUIRE(batches[1].instances.size() == 1);
+        CHECK(batches[1].instances[0] == glm::mat4{2.0F});
+
+        frame.clear();
+        CHECK(frame.drawBatches().empty());
+        CHECK(frame.instanceCount() == 0);
+
+        frame.draw(b, glm::mat4{5.0F});
+        REQUIRE(frame.drawBatches().size() == 1);
+        CHECK(frame.drawBatches()[0].grid == b);
+    }
+
+    SUBCASE("culling and levels of detail")
+    {
+        // An 8x8x8 grid with a coarser version of itself.
+        a->min = glm::vec3{0.0F};
+        a->max = glm::vec3{8.0F};
+        a->lod = b;
+        b->min = glm::vec3{0.0F};
+        b->max = glm::vec3{4.0F};
+
+        RendererFrame frame{};
+        frame.light(glm::mat4{1.0F}, PointLight{});
+        auto near = glm::translate(glm::mat4{1.0F}, glm::vec3{-4.0F, -4.0F, -20.0F});
+        auto behind = glm::translate(glm::mat4{1.0F}, glm::vec3{-4.0F, -4.0F, 20.0F});
+        auto aside = glm::translate(glm::mat4{1.0F}, glm::vec3{100.0F, -4.0F, -20.0F});
+        auto far = glm::translate(glm::mat4{1.0F}, glm::vec3{-4.0F, -4.0F, -95.0F});
+        frame.draw(a, near);
+        frame.draw(a, behind);
+        frame.draw(a, aside);
+        frame.draw(a, far);
+
+        // The camera looks down the -Z axis, and each voxel of the far instance is about half a pixel tall.
+        auto projection = glm::perspective(glm::radians(90.0F), 1.0F, 0.1F, 100.0F);
+        RendererFrame culled{};
+        culled.cull(frame, glm::mat4{1.0F}, projection, 100.0F, 0.0F);
+        CHECK(culled.pointLights().size() == 1);
+        REQUIRE(culled.drawBatches().size() == 1);
+        CHECK(culled.drawBatches()[0].grid == a);
+        REQUIRE(culled.drawBatches()[0].instances.size() == 2);
+        CHECK(culled.drawBatches()[0].instances[0] == near);
+        CHECK(culled.drawBatches()[0].instances[1] == far);
+
+        // Voxels of the coarser grid would still be less than two pixels tall.
+        culled.cull(frame, glm::mat4{1.0F}, projection, 100.0F, 2.0F);
+        REQUIRE(culled.drawBatches().size() == 2);
+        CHECK(culled.drawBatches()[0].grid == a);
+        CHECK(culled.drawBatches()[0].instances[0] == near);
+        CHECK(culled.drawBatches()[1].grid == b);
+        CHECK(culled.drawBatches()[1].instances[0] == glm::scale(far, glm::vec3{2.0F}));
+
+        // The coarser grid is picked once its voxels are exactly as large as the threshold, and not before.
+        float distance = 91.0F - glm::length(glm::vec3{4.0F});
+        float pixels = 1.0F * (projection[1][1] * 100.0F * 0.5F) / distance;
+        culled.cull(frame, glm::mat4{1.0F}, projection, 100.0F, pixels * 2.0F);
+        REQUIRE(culled.drawBatches().size() == 2);
+        CHECK(culled.drawBatches()[1].grid == b);
+        culled.cull(frame, glm::mat4{1.0F}, projection, 100.0F, std::nextafter(pixels * 2.0F, 0.0F));
+        REQUIRE(culled.drawBatches().size() == 1);
+        CHECK(culled.drawBatches()[0].grid == a);
+    }
+}
@@ -0,0 +1,174 @@
+#include <map>
+#include <utility>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/renderer/mesher.hpp>
+
+using cubos::engine::GridMesher;
+using cubos::engine::triangulate;
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelMesh;
+using cubos::engine::VoxelVertex;
+
+/// @brief Area covered by the faces of a mesh, for each face direction and material.
+using FaceAreas = std::map<std::pair<uint16_t, uint16_t>, uint32_t>;
+
+/// @brief Adds the area of the faces of a mesh to a map.
+/// @param mesh Mesh, made of quads.
+/// @param areas Areas to add to.
+static void addAreas(const VoxelMesh& mesh, FaceAreas& areas)
+{
+    for (std::size_t i = 0; i < mesh.vertices.size(); i += 4)
+    {
+        const auto& vertex = mesh.vertices[i];
+        auto extent = glm::abs(glm::ivec3{mesh.vertices[i + 2].unpackPosition()} - glm::ivec3{vertex.unpackPosition()});
+        extent[vertex.face / 2] = 1;
+        areas[{vertex.face, vertex.material}] += static_cast<uint32_t>(extent.x * extent.y * extent.z);
+    }
+}
+
+TEST_CASE("renderer.mesher")
+{
+    // Spans 3x1x2 chunks, with partial chunks at the end of the X and Z axes.
+    glm::uvec3 size{70, 20, 40};
+    VoxelGrid grid{size};
+    for (int x = 0; x < static_cast<int>(size.x); ++x)
+    {
+        for (int z = 0; z < static_cast<int>(size.z); ++z)
+        {
+            for (int y = 0; y <= (x * z) % static_cast<int>(size.y); ++y)
+            {
+                grid.set({x, y, z}, static_cast<uint16_t>(1 + (x + y) % 3));
+            }
+        }
+    }
+
+    std::vector<glm::ivec3> chunks;
+    for (int z = 0; z < 2; ++z)
+    {
+        for (int x = 0; x < 3; ++x)
+        {
+            chunks.push_back(glm::ivec3{x, 0, z} * GridMesher::ChunkSize);
+        }
+    }
+
+    GridMesher mesher{};
+    mesher.setThreadCount(2);
+
+    SUBCASE("chunks cover the same faces as the whole grid")
+    {
+        VoxelMesh whole;
+        triangulate(grid, whole.vertices, whole.indices);
+        REQUIRE_FALSE(whole.indices.empty());
+        FaceAreas expected;
+        addAreas(whole, expected);
+
+        VoxelGrid copy;
+        copy = grid;
+        auto job = mesher.submit(std::move(copy), {0, 0, 0}, chunks);
+        mesher.wait();
+        REQUIRE(job->done());
+        REQUIRE(job->chunks() == chunks);
+
+        FaceAreas areas;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            const auto& mesh = job->mesh(i, 0);
+            CHECK(mesh.indices.size() * 4 == mesh.vertices.size() * 6);
+            addAreas(mesh, areas);
+        }
+        CHECK(areas == expected);
+
+        // The size of each chunk covers every one of its levels of detail.
+        std::size_t total = 0;
+        for (std::size_t i = 0; i < chunks.size(); ++i)
+        {
+            std::size_t size = 0;
+            for (std::size_t lod = 0; lod < GridMesher::LodCount; ++lod)
+            {
+                const auto& mesh = job->mesh(i, lod);
+                size += mesh.vertices.size() * sizeof(VoxelVertex) + mesh.indices.size() * sizeof(uint32_t);
+            }
+            CHECK(job->size(i) == size);
+            total += size;
+        }
+        CHECK(total > whole.vertices.size() * sizeof(VoxelVertex));
+    }
+
+    SUBCASE("chunks of a region match chunks of the whole grid")
+    {
+        // A chunk in the middle of the grid only needs its neighbouring voxels to be meshed.
+        glm::ivec3 chunk{GridMesher::ChunkSize, 0, 0};
+        glm::ivec3 min = chunk - GridMesher::ChunkMargin;
+        glm::uvec3 regionSize{GridMesher::ChunkSize + 2 * GridMesher::ChunkMargin, size.y + GridMesher::ChunkMargin,
+                              GridMesher::ChunkSize + 2 * GridMesher::ChunkMargin};
+
+        VoxelGrid copy;
+        copy = grid;
+        auto whole = mesher.submit(std::move(copy), {0, 0, 0}, {chunk});
+        auto region = mesher.submit(VoxelGrid{grid, min, regionSize}, min, {chunk});
+        mesher.wait();
+
+        for (std::size_t lod = 0; lod < GridMesher::LodCount; ++lod)
+        {
+            const auto& expected = whole->mesh(0, lod);
+            const auto& mesh = region->mesh(0, lod);
+            REQUIRE_FALSE(mesh.indices.empty());
+            REQUIRE(mesh.indices == expected.indices);
+            REQUIRE(mesh.vertices.size() == expected.vertices.size());
+            for (std::size_t i = 0; i < mesh.vertices.size(); ++i)
+            {
+                CHECK(mesh.vertices[i].position == expected.vertices[i].position);
+                CHECK(mesh.vertices[i].face == expected.vertices[i].face);
+                CHECK(mesh.vertices[i].material == expected.vertices[i].material);
+            }
+        }
+    }
+
+    SUBCASE("coarser levels of detail have voxels twice as large")
+    {
+        // A solid block of a single material, whose levels of detail are also solid blocks.
+        VoxelGrid block{{16, 8, 4}};
+        for (int x = 0; x < 16; ++x)
+        {
+            for (int y = 0; y < 8; ++y)
+            {
+                for (int z = 0; z < 4; ++z)
+                {
+                    block.set({x, y, z}, 2);
+                }
+            }
+        }
+
+        auto job = mesher.submit(std::move(block), {0, 0, 0}, {{0, 0, 0}});
+        mesher.wait();
+        for (std::size_t lod = 0; lod < GridMesher::LodCount; ++lod)
+        {
+            auto factor = 1U << lod;
+            FaceAreas areas;
+            addAreas(job->mesh(0, lod), areas);
+            CHECK(areas == FaceAreas{{{0, 2}, 8 * 4 / (factor * factor)},
+                                     {{1, 2}, 8 * 4 / (factor * factor)},
+                                     {{2, 2}, 16 * 4 / (factor * factor)},
+                                     {{3, 2}, 16 * 4 / (factor * factor)},
+                                     {{4, 2}, 16 * 8 / (factor * factor)},
+                                     {{5, 2}, 16 * 8 / (factor * factor)}});
+        }
+    }
+
+    SUBCASE("jobs without chunks are done right away")
+    {
+        auto job = mesher.submit(VoxelGrid{}, {0, 0, 0}, {});
+        CHECK(job->done());
+    }
+
+    SUBCASE("cancelled jobs still finish")
+    {
+        auto job = mesher.submit(std::move(grid), {0, 0, 0}, chunks);
+        job->cancel();
+        mesher.wait();
+        CHECK(job->done());
+    }
+}
@@ -0,0 +1,68 @@
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/renderer/vertex.hpp>
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::engine::triangulate;
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelVertex;
+
+TEST_CASE("renderer.vertex")
+{
+    CHECK(sizeof(VoxelVertex) == 8);
+
+    SUBCASE("positions are packed losslessly")
+    {
+        for (uint32_t i = 0; i <= VoxelVertex::MaxCoordinate; i += 31)
+        {
+            glm::uvec3 position{i, VoxelVertex::MaxCoordinate - i, (i * 7) % (VoxelVertex::MaxCoordinate + 1)};
+            VoxelVertex vertex{VoxelVertex::packPosition(position), 0, 0};
+            REQUIRE(vertex.unpackPosition() == position);
+        }
+    }
+
+    SUBCASE("single voxel")
+    {
+        VoxelGrid grid{{3, 3, 3}};
+        grid.set({1, 1, 1}, 5);
+
+        std::vector<VoxelVertex> vertices;
+        std::vector<uint32_t> indices;
+        triangulate(grid, vertices, indices);
+        REQUIRE(vertices.size() == 24);
+        REQUIRE(indices.size() == 36);
+
+        // Every face points away from the voxel, so its vertices lie on the side of the voxel
+        // its normal points to.
+        int faces[6] = {};
+        for (const auto& vertex : vertices)
+        {
+            REQUIRE(vertex.face < 6);
+            CHECK(vertex.material == 5);
+            faces[vertex.face] += 1;
+
+            auto position = vertex.unpackPosition();
+            auto normal = vertex.normal();
+            auto axis = vertex.face / 2;
+            CHECK(position[axis] == (normal[axis] > 0.0F ? 2U : 1U));
+        }
+
+        for (int count : faces)
+        {
+            CHECK(count == 4);
+        }
+    }
+
+    SUBCASE("grids too large to pack are rejected")
+    {
+        VoxelGrid grid{{VoxelVertex::MaxCoordinate + 1, 1, 1}};
+        grid.set({0, 0, 0}, 1);
+
+        std::vector<VoxelVertex> vertices;
+        std::vector<uint32_t> indices;
+        triangulate(grid, vertices, indices);
+        CHECK(vertices.empty());
+        CHECK(indices.empty());
+    }
+}
@@ -0,0 +1,95 @@
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/transform/plugin.hpp>
+
+using cubos::core::ecs::Commands;
+using cubos::core::ecs::Entity;
+using cubos::core::ecs::Query;
+using cubos::core::ecs::Read;
+using cubos::core::ecs::Write;
+using namespace cubos::engine;
+
+/// @brief Entities spawned by the setup system, and the number of frames which have run.
+struct Hierarchy
+{
+    Entity root;
+    Entity child;
+    Entity grandchild;
+    int frame = 0;
+};
+
+static void setup(Commands cmds, Write<Hierarchy> hierarchy)
+{
+    hierarchy->root = cmds.create(Position{{1.0F, 0.0F, 0.0F}}).entity();
+    hierarchy->child = cmds.create(Position{{0.0F, 2.0F, 0.0F}}, Parent{hierarchy->root}).entity();
+    hierarchy->grandchild = cmds.create(Position{{0.0F, 0.0F, 3.0F}}, Parent{hierarchy->child}).entity();
+}
+
+/// @brief Gets the position of an entity in the world.
+/// @param query Query over the local to world matrices.
+/// @param entity Entity.
+/// @return World position.
+static glm::vec3 worldPosition(Query<Read<LocalToWorld>>& query, Entity entity)
+{
+    auto mat = std::get<0>(*query[entity])->mat;
+    return {mat[3][0], mat[3][1], mat[3][2]};
+}
+
+static void check(Commands cmds, Write<Hierarchy> hierarchy, Write<ShouldQuit> quit,
+                  Query<Read<LocalToWorld>> transforms, Query<Write<Position>> positions)
+{
+    switch (hierarchy->frame++)
+    {
+    case 0:
+        // Matrices must already be propagated on the first frame.
+        CHECK(worldPosition(transforms, hierarchy->root) == glm::vec3{1.0F, 0.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->child) == glm::vec3{1.0F, 2.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->grandchild) == glm::vec3{1.0F, 2.0F, 3.0F});
+
+        // Moving the root must move the whole hierarchy.
+        std::get<0>(*positions[hierarchy->root])->vec = {0.0F, 0.0F, 0.0F};
+        quit->value = false;
+        break;
+    case 1:
+        CHECK(worldPosition(transforms, hierarchy->root) == glm::vec3{0.0F, 0.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->child) == glm::vec3{0.0F, 2.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->grandchild) == glm::vec3{0.0F, 2.0F, 3.0F});
+
+        // Moving a child must only move its subtree.
+        std::get<0>(*positions[hierarchy->child])->vec = {0.0F, 4.0F, 0.0F};
+        break;
+    case 2:
+        CHECK(worldPosition(transforms, hierarchy->root) == glm::vec3{0.0F, 0.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->child) == glm::vec3{0.0F, 4.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->grandchild) == glm::vec3{0.0F, 4.0F, 3.0F});
+
+        // Removing the position of a child must place it back on its parent.
+        cmds.remove<Position>(hierarchy->child);
+        break;
+    case 3:
+        CHECK(worldPosition(transforms, hierarchy->root) == glm::vec3{0.0F, 0.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->child) == glm::vec3{0.0F, 0.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->grandchild) == glm::vec3{0.0F, 0.0F, 3.0F});
+
+        // Destroying the root must turn the child into a root, which still follows its position.
+        cmds.destroy(hierarchy->root);
+        cmds.add(hierarchy->child, Position{{0.0F, 1.0F, 0.0F}});
+        break;
+    default:
+        CHECK(worldPosition(transforms, hierarchy->child) == glm::vec3{0.0F, 1.0F, 0.0F});
+        CHECK(worldPosition(transforms, hierarchy->grandchild) == glm::vec3{0.0F, 1.0F, 3.0F});
+        quit->value = true;
+        break;
+    }
+}
+
+TEST_CASE("transform.hierarchy")
+{
+    auto cubos = Cubos{};
+    cubos.addPlugin(transformPlugin);
+    cubos.addResource<Hierarchy>();
+    cubos.startupSystem(setup);
+    cubos.system(check).after("cubos.transform.update");
+    cubos.run();
+}
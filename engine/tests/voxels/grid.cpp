@@ -0,0 +1,348 @@
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/core/data/old/binary_deserializer.hpp>
+#include <cubos/core/data/old/binary_serializer.hpp>
+#include <cubos/core/memory/buffer_stream.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+
+using cubos::core::data::old::BinaryDeserializer;
+using cubos::core::data::old::BinarySerializer;
+using cubos::core::memory::BufferStream;
+using cubos::core::memory::SeekOrigin;
+using cubos::engine::VoxelGrid;
+
+TEST_CASE("voxels.grid")
+{
+    // A size which isn't a multiple of the brick size, so that bricks on the edges are partial.
+    glm::uvec3 size{37, 21, 19};
+    VoxelGrid grid{size};
+    CHECK(grid.size() == size);
+    CHECK(grid.begin() == grid.end());
+
+    // Dense copy of the grid which the grid is checked against.
+    std::vector<uint16_t> reference(static_cast<std::size_t>(size.x) * size.y * size.z, 0);
+    auto index = [&](const glm::ivec3& p) {
+        return static_cast<std::size_t>(p.x) + static_cast<std::size_t>(p.y) * size.x +
+               static_cast<std::size_t>(p.z) * size.x * size.y;
+    };
+
+    auto checkAll = [&]() {
+        for (int z = 0; z < static_cast<int>(size.z); ++z)
+        {
+            for (int y = 0; y < static_cast<int>(size.y); ++y)
+            {
+                for (int x = 0; x < static_cast<int>(size.x); ++x)
+                {
+                    REQUIRE(grid.get({x, y, z}) == reference[index({x, y, z})]);
+                }
+            }
+        }
+
+        // Every non-empty voxel is visited exactly once.
+        std::vector<bool> visited(reference.size(), false);
+        for (const auto& voxel : grid)
+        {
+            REQUIRE(voxel.material != 0);
+            REQUIRE(voxel.material == reference[index(voxel.position)]);
+            REQUIRE_FALSE(visited[index(voxel.position)]);
+            visited[index(voxel.position)] = true;
+        }
+        for (std::size_t i = 0; i < reference.size(); ++i)
+        {
+            REQUIRE(visited[i] == (reference[i] != 0));
+        }
+    };
+
+    std::mt19937 rng{7};
+    std::uniform_int_distribution<int> material{1, 3};
+
+    SUBCASE("sparse set and get")
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            glm::ivec3 p{static_cast<int>(rng() % size.x), static_cast<int>(rng() % size.y),
+                         static_cast<int>(rng() % size.z)};
+            auto mat = static_cast<uint16_t>(i % 5 == 0 ? 0 : material(rng));
+            grid.set(p, mat);
+            reference[index(p)] = mat;
+        }
+        checkAll();
+
+        grid.compact();
+        checkAll();
+    }
+
+    SUBCASE("uniform bricks")
+    {
+        // Fill the grid, then empty a corner, which splits the bricks it touches.
+        for (int z = 0; z < static_cast<int>(size.z); ++z)
+        {
+            for (int y = 0; y < static_cast<int>(size.y); ++y)
+            {
+                for (int x = 0; x < static_cast<int>(size.x); ++x)
+                {
+                    auto mat = static_cast<uint16_t>(x < 5 && y < 5 && z < 5 ? 0 : 2);
+                    grid.set({x, y, z}, mat);
+                    reference[index({x, y, z})] = mat;
+                }
+            }
+        }
+        checkAll();
+
+        grid.compact();
+        checkAll();
+
+        // Copies and grids built from flat data are the same.
+        VoxelGrid copy;
+        copy = grid;
+        VoxelGrid flat{size, reference};
+        for (int z = 0; z < static_cast<int>(size.z); ++z)
+        {
+            for (int y = 0; y < static_cast<int>(size.y); ++y)
+            {
+                for (int x = 0; x < static_cast<int>(size.x); ++x)
+                {
+                    REQUIRE(copy.get({x, y, z}) == reference[index({x, y, z})]);
+                    REQUIRE(flat.get({x, y, z}) == reference[index({x, y, z})]);
+                }
+            }
+        }
+
+        grid.clear();
+        std::fill(reference.begin(), reference.end(), uint16_t{0});
+        checkAll();
+    }
+
+    SUBCASE("serialization")
+    {
+        // Mostly empty terrain, with a few long runs and some noise on top.
+        for (int z = 0; z < static_cast<int>(size.z); ++z)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                for (int y = 0; y < 3 + (x + z) % 4; ++y)
+                {
+                    auto mat = static_cast<uint16_t>(y == 0 ? 1 : 2);
+                    grid.set({x, y, z}, mat);
+                    reference[index({x, y, z})] = mat;
+                }
+            }
+        }
+        for (int i = 0; i < 50; ++i)
+        {
+            glm::ivec3 p{static_cast<int>(rng() % size.x), static_cast<int>(rng() % size.y),
+                         static_cast<int>(rng() % size.z)};
+            grid.set(p, 300);
+            reference[index(p)] = 300;
+        }
+
+        // A solid slab, which is a single run covering whole bricks.
+        for (int z = 8; z < 16; ++z)
+        {
+            for (int y = 0; y < static_cast<int>(size.y); ++y)
+            {
+                for (int x = 0; x < static_cast<int>(size.x); ++x)
+                {
+                    grid.set({x, y, z}, 3);
+                    reference[index({x, y, z})] = 3;
+                }
+            }
+        }
+
+        BufferStream stream{};
+        BinarySerializer serializer{stream};
+        serializer.write(grid, nullptr);
+        serializer.write(uint32_t{0xDEADBEEF}, nullptr);
+        REQUIRE_FALSE(serializer.failed());
+
+        // Much smaller than two bytes per voxel.
+        CHECK(stream.tell() * 8 < reference.size() * sizeof(uint16_t));
+
+        stream.seek(0, SeekOrigin::Begin);
+        BinaryDeserializer deserializer{stream};
+        grid = VoxelGrid{};
+        deserializer.read(grid);
+        uint32_t sentinel = 0;
+        deserializer.read(sentinel);
+        REQUIRE_FALSE(deserializer.failed());
+        CHECK(sentinel == 0xDEADBEEF);
+        CHECK(grid.size() == size);
+        checkAll();
+
+        // An empty grid is written as a handful of words.
+        VoxelGrid empty{{64, 64, 64}};
+        BufferStream emptyStream{};
+        BinarySerializer emptySerializer{emptyStream};
+        emptySerializer.write(empty, nullptr);
+        CHECK(emptyStream.tell() < 64);
+    }
+
+    SUBCASE("legacy serialization")
+    {
+        // Grids used to be written as their size followed by a flat array of material indices.
+        for (std::size_t i = 0; i < reference.size(); ++i)
+        {
+            reference[i] = static_cast<uint16_t>(rng() % 4 == 0 ? rng() % 8 : 0);
+        }
+
+        BufferStream stream{};
+        BinarySerializer serializer{stream};
+        serializer.beginObject(nullptr);
+        serializer.write(size, "size");
+        serializer.write(reference, "data");
+        serializer.endObject();
+        serializer.write(uint32_t{0xDEADBEEF}, nullptr);
+        REQUIRE_FALSE(serializer.failed());
+
+        stream.seek(0, SeekOrigin::Begin);
+        BinaryDeserializer deserializer{stream};
+        deserializer.read(grid);
+        uint32_t sentinel = 0;
+        deserializer.read(sentinel);
+        REQUIRE_FALSE(deserializer.failed());
+        CHECK(sentinel == 0xDEADBEEF);
+        CHECK(grid.size() == size);
+        checkAll();
+    }
+
+    SUBCASE("malformed serialization")
+    {
+        // Writes a grid header followed by a few words of runs, and then a sentinel.
+        auto write = [](BufferStream& stream, uint8_t version, glm::uvec3 size) {
+            BinarySerializer serializer{stream};
+            serializer.beginObject(nullptr);
+            serializer.write(uint32_t{0}, "tag");
+            serializer.write(version, "version");
+            serializer.write(size, "size");
+            serializer.write(uint8_t{1}, "materialBits");
+            serializer.write(uint8_t{4}, "lengthBits");
+            serializer.beginArray(4, "runs");
+            for (int i = 0; i < 4; ++i)
+            {
+                serializer.writeU64(~uint64_t{0}, nullptr);
+            }
+            serializer.endArray();
+            serializer.endObject();
+            serializer.write(uint32_t{0xDEADBEEF}, nullptr);
+            REQUIRE_FALSE(serializer.failed());
+        };
+
+        // Sizes which would overflow, which are too large, or which the words can't cover, must
+        // be rejected without allocating them, and unsupported versions must be skipped whole.
+        for (int version : {1, 2})
+        {
+            for (auto badSize : {glm::uvec3{UINT32_MAX, 1, 1}, glm::uvec3{1 << 12}, glm::uvec3{64}})
+            {
+                BufferStream stream{};
+                write(stream, static_cast<uint8_t>(version), badSize);
+                stream.seek(0, SeekOrigin::Begin);
+                BinaryDeserializer deserializer{stream};
+                deserializer.read(grid);
+                uint32_t sentinel = 0;
+                deserializer.read(sentinel);
+                CHECK(sentinel == 0xDEADBEEF);
+                CHECK(grid.size() == glm::uvec3{1, 1, 1});
+                CHECK(grid.get({0, 0, 0}) == 0);
+            }
+        }
+
+        // The same words are enough for a small grid.
+        BufferStream small{};
+        write(small, 1, {16, 1, 1});
+        small.seek(0, SeekOrigin::Begin);
+        BinaryDeserializer smallDeserializer{small};
+        smallDeserializer.read(grid);
+        CHECK(grid.size() == glm::uvec3{16, 1, 1});
+        CHECK(grid.get({15, 0, 0}) == 1);
+    }
+
+    SUBCASE("revisions")
+    {
+        auto revision = grid.revision();
+        glm::ivec3 all{static_cast<int>(size.x), static_cast<int>(size.y), static_cast<int>(size.z)};
+        CHECK_FALSE(grid.changedSince({0, 0, 0}, all, revision));
+
+        // Setting a voxel to its current material isn't a change.
+        grid.set({10, 10, 10}, 0);
+        CHECK(grid.revision() == revision);
+
+        // Only the brick of a changed voxel is marked.
+        grid.set({10, 10, 10}, 1);
+        CHECK(grid.revision() > revision);
+        CHECK(grid.changedSince({0, 0, 0}, all, revision));
+        CHECK(grid.changedSince({10, 10, 10}, {11, 11, 11}, revision));
+        CHECK(grid.changedSince({15, 15, 15}, {40, 40, 40}, revision));
+        CHECK_FALSE(grid.changedSince({16, 0, 0}, all, revision));
+        CHECK_FALSE(grid.changedSince({-10, -10, -10}, {8, 8, 8}, revision));
+        CHECK_FALSE(grid.changedSince({10, 10, 10}, {11, 11, 11}, grid.revision()));
+
+        // Compacting doesn't change any voxel.
+        revision = grid.revision();
+        grid.compact();
+        CHECK_FALSE(grid.changedSince({0, 0, 0}, all, revision));
+
+        // Copies may diverge, so every voxel of a copy is newer than any revision of the original.
+        VoxelGrid copy;
+        copy = grid;
+        grid.set({0, 0, 0}, 2);
+        CHECK(copy.revision() > grid.revision());
+        CHECK(copy.changedSince({30, 16, 16}, all, grid.revision()));
+
+        // The same goes for resets.
+        revision = grid.revision();
+        grid.clear();
+        CHECK(grid.changedSince({30, 16, 16}, all, revision));
+    }
+
+    SUBCASE("region copies")
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            glm::ivec3 p{static_cast<int>(rng() % size.x), static_cast<int>(rng() % size.y),
+                         static_cast<int>(rng() % size.z)};
+            auto mat = static_cast<uint16_t>(material(rng));
+            grid.set(p, mat);
+            reference[index(p)] = mat;
+        }
+
+        // The region goes past the grid on some axes, where it's left empty.
+        glm::ivec3 min{-3, 5, 9};
+        glm::uvec3 regionSize{20, 10, 15};
+        VoxelGrid region{grid, min, regionSize};
+        REQUIRE(region.size() == regionSize);
+        for (int z = 0; z < static_cast<int>(regionSize.z); ++z)
+        {
+            for (int y = 0; y < static_cast<int>(regionSize.y); ++y)
+            {
+                for (int x = 0; x < static_cast<int>(regionSize.x); ++x)
+                {
+                    auto p = min + glm::ivec3{x, y, z};
+                    bool inside = p.x >= 0 && p.z < static_cast<int>(size.z);
+                    REQUIRE(region.get({x, y, z}) == (inside ? reference[index(p)] : 0));
+                }
+            }
+        }
+    }
+
+    SUBCASE("resize")
+    {
+        grid.set({1, 2, 3}, 1);
+        grid.setSize({3, 3, 3});
+        CHECK(grid.size() == glm::uvec3{3, 3, 3});
+        CHECK(grid.get({1, 2, 2}) == 0);
+        CHECK(grid.begin() == grid.end());
+
+        grid.set({2, 2, 2}, 4);
+        auto it = grid.begin();
+        REQUIRE(it != grid.end());
+        CHECK(it->position == glm::ivec3{2, 2, 2});
+        CHECK(it->material == 4);
+        CHECK(++it == grid.end());
+    }
+}
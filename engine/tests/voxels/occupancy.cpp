@@ -0,0 +1,175 @@
+#include <cmath>
+#include <random>
+
+#include <doctest/doctest.h>
+#include <glm/glm.hpp>
+
+#include <cubos/engine/voxels/grid.hpp>
+#include <cubos/engine/voxels/occupancy.hpp>
+
+using cubos::engine::VoxelGrid;
+using cubos::engine::VoxelHit;
+using cubos::engine::VoxelOccupancy;
+
+/// @brief Finds the parameter at which a ray enters a box, by brute force.
+/// @return Entry parameter, zero if the origin is inside the box, or infinity if it's missed.
+static float enterBox(const glm::vec3& min, const glm::vec3& max, const glm::vec3& origin, const glm::vec3& direction)
+{
+    float enter = 0.0F;
+    float exit = INFINITY;
+    for (glm::length_t i = 0; i < 3; ++i)
+    {
+        if (direction[i] == 0.0F)
+        {
+            if (origin[i] <= min[i] || origin[i] >= max[i])
+            {
+                return INFINITY;
+            }
+            continue;
+        }
+
+        float a = (min[i] - origin[i]) / direction[i];
+        float b = (max[i] - origin[i]) / direction[i];
+        enter = std::max(enter, std::min(a, b));
+        exit = std::min(exit, std::max(a, b));
+    }
+    return enter < exit ? enter : INFINITY;
+}
+
+TEST_CASE("voxels.occupancy")
+{
+    // A grid whose size isn't a multiple of the brick or region sizes, mostly empty so that the
+    // traversal has space to skip, with a denser block in a corner.
+    glm::uvec3 size{37, 21, 19};
+    VoxelGrid grid{size};
+    std::mt19937 rng{42};
+    std::uniform_real_distribution<float> unit{0.0F, 1.0F};
+    int solid = 0;
+    for (int z = 0; z < static_cast<int>(size.z); ++z)
+    {
+        for (int y = 0; y < static_cast<int>(size.y); ++y)
+        {
+            for (int x = 0; x < static_cast<int>(size.x); ++x)
+            {
+                float chance = x > 25 && y > 12 ? 0.5F : 0.01F;
+                if (unit(rng) < chance)
+                {
+                    grid.set({x, y, z}, 1);
+                    ++solid;
+                }
+            }
+        }
+    }
+
+    VoxelOccupancy occupancy{grid};
+    CHECK(occupancy.size() == size);
+
+    SUBCASE("get")
+    {
+        for (int z = -1; z <= static_cast<int>(size.z); ++z)
+        {
+            for (int y = -1; y <= static_cast<int>(size.y); ++y)
+            {
+                for (int x = -1; x <= static_cast<int>(size.x); ++x)
+                {
+                    bool inside = x >= 0 && y >= 0 && z >= 0 && x < static_cast<int>(size.x) &&
+                                  y < static_cast<int>(size.y) && z < static_cast<int>(size.z);
+                    REQUIRE(occupancy.get({x, y, z}) == (inside && grid.get({x, y, z}) != 0));
+                }
+            }
+        }
+    }
+
+    SUBCASE("range queries")
+    {
+        int count = 0;
+        occupancy.forEach({-5, -5, -5}, {100, 100, 100}, [&](const glm::ivec3& voxel) {
+            CHECK(grid.get(voxel) != 0);
+            ++count;
+        });
+        CHECK(count == solid);
+
+        for (int i = 0; i < 200; ++i)
+        {
+            glm::ivec3 min{static_cast<int>(unit(rng) * 40.0F) - 2, static_cast<int>(unit(rng) * 24.0F) - 2,
+                           static_cast<int>(unit(rng) * 22.0F) - 2};
+            glm::ivec3 max = min + glm::ivec3{static_cast<int>(unit(rng) * 10.0F), static_cast<int>(unit(rng) * 10.0F),
+                                              static_cast<int>(unit(rng) * 10.0F)};
+
+            int expected = 0;
+            for (int z = min.z; z < max.z; ++z)
+            {
+                for (int y = min.y; y < max.y; ++y)
+                {
+                    for (int x = min.x; x < max.x; ++x)
+                    {
+                        expected += occupancy.get({x, y, z}) ? 1 : 0;
+                    }
+                }
+            }
+
+            int found = 0;
+            occupancy.forEach(min, max, [&](const glm::ivec3& /*voxel*/) { ++found; });
+            REQUIRE(found == expected);
+            REQUIRE(occupancy.any(min, max) == (expected > 0));
+        }
+    }
+
+    SUBCASE("raycast")
+    {
+        for (int i = 0; i < 500; ++i)
+        {
+            glm::vec3 origin{unit(rng) * 60.0F - 10.0F, unit(rng) * 40.0F - 10.0F, unit(rng) * 40.0F - 10.0F};
+            glm::vec3 direction{unit(rng) - 0.5F, unit(rng) - 0.5F, unit(rng) - 0.5F};
+            if (i % 10 == 0)
+            {
+                // Axis-aligned rays have directions with zero components.
+                direction = glm::vec3{0.0F};
+                direction[i % 3] = i % 20 == 0 ? 1.0F : -1.0F;
+            }
+
+            float expected = INFINITY;
+            occupancy.forEach({0, 0, 0}, glm::ivec3{size}, [&](const glm::ivec3& voxel) {
+                expected = std::min(expected, enterBox(glm::vec3{voxel}, glm::vec3{voxel} + 1.0F, origin, direction));
+            });
+
+            VoxelHit hit;
+            bool found = occupancy.raycast(origin, direction, 100.0F, hit);
+            REQUIRE(found == (expected <= 100.0F));
+            if (found)
+            {
+                CHECK(hit.distance == doctest::Approx(expected).epsilon(1e-3));
+                CHECK(occupancy.get(hit.voxel));
+
+                auto point = origin + direction * hit.distance;
+                CHECK(enterBox(glm::vec3{hit.voxel} - 1e-3F, glm::vec3{hit.voxel} + 1.001F, point, direction) == 0.0F);
+            }
+        }
+    }
+
+    SUBCASE("boxcast")
+    {
+        for (int i = 0; i < 300; ++i)
+        {
+            glm::vec3 halfSize{unit(rng) * 2.0F + 0.1F, unit(rng) * 2.0F + 0.1F, unit(rng) * 2.0F + 0.1F};
+            glm::vec3 origin{unit(rng) * 60.0F - 10.0F, unit(rng) * 40.0F - 10.0F, unit(rng) * 40.0F - 10.0F};
+            glm::vec3 direction{unit(rng) - 0.5F, unit(rng) - 0.5F, unit(rng) - 0.5F};
+
+            // The box hits a voxel when its center enters the voxel grown by the box's size.
+            float expected = INFINITY;
+            occupancy.forEach({0, 0, 0}, glm::ivec3{size}, [&](const glm::ivec3& voxel) {
+                expected = std::min(expected, enterBox(glm::vec3{voxel} - halfSize, glm::vec3{voxel} + 1.0F + halfSize,
+                                                       origin, direction));
+            });
+
+            VoxelHit hit;
+            bool found = occupancy.boxcast(halfSize, origin, direction, 100.0F, hit);
+            REQUIRE(found == (expected <= 100.0F));
+            if (found)
+            {
+                CHECK(hit.distance == doctest::Approx(expected).epsilon(1e-3));
+                CHECK(occupancy.get(hit.voxel));
+            }
+        }
+    }
+}
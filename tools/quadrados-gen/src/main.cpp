@@ -792,9 +792,11 @@ static bool generate(const GenerateOptions& options)
     file << "/// Do not edit this file." << std::endl;
     file << std::endl;
     file << "#include <cubos/core/ecs/registry.hpp>" << std::endl;
+    file << "#include <cubos/core/ecs/archetype_storage.hpp>" << std::endl;
     file << "#include <cubos/core/ecs/vec_storage.hpp>" << std::endl;
     file << "#include <cubos/core/ecs/map_storage.hpp>" << std::endl;
     file << "#include <cubos/core/ecs/null_storage.hpp>" << std::endl;
+    file << "#include <cubos/core/ecs/sparse_set_storage.hpp>" << std::endl;
     file << std::endl;
 
     // Include all the component headers.